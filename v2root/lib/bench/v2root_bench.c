@@ -0,0 +1,440 @@
+/*
+ * Benchmark harness for the V2ROOT native library.
+ *
+ * Runs a corpus of VLESS, VMess and Shadowsocks share links through the parsers, the base64
+ * decoder, the validators and the in-memory config renderer, then probes a loopback mock
+ * upstream with probe_config_quick and, when a V2Ray binary is given, times the V2Ray process
+ * lifecycle behind every full probe: start from an in-memory config, inbound ready, stop.
+ *
+ * Build and run with `make -f Makefile.linux bench` (or Makefile.win). Pass options through
+ * BENCH_ARGS, e.g. `make -f Makefile.linux bench BENCH_ARGS="--iterations 50000 --v2ray v2ray"`.
+ *
+ * Options:
+ *   --iterations N   Operations per micro benchmark (default BENCH_DEFAULT_ITERATIONS).
+ *   --filter TEXT    Only run benchmarks whose name contains TEXT.
+ *   --v2ray PATH     Enables the v2ray_lifecycle scenario (Linux always uses v2ray in PATH).
+ *
+ * test_config_connection itself is not benchmarked: it requests PRIMARY_PROBE_URL over TLS
+ * through the node, which cannot be served from the loopback mock, so every op would time
+ * the failure path instead of the library.
+ *
+ * Every benchmark prints one JSON object per line on stdout:
+ *   {"bench":"parse_vless","ops":20000,"failures":0,"ns_per_op":812.4,"allocs_per_op":9.00,
+ *    "p50_ns":790,"p99_ns":1210}
+ *
+ * Allocations are counted by linking with -Wl,--wrap for malloc, calloc, realloc and strdup
+ * and by routing jansson and cJSON through the same counters.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <jansson.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include "cJSON.h"
+#include "libv2root_common.h"
+#include "libv2root_base64.h"
+#include "libv2root_config.h"
+#include "libv2root_core.h"
+#include "libv2root_log.h"
+#include "libv2root_manage.h"
+#include "libv2root_shadowsocks.h"
+#include "libv2root_utils.h"
+#include "libv2root_vless.h"
+#include "libv2root_vmess.h"
+
+#ifdef _WIN32
+#include "libv2root_win.h"
+#define bench_stop_v2ray win_stop_v2ray_process
+#else
+#include "libv2root_linux.h"
+#define bench_stop_v2ray linux_stop_v2ray_process
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS 20000
+#define BENCH_PROBE_DIVISOR 10              /* Quick probes run iterations / BENCH_PROBE_DIVISOR */
+#define BENCH_LIFECYCLE_OPS 20              /* Every op starts and stops a V2Ray process */
+#define BENCH_HTTP_PORT 10808
+#define BENCH_SOCKS_PORT 10809
+
+#ifdef _WIN32
+#define BENCH_NULL_DEVICE "NUL"
+typedef SOCKET bench_socket_t;
+#define BENCH_CLOSE_SOCKET closesocket
+#define BENCH_INVALID_SOCKET INVALID_SOCKET
+#else
+#define BENCH_NULL_DEVICE "/dev/null"
+typedef int bench_socket_t;
+#define BENCH_CLOSE_SOCKET close
+#define BENCH_INVALID_SOCKET (-1)
+#endif
+
+/* Corpus of share links as they appear in public subscriptions */
+static const char* vless_fixtures[] = {
+    "vless://b831381d-6324-4d53-ad4f-8cda48b30811@fra1.example-node.net:443?encryption=none&security=tls"
+    "&sni=fra1.example-node.net&fp=chrome&alpn=h2%2Chttp%2F1.1&type=ws&host=fra1.example-node.net"
+    "&path=%2Fvless%3Fed%3D2048#DE%20Frankfurt%2001",
+    "vless://6f1c3b52-9a0e-4d2b-8e71-2f5d9c0a4b17@203.0.113.24:443?encryption=none&flow=xtls-rprx-vision"
+    "&security=reality&sni=www.microsoft.com&fp=chrome&pbk=SbVKOEMjK0sIlbwg4akyBg5mL5KZwwB-ed4eEE7YnRc"
+    "&sid=6ba85179e30d4fc2&type=tcp&headerType=none#NL%20Reality",
+    "vless://0b6d5c7e-3a2f-4e1d-9c8b-7a6f5e4d3c2b@cdn.example.org:2053?encryption=none&security=tls"
+    "&sni=cdn.example.org&type=grpc&serviceName=vlgrpc&mode=gun#grpc-edge",
+    "vless://a3f0e2d1-5b4c-4a39-8e27-1d0c9b8a7f6e@[2001:db8::25]:8443?encryption=none&security=none"
+    "&type=tcp&headerType=http&host=speedtest.example.net&path=%2F#v6-http",
+};
+
+static const char* vmess_fixtures[] = {
+    "vmess://eyJ2IjoiMiIsInBzIjoiZGUtZnJhLTAxIiwiYWRkIjoiZnJhMS5leGFtcGxlLW5vZGUubmV0IiwicG9ydCI6IjQ0MyIsImlkIjoi"
+    "YjgzMTM4MWQtNjMyNC00ZDUzLWFkNGYtOGNkYTQ4YjMwODExIiwiYWlkIjoiMCIsInNjeSI6ImF1dG8iLCJuZXQiOiJ3cyIsInR5cGUi"
+    "OiJub25lIiwiaG9zdCI6ImZyYTEuZXhhbXBsZS1ub2RlLm5ldCIsInBhdGgiOiIvcmF5IiwidGxzIjoidGxzIiwic25pIjoiZnJhMS5l"
+    "eGFtcGxlLW5vZGUubmV0IiwiYWxwbiI6ImgyLGh0dHAvMS4xIiwiZnAiOiJjaHJvbWUifQ==",
+    "vmess://eyJ2IjoiMiIsInBzIjoibmwtZ3JwYyIsImFkZCI6IjIwMy4wLjExMy4yNCIsInBvcnQiOjg0NDMsImlkIjoiNmYxYzNiNTItOWEw"
+    "ZS00ZDJiLThlNzEtMmY1ZDljMGE0YjE3IiwiYWlkIjowLCJzY3kiOiJhZXMtMTI4LWdjbSIsIm5ldCI6ImdycGMiLCJ0eXBlIjoiZ3Vu"
+    "Iiwic2VydmljZU5hbWUiOiJ2bWdycGMiLCJ0bHMiOiJ0bHMiLCJzbmkiOiJjZG4uZXhhbXBsZS5vcmcifQ==",
+};
+
+static const char* ss_fixtures[] = {
+    "ss://Y2hhY2hhMjAtaWV0Zi1wb2x5MTMwNTpabTl2WW1GeVltRjZjWFY0@198.51.100.7:8388#SG%20ss",
+    "ss://YWVzLTI1Ni1nY206cDRzc3cwcmQtMjAyNEAxOTguNTEuMTAwLjc6ODM4OA==#legacy",
+    "ss://aes-256-gcm:password123@server.example.com:8388?plugin=v2ray-plugin&plugin-opts=tls%3Bhost%3Dserver.example.com#plugin",
+};
+
+static const char* address_fixtures[] = {
+    "fra1.example-node.net", "203.0.113.24", "cdn.example.org", "2001:db8::25",
+    "198.51.100.7", "a.very.long.subdomain.chain.of.an.example-provider.co.uk",
+};
+
+static const char* uuid_fixtures[] = {
+    "b831381d-6324-4d53-ad4f-8cda48b30811", "6f1c3b52-9a0e-4d2b-8e71-2f5d9c0a4b17",
+    "0b6d5c7e-3a2f-4e1d-9c8b-7a6f5e4d3c2b", "A3F0E2D1-5B4C-4A39-8E27-1D0C9B8A7F6E",
+};
+
+#define FIXTURE_COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+/* Allocation counter fed by the --wrap shims and the JSON library hooks */
+static long long alloc_count = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+char* __real_strdup(const char* str);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+char* __wrap_strdup(const char* str) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_strdup(str);
+}
+
+/* The JSON libraries are shared objects, so their allocations bypass --wrap without these */
+static void* counting_malloc(size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+static void counting_free(void* ptr) {
+    free(ptr);
+}
+
+static long long now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (long long)((double)counter.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+static int compare_ns(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static long long percentile_ns(const long long* sorted, int count, int percentile) {
+    int rank = (count * percentile + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+/* One operation of a benchmark; returns 0 on success */
+typedef int (*BenchFn)(void* arg, int i);
+
+static const char* bench_filter = NULL;
+
+/*
+ * Runs fn ops times after a short warm-up and prints its JSON result line.
+ */
+static void run_bench(const char* name, BenchFn fn, void* arg, int ops) {
+    if (bench_filter && !strstr(name, bench_filter)) return;
+    if (ops < 1) ops = 1;
+    long long* samples = malloc((size_t)ops * sizeof(long long));
+    if (!samples) {
+        fprintf(stderr, "bench: out of memory for %s\n", name);
+        return;
+    }
+    int warmup = ops >= 100 ? ops / 100 : 0;
+    for (int i = 0; i < warmup; i++) fn(arg, i);
+
+    int failures = 0;
+    long long allocs_before = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    long long start = now_ns();
+    for (int i = 0; i < ops; i++) {
+        long long op_start = now_ns();
+        if (fn(arg, i) != 0) failures++;
+        samples[i] = now_ns() - op_start;
+    }
+    long long elapsed = now_ns() - start;
+    long long allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED) - allocs_before;
+
+    qsort(samples, (size_t)ops, sizeof(long long), compare_ns);
+    printf("{\"bench\":\"%s\",\"ops\":%d,\"failures\":%d,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,"
+           "\"p50_ns\":%lld,\"p99_ns\":%lld}\n",
+           name, ops, failures, (double)elapsed / ops, (double)allocs / ops,
+           percentile_ns(samples, ops, 50), percentile_ns(samples, ops, 99));
+    fflush(stdout);
+    free(samples);
+}
+
+/* Parser benchmarks write the generated config to the null device */
+static FILE* sink = NULL;
+
+static int bench_parse_vless(void* arg, int i) {
+    (void)arg;
+    return parse_vless_string(vless_fixtures[i % FIXTURE_COUNT(vless_fixtures)], sink, BENCH_HTTP_PORT, BENCH_SOCKS_PORT);
+}
+
+static int bench_parse_vmess(void* arg, int i) {
+    (void)arg;
+    return parse_vmess_string(vmess_fixtures[i % FIXTURE_COUNT(vmess_fixtures)], sink, BENCH_HTTP_PORT, BENCH_SOCKS_PORT);
+}
+
+static int bench_parse_shadowsocks(void* arg, int i) {
+    (void)arg;
+    return parse_shadowsocks_string(ss_fixtures[i % FIXTURE_COUNT(ss_fixtures)], sink, BENCH_HTTP_PORT, BENCH_SOCKS_PORT);
+}
+
+static int bench_base64_decode(void* arg, int i) {
+    (void)arg;
+    const char* payload = vmess_fixtures[i % FIXTURE_COUNT(vmess_fixtures)] + strlen("vmess://");
+    unsigned char out[1024];
+    return base64_decode_into(payload, strlen(payload), out, sizeof(out)) < 0 ? -1 : 0;
+}
+
+static int bench_validate_address(void* arg, int i) {
+    (void)arg;
+    return validate_address(address_fixtures[i % FIXTURE_COUNT(address_fixtures)]) ? 0 : -1;
+}
+
+static int bench_validate_uuid(void* arg, int i) {
+    (void)arg;
+    return validate_uuid(uuid_fixtures[i % FIXTURE_COUNT(uuid_fixtures)]) ? 0 : -1;
+}
+
+/* Whole corpus in one rotation, for the config-emit benchmark */
+static const char* render_fixtures[FIXTURE_COUNT(vless_fixtures) + FIXTURE_COUNT(vmess_fixtures) + FIXTURE_COUNT(ss_fixtures)];
+
+static int bench_render_config(void* arg, int i) {
+    (void)arg;
+    ConfigBuffer config;
+    if (render_config_buffer(render_fixtures[i % FIXTURE_COUNT(render_fixtures)], BENCH_HTTP_PORT, BENCH_SOCKS_PORT, &config) != 0) {
+        return -1;
+    }
+    config_buffer_free(&config);
+    return 0;
+}
+
+/*
+ * Loopback mock upstream: accepts connections, answers any request with an empty 204 and
+ * closes, so probes measure the library rather than a remote network.
+ */
+typedef struct {
+    bench_socket_t listener;
+    int port;
+    int stopping;
+    pthread_t thread;
+} MockUpstream;
+
+static void* mock_upstream_main(void* arg) {
+    MockUpstream* mock = (MockUpstream*)arg;
+    static const char response[] = "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    while (!__atomic_load_n(&mock->stopping, __ATOMIC_ACQUIRE)) {
+        bench_socket_t client = accept(mock->listener, NULL, NULL);
+        if (client == BENCH_INVALID_SOCKET) continue;
+        char request[2048];
+        if (recv(client, request, sizeof(request), 0) > 0) {
+            send(client, response, (int)(sizeof(response) - 1), 0);
+        }
+        BENCH_CLOSE_SOCKET(client);
+    }
+    return NULL;
+}
+
+static int mock_upstream_start(MockUpstream* mock) {
+    memset(mock, 0, sizeof(*mock));
+    mock->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (mock->listener == BENCH_INVALID_SOCKET) return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (bind(mock->listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(mock->listener, 128) != 0 ||
+        getsockname(mock->listener, (struct sockaddr*)&addr, &len) != 0) {
+        BENCH_CLOSE_SOCKET(mock->listener);
+        return -1;
+    }
+    mock->port = ntohs(addr.sin_port);
+    if (pthread_create(&mock->thread, NULL, mock_upstream_main, mock) != 0) {
+        BENCH_CLOSE_SOCKET(mock->listener);
+        return -1;
+    }
+    return 0;
+}
+
+static void mock_upstream_stop(MockUpstream* mock) {
+    __atomic_store_n(&mock->stopping, 1, __ATOMIC_RELEASE);
+    /* Wake the blocked accept with one last connection */
+    bench_socket_t wake = socket(AF_INET, SOCK_STREAM, 0);
+    if (wake != BENCH_INVALID_SOCKET) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons((unsigned short)mock->port);
+        connect(wake, (struct sockaddr*)&addr, sizeof(addr));
+        BENCH_CLOSE_SOCKET(wake);
+    }
+    pthread_join(mock->thread, NULL);
+    BENCH_CLOSE_SOCKET(mock->listener);
+}
+
+static int bench_probe_quick(void* arg, int i) {
+    (void)i;
+    ProbeResult result;
+    return probe_config_quick((const char*)arg, &result, 0, 0) == 0 && result.success ? 0 : -1;
+}
+
+/* Counts ops in which V2Ray started from the rendered config, accepted on its inbound and stopped */
+static int bench_v2ray_lifecycle(void* arg, int i) {
+    (void)i;
+    ConfigBuffer config;
+    if (render_config_buffer((const char*)arg, BENCH_HTTP_PORT, BENCH_SOCKS_PORT, &config) != 0) return -1;
+    PID_TYPE pid = 0;
+    int rc = start_v2ray_from_buffer(&config, &pid);
+    if (rc == 0 && pid != 0) {
+        rc = wait_for_v2ray_ready(pid, BENCH_HTTP_PORT);
+        if (bench_stop_v2ray(pid) != 0) rc = -1;
+    } else {
+        rc = -1;
+    }
+    config_buffer_free(&config);
+    return rc == 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    const char* v2ray_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            bench_filter = argv[++i];
+        } else if (strcmp(argv[i], "--v2ray") == 0 && i + 1 < argc) {
+            v2ray_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--filter TEXT] [--v2ray PATH]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations < 1) iterations = BENCH_DEFAULT_ITERATIONS;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        fprintf(stderr, "bench: WSAStartup failed\n");
+        return 1;
+    }
+#endif
+    json_set_alloc_funcs(counting_malloc, counting_free);
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    cJSON_InitHooks(&hooks);
+    v2root_set_log_level(LOG_LEVEL_ERROR);
+
+    sink = fopen(BENCH_NULL_DEVICE, "w");
+    if (!sink) {
+        fprintf(stderr, "bench: cannot open %s\n", BENCH_NULL_DEVICE);
+        return 1;
+    }
+    int n = 0;
+    for (int i = 0; i < FIXTURE_COUNT(vless_fixtures); i++) render_fixtures[n++] = vless_fixtures[i];
+    for (int i = 0; i < FIXTURE_COUNT(vmess_fixtures); i++) render_fixtures[n++] = vmess_fixtures[i];
+    for (int i = 0; i < FIXTURE_COUNT(ss_fixtures); i++) render_fixtures[n++] = ss_fixtures[i];
+
+    run_bench("parse_vless", bench_parse_vless, NULL, iterations);
+    run_bench("parse_vmess", bench_parse_vmess, NULL, iterations);
+    run_bench("parse_shadowsocks", bench_parse_shadowsocks, NULL, iterations);
+    run_bench("base64_decode", bench_base64_decode, NULL, iterations);
+    run_bench("validate_address", bench_validate_address, NULL, iterations);
+    run_bench("validate_uuid", bench_validate_uuid, NULL, iterations);
+    run_bench("render_config", bench_render_config, NULL, iterations);
+    fclose(sink);
+
+    MockUpstream mock;
+    if (mock_upstream_start(&mock) != 0) {
+        fprintf(stderr, "bench: cannot start the loopback mock upstream\n");
+        return 1;
+    }
+    char mock_config[256];
+    snprintf(mock_config, sizeof(mock_config),
+             "vless://b831381d-6324-4d53-ad4f-8cda48b30811@127.0.0.1:%d?encryption=none&security=none&type=tcp#mock",
+             mock.port);
+    run_bench("probe_quick_loopback", bench_probe_quick, mock_config, iterations / BENCH_PROBE_DIVISOR);
+
+    if (v2ray_path) {
+        if (init_v2ray("v2root_bench_config.json", v2ray_path) != 0) {
+            fprintf(stderr, "bench: V2Ray not available, skipping v2ray_lifecycle\n");
+        } else {
+            run_bench("v2ray_lifecycle", bench_v2ray_lifecycle, mock_config, BENCH_LIFECYCLE_OPS);
+        }
+    }
+    mock_upstream_stop(&mock);
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
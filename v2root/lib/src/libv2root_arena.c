@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <jansson.h>
+
+#include "cJSON.h"
+#include "libv2root_common.h"
+#include "libv2root_arena.h"
+#include "libv2root_utils.h"
+
+struct ArenaBlock {
+    ArenaBlock* prev;               /* Older block of the chain, or next spare block */
+    size_t size;                    /* Usable bytes after the header */
+    size_t used;
+};
+
+#define ARENA_HEADER (((sizeof(ArenaBlock) + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN)
+#define ARENA_DATA(block) ((char*)(block) + ARENA_HEADER)
+
+typedef struct {
+    ArenaBlock* current;            /* Newest block in use, NULL outside all scopes */
+    ArenaBlock* spare;              /* Released blocks kept for reuse */
+    size_t retained;                /* Usable bytes of every block the arena owns */
+    int depth;                      /* Open scopes */
+    int json_suspended;             /* 1 while JSON allocations bypass the arena */
+} Arena;
+
+static THREAD_LOCAL Arena* thread_arena = NULL;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static pthread_key_t arena_key;
+static json_malloc_t json_prev_malloc = malloc;
+static json_free_t json_prev_free = free;
+
+static int arena_owns(const Arena* arena, const void* ptr) {
+    const char* p = (const char*)ptr;
+    for (int chain = 0; chain < 2; chain++) {
+        for (const ArenaBlock* b = chain == 0 ? arena->current : arena->spare; b; b = b->prev) {
+            if (p >= ARENA_DATA(b) && p < ARENA_DATA(b) + b->size) return 1;
+        }
+    }
+    return 0;
+}
+
+static void* arena_json_malloc(size_t size) {
+    Arena* arena = thread_arena;
+    if (arena && arena->depth > 0 && !arena->json_suspended) {
+        void* ptr = arena_alloc(size);
+        if (ptr) return ptr;
+    }
+    return json_prev_malloc(size);
+}
+
+static void arena_json_free(void* ptr) {
+    if (!ptr) return;
+    Arena* arena = thread_arena;
+    if (arena && arena_owns(arena, ptr)) return;
+    json_prev_free(ptr);
+}
+
+static void* arena_cjson_malloc(size_t size) {
+    Arena* arena = thread_arena;
+    if (arena && arena->depth > 0 && !arena->json_suspended) {
+        void* ptr = arena_alloc(size);
+        if (ptr) return ptr;
+    }
+    return malloc(size);
+}
+
+static void arena_cjson_free(void* ptr) {
+    if (!ptr) return;
+    Arena* arena = thread_arena;
+    if (arena && arena_owns(arena, ptr)) return;
+    free(ptr);
+}
+
+/* Thread exit: returns every block of the thread's arena */
+static void arena_destroy(void* value) {
+    Arena* arena = (Arena*)value;
+    for (int chain = 0; chain < 2; chain++) {
+        ArenaBlock* b = chain == 0 ? arena->current : arena->spare;
+        while (b) {
+            ArenaBlock* prev = b->prev;
+            free(b);
+            b = prev;
+        }
+    }
+    free(arena);
+}
+
+/*
+ * Creates the thread-exit key and routes the jansson and cJSON allocators through the
+ * arenas. Allocations made before this point came from the previous allocators, which
+ * arena_json_free and arena_cjson_free fall back to for memory outside every arena.
+ */
+static void arena_global_init(void) {
+    if (pthread_key_create(&arena_key, arena_destroy) != 0) {
+        log_message("Failed to create arena thread key", __FILE__, __LINE__, 0, NULL);
+    }
+    json_get_alloc_funcs(&json_prev_malloc, &json_prev_free);
+    if (!json_prev_malloc || !json_prev_free) {
+        json_prev_malloc = malloc;
+        json_prev_free = free;
+    }
+    json_set_alloc_funcs(arena_json_malloc, arena_json_free);
+    cJSON_Hooks hooks = { arena_cjson_malloc, arena_cjson_free };
+    cJSON_InitHooks(&hooks);
+}
+
+static Arena* arena_get(void) {
+    if (thread_arena) return thread_arena;
+    pthread_once(&arena_once, arena_global_init);
+    Arena* arena = calloc(1, sizeof(Arena));
+    if (!arena) {
+        log_message("Failed to allocate scratch arena", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    pthread_setspecific(arena_key, arena);
+    thread_arena = arena;
+    return arena;
+}
+
+/* Takes a spare block of at least size bytes, or allocates one */
+static ArenaBlock* arena_take_block(Arena* arena, size_t size) {
+    for (ArenaBlock** link = &arena->spare; *link; link = &(*link)->prev) {
+        if ((*link)->size >= size) {
+            ArenaBlock* b = *link;
+            *link = b->prev;
+            b->used = 0;
+            return b;
+        }
+    }
+    size_t capacity = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    ArenaBlock* b = malloc(ARENA_HEADER + capacity);
+    if (!b) return NULL;
+    b->size = capacity;
+    b->used = 0;
+    arena->retained += capacity;
+    return b;
+}
+
+/*
+ * Opens a scratch scope on the calling thread.
+ *
+ * Returns:
+ *   ArenaMark: The position arena_end rewinds to; inactive if no arena could be created, in
+ *   which case arena_alloc returns NULL and JSON allocations use the previous allocators.
+ */
+ArenaMark arena_begin(void) {
+    ArenaMark mark = { NULL, 0, 0 };
+    Arena* arena = arena_get();
+    if (!arena) return mark;
+    mark.block = arena->current;
+    mark.used = arena->current ? arena->current->used : 0;
+    mark.active = 1;
+    arena->depth++;
+    return mark;
+}
+
+/*
+ * Closes the scope opened by arena_begin, releasing everything allocated in it.
+ *
+ * Parameters:
+ *   mark (ArenaMark): The value arena_begin returned.
+ */
+void arena_end(ArenaMark mark) {
+    Arena* arena = thread_arena;
+    if (!mark.active || !arena || arena->depth <= 0) return;
+    while (arena->current && arena->current != mark.block) {
+        ArenaBlock* b = arena->current;
+        arena->current = b->prev;
+        b->prev = arena->spare;
+        arena->spare = b;
+    }
+    if (arena->current) arena->current->used = mark.used;
+    if (--arena->depth > 0) return;
+    arena->json_suspended = 0;
+    while (arena->spare && arena->retained > ARENA_RETAIN_BYTES) {
+        ArenaBlock* b = arena->spare;
+        arena->spare = b->prev;
+        arena->retained -= b->size;
+        free(b);
+    }
+}
+
+void* arena_alloc(size_t size) {
+    Arena* arena = thread_arena;
+    if (!arena || arena->depth <= 0) return NULL;
+    size = size ? ((size + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN : ARENA_ALIGN;
+    ArenaBlock* b = arena->current;
+    if (!b || b->size - b->used < size) {
+        b = arena_take_block(arena, size);
+        if (!b) return NULL;
+        b->prev = arena->current;
+        arena->current = b;
+    }
+    void* ptr = ARENA_DATA(b) + b->used;
+    b->used += size;
+    return ptr;
+}
+
+int arena_json_suspend(void) {
+    Arena* arena = thread_arena;
+    if (!arena) return 0;
+    int suspended = arena->json_suspended;
+    arena->json_suspended = 1;
+    return suspended;
+}
+
+void arena_json_resume(int suspended) {
+    Arena* arena = thread_arena;
+    if (arena) arena->json_suspended = suspended;
+}
@@ -0,0 +1,60 @@
+#ifndef LIBV2ROOT_ARENA_H
+#define LIBV2ROOT_ARENA_H
+
+#include <stddef.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per-thread scratch arenas.
+ *
+ * Decoding, parsing and rendering a config allocates many short-lived pieces: base64 output,
+ * cJSON and jansson trees, rendered outbounds. Between arena_begin and arena_end those come
+ * from a bump allocator owned by the calling thread, and arena_end releases all of them at
+ * once by rewinding, so a sweep over thousands of configs reuses the same few blocks instead
+ * of calling malloc and free for every node.
+ *
+ * The jansson (json_set_alloc_funcs) and cJSON (cJSON_InitHooks) allocators are routed
+ * through the arena while a scope is open on the calling thread. Frees of arena memory are
+ * no-ops; everything else goes to the previous allocator, so trees created outside a scope
+ * may still be released inside one. The reverse is not allowed: a tree allocated inside a
+ * scope must be released, or no longer used, before the scope ends, and must not be handed
+ * to another thread. Strings that callers release with free(), such as json_dumps output,
+ * must be produced with the arena suspended (arena_json_suspend).
+ *
+ * Scopes nest; arena_end rewinds to its own arena_begin. Blocks beyond ARENA_RETAIN_BYTES are
+ * returned to the system when the outermost scope ends, the rest are kept for the thread's
+ * next scope and freed when the thread exits.
+ */
+
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_RETAIN_BYTES 262144
+#define ARENA_ALIGN 16
+
+typedef struct ArenaBlock ArenaBlock;
+
+/* Position to rewind to, returned by arena_begin */
+typedef struct {
+    ArenaBlock* block;
+    size_t used;
+    int active;                     /* 0 if the thread's arena could not be created */
+} ArenaMark;
+
+ArenaMark arena_begin(void);
+void arena_end(ArenaMark mark);
+
+/* Allocates size bytes, ARENA_ALIGN aligned, in the calling thread's open scope; NULL outside */
+void* arena_alloc(size_t size);
+
+/* Stops routing JSON allocations to the arena; returns the state for arena_json_resume */
+int arena_json_suspend(void);
+void arena_json_resume(int suspended);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_ARENA_H */
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "libv2root_common.h"
+#include "libv2root_balancer.h"
+#include "libv2root_config.h"
+#include "libv2root_observatory.h"
+#include "libv2root_utils.h"
+
+/*
+ * Appends the HTTP and SOCKS inbounds, laid out as the single-config parsers write them.
+ */
+static void add_proxy_inbounds(json_t* inbounds, int http_port, int socks_port) {
+    json_t* http = json_object();
+    json_object_set_new(http, "port", json_integer(http_port));
+    json_object_set_new(http, "protocol", json_string("http"));
+    json_object_set_new(http, "settings", json_object());
+    json_array_append_new(inbounds, http);
+
+    json_t* socks = json_object();
+    json_t* socks_settings = json_object();
+    json_object_set_new(socks_settings, "udp", json_true());
+    json_object_set_new(socks, "port", json_integer(socks_port));
+    json_object_set_new(socks, "protocol", json_string("socks"));
+    json_object_set_new(socks, "settings", socks_settings);
+    json_array_append_new(inbounds, socks);
+}
+
+/*
+ * Builds a V2Ray config that balances the proxy inbounds over up to k nodes.
+ *
+ * Node i becomes the outbound tagged balanced-out-i. A single routing rule sends all TCP and
+ * UDP traffic to the balancer, which selects among every balanced-out- outbound. With
+ * BALANCER_STRATEGY_LEAST_PING the observatory is added so the balancer has delays to rank by.
+ * Nodes that fail to render are skipped.
+ *
+ * Parameters:
+ *   configs (const char**): VLESS, VMess, or Shadowsocks configuration strings.
+ *   k (int): Number of configs (1..MAX_BALANCED_CONFIGS).
+ *   http_port (int): HTTP proxy port.
+ *   socks_port (int): SOCKS proxy port.
+ *   strategy (int): One of the BALANCER_STRATEGY_* constants.
+ *   written (int*): Receives the number of outbounds included.
+ *
+ * Returns:
+ *   json_t*: A new config document, or NULL if no node could be rendered or on failure.
+ *
+ * Errors:
+ *   Logs errors for invalid arguments, render failures, or JSON allocation failures.
+ */
+json_t* build_balanced_config(const char** configs, int k, int http_port, int socks_port, int strategy, int* written) {
+    *written = 0;
+    if (!configs || k <= 0 || k > MAX_BALANCED_CONFIGS ||
+        (strategy != BALANCER_STRATEGY_RANDOM && strategy != BALANCER_STRATEGY_LEAST_PING)) {
+        log_message("Invalid balanced config arguments", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    json_t* root = json_object();
+    json_t* inbounds = json_array();
+    json_t* outbounds = json_array();
+    json_t* routing = json_object();
+    json_t* rules = json_array();
+    json_t* balancers = json_array();
+    if (!root || !inbounds || !outbounds || !routing || !rules || !balancers) {
+        json_decref(root);
+        json_decref(inbounds);
+        json_decref(outbounds);
+        json_decref(routing);
+        json_decref(rules);
+        json_decref(balancers);
+        log_message("Failed to allocate balanced config", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    json_object_set_new(root, "inbounds", inbounds);
+    json_object_set_new(root, "outbounds", outbounds);
+    json_object_set_new(root, "routing", routing);
+    json_object_set_new(routing, "rules", rules);
+    json_object_set_new(routing, "balancers", balancers);
+    add_proxy_inbounds(inbounds, http_port, socks_port);
+
+    for (int i = 0; i < k; i++) {
+        json_t* outbound = configs[i] ? render_outbound(configs[i]) : NULL;
+        if (!outbound) {
+            LOG_WARNINGF("Skipping balanced node", "Node %d could not be rendered", i);
+            continue;
+        }
+        char tag[32];
+        snprintf(tag, sizeof(tag), "%s%d", BALANCED_OUTBOUND_PREFIX, i);
+        json_object_set_new(outbound, "tag", json_string(tag));
+        json_array_append_new(outbounds, outbound);
+        (*written)++;
+    }
+    if (*written == 0) {
+        json_decref(root);
+        log_message("No balanced node could be rendered", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+
+    json_t* balancer = json_object();
+    json_t* selector = json_array();
+    json_t* balancer_strategy = json_object();
+    json_array_append_new(selector, json_string(BALANCED_OUTBOUND_PREFIX));
+    json_object_set_new(balancer_strategy, "type",
+                        json_string(strategy == BALANCER_STRATEGY_LEAST_PING ? "leastPing" : "random"));
+    json_object_set_new(balancer, "tag", json_string(BALANCER_TAG));
+    json_object_set_new(balancer, "selector", selector);
+    json_object_set_new(balancer, "strategy", balancer_strategy);
+    json_array_append_new(balancers, balancer);
+
+    json_t* rule = json_object();
+    json_object_set_new(rule, "type", json_string("field"));
+    json_object_set_new(rule, "network", json_string("tcp,udp"));
+    json_object_set_new(rule, "balancerTag", json_string(BALANCER_TAG));
+    json_array_append_new(rules, rule);
+
+    if (strategy == BALANCER_STRATEGY_LEAST_PING && observatory_attach(root, BALANCED_OUTBOUND_PREFIX, 0) != 0) {
+        json_decref(root);
+        return NULL;
+    }
+    return root;
+}
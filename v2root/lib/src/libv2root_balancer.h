@@ -0,0 +1,34 @@
+#ifndef LIBV2ROOT_BALANCER_H
+#define LIBV2ROOT_BALANCER_H
+
+#include <jansson.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Load-balanced configs.
+ *
+ * One V2Ray config with an outbound per node and a routing balancer in front of them, so
+ * concurrent connections through the HTTP and SOCKS inbounds are spread over several upstream
+ * links instead of one.
+ */
+
+#define MAX_BALANCED_CONFIGS 64
+#define BALANCER_TAG "balancer"
+#define BALANCED_OUTBOUND_PREFIX "balanced-out-"
+
+/* Balancer strategies */
+#define BALANCER_STRATEGY_RANDOM 0          /* Uniformly random outbound per connection */
+#define BALANCER_STRATEGY_LEAST_PING 1      /* Lowest observatory delay */
+
+/* Builds the balanced config document; written receives the number of outbounds included */
+json_t* build_balanced_config(const char** configs, int k, int http_port, int socks_port, int strategy, int* written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_BALANCER_H */
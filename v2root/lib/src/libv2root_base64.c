@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "libv2root_common.h"
+#include "libv2root_arena.h"
+#include "libv2root_base64.h"
+#include "libv2root_utils.h"
+
+#define B64_SPACE 0x40
+#define B64_PAD 0x41
+#define B64_INVALID 0xFF
+
+/*
+ * Sextet value of every input byte. Both the standard (+/) and URL-safe (-_) alphabets map to
+ * 62/63 so subscription payloads decode whichever one the provider used; values with either of
+ * the top two bits set mark whitespace, padding or invalid bytes.
+ */
+static const unsigned char b64_table[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x40, 0x40, 0xFF, 0xFF, 0x40, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0x3E, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0x41, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/*
+ * Decodes base64 text into a caller-provided buffer.
+ *
+ * Unbroken runs of four alphabet characters are decoded with four table lookups and one
+ * branch; whitespace (line-wrapped subscription bodies) and padding drop to a per-character
+ * path for a single quartet before returning to the fast loop. Padding is optional.
+ *
+ * Parameters:
+ *   input (const char*): The encoded text; need not be NUL-terminated.
+ *   len (size_t): Length of input in bytes.
+ *   out (unsigned char*): Receives the decoded bytes; not NUL-terminated.
+ *   out_size (size_t): Capacity of out; BASE64_DECODED_MAX(len) is always enough.
+ *
+ * Returns:
+ *   int: Number of decoded bytes, -1 if the input is not valid base64, or -2 if out is too small.
+ *
+ * Errors:
+ *   None logged; callers decide whether a non-base64 input is an error.
+ */
+EXPORT int base64_decode_into(const char* input, size_t len, unsigned char* out, size_t out_size) {
+    if (!input || (!out && len > 0)) return -1;
+    const unsigned char* s = (const unsigned char*)input;
+    const unsigned char* end = s + len;
+    size_t o = 0;
+
+    for (;;) {
+        while (end - s >= 4) {
+            uint32_t a = b64_table[s[0]];
+            uint32_t b = b64_table[s[1]];
+            uint32_t c = b64_table[s[2]];
+            uint32_t d = b64_table[s[3]];
+            if ((a | b | c | d) & 0xC0) break;
+            if (out_size - o < 3) return -2;
+            uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+            out[o] = (unsigned char)(v >> 16);
+            out[o + 1] = (unsigned char)(v >> 8);
+            out[o + 2] = (unsigned char)v;
+            o += 3;
+            s += 4;
+        }
+
+        uint32_t acc = 0;
+        int n = 0;
+        int pad = 0;
+        while (s < end && n < 4) {
+            unsigned t = b64_table[*s++];
+            if (t < 64) {
+                acc = (acc << 6) | t;
+                n++;
+            } else if (t == B64_PAD) {
+                pad = 1;
+                break;
+            } else if (t != B64_SPACE) {
+                return -1;
+            }
+        }
+
+        if (n == 4) {
+            if (out_size - o < 3) return -2;
+            out[o] = (unsigned char)(acc >> 16);
+            out[o + 1] = (unsigned char)(acc >> 8);
+            out[o + 2] = (unsigned char)acc;
+            o += 3;
+            continue;
+        }
+
+        /* End of data: a partial quartet of 2 or 3 sextets carries 1 or 2 bytes */
+        if (n == 1) return -1;
+        if (n > 1) {
+            if (out_size - o < (size_t)(n - 1)) return -2;
+            if (n == 2) {
+                out[o++] = (unsigned char)(acc >> 4);
+            } else {
+                out[o++] = (unsigned char)(acc >> 10);
+                out[o++] = (unsigned char)(acc >> 2);
+            }
+        }
+        if (pad) {
+            while (s < end) {
+                unsigned t = b64_table[*s++];
+                if (t != B64_PAD && t != B64_SPACE) return -1;
+            }
+        }
+        break;
+    }
+    return o > (size_t)INT32_MAX ? -1 : (int)o;
+}
+
+/*
+ * Decodes base64 text into one newly allocated, NUL-terminated buffer.
+ *
+ * Parameters:
+ *   input (const char*): The encoded text; need not be NUL-terminated.
+ *   len (size_t): Length of input in bytes.
+ *   out_len (size_t*): Receives the decoded length if not NULL.
+ *
+ * Returns:
+ *   char*: The decoded data, or NULL on invalid input or allocation failure.
+ *
+ * Errors:
+ *   Logs allocation failures; invalid input is left to the caller to report.
+ */
+char* base64_decode_alloc(const char* input, size_t len, size_t* out_len) {
+    if (!input) return NULL;
+    size_t size = BASE64_DECODED_MAX(len);
+    unsigned char* out = malloc(size + 1);
+    if (!out) {
+        log_message("Failed to allocate memory for base64 decode", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    int n = base64_decode_into(input, len, out, size);
+    if (n < 0) {
+        free(out);
+        return NULL;
+    }
+    out[n] = '\0';
+    if (out_len) *out_len = (size_t)n;
+    return (char*)out;
+}
+
+/*
+ * Decodes base64 text into a NUL-terminated buffer in the calling thread's scratch arena.
+ *
+ * Parameters:
+ *   input (const char*): The encoded text; need not be NUL-terminated.
+ *   len (size_t): Length of input in bytes.
+ *   out_len (size_t*): Receives the decoded length if not NULL.
+ *
+ * Returns:
+ *   char*: The decoded data, valid until the enclosing arena_end, or NULL on invalid input or
+ *   when no scope is open.
+ */
+char* base64_decode_scratch(const char* input, size_t len, size_t* out_len) {
+    if (!input) return NULL;
+    size_t size = BASE64_DECODED_MAX(len);
+    unsigned char* out = arena_alloc(size + 1);
+    if (!out) return NULL;
+    int n = base64_decode_into(input, len, out, size);
+    if (n < 0) return NULL;
+    out[n] = '\0';
+    if (out_len) *out_len = (size_t)n;
+    return (char*)out;
+}
+
+/*
+ * Checks that every byte of input is a base64 alphabet character or padding.
+ *
+ * Only the byte classes are checked, not whether the text decodes; it is used to tell an
+ * encoded share-link segment from a plain one.
+ *
+ * Parameters:
+ *   input (const char*): The text to check.
+ *   len (size_t): Length of input in bytes.
+ *
+ * Returns:
+ *   int: 1 if input is non-empty and consists only of base64 characters, 0 otherwise.
+ */
+int base64_is_encoded(const char* input, size_t len) {
+    if (!input || len == 0) return 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned t = b64_table[(unsigned char)input[i]];
+        if (t >= 64 && t != B64_PAD) return 0;
+    }
+    return 1;
+}
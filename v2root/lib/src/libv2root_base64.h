@@ -0,0 +1,30 @@
+#ifndef LIBV2ROOT_BASE64_H
+#define LIBV2ROOT_BASE64_H
+
+#include <stddef.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Largest number of bytes len input characters can decode to */
+#define BASE64_DECODED_MAX(len) ((((len) + 3) / 4) * 3)
+
+/* Decodes standard or URL-safe base64 into a caller-provided buffer */
+EXPORT int base64_decode_into(const char* input, size_t len, unsigned char* out, size_t out_size);
+
+/* Decodes into a single NUL-terminated allocation; release with free() */
+char* base64_decode_alloc(const char* input, size_t len, size_t* out_len);
+
+/* Decodes into the calling thread's open arena scope (see libv2root_arena.h); never freed */
+char* base64_decode_scratch(const char* input, size_t len, size_t* out_len);
+
+/* Returns 1 if every byte of input belongs to the base64 alphabets or padding */
+int base64_is_encoded(const char* input, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_BASE64_H */
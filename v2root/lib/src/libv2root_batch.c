@@ -0,0 +1,773 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <jansson.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include "libv2root_win.h"
+#else
+#include <unistd.h>
+#include <sys/wait.h>
+#include "libv2root_linux.h"
+#include "libv2root_http.h"
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_batch.h"
+#include "libv2root_arena.h"
+#include "libv2root_config.h"
+#include "libv2root_deadline.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_manage.h"
+#include "libv2root_metrics.h"
+#include "libv2root_observatory.h"
+#include "libv2root_ports.h"
+#include "libv2root_utils.h"
+
+#define BATCH_OUTBOUND_PREFIX "probe-out-"
+#define OBSERVATORY_POLL_MS 250
+
+#ifdef _WIN32
+/* Shared state for the WinHTTP probe worker pool of one chunk */
+typedef struct {
+    ProbeResult* out;
+    const int* valid;
+    int count;
+    int base_port;
+    int next;
+    pthread_mutex_t lock;               /* Guards next and deadline */
+    HANDLE hProcess;
+    ProbeDeadline* deadline;
+} BatchWork;
+#endif
+
+/*
+ * Marks a batch entry as failed.
+ *
+ * Parameters:
+ *   result (ProbeResult*): The result slot to update.
+ *   error_type (const char*): One of the PROBE_ERROR_* classifications.
+ *   details (const char*): Human-readable failure description.
+ *
+ * Returns:
+ *   None
+ */
+static void batch_fail(ProbeResult* result, const char* error_type, const char* details) {
+    result->success = 0;
+    result->score = 0.0;
+    strncpy(result->error_type, error_type, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    snprintf(result->error_details, sizeof(result->error_details), "%s", details);
+}
+
+/*
+ * Builds a V2Ray config document with one outbound per valid entry.
+ *
+ * Entry i gets the outbound tagged probe-out-i. When base_port is positive it also listens on
+ * 127.0.0.1:(base_port + i) with tag probe-in-i, routed to its outbound, mirroring the
+ * single-config layout of the parsers.
+ *
+ * Parameters:
+ *   outbounds_in (json_t**): Rendered outbounds, NULL for entries that failed to render.
+ *   valid (const int*): Per-entry flags; only entries with a non-zero flag are included.
+ *   count (int): Number of entries.
+ *   base_port (int): HTTP inbound port of entry 0, or 0 for outbounds only.
+ *   written (int*): Receives the number of entries included.
+ *
+ * Returns:
+ *   json_t*: A new config document, or NULL on failure.
+ *
+ * Errors:
+ *   Logs errors for JSON allocation failures.
+ */
+static json_t* build_batch_config(json_t** outbounds_in, const int* valid, int count, int base_port, int* written) {
+    json_t* root = json_object();
+    json_t* inbounds = json_array();
+    json_t* outbounds = json_array();
+    json_t* rules = json_array();
+    json_t* routing = json_object();
+    if (!root || !inbounds || !outbounds || !rules || !routing) {
+        json_decref(root);
+        json_decref(inbounds);
+        json_decref(outbounds);
+        json_decref(rules);
+        json_decref(routing);
+        log_message("Failed to allocate batch config", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    *written = 0;
+    for (int i = 0; i < count; i++) {
+        if (!valid[i]) continue;
+        char in_tag[32], out_tag[32];
+        snprintf(in_tag, sizeof(in_tag), "probe-in-%d", i);
+        snprintf(out_tag, sizeof(out_tag), "%s%d", BATCH_OUTBOUND_PREFIX, i);
+
+        json_t* outbound = json_copy(outbounds_in[i]);
+        json_object_set_new(outbound, "tag", json_string(out_tag));
+        json_array_append_new(outbounds, outbound);
+        (*written)++;
+        if (base_port <= 0) continue;
+
+        json_t* inbound = json_object();
+        json_object_set_new(inbound, "tag", json_string(in_tag));
+        json_object_set_new(inbound, "listen", json_string("127.0.0.1"));
+        json_object_set_new(inbound, "port", json_integer(base_port + i));
+        json_object_set_new(inbound, "protocol", json_string("http"));
+        json_object_set_new(inbound, "settings", json_object());
+        json_array_append_new(inbounds, inbound);
+
+        json_t* rule = json_object();
+        json_t* rule_tags = json_array();
+        json_array_append_new(rule_tags, json_string(in_tag));
+        json_object_set_new(rule, "type", json_string("field"));
+        json_object_set_new(rule, "inboundTag", rule_tags);
+        json_object_set_new(rule, "outboundTag", json_string(out_tag));
+        json_array_append_new(rules, rule);
+    }
+    json_object_set_new(routing, "rules", rules);
+    json_object_set_new(root, "inbounds", inbounds);
+    json_object_set_new(root, "outbounds", outbounds);
+    json_object_set_new(root, "routing", routing);
+    return root;
+}
+
+/*
+ * Serializes a config document into a finished buffer and releases the document.
+ *
+ * Parameters:
+ *   root (json_t*): The config document; its reference is consumed.
+ *   config (ConfigBuffer*): Receives the serialized config; release with config_buffer_free.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+static int dump_batch_config(json_t* root, ConfigBuffer* config) {
+    /* config_buffer_free releases the text with free(), so it must not come from the arena */
+    int suspended = arena_json_suspend();
+    config->data = json_dumps(root, JSON_COMPACT);
+    arena_json_resume(suspended);
+    json_decref(root);
+    if (!config->data) {
+        log_message("Failed to serialize batch config", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    config->len = strlen(config->data);
+    return 0;
+}
+
+/*
+ * Builds a V2Ray config in memory with one inbound/outbound pair per valid entry.
+ *
+ * Parameters:
+ *   outbounds_in (json_t**): Rendered outbounds, NULL for entries that failed to render.
+ *   valid (const int*): Per-entry flags; only entries with a non-zero flag are included.
+ *   count (int): Number of entries.
+ *   base_port (int): HTTP inbound port of entry 0.
+ *   config (ConfigBuffer*): Receives the serialized config; release with config_buffer_free.
+ *
+ * Returns:
+ *   int: Number of entries written on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for JSON allocation or serialization failures.
+ */
+static int write_batch_config(json_t** outbounds_in, const int* valid, int count, int base_port, ConfigBuffer* config) {
+    memset(config, 0, sizeof(ConfigBuffer));
+    int written = 0;
+    json_t* root = build_batch_config(outbounds_in, valid, count, base_port, &written);
+    if (!root || dump_batch_config(root, config) != 0) return -1;
+    return written;
+}
+
+#ifdef _WIN32
+/*
+ * Worker thread: probes batch inbounds until the shared cursor is exhausted.
+ *
+ * Parameters:
+ *   arg (void*): Pointer to the chunk's BatchWork.
+ *
+ * Returns:
+ *   void*: Always NULL.
+ */
+static void* batch_worker(void* arg) {
+    BatchWork* work = (BatchWork*)arg;
+    for (;;) {
+        pthread_mutex_lock(&work->lock);
+        int i = work->next++;
+        int stopped = deadline_done(work->deadline);
+        pthread_mutex_unlock(&work->lock);
+        if (i >= work->count) break;
+        if (!work->valid[i]) continue;
+        ProbeResult* result = &work->out[i];
+        if (stopped) {
+            deadline_skip(result);
+            continue;
+        }
+
+        int latency = 0;
+        int rc = win_test_connection(work->base_port + i, &latency, work->hProcess);
+        if (rc != 0) {
+            batch_fail(result, PROBE_ERROR_TRANSPORT, "Proxy connection test failed through batch inbound");
+            continue;
+        }
+        result->success = 1;
+        result->ttfb_ms = latency;
+        result->proxy_setup_ms = latency; /* Approximation, as in probe_config_full */
+        result->total_ms = latency;
+        result->score = calculate_probe_score(latency, 0, 1);
+        if (work->deadline) {
+            pthread_mutex_lock(&work->lock);
+            deadline_observe(work->deadline, latency);
+            pthread_mutex_unlock(&work->lock);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Probes every valid inbound of a running chunk with a WinHTTP worker pool.
+ *
+ * WinHTTP requests keep their fixed timeouts; a deadline in stop mode still ends the chunk
+ * early, since workers stop taking entries once it is done.
+ *
+ * Parameters:
+ *   out (ProbeResult*): Result slots for the chunk.
+ *   valid (const int*): Per-entry flags; only valid entries are probed.
+ *   count (int): Number of entries in the chunk.
+ *   written (int): Number of valid entries, used to size the pool.
+ *   base_port (int): HTTP inbound port of entry 0.
+ *   hProcess (HANDLE): Handle of the chunk's V2Ray process.
+ *   deadline (ProbeDeadline*): Selection deadline shared by the sweep, or NULL.
+ *
+ * Returns:
+ *   None
+ */
+static void probe_chunk_inbounds(ProbeResult* out, const int* valid, int count, int written, int base_port, HANDLE hProcess,
+                                 ProbeDeadline* deadline) {
+    BatchWork work;
+    work.out = out;
+    work.valid = valid;
+    work.count = count;
+    work.base_port = base_port;
+    work.next = 0;
+    work.hProcess = hProcess;
+    work.deadline = deadline;
+    pthread_mutex_init(&work.lock, NULL);
+
+    int nthreads = written < MAX_CONCURRENT_PROBES ? written : MAX_CONCURRENT_PROBES;
+    pthread_t threads[MAX_CONCURRENT_PROBES];
+    int started = 0;
+    for (int t = 0; t < nthreads; t++) {
+        if (pthread_create(&threads[t], NULL, batch_worker, &work) != 0) {
+            log_message("Failed to create batch probe thread", __FILE__, __LINE__, errno, NULL);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        batch_worker(&work);
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    pthread_mutex_destroy(&work.lock);
+}
+#endif
+
+/*
+ * Probes one chunk of rendered configurations with a single V2Ray process.
+ *
+ * If V2Ray refuses to start with the combined config, the chunk is split in half and
+ * each half retried, so a single bad outbound only costs O(log n) extra spawns.
+ *
+ * Parameters:
+ *   outbounds (json_t**): Rendered outbounds for the chunk.
+ *   valid (int*): Per-entry flags; cleared for entries that fail here.
+ *   out (ProbeResult*): Result slots for the chunk.
+ *   count (int): Number of entries in the chunk.
+ *   base_port (int): HTTP inbound port of entry 0.
+ *   samples (int): Requests per inbound (see probe_configs_batch_sampled).
+ *   deadline (ProbeDeadline*): Selection deadline shared by the sweep, or NULL.
+ *
+ * Returns:
+ *   None
+ *
+ * Errors:
+ *   Failures are recorded per entry in out; process errors are logged.
+ */
+static void probe_chunk(json_t** outbounds, int* valid, ProbeResult* out, int count, int base_port, int samples,
+                        ProbeDeadline* deadline) {
+    ConfigBuffer config;
+    int written = write_batch_config(outbounds, valid, count, base_port, &config);
+    if (written <= 0) {
+        config_buffer_free(&config);
+        if (written < 0) {
+            for (int i = 0; i < count; i++) {
+                if (valid[i]) batch_fail(&out[i], PROBE_ERROR_UNKNOWN, "Failed to write batch config");
+            }
+        }
+        return;
+    }
+
+    PID_TYPE pid = 0;
+    if (start_v2ray_from_buffer(&config, &pid) != 0) {
+        log_message("Failed to start V2Ray process for batch", __FILE__, __LINE__, 0, NULL);
+        for (int i = 0; i < count; i++) {
+            if (valid[i]) batch_fail(&out[i], PROBE_ERROR_UNKNOWN, "Failed to start V2Ray process");
+        }
+        config_buffer_free(&config);
+        return;
+    }
+
+    /* Every inbound is bound before V2Ray reports started, so the first one is representative */
+    int first = 0;
+    while (!valid[first]) first++;
+    int ready = wait_for_v2ray_ready(pid, base_port + first);
+
+    int alive = 1;
+#ifdef _WIN32
+    HANDLE hProcess = OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE | PROCESS_QUERY_INFORMATION, FALSE, pid);
+    DWORD exitCode;
+    if (!hProcess || (GetExitCodeProcess(hProcess, &exitCode) && exitCode != STILL_ACTIVE)) {
+        alive = 0;
+    }
+#else
+    int status;
+    if (waitpid(pid, &status, WNOHANG) == pid) {
+        alive = 0;
+        pid = 0;
+    }
+#endif
+
+    if (!alive) {
+#ifdef _WIN32
+        if (hProcess) CloseHandle(hProcess);
+        win_stop_v2ray_process(pid);
+#endif
+        config_buffer_free(&config);
+        if (written == 1) {
+            for (int i = 0; i < count; i++) {
+                if (valid[i]) {
+                    batch_fail(&out[i], PROBE_ERROR_UNKNOWN, "V2Ray rejected configuration");
+                    valid[i] = 0;
+                }
+            }
+            return;
+        }
+        char extra_info[128];
+        snprintf(extra_info, sizeof(extra_info), "Chunk of %d configs rejected, bisecting", written);
+        log_message("V2Ray exited on batch config", __FILE__, __LINE__, 0, extra_info);
+        int half = count / 2;
+        probe_chunk(outbounds, valid, out, half, base_port, samples, deadline);
+        probe_chunk(outbounds + half, valid + half, out + half, count - half, base_port + half, samples, deadline);
+        return;
+    }
+
+    if (ready != 0) {
+        log_message("V2Ray did not become ready for batch", __FILE__, __LINE__, 0, NULL);
+        for (int i = 0; i < count; i++) {
+            if (valid[i]) batch_fail(&out[i], PROBE_ERROR_TIMEOUT, "V2Ray did not become ready");
+        }
+#ifdef _WIN32
+        win_stop_v2ray_process(pid);
+        CloseHandle(hProcess);
+#else
+        linux_stop_v2ray_process(pid);
+#endif
+        config_buffer_free(&config);
+        return;
+    }
+
+#ifdef _WIN32
+    probe_chunk_inbounds(out, valid, count, written, base_port, hProcess, deadline);
+#else
+    int ports[MAX_BATCH_CONFIGS];
+    for (int i = 0; i < count; i++) {
+        ports[i] = valid[i] ? base_port + i : 0;
+    }
+    if (http_probe_ports(ports, count, samples, out, deadline) < 0) {
+        for (int i = 0; i < count; i++) {
+            if (valid[i]) batch_fail(&out[i], PROBE_ERROR_UNKNOWN, "Failed to initialize HTTP probe engine");
+        }
+    }
+#endif
+
+#ifdef _WIN32
+    win_stop_v2ray_process(pid);
+    CloseHandle(hProcess);
+#else
+    linux_stop_v2ray_process(pid);
+#endif
+    config_buffer_free(&config);
+}
+
+/*
+ * Copies one observatory status into a batch result.
+ *
+ * The observatory times a full request through the outbound, so its delay is stored as TTFB
+ * and, as in probe_config_full, approximates the proxy setup time.
+ *
+ * Parameters:
+ *   result (ProbeResult*): The result slot to update.
+ *   status (const ObservatoryStatus*): The outbound's observatory entry.
+ *
+ * Returns:
+ *   None
+ */
+static void observatory_result(ProbeResult* result, const ObservatoryStatus* status) {
+    if (!status->alive) {
+        const char* reason = status->error[0] ? status->error : "Observatory probe failed";
+        int timed_out = strstr(reason, "timeout") != NULL || strstr(reason, "deadline") != NULL;
+        batch_fail(result, timed_out ? PROBE_ERROR_TIMEOUT : PROBE_ERROR_TRANSPORT, reason);
+        return;
+    }
+    int delay = status->delay_ms > 0x7fffffff ? 0x7fffffff : (int)status->delay_ms;
+    result->success = 1;
+    result->ttfb_ms = delay;
+    result->proxy_setup_ms = delay;
+    result->total_ms = delay;
+    result->score = calculate_probe_score(delay, 0, 1);
+}
+
+/*
+ * Probes one chunk with V2Ray's observatory instead of client-side requests.
+ *
+ * The chunk's outbounds are loaded into one process with the observatory and its API
+ * service enabled; V2Ray probes them all concurrently and the results are polled from the API
+ * on base_port until every outbound has been tried or the probe deadline passes. If the
+ * process does not start, or its V2Ray build has no observatory API, the chunk falls back to
+ * probe_chunk, which also isolates configs V2Ray rejects.
+ *
+ * Parameters:
+ *   outbounds (json_t**): Rendered outbounds for the chunk.
+ *   valid (int*): Per-entry flags; cleared for entries that fail in the fallback.
+ *   out (ProbeResult*): Result slots for the chunk.
+ *   count (int): Number of entries in the chunk.
+ *   base_port (int): API port; the fallback uses base_port + i.
+ *
+ * Returns:
+ *   None
+ *
+ * Errors:
+ *   Failures are recorded per entry in out; process errors are logged.
+ */
+static void probe_chunk_observatory(json_t** outbounds, int* valid, ProbeResult* out, int count, int base_port) {
+    ConfigBuffer config;
+    memset(&config, 0, sizeof(ConfigBuffer));
+    int written = 0;
+    int dumped = 0;
+    json_t* root = build_batch_config(outbounds, valid, count, 0, &written);
+    if (root && written > 0 && observatory_attach(root, BATCH_OUTBOUND_PREFIX, base_port) == 0) {
+        dumped = dump_batch_config(root, &config) == 0;
+    } else {
+        json_decref(root);
+    }
+    if (!dumped) {
+        config_buffer_free(&config);
+        probe_chunk(outbounds, valid, out, count, base_port, 1, NULL);
+        return;
+    }
+
+    PID_TYPE pid = 0;
+    int started = start_v2ray_from_buffer(&config, &pid) == 0;
+    int ready = started && wait_for_v2ray_ready(pid, base_port) == 0;
+    int api_ok = 0;
+    int done[MAX_BATCH_CONFIGS] = {0};
+    if (ready) {
+        ObservatoryStatus* statuses = malloc((size_t)count * sizeof(ObservatoryStatus));
+        long long deadline = get_monotonic_ms() + DEFAULT_TTFB_TIMEOUT_MS * 2;
+        int remaining = written;
+        while (statuses && remaining > 0) {
+            int reported = observatory_query(base_port, statuses, count);
+            if (reported >= 0) api_ok = 1;
+            for (int k = 0; k < reported; k++) {
+                int i = -1;
+                if (strncmp(statuses[k].tag, BATCH_OUTBOUND_PREFIX, strlen(BATCH_OUTBOUND_PREFIX)) == 0) {
+                    i = atoi(statuses[k].tag + strlen(BATCH_OUTBOUND_PREFIX));
+                }
+                if (i < 0 || i >= count || !valid[i] || done[i] || statuses[k].last_try_time <= 0) continue;
+                observatory_result(&out[i], &statuses[k]);
+                done[i] = 1;
+                remaining--;
+            }
+            if (remaining == 0 || get_monotonic_ms() >= deadline) break;
+#ifdef _WIN32
+            Sleep(OBSERVATORY_POLL_MS);
+#else
+            usleep(OBSERVATORY_POLL_MS * 1000);
+#endif
+        }
+        free(statuses);
+    }
+    if (started) {
+#ifdef _WIN32
+        win_stop_v2ray_process(pid);
+#else
+        linux_stop_v2ray_process(pid);
+#endif
+    }
+    config_buffer_free(&config);
+
+    if (!api_ok) {
+        LOG_WARNING("Observatory unavailable, probing batch through inbounds", NULL);
+        probe_chunk(outbounds, valid, out, count, base_port, 1, NULL);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (valid[i] && !done[i]) batch_fail(&out[i], PROBE_ERROR_TIMEOUT, "Observatory did not probe outbound in time");
+    }
+}
+
+/*
+ * Runs the chunked batch probe over configs without deduplication.
+ *
+ * Once a stop-mode deadline is done the remaining chunks are skipped without starting V2Ray.
+ *
+ * Parameters:
+ *   samples (int): Requests per inbound, or 0 to probe through the observatory.
+ *   deadline (ProbeDeadline*): Selection deadline for the whole sweep, or NULL.
+ *
+ * Returns:
+ *   int: Number of successful probes.
+ */
+static int probe_chunks(const char** configs, int n, ProbeResult* out, int base_port, int chunk_size, int samples,
+                        ProbeDeadline* deadline) {
+    json_t* outbounds[MAX_BATCH_CONFIGS];
+    int valid[MAX_BATCH_CONFIGS];
+    int succeeded = 0;
+
+    for (int start = 0; start < n; start += chunk_size) {
+        int count = n - start < chunk_size ? n - start : chunk_size;
+        if (deadline_done(deadline)) {
+            for (int i = 0; i < count; i++) {
+                memset(&out[start + i], 0, sizeof(ProbeResult));
+                deadline_skip(&out[start + i]);
+            }
+            continue;
+        }
+        /* The chunk's outbounds and batch documents live in the scratch arena until its end */
+        ArenaMark scratch = arena_begin();
+        for (int i = 0; i < count; i++) {
+            ProbeResult* result = &out[start + i];
+            memset(result, 0, sizeof(ProbeResult));
+            result->attempts = 1;
+            strncpy(result->error_type, PROBE_ERROR_NONE, sizeof(result->error_type) - 1);
+            outbounds[i] = configs[start + i] ? render_outbound(configs[start + i]) : NULL;
+            valid[i] = outbounds[i] != NULL;
+            if (!valid[i]) {
+                batch_fail(result, PROBE_ERROR_UNKNOWN, "Failed to parse configuration");
+            }
+        }
+
+        if (samples > 0) {
+            probe_chunk(outbounds, valid, out + start, count, base_port, samples, deadline);
+        } else {
+            probe_chunk_observatory(outbounds, valid, out + start, count, base_port);
+        }
+
+        int probed = 0;
+        for (int i = 0; i < count; i++) {
+            if (outbounds[i]) json_decref(outbounds[i]);
+            if (out[start + i].success) succeeded++;
+            if (strcmp(out[start + i].error_type, PROBE_ERROR_SKIPPED) != 0) probed++;
+        }
+        arena_end(scratch);
+        metrics_probes_started(probed);
+        metrics_probe_results(out + start, count);
+    }
+
+    return succeeded;
+}
+
+/*
+ * Deduplicates configs by fingerprint, probes each distinct one and expands the results.
+ *
+ * With base_port <= 0 the inbound ports are leased from the port allocator for the call.
+ *
+ * Parameters:
+ *   samples (int): Requests per inbound, or 0 to probe through the observatory.
+ *   deadline (ProbeDeadline*): Selection deadline for the whole sweep, or NULL.
+ *
+ * Returns:
+ *   int: Number of successful probes on success, -1 on invalid input.
+ */
+static int probe_batch_unique(const char** configs, int n, ProbeResult* out, int base_port, int samples,
+                              ProbeDeadline* deadline) {
+    if (!configs || !out || n <= 0) {
+        log_message("Invalid arguments to probe_configs_batch", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    int chunk_size = n < MAX_BATCH_CONFIGS ? n : MAX_BATCH_CONFIGS;
+    if (base_port <= 0) {
+        int leased = port_lease(chunk_size);
+        if (leased < 0) {
+            log_message("No free ports for batch probe", __FILE__, __LINE__, 0, NULL);
+            return -1;
+        }
+        int rc = probe_batch_unique(configs, n, out, leased, samples, deadline);
+        port_release(leased, chunk_size);
+        return rc;
+    }
+    if (base_port + chunk_size - 1 > 65535) {
+        log_message("Batch port range exceeds 65535", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+
+    /* Configs that differ only in remark or parameter order are probed once */
+    const char** unique = malloc((size_t)n * sizeof(const char*));
+    int* slot = malloc((size_t)n * sizeof(int));
+    ProbeResult* results = malloc((size_t)n * sizeof(ProbeResult));
+    FpIndex index;
+    if (!unique || !slot || !results || fp_index_init(&index, (size_t)n) != 0) {
+        free(unique);
+        free(slot);
+        free(results);
+        return probe_chunks(configs, n, out, base_port, chunk_size, samples, deadline);
+    }
+    int unique_count = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t key = configs[i] ? v2root_config_fingerprint(configs[i]) : 0;
+        int first = key ? fp_index_insert(&index, key, unique_count) : -1;
+        if (first >= 0) {
+            slot[i] = first;
+            continue;
+        }
+        slot[i] = unique_count;
+        unique[unique_count++] = configs[i];
+    }
+    fp_index_free(&index);
+
+    probe_chunks(unique, unique_count, results, base_port, chunk_size, samples, deadline);
+    int succeeded = 0;
+    for (int i = 0; i < n; i++) {
+        out[i] = results[slot[i]];
+        if (out[i].success) succeeded++;
+    }
+    free(unique);
+    free(slot);
+    free(results);
+
+    LOG_INFOF("Batch probe completed", "Batch probe: %d/%d configs reachable, %d probed", succeeded, n, unique_count);
+    return succeeded;
+}
+
+/*
+ * Probes many configurations through a single V2Ray process per chunk.
+ *
+ * Configurations are processed in chunks of up to MAX_BATCH_CONFIGS. Each chunk is rendered
+ * into one V2Ray config with a tagged outbound per entry, each routed from its own HTTP
+ * inbound on base_port + i; V2Ray is started once and all inbounds are probed concurrently
+ * with up to MAX_CONCURRENT_PROBES requests in flight (one curl multi handle on Linux, a
+ * WinHTTP worker pool on Windows). Configurations with the same canonical fingerprint are
+ * probed once and share the result.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, filled in the same order as configs.
+ *   base_port (int): First local inbound port (leased from the port allocator if <= 0).
+ *
+ * Returns:
+ *   int: Number of successful probes on success, -1 on invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input or port ranges. Per-config failures are reported through
+ *   error_type/error_details in out rather than the return value.
+ */
+EXPORT int probe_configs_batch(const char** configs, int n, ProbeResult* out, int base_port) {
+    return probe_configs_batch_sampled(configs, n, out, base_port, 1);
+}
+
+/*
+ * Batch probe that issues several requests per configuration over one warm connection.
+ *
+ * The first request of each inbound measures tunnel setup (proxy_setup_ms, ttfb_ms); the
+ * remaining samples reuse its connection and their median is stored in warm_rtt_ms, which
+ * reflects the steady-state round trip through the node. attempts holds the number of
+ * samples that completed. On Windows one sample is taken per configuration.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, filled in the same order as configs.
+ *   base_port (int): First local inbound port (leased from the port allocator if <= 0).
+ *   samples (int): Requests per configuration (clamped to 1..MAX_PROBE_SAMPLES).
+ *
+ * Returns:
+ *   int: Number of successful probes on success, -1 on invalid input.
+ *
+ * Errors:
+ *   As probe_configs_batch.
+ */
+EXPORT int probe_configs_batch_sampled(const char** configs, int n, ProbeResult* out, int base_port, int samples) {
+    if (samples < 1) samples = 1;
+    if (samples > MAX_PROBE_SAMPLES) samples = MAX_PROBE_SAMPLES;
+    return probe_batch_unique(configs, n, out, base_port, samples, NULL);
+}
+
+/*
+ * Batch probe that lets V2Ray's observatory measure every configuration in-process.
+ *
+ * Each chunk runs in one V2Ray process with the observatory enabled for all of its outbounds;
+ * V2Ray probes them concurrently (a request to PRIMARY_PROBE_URL through each outbound) and
+ * the delays are read back over the API service, so no client-side request is made per
+ * configuration. ttfb_ms, proxy_setup_ms and total_ms hold the observatory delay. If the
+ * installed V2Ray has no observatory API the chunk is probed as in probe_configs_batch.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, filled in the same order as configs.
+ *   base_port (int): API port, and first inbound port of the fallback (leased from the
+ *                    port allocator if <= 0).
+ *
+ * Returns:
+ *   int: Number of successful probes on success, -1 on invalid input.
+ *
+ * Errors:
+ *   As probe_configs_batch.
+ */
+EXPORT int probe_configs_observatory(const char** configs, int n, ProbeResult* out, int base_port) {
+    return probe_batch_unique(configs, n, out, base_port, 0, NULL);
+}
+
+/*
+ * Batch probe for picking the fastest nodes of a list, with adaptive deadlines.
+ *
+ * Probes as probe_configs_batch, but once k configs have answered, a request still without a
+ * first byte after factor times the median TTFB of the k fastest is abandoned as a timeout
+ * (never sooner than MIN_ADAPTIVE_TIMEOUT_MS). With stop set, the sweep ends as soon as k
+ * configs have succeeded: entries not yet probed, including whole chunks, are marked
+ * PROBE_ERROR_SKIPPED, and requests in flight are cut at the k-th best TTFB, since they could
+ * no longer make the set. The time spent then scales with how good the list is, not with how
+ * many dead nodes it holds. The fastest k configs are among the successful results.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, filled in the same order as configs.
+ *   base_port (int): First local inbound port (leased from the port allocator if <= 0).
+ *   k (int): Size of the reference set (clamped to 1..MAX_SELECT_K), e.g. DEFAULT_SELECT_K.
+ *   factor (double): Deadline as a multiple of the reference median, e.g. DEFAULT_SELECT_FACTOR.
+ *   stop (int): Non-zero to stop once k configs have succeeded.
+ *
+ * Returns:
+ *   int: Number of successful probes on success, -1 on invalid input.
+ *
+ * Errors:
+ *   As probe_configs_batch.
+ */
+EXPORT int probe_configs_select(const char** configs, int n, ProbeResult* out, int base_port, int k, double factor, int stop) {
+    ProbeDeadline deadline;
+    deadline_init(&deadline, k, factor, stop);
+    int succeeded = probe_batch_unique(configs, n, out, base_port, 1, &deadline);
+    if (succeeded >= 0) {
+        LOG_INFOF("Selection probe completed", "Selection probe: %d/%d configs reachable, k=%d%s", succeeded, n,
+                  deadline.k, deadline_done(&deadline) ? ", k reached" : "");
+    }
+    return succeeded;
+}
@@ -0,0 +1,24 @@
+#ifndef LIBV2ROOT_BATCH_H
+#define LIBV2ROOT_BATCH_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Batch probing: one V2Ray process per chunk of configurations */
+EXPORT int probe_configs_batch(const char** configs, int n, ProbeResult* out, int base_port);
+EXPORT int probe_configs_batch_sampled(const char** configs, int n, ProbeResult* out, int base_port, int samples);
+
+/* Batch probing for node selection: adaptive deadlines and an optional stop after k good nodes */
+EXPORT int probe_configs_select(const char** configs, int n, ProbeResult* out, int base_port, int k, double factor, int stop);
+
+/* Batch probing measured by V2Ray's own observatory */
+EXPORT int probe_configs_observatory(const char** configs, int n, ProbeResult* out, int base_port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_BATCH_H */
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_cache.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_records.h"
+#include "libv2root_utils.h"
+
+/* The mapping, guarded by cache_lock */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static CacheHeader* cache_header = NULL;
+static CacheEntry* cache_entries = NULL;
+static size_t cache_size = 0;
+#ifdef _WIN32
+static HANDLE cache_file = INVALID_HANDLE_VALUE;
+static HANDLE cache_mapping = NULL;
+#else
+static int cache_fd = -1;
+#endif
+
+long long cache_wall_ms(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULARGE_INTEGER t;
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    return (long long)((t.QuadPart - 116444736000000000ULL) / 10000ULL);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+static size_t cache_file_size(uint32_t capacity) {
+    return sizeof(CacheHeader) + (size_t)capacity * sizeof(CacheEntry);
+}
+
+/* Returns 1 if header describes a cache file of file_size bytes written by this version */
+static int header_valid(const CacheHeader* header, size_t file_size) {
+    return memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == CACHE_FILE_VERSION && header->entry_size == sizeof(CacheEntry) &&
+           header->capacity > 0 && header->capacity <= CACHE_MAX_CAPACITY &&
+           (header->capacity & (header->capacity - 1)) == 0 &&
+           header->count <= header->capacity && file_size == cache_file_size(header->capacity);
+}
+
+/* Unmaps and closes the cache file; cache_lock must be held */
+static void unmap_cache(void) {
+#ifdef _WIN32
+    if (cache_header) {
+        FlushViewOfFile(cache_header, 0);
+        UnmapViewOfFile(cache_header);
+    }
+    if (cache_mapping) CloseHandle(cache_mapping);
+    if (cache_file != INVALID_HANDLE_VALUE) CloseHandle(cache_file);
+    cache_mapping = NULL;
+    cache_file = INVALID_HANDLE_VALUE;
+#else
+    if (cache_header) {
+        msync(cache_header, cache_size, MS_ASYNC);
+        munmap(cache_header, cache_size);
+    }
+    if (cache_fd >= 0) close(cache_fd);
+    cache_fd = -1;
+#endif
+    cache_header = NULL;
+    cache_entries = NULL;
+    cache_size = 0;
+}
+
+/*
+ * Opens or creates the cache file and maps it; cache_lock must be held.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+static int map_cache(const char* path, uint32_t capacity) {
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    int fresh;
+#ifdef _WIN32
+    cache_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (cache_file == INVALID_HANDLE_VALUE) {
+        log_message("Failed to open cache file", __FILE__, __LINE__, (int)GetLastError(), path);
+        return -1;
+    }
+    LARGE_INTEGER existing;
+    DWORD read = 0;
+    fresh = !GetFileSizeEx(cache_file, &existing) ||
+            !ReadFile(cache_file, &header, sizeof(header), &read, NULL) || read != sizeof(header) ||
+            !header_valid(&header, (size_t)existing.QuadPart);
+#else
+    cache_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (cache_fd < 0) {
+        log_message("Failed to open cache file", __FILE__, __LINE__, errno, path);
+        return -1;
+    }
+    struct stat st;
+    fresh = fstat(cache_fd, &st) != 0 ||
+            pread(cache_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            !header_valid(&header, (size_t)st.st_size);
+#endif
+    if (fresh) {
+        LOG_INFO("Creating probe cache", path);
+    } else {
+        capacity = header.capacity;
+    }
+    cache_size = cache_file_size(capacity);
+
+#ifdef _WIN32
+    if (fresh) {
+        LARGE_INTEGER zero, size;
+        zero.QuadPart = 0;
+        size.QuadPart = (LONGLONG)cache_size;
+        /* Truncate first so a stale file leaves no old entries behind */
+        if (!SetFilePointerEx(cache_file, zero, NULL, FILE_BEGIN) || !SetEndOfFile(cache_file) ||
+            !SetFilePointerEx(cache_file, size, NULL, FILE_BEGIN) || !SetEndOfFile(cache_file)) {
+            log_message("Failed to size cache file", __FILE__, __LINE__, (int)GetLastError(), path);
+            unmap_cache();
+            return -1;
+        }
+    }
+    cache_mapping = CreateFileMappingA(cache_file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)cache_size >> 32),
+                                       (DWORD)(cache_size & 0xffffffffu), NULL);
+    void* base = cache_mapping ? MapViewOfFile(cache_mapping, FILE_MAP_ALL_ACCESS, 0, 0, cache_size) : NULL;
+    if (!base) {
+        log_message("Failed to map cache file", __FILE__, __LINE__, (int)GetLastError(), path);
+        unmap_cache();
+        return -1;
+    }
+#else
+    if (fresh && (ftruncate(cache_fd, 0) != 0 || ftruncate(cache_fd, (off_t)cache_size) != 0)) {
+        log_message("Failed to size cache file", __FILE__, __LINE__, errno, path);
+        unmap_cache();
+        return -1;
+    }
+    void* base = mmap(NULL, cache_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache_fd, 0);
+    if (base == MAP_FAILED) {
+        log_message("Failed to map cache file", __FILE__, __LINE__, errno, path);
+        unmap_cache();
+        return -1;
+    }
+#endif
+    cache_header = (CacheHeader*)base;
+    cache_entries = (CacheEntry*)((char*)base + sizeof(CacheHeader));
+    if (fresh) {
+        /* The file was zero-filled by the resize, so every slot starts empty */
+        memcpy(cache_header->magic, CACHE_MAGIC, sizeof(cache_header->magic));
+        cache_header->version = CACHE_FILE_VERSION;
+        cache_header->entry_size = sizeof(CacheEntry);
+        cache_header->capacity = capacity;
+        cache_header->count = 0;
+    }
+    return 0;
+}
+
+/*
+ * Opens a probe cache file, creating it if it does not exist.
+ *
+ * An existing file is mapped as is after its header is checked; a file with a different
+ * version, record size or a damaged header is recreated empty. Any cache already open is
+ * closed first.
+ *
+ * Parameters:
+ *   path (const char*): Path of the cache file.
+ *   capacity (int): Slots of a new file, rounded up to a power of two (CACHE_DEFAULT_CAPACITY
+ *                   if <= 0). An existing file keeps its own capacity.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input or file and mapping failures.
+ */
+EXPORT int v2root_cache_open(const char* path, int capacity) {
+    if (!path || path[0] == '\0' || capacity > CACHE_MAX_CAPACITY) {
+        log_message("Invalid arguments to v2root_cache_open", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    uint32_t slots = 1;
+    while ((int)slots < (capacity > 0 ? capacity : CACHE_DEFAULT_CAPACITY)) slots <<= 1;
+    pthread_mutex_lock(&cache_lock);
+    unmap_cache();
+    int rc = map_cache(path, slots);
+    int count = rc == 0 ? (int)cache_header->count : 0;
+    pthread_mutex_unlock(&cache_lock);
+    if (rc != 0) return V2ROOT_ERROR;
+    LOG_INFOF("Probe cache opened", "%s: %d cached configs", path, count);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Writes back and closes the open cache.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if no cache is open.
+ */
+EXPORT int v2root_cache_close(void) {
+    pthread_mutex_lock(&cache_lock);
+    int was_open = cache_header != NULL;
+    unmap_cache();
+    pthread_mutex_unlock(&cache_lock);
+    return was_open ? V2ROOT_SUCCESS : V2ROOT_ERROR;
+}
+
+int cache_is_open(void) {
+    pthread_mutex_lock(&cache_lock);
+    int open = cache_header != NULL;
+    pthread_mutex_unlock(&cache_lock);
+    return open;
+}
+
+static long long entry_newest_ms(const CacheEntry* entry) {
+    if (entry->count == 0) return 0;
+    return entry->samples[(entry->head + CACHE_SAMPLES - 1) % CACHE_SAMPLES].time_ms;
+}
+
+/*
+ * Finds the slot of fingerprint; cache_lock must be held and a cache open.
+ *
+ * Parameters:
+ *   fingerprint (uint64_t): Non-zero config fingerprint.
+ *   insert (int): Non-zero to claim an empty slot, or evict the least recently updated of the
+ *                 probe sequence, when fingerprint is not cached.
+ *
+ * Returns:
+ *   CacheEntry*: The entry, or NULL if fingerprint is not cached and insert is 0.
+ */
+static CacheEntry* find_entry(uint64_t fingerprint, int insert) {
+    uint32_t mask = cache_header->capacity - 1;
+    int probes = cache_header->capacity < CACHE_MAX_PROBE ? (int)cache_header->capacity : CACHE_MAX_PROBE;
+    CacheEntry* victim = NULL;
+    for (int i = 0; i < probes; i++) {
+        CacheEntry* entry = &cache_entries[(uint32_t)(fingerprint + (uint64_t)i) & mask];
+        if (entry->fingerprint == fingerprint) return entry;
+        if (entry->fingerprint == 0) {
+            if (!insert) return NULL;
+            cache_header->count++;
+            victim = entry;
+            break;
+        }
+        if (!victim || entry_newest_ms(entry) < entry_newest_ms(victim)) victim = entry;
+    }
+    if (!insert) return NULL;
+    memset(victim, 0, sizeof(CacheEntry));
+    victim->fingerprint = fingerprint;
+    return victim;
+}
+
+void cache_record_fingerprint(uint64_t fingerprint, const ProbeResult* result) {
+    if (fingerprint == 0 || !result) return;
+    if (!result->success && strcmp(result->error_type, PROBE_ERROR_SKIPPED) == 0) return;
+    long long now = cache_wall_ms();
+    pthread_mutex_lock(&cache_lock);
+    if (cache_header) {
+        CacheEntry* entry = find_entry(fingerprint, 1);
+        CacheSample* sample = &entry->samples[entry->head];
+        sample->time_ms = now;
+        sample->success = result->success ? 1 : 0;
+        sample->error_code = result->success ? PROBE_CODE_NONE : probe_error_code(result->error_type);
+        sample->ttfb_ms = result->ttfb_ms;
+        sample->tcp_connect_ms = result->tcp_connect_ms;
+        sample->total_ms = result->total_ms;
+        sample->reserved = 0;
+        entry->head = (entry->head + 1) % CACHE_SAMPLES;
+        if (entry->count < CACHE_SAMPLES) entry->count++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void cache_record_results(const char** configs, const ProbeResult* results, int n) {
+    if (!configs || !results || !cache_is_open()) return;
+    for (int i = 0; i < n; i++) {
+        if (configs[i]) cache_record_fingerprint(v2root_config_fingerprint(configs[i]), &results[i]);
+    }
+}
+
+int cache_samples(uint64_t fingerprint, CacheSample* out, int max) {
+    int copied = 0;
+    pthread_mutex_lock(&cache_lock);
+    const CacheEntry* entry = cache_header && fingerprint != 0 ? find_entry(fingerprint, 0) : NULL;
+    if (entry) {
+        int count = (int)entry->count < max ? (int)entry->count : max;
+        uint32_t first = (entry->head + CACHE_SAMPLES - (uint32_t)count) % CACHE_SAMPLES;
+        for (; copied < count; copied++) {
+            out[copied] = entry->samples[(first + (uint32_t)copied) % CACHE_SAMPLES];
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return copied;
+}
+
+/*
+ * Appends one probe outcome for a config.
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *   result (const ProbeResult*): The probe outcome.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if no cache is open, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input or a config without a fingerprint.
+ */
+EXPORT int v2root_cache_record(const char* config_str, const ProbeResult* result) {
+    uint64_t fingerprint = config_str ? v2root_config_fingerprint(config_str) : 0;
+    if (fingerprint == 0 || !result) {
+        log_message("Invalid arguments to v2root_cache_record", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    if (!cache_is_open()) return V2ROOT_ERROR;
+    cache_record_fingerprint(fingerprint, result);
+    return V2ROOT_SUCCESS;
+}
+
+/* Summarises the cached samples of fingerprint; returns 0 if it has any, -1 otherwise */
+static int cache_stat(uint64_t fingerprint, long long now, CacheStat* out) {
+    CacheSample samples[CACHE_SAMPLES];
+    int count = cache_samples(fingerprint, samples, CACHE_SAMPLES);
+    memset(out, 0, sizeof(CacheStat));
+    out->fingerprint = fingerprint;
+    if (count == 0) return -1;
+    int latency[CACHE_SAMPLES], tcp[CACHE_SAMPLES];
+    for (int i = 0; i < count; i++) {
+        if (!samples[i].success) continue;
+        latency[out->successes] = samples[i].ttfb_ms > 0 ? samples[i].ttfb_ms : samples[i].total_ms;
+        tcp[out->successes] = samples[i].tcp_connect_ms;
+        out->successes++;
+    }
+    out->samples = count;
+    out->last_success = samples[count - 1].success;
+    out->success_rate = (double)out->successes / count;
+    out->age_ms = now - samples[count - 1].time_ms;
+    if (out->age_ms < 0) out->age_ms = 0;
+    if (out->successes > 0) {
+        out->median_ms = percentile_int(latency, out->successes, 50);
+        out->score = calculate_probe_score(out->median_ms, percentile_int(tcp, out->successes, 50), 1) * out->success_rate;
+    }
+    return 0;
+}
+
+/*
+ * Reads the cached summary of a config.
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *   out (CacheStat*): Receives the summary.
+ *
+ * Returns:
+ *   int: 0 if the config is cached, -1 if it is not or no cache is open, -2 for invalid input.
+ */
+EXPORT int v2root_cache_get(const char* config_str, CacheStat* out) {
+    if (!config_str || !out) {
+        log_message("Invalid arguments to v2root_cache_get", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    return cache_stat(v2root_config_fingerprint(config_str), cache_wall_ms(), out) == 0 ? V2ROOT_SUCCESS : V2ROOT_ERROR;
+}
+
+/*
+ * Picks the config with the best cached score for a warm start.
+ *
+ * Only configs whose newest cached sample succeeded, and is at most max_age_ms old, are
+ * considered, so the pick can be started before anything has been probed in this process.
+ *
+ * Parameters:
+ *   configs (const char**): Candidate configuration strings.
+ *   n (int): Number of candidates.
+ *   max_age_ms (long long): Oldest acceptable sample age, or <= 0 for any age.
+ *
+ * Returns:
+ *   int: Index of the best candidate, -1 if none qualifies or no cache is open,
+ *        -2 for invalid input.
+ */
+EXPORT int v2root_cache_best(const char** configs, int n, long long max_age_ms) {
+    if (!configs || n <= 0) {
+        log_message("Invalid arguments to v2root_cache_best", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    if (!cache_is_open()) return V2ROOT_ERROR;
+    long long now = cache_wall_ms();
+    int best = -1;
+    double best_score = 0.0;
+    CacheStat stat;
+    for (int i = 0; i < n; i++) {
+        if (!configs[i] || cache_stat(v2root_config_fingerprint(configs[i]), now, &stat) != 0) continue;
+        if (!stat.last_success || (max_age_ms > 0 && stat.age_ms > max_age_ms)) continue;
+        if (best < 0 || stat.score > best_score) {
+            best = i;
+            best_score = stat.score;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,93 @@
+#ifndef LIBV2ROOT_CACHE_H
+#define LIBV2ROOT_CACHE_H
+
+#include <stdint.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Persistent probe-result cache.
+ *
+ * A fixed-record file keyed by config fingerprint that keeps the last CACHE_SAMPLES probe
+ * outcomes of each config with their wall-clock times, so latency knowledge survives a
+ * restart. The file is a header followed by an open-addressing table of CacheEntry slots and
+ * is memory-mapped as is: opening it validates the header and maps it, with no parsing, and
+ * lookups touch only the slots of one probe sequence. While a cache is open, the record APIs
+ * and the health monitor write every probe outcome to it, and the monitor seeds newly added
+ * configs from it. One process should use a cache file at a time.
+ */
+
+#define CACHE_MAGIC "V2RCACHE"
+#define CACHE_FILE_VERSION 1
+#define CACHE_SAMPLES 8                     /* Samples kept per config */
+#define CACHE_DEFAULT_CAPACITY 4096         /* Slots of a new cache file */
+#define CACHE_MAX_CAPACITY 1048576
+#define CACHE_MAX_PROBE 16                  /* Slots searched per fingerprint; the oldest is evicted when all are taken */
+
+typedef struct {
+    char magic[8];                  /* CACHE_MAGIC, not terminated */
+    uint32_t version;               /* CACHE_FILE_VERSION */
+    uint32_t entry_size;            /* sizeof(CacheEntry) */
+    uint32_t capacity;              /* Slots; a power of two */
+    uint32_t count;                 /* Occupied slots */
+    uint64_t reserved;
+} CacheHeader;
+
+typedef struct {
+    int64_t time_ms;                /* Wall-clock time of the probe, Unix milliseconds */
+    int32_t success;
+    int32_t error_code;             /* PROBE_CODE_* */
+    int32_t ttfb_ms;
+    int32_t tcp_connect_ms;
+    int32_t total_ms;
+    int32_t reserved;
+} CacheSample;
+
+typedef struct {
+    uint64_t fingerprint;           /* v2root_config_fingerprint, 0 for an empty slot */
+    uint32_t head;                  /* Slot of the next sample */
+    uint32_t count;                 /* Samples stored, at most CACHE_SAMPLES */
+    CacheSample samples[CACHE_SAMPLES];
+} CacheEntry;
+
+/* Summary of one cached config */
+typedef struct {
+    uint64_t fingerprint;
+    int samples;
+    int successes;
+    int last_success;               /* 1 if the newest sample succeeded */
+    int median_ms;                  /* Median latency of the successful samples, 0 if none */
+    double success_rate;
+    double score;                   /* calculate_probe_score of the medians, times success_rate */
+    long long age_ms;               /* Time since the newest sample */
+} CacheStat;
+
+EXPORT int v2root_cache_open(const char* path, int capacity);
+EXPORT int v2root_cache_close(void);
+EXPORT int v2root_cache_record(const char* config_str, const ProbeResult* result);
+EXPORT int v2root_cache_get(const char* config_str, CacheStat* out);
+EXPORT int v2root_cache_best(const char** configs, int n, long long max_age_ms);
+
+/* Returns 1 while a cache file is open */
+int cache_is_open(void);
+
+/* Appends a probe outcome for fingerprint; a no-op without an open cache */
+void cache_record_fingerprint(uint64_t fingerprint, const ProbeResult* result);
+
+/* Appends the outcomes of n probes of configs, skipping entries that were never probed */
+void cache_record_results(const char** configs, const ProbeResult* results, int n);
+
+/* Copies up to max cached samples of fingerprint, oldest first; returns the number copied */
+int cache_samples(uint64_t fingerprint, CacheSample* out, int max);
+
+/* Current wall-clock time in Unix milliseconds */
+long long cache_wall_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_CACHE_H */
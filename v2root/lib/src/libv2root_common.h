@@ -1,6 +1,8 @@
 #ifndef LIBV2ROOT_COMMON_H
 #define LIBV2ROOT_COMMON_H
 
+#include <stdint.h>
+
 #ifdef _WIN32
 #include <windows.h>
 #define EXPORT __declspec(dllexport)
@@ -12,6 +14,12 @@
 #define PID_TYPE pid_t
 #endif
 
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 /* Default proxy ports */
 #define DEFAULT_HTTP_PORT 2300
 #define DEFAULT_SOCKS_PORT 2301
@@ -46,12 +54,43 @@
 
 /* Probe settings */
 #define DEFAULT_DNS_TIMEOUT_MS 1000
+#define DEFAULT_DNS_CACHE_TTL_MS 300000
+#define DEFAULT_DNS_NEGATIVE_TTL_MS 30000
 #define DEFAULT_TCP_TIMEOUT_MS 2500
 #define DEFAULT_TLS_TIMEOUT_MS 3000
 #define DEFAULT_TRANSPORT_TIMEOUT_MS 3000
 #define DEFAULT_TTFB_TIMEOUT_MS 5000
+#define DEFAULT_READY_TIMEOUT_MS 10000
 #define DEFAULT_PROBE_ATTEMPTS 3
 #define MAX_CONCURRENT_PROBES 50
+#define SCORE_REFERENCE_MBPS 10.0       /* Bandwidth at which it earns half its score weight */
+
+/* Loopback ports leased to temporary V2Ray instances */
+#define DEFAULT_PORT_RANGE_FIRST 20000
+#define DEFAULT_PORT_RANGE_LAST 29999
+
+/* Batch probe settings */
+#define MAX_BATCH_CONFIGS 256
+#define MAX_PROBE_SAMPLES 16
+
+/* Selection probe settings */
+#define DEFAULT_SELECT_K 10
+#define DEFAULT_SELECT_FACTOR 3.0
+#define MAX_SELECT_K 64
+#define MIN_ADAPTIVE_TIMEOUT_MS 250     /* Adaptive deadlines never drop below this */
+
+/* Warm pool settings */
+#define POOL_DRAIN_MS 30000             /* Longest a replaced process keeps serving open connections */
+
+/* Health monitor settings */
+#define DEFAULT_MONITOR_PROBES_PER_SECOND 10
+#define DEFAULT_MONITOR_STALE_MS 60000
+
+/* Failover settings */
+#define DEFAULT_FAILOVER_MAX_TTFB_MS 1500
+#define DEFAULT_FAILOVER_MAX_ERROR_RATE 0.3
+#define DEFAULT_FAILOVER_HYSTERESIS 0.15
+#define DEFAULT_FAILOVER_HOLD_MS 30000      /* Minimum time between switches not forced by degradation */
 
 /* Probe endpoints */
 #define PRIMARY_PROBE_URL "https://www.google.com/generate_204"
@@ -63,18 +102,36 @@ typedef struct {
     int success;                    /* 0 = failed, 1 = success */
     int dns_ms;                     /* DNS resolution time */
     int tcp_connect_ms;             /* TCP connect time */
-    int tls_handshake_ms;           /* TLS handshake time */
-    int transport_handshake_ms;     /* Transport-specific handshake */
-    int proxy_setup_ms;             /* Total proxy setup time */
-    int app_connect_ms;             /* Proxied connection time */
+    int tls_handshake_ms;           /* TLS handshake with the probe URL through the tunnel */
+    int transport_handshake_ms;     /* CONNECT through V2Ray and the node, after the local connect */
+    int proxy_setup_ms;             /* Tunnel and TLS setup (transport + TLS handshake) */
+    int app_connect_ms;             /* Request start until the tunnelled TLS session is up */
     int ttfb_ms;                    /* Time to first byte */
     int total_ms;                   /* Total probe time */
     int attempts;                   /* Number of attempts */
     double score;                   /* Normalized score (0.0-1.0) */
     char error_type[64];            /* Error classification */
     char error_details[256];        /* Detailed error message */
+    int dns_cache_hit;              /* 1 if dns_ms was served by the DNS cache */
+    int warm_rtt_ms;                /* Median request RTT over a reused connection (sampled probes) */
+    int v2ray_ready_ms;             /* V2Ray start until its inbound accepted connections (full probes) */
+    int ttfb_p90_ms;                /* 90th percentile of ttfb_ms over the attempts (full probes) */
+    double throughput_mbps;         /* Download rate through the tunnel (bandwidth probes), 0 if not measured */
+    int stalls;                     /* Intervals in which no data arrived (bandwidth probes) */
 } ProbeResult;
 
+/*
+ * Phase timings of one proxied request, in milliseconds from the start of the request.
+ * Phases the platform cannot observe are left at 0.
+ */
+typedef struct {
+    int connect_ms;                 /* TCP connect to the local V2Ray inbound */
+    int tunnel_ms;                  /* CONNECT response received from V2Ray */
+    int app_connect_ms;             /* TLS session with the probe URL established */
+    int ttfb_ms;                    /* First response byte */
+    int total_ms;                   /* Transfer complete */
+} ProbeSample;
+
 /* Error types */
 #define PROBE_ERROR_NONE "none"
 #define PROBE_ERROR_DNS "dns_failure"
@@ -85,5 +142,67 @@ typedef struct {
 #define PROBE_ERROR_UPSTREAM_BLOCKED "upstream_blocked"
 #define PROBE_ERROR_TIMEOUT "timeout"
 #define PROBE_ERROR_UNKNOWN "unknown"
+#define PROBE_ERROR_SKIPPED "skipped"      /* Not probed; a selection sweep stopped early */
+
+/* Error classes of ProbeRecord.error_code, one per PROBE_ERROR_* string */
+#define PROBE_CODE_NONE 0
+#define PROBE_CODE_DNS 1
+#define PROBE_CODE_TCP 2
+#define PROBE_CODE_TLS 3
+#define PROBE_CODE_TRANSPORT 4
+#define PROBE_CODE_AUTH 5
+#define PROBE_CODE_UPSTREAM_BLOCKED 6
+#define PROBE_CODE_TIMEOUT 7
+#define PROBE_CODE_UNKNOWN 8
+#define PROBE_CODE_SKIPPED 9
+#define PROBE_CODE_COUNT 10
+
+/*
+ * Versioned, fixed-layout probe record for the record and streaming APIs.
+ *
+ * Every member has a fixed width and the record starts with its size and version, so bindings
+ * can map it directly. Fields are only ever appended; a caller built against an older version
+ * passes its smaller record size and receives the fields it knows about.
+ */
+#define PROBE_RECORD_VERSION 4
+
+typedef struct {
+    uint32_t size;                  /* Bytes of this record filled by the library */
+    uint32_t version;               /* PROBE_RECORD_VERSION of the library */
+    int32_t index;                  /* Position of the config in the request */
+    int32_t success;                /* 0 = failed, 1 = success */
+    int32_t error_code;             /* PROBE_CODE_* */
+    int32_t http_status;            /* HTTP status of the probe request, 0 if not known */
+    int32_t dns_ms;
+    int32_t tcp_connect_ms;
+    int32_t tls_handshake_ms;
+    int32_t transport_handshake_ms;
+    int32_t proxy_setup_ms;
+    int32_t app_connect_ms;
+    int32_t ttfb_ms;
+    int32_t total_ms;
+    int32_t attempts;
+    int32_t dns_cache_hit;
+    int32_t warm_rtt_ms;
+    int32_t reserved;               /* Keeps score 8-byte aligned */
+    double score;
+    char error_details[256];        /* Detailed error message, empty on success */
+    /* Version 2 */
+    int32_t v2ray_ready_ms;
+    int32_t ttfb_p90_ms;
+    /* Version 3 */
+    int32_t stage;                  /* PROBE_STAGE_* the config reached in a pipeline probe */
+    int32_t reserved_v3;
+    /* Version 4 */
+    double throughput_mbps;
+    int32_t stalls;
+    int32_t reserved_v4;
+} ProbeRecord;
+
+/* Stages of ProbeRecord.stage; records of single-mode probes report PROBE_STAGE_NONE */
+#define PROBE_STAGE_NONE 0
+#define PROBE_STAGE_TCP 1                   /* DNS + TCP connect to the server */
+#define PROBE_STAGE_TLS 2                   /* Direct TLS/REALITY handshake with the server */
+#define PROBE_STAGE_TTFB 3                  /* Proxied request through V2Ray */
 
 #endif /* LIBV2ROOT_COMMON_H */
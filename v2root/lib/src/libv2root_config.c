@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <jansson.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include "libv2root_win.h"
+#else
+#include <unistd.h>
+#include "libv2root_linux.h"
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_config.h"
+#include "libv2root_manage.h"
+#include "libv2root_utils.h"
+
+#ifdef _WIN32
+static volatile LONG config_file_counter = 0;
+
+/*
+ * Opens a temporary, delete-on-close file as a FILE* sink.
+ * Windows has no open_memstream; FILE_ATTRIBUTE_TEMPORARY keeps the data in the cache manager.
+ */
+static FILE* win_open_temp_sink(void) {
+    char dir[MAX_PATH];
+    char path[MAX_PATH];
+    DWORD n = GetTempPathA(sizeof(dir), dir);
+    if (n == 0 || n >= sizeof(dir) || GetTempFileNameA(dir, "v2r", 0, path) == 0) {
+        return NULL;
+    }
+    HANDLE h = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (h == INVALID_HANDLE_VALUE) {
+        DeleteFileA(path);
+        return NULL;
+    }
+    int fd = _open_osfhandle((intptr_t)h, _O_RDWR | _O_BINARY);
+    if (fd < 0) {
+        CloseHandle(h);
+        return NULL;
+    }
+    FILE* fp = _fdopen(fd, "w+b");
+    if (!fp) _close(fd);
+    return fp;
+}
+#endif
+
+/*
+ * Opens an in-memory sink for a generated config.
+ *
+ * Parameters:
+ *   buf (ConfigBuffer*): The buffer to initialize; buf->fp is ready for writing on success.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors if the sink cannot be created.
+ */
+int config_buffer_open(ConfigBuffer* buf) {
+    if (!buf) return -1;
+    memset(buf, 0, sizeof(ConfigBuffer));
+#ifdef _WIN32
+    buf->fp = win_open_temp_sink();
+#else
+    buf->fp = open_memstream(&buf->data, &buf->len);
+#endif
+    if (!buf->fp) {
+        log_message("Failed to open config buffer", __FILE__, __LINE__, errno, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Closes the sink and leaves the written config in buf->data/buf->len.
+ *
+ * Parameters:
+ *   buf (ConfigBuffer*): A buffer opened with config_buffer_open.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors if the written data cannot be collected.
+ */
+int config_buffer_finish(ConfigBuffer* buf) {
+    if (!buf || !buf->fp) return -1;
+#ifdef _WIN32
+    FILE* fp = buf->fp;
+    buf->fp = NULL;
+    long size = -1;
+    if (fflush(fp) == 0 && fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        log_message("Failed to read back config buffer", __FILE__, __LINE__, errno, NULL);
+        return -1;
+    }
+    buf->data = malloc((size_t)size + 1);
+    if (!buf->data || fread(buf->data, 1, (size_t)size, fp) != (size_t)size) {
+        fclose(fp);
+        free(buf->data);
+        buf->data = NULL;
+        log_message("Failed to read back config buffer", __FILE__, __LINE__, errno, NULL);
+        return -1;
+    }
+    buf->data[size] = '\0';
+    buf->len = (size_t)size;
+    fclose(fp);
+#else
+    /* open_memstream updates data/len and NUL-terminates on close */
+    if (fclose(buf->fp) != 0) {
+        buf->fp = NULL;
+        log_message("Failed to finish config buffer", __FILE__, __LINE__, errno, NULL);
+        return -1;
+    }
+    buf->fp = NULL;
+#endif
+    return buf->data ? 0 : -1;
+}
+
+/*
+ * Releases a config buffer and removes any temporary file it was handed to V2Ray through.
+ *
+ * Parameters:
+ *   buf (ConfigBuffer*): The buffer to release; safe to call on a partially initialized buffer.
+ *
+ * Returns:
+ *   None
+ */
+void config_buffer_free(ConfigBuffer* buf) {
+    if (!buf) return;
+    if (buf->fp) fclose(buf->fp);
+    free(buf->data);
+#ifdef _WIN32
+    if (buf->path[0] && !DeleteFileA(buf->path)) {
+        log_message("Failed to delete temporary config", __FILE__, __LINE__, GetLastError(), buf->path);
+    }
+#endif
+    memset(buf, 0, sizeof(ConfigBuffer));
+}
+
+/*
+ * Renders a VLESS, VMess, or Shadowsocks configuration string into memory.
+ *
+ * Parameters:
+ *   config_str (const char*): The configuration string.
+ *   http_port (int): The HTTP inbound port.
+ *   socks_port (int): The SOCKS inbound port.
+ *   buf (ConfigBuffer*): Receives the rendered config; release with config_buffer_free.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Parser errors are logged by the protocol parsers.
+ */
+int render_config_buffer(const char* config_str, int http_port, int socks_port, ConfigBuffer* buf) {
+    if (config_buffer_open(buf) != 0) return -1;
+    if (write_config_for_protocol(config_str, buf->fp, http_port, socks_port) != 0 ||
+        config_buffer_finish(buf) != 0) {
+        config_buffer_free(buf);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Renders a configuration string and extracts its primary outbound.
+ *
+ * The protocol parsers write a complete V2Ray document; it is rendered into memory, loaded
+ * back and the first outbound is detached for reuse in the combined config.
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *
+ * Returns:
+ *   json_t*: A new reference to the outbound object on success, NULL on failure.
+ *
+ * Errors:
+ *   Logs errors for buffer failures, parser failures, or malformed generated JSON.
+ */
+json_t* render_outbound(const char* config_str) {
+    ConfigBuffer config;
+    if (render_config_buffer(config_str, DEFAULT_HTTP_PORT, DEFAULT_SOCKS_PORT, &config) != 0) {
+        return NULL;
+    }
+    json_error_t error;
+    json_t* root = json_loadb(config.data, config.len, 0, &error);
+    config_buffer_free(&config);
+    if (!root) {
+        char err_msg[256];
+        snprintf(err_msg, sizeof(err_msg), "JSON error: %s (line %d, column %d)", error.text, error.line, error.column);
+        log_message("Generated config is not valid JSON", __FILE__, __LINE__, 0, err_msg);
+        return NULL;
+    }
+    json_t* outbound = json_array_get(json_object_get(root, "outbounds"), 0);
+    if (!json_is_object(outbound)) {
+        log_message("Generated config has no outbound", __FILE__, __LINE__, 0, config_str);
+        json_decref(root);
+        return NULL;
+    }
+    json_incref(outbound);
+    json_decref(root);
+    return outbound;
+}
+
+/*
+ * Starts V2Ray on an in-memory config.
+ *
+ * On Linux the config is piped to "v2ray run -c stdin:". On Windows it is written to a unique
+ * temporary file, marked temporary so it normally never reaches the disk, which is removed by
+ * config_buffer_free, and the process joins the managed job object (win_start_v2ray_managed).
+ *
+ * Parameters:
+ *   buf (ConfigBuffer*): A finished config buffer.
+ *   executable (const char*): V2Ray executable path (Windows; Linux runs v2ray from PATH).
+ *   pid (PID_TYPE*): Receives the V2Ray process ID.
+ *
+ * Returns:
+ *   int: 0 on success, a negative value from the platform start function on failure.
+ *
+ * Errors:
+ *   Logs errors for temporary file or process creation failures.
+ */
+int start_v2ray_from_buffer_with(ConfigBuffer* buf, const char* executable, PID_TYPE* pid) {
+    if (!buf || !buf->data || !pid) {
+        log_message("Invalid arguments to start_v2ray_from_buffer", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+#ifdef _WIN32
+    char dir[MAX_PATH];
+    DWORD n = GetTempPathA(sizeof(dir), dir);
+    if (n == 0 || n >= sizeof(dir)) {
+        log_message("Failed to get temporary directory", __FILE__, __LINE__, GetLastError(), NULL);
+        return -1;
+    }
+    snprintf(buf->path, sizeof(buf->path), "%sv2root-%lu-%ld.json", dir,
+             (unsigned long)GetCurrentProcessId(), (long)InterlockedIncrement(&config_file_counter));
+    HANDLE h = CreateFileA(buf->path, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY, NULL);
+    if (h == INVALID_HANDLE_VALUE) {
+        log_message("Failed to create temporary config", __FILE__, __LINE__, GetLastError(), buf->path);
+        buf->path[0] = '\0';
+        return -1;
+    }
+    DWORD written = 0;
+    BOOL ok = WriteFile(h, buf->data, (DWORD)buf->len, &written, NULL) && written == (DWORD)buf->len;
+    CloseHandle(h);
+    if (!ok) {
+        log_message("Failed to write temporary config", __FILE__, __LINE__, GetLastError(), buf->path);
+        return -1;
+    }
+    return win_start_v2ray_managed(buf->path, executable, pid);
+#else
+    (void)executable;
+    return linux_start_v2ray_process_stdin(buf->data, buf->len, pid);
+#endif
+}
+
+/* Starts V2Ray on a finished buffer with the default context's executable */
+int start_v2ray_from_buffer(ConfigBuffer* buf, PID_TYPE* pid) {
+    return start_v2ray_from_buffer_with(buf, get_v2ray_executable_path(), pid);
+}
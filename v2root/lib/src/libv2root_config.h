@@ -0,0 +1,41 @@
+#ifndef LIBV2ROOT_CONFIG_H
+#define LIBV2ROOT_CONFIG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <jansson.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A generated V2Ray config held in memory instead of a fixed file in the working directory */
+typedef struct {
+    FILE* fp;                       /* Sink the protocol parsers write into */
+    char* data;                     /* NUL-terminated config once finished */
+    size_t len;                     /* Length of data in bytes */
+    char path[MAX_PATH_LENGTH];     /* Windows: unique temporary file handed to V2Ray */
+} ConfigBuffer;
+
+int config_buffer_open(ConfigBuffer* buf);
+int config_buffer_finish(ConfigBuffer* buf);
+void config_buffer_free(ConfigBuffer* buf);
+
+/* Renders a configuration string into a finished buffer */
+int render_config_buffer(const char* config_str, int http_port, int socks_port, ConfigBuffer* buf);
+
+/* Renders a configuration string and returns a new reference to its primary outbound */
+json_t* render_outbound(const char* config_str);
+
+/* Starts V2Ray on a finished buffer (stdin on Linux, unique temp file on Windows) */
+int start_v2ray_from_buffer(ConfigBuffer* buf, PID_TYPE* pid);
+
+/* As start_v2ray_from_buffer, with the executable of a specific context (used on Windows) */
+int start_v2ray_from_buffer_with(ConfigBuffer* buf, const char* executable, PID_TYPE* pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_CONFIG_H */
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "libv2root_common.h"
+#include "libv2root_context.h"
+#include "libv2root_utils.h"
+
+static v2root_ctx_t default_ctx = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .http_port = DEFAULT_HTTP_PORT,
+    .socks_port = DEFAULT_SOCKS_PORT,
+    .ready_timeout_ms = DEFAULT_READY_TIMEOUT_MS,
+};
+
+/*
+ * Creates a context with the default ports and readiness timeout.
+ *
+ * The context must be initialized with v2root_ctx_init before V2Ray can be started in it.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   v2root_ctx_t*: The new context, or NULL on allocation failure; release with v2root_ctx_free.
+ */
+EXPORT v2root_ctx_t* v2root_ctx_new(void) {
+    v2root_ctx_t* ctx = calloc(1, sizeof(v2root_ctx_t));
+    if (!ctx) {
+        log_message("Failed to allocate context", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    if (pthread_mutex_init(&ctx->lock, NULL) != 0) {
+        free(ctx);
+        log_message("Failed to initialize context lock", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    ctx->http_port = DEFAULT_HTTP_PORT;
+    ctx->socks_port = DEFAULT_SOCKS_PORT;
+    ctx->ready_timeout_ms = DEFAULT_READY_TIMEOUT_MS;
+    return ctx;
+}
+
+/*
+ * Stops the context's V2Ray process, if any, and releases the context.
+ *
+ * The default context cannot be released; passing it only stops its process.
+ */
+EXPORT void v2root_ctx_free(v2root_ctx_t* ctx) {
+    if (!ctx) return;
+    if (ctx->pid != 0) v2root_ctx_stop(ctx);
+    if (ctx == &default_ctx) return;
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
+/* Returns the context used by the context-free exports */
+EXPORT v2root_ctx_t* v2root_ctx_default(void) {
+    return &default_ctx;
+}
+
+/*
+ * Sets the HTTP and SOCKS ports used by the context's start and parse calls.
+ *
+ * Parameters:
+ *   ctx (v2root_ctx_t*): The context.
+ *   http_port (int): HTTP proxy port (defaults to 2300 if <= 0).
+ *   socks_port (int): SOCKS proxy port (defaults to 2301 if <= 0).
+ *
+ * Returns:
+ *   int: 0 on success, -2 for a NULL context or out-of-range ports.
+ */
+EXPORT int v2root_ctx_set_ports(v2root_ctx_t* ctx, int http_port, int socks_port) {
+    if (!ctx || http_port > 65535 || socks_port > 65535) return V2ROOT_ERROR_INVALID_INPUT;
+    ctx->http_port = http_port > 0 ? http_port : DEFAULT_HTTP_PORT;
+    ctx->socks_port = socks_port > 0 ? socks_port : DEFAULT_SOCKS_PORT;
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Sets the context's upper bound for waiting on a freshly started V2Ray process.
+ *
+ * Parameters:
+ *   ctx (v2root_ctx_t*): The context.
+ *   timeout_ms (int): Readiness timeout in milliseconds (resets to DEFAULT_READY_TIMEOUT_MS if <= 0).
+ *
+ * Returns:
+ *   int: 0 on success, -2 for a NULL context.
+ */
+EXPORT int v2root_ctx_set_ready_timeout(v2root_ctx_t* ctx, int timeout_ms) {
+    if (!ctx) return V2ROOT_ERROR_INVALID_INPUT;
+    ctx->ready_timeout_ms = timeout_ms > 0 ? timeout_ms : DEFAULT_READY_TIMEOUT_MS;
+    return V2ROOT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#ifndef LIBV2ROOT_CONTEXT_H
+#define LIBV2ROOT_CONTEXT_H
+
+#include <pthread.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Library instance state.
+ *
+ * Everything a V2Ray instance needs (paths, ports, process, readiness timeout and result
+ * buffers) lives in a context, so independent contexts can test and probe configs from
+ * different threads at once. The original exports operate on the default context. The
+ * context's ports are those of the proxy started by v2root_ctx_start; tests and probes lease
+ * their own ports from the port allocator.
+ */
+
+#define CONTEXT_SCRATCH_LENGTH 1024
+
+typedef struct v2root_ctx {
+    pthread_mutex_t lock;                       /* Serialises init, start and stop */
+    int initialized;
+    char config_file[MAX_PATH_LENGTH];
+    char executable_path[MAX_PATH_LENGTH];
+    PID_TYPE pid;                               /* Process started by v2root_ctx_start, 0 if none */
+    int starts;                                 /* Successful starts; later ones count as restarts */
+    int http_port;
+    int socks_port;
+    int ready_timeout_ms;
+    char scratch[CONTEXT_SCRATCH_LENGTH];       /* Result of v2root_ctx_measure_ttfb */
+} v2root_ctx_t;
+
+EXPORT v2root_ctx_t* v2root_ctx_new(void);
+EXPORT void v2root_ctx_free(v2root_ctx_t* ctx);
+EXPORT v2root_ctx_t* v2root_ctx_default(void);
+EXPORT int v2root_ctx_set_ports(v2root_ctx_t* ctx, int http_port, int socks_port);
+EXPORT int v2root_ctx_set_ready_timeout(v2root_ctx_t* ctx, int timeout_ms);
+
+/* Implemented in libv2root_manage.c */
+EXPORT int v2root_ctx_init(v2root_ctx_t* ctx, const char* config_file, const char* v2ray_path);
+EXPORT int v2root_ctx_parse_config_string(v2root_ctx_t* ctx, const char* config_str);
+EXPORT int v2root_ctx_start(v2root_ctx_t* ctx, PID_TYPE* pid);
+EXPORT int v2root_ctx_stop(v2root_ctx_t* ctx);
+EXPORT int v2root_ctx_test_connection(v2root_ctx_t* ctx, const char* config_str, int* latency);
+EXPORT int v2root_ctx_probe_full(v2root_ctx_t* ctx, const char* config_str, ProbeResult* result, int attempts);
+EXPORT const char* v2root_ctx_measure_ttfb(v2root_ctx_t* ctx, const char* config_str);
+EXPORT int v2root_ctx_measure_ttfb_record(v2root_ctx_t* ctx, const char* config_str, void* out, size_t record_size);
+
+/* Waits for a process started for ctx to accept connections on port */
+int ctx_wait_for_ready(const v2root_ctx_t* ctx, PID_TYPE pid, int port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_CONTEXT_H */
@@ -2,36 +2,29 @@
 #include <string.h>
 #include "libv2root_core.h"
 #include "libv2root_common.h"
+#include "libv2root_context.h"
 
 /* Core functions are implemented in libv2root_manage.c */
 /* This file serves as the main entry point and can contain */
 /* additional wrapper functions or shared state management */
 
-/* Global configuration state */
-static int g_initialized = 0;
+/*
+ * Check if V2ROOT is initialized
+ */
+int is_v2root_initialized(void) {
+    return __atomic_load_n(&v2root_ctx_default()->initialized, __ATOMIC_ACQUIRE);
+}
 
 /* 
  * Core initialization wrapper
  * Validates and initializes the V2Ray environment
  */
 EXPORT int v2root_init(const char* config_file, const char* v2ray_path) {
-    if (g_initialized) {
+    if (is_v2root_initialized()) {
         return V2ROOT_SUCCESS;
     }
     
-    int result = init_v2ray(config_file, v2ray_path);
-    if (result == V2ROOT_SUCCESS) {
-        g_initialized = 1;
-    }
-    
-    return result;
-}
-
-/*
- * Check if V2ROOT is initialized
- */
-int is_v2root_initialized(void) {
-    return g_initialized;
+    return init_v2ray(config_file, v2ray_path);
 }
 
 /*
@@ -39,5 +32,5 @@ int is_v2root_initialized(void) {
  */
 EXPORT void v2root_cleanup(void) {
     stop_v2ray();
-    g_initialized = 0;
+    __atomic_store_n(&v2root_ctx_default()->initialized, 0, __ATOMIC_RELEASE);
 }
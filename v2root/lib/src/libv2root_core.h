@@ -16,6 +16,7 @@ EXPORT int reset_network_proxy(void);
 
 /* Configuration parsing */
 EXPORT int parse_config_string(const char* config_str, int http_port, int socks_port);
+EXPORT int parse_config_strings_balanced(const char** configs, int k, int http_port, int socks_port, int strategy);
 
 /* Connection testing */
 EXPORT int test_config_connection(const char* config_str, int* latency, int http_port, int socks_port);
@@ -26,6 +27,8 @@ EXPORT int ping_server(const char* address, int port);
 /* Advanced connection testing with end-to-end probe */
 EXPORT int probe_config_full(const char* config_str, ProbeResult* result, int http_port, int socks_port, int attempts);
 EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int http_port, int socks_port);
+EXPORT int probe_config_throughput(const char* config_str, ProbeResult* result, int http_port, int socks_port,
+                                   int streams, int bytes, int budget_ms);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libv2root_common.h"
+#include "libv2root_deadline.h"
+
+/*
+ * Resets a deadline for a new sweep.
+ *
+ * Parameters:
+ *   deadline (ProbeDeadline*): The deadline to reset.
+ *   k (int): Size of the reference set; clamped to 1..MAX_SELECT_K.
+ *   factor (double): Deadline as a multiple of the reference median; at least 1.
+ *   stop (int): Non-zero to stop the sweep once k probes have succeeded.
+ *
+ * Returns:
+ *   None
+ */
+void deadline_init(ProbeDeadline* deadline, int k, double factor, int stop) {
+    memset(deadline, 0, sizeof(ProbeDeadline));
+    if (k < 1) k = 1;
+    if (k > MAX_SELECT_K) k = MAX_SELECT_K;
+    deadline->k = k;
+    deadline->factor = factor < 1.0 ? 1.0 : factor;
+    deadline->stop = stop != 0;
+}
+
+/*
+ * Adds the latency of a successful probe to the reference set.
+ *
+ * The set is kept sorted by insertion; it holds at most MAX_SELECT_K entries, so this stays
+ * cheaper than any probe it accounts for.
+ *
+ * Parameters:
+ *   deadline (ProbeDeadline*): The sweep's deadline.
+ *   latency_ms (int): Latency of the probe.
+ *
+ * Returns:
+ *   None
+ */
+void deadline_observe(ProbeDeadline* deadline, int latency_ms) {
+    int kept = deadline->found < deadline->k ? deadline->found : deadline->k;
+    deadline->found++;
+    if (kept == deadline->k && latency_ms >= deadline->best[kept - 1]) return;
+    int j = kept < deadline->k ? kept : kept - 1;
+    while (j > 0 && deadline->best[j - 1] > latency_ms) {
+        deadline->best[j] = deadline->best[j - 1];
+        j--;
+    }
+    deadline->best[j] = latency_ms;
+}
+
+/*
+ * Returns the time budget of one probe.
+ *
+ * Parameters:
+ *   deadline (const ProbeDeadline*): The sweep's deadline, or NULL for fixed timeouts.
+ *   timeout_ms (int): Fixed timeout of the probe, used until the reference set is full.
+ *
+ * Returns:
+ *   int: Milliseconds a probe may run before it is abandoned.
+ */
+int deadline_ms(const ProbeDeadline* deadline, int timeout_ms) {
+    if (!deadline || deadline->found < deadline->k) return timeout_ms;
+    double adaptive = deadline->factor * deadline->best[deadline->k / 2];
+    int ms = adaptive < (double)timeout_ms ? (int)adaptive : timeout_ms;
+    if (ms < MIN_ADAPTIVE_TIMEOUT_MS) ms = MIN_ADAPTIVE_TIMEOUT_MS;
+    if (deadline->stop && deadline->best[deadline->k - 1] < ms) {
+        /* A probe slower than the k-th best cannot enter the set any more */
+        ms = deadline->best[deadline->k - 1];
+    }
+    return ms;
+}
+
+/*
+ * Tells a sweep whether to start further probes.
+ *
+ * Parameters:
+ *   deadline (const ProbeDeadline*): The sweep's deadline, or NULL for fixed timeouts.
+ *
+ * Returns:
+ *   int: 1 in stop mode once k probes have succeeded, 0 otherwise.
+ */
+int deadline_done(const ProbeDeadline* deadline) {
+    return deadline && deadline->stop && deadline->found >= deadline->k;
+}
+
+/*
+ * Marks a result as not probed because the sweep had already found its k nodes.
+ *
+ * Parameters:
+ *   result (ProbeResult*): The result of the config that was not probed.
+ *
+ * Returns:
+ *   None
+ */
+void deadline_skip(ProbeResult* result) {
+    result->success = 0;
+    result->score = 0.0;
+    strncpy(result->error_type, PROBE_ERROR_SKIPPED, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    snprintf(result->error_details, sizeof(result->error_details), "Not probed: selection already found its nodes");
+}
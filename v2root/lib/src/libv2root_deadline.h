@@ -0,0 +1,50 @@
+#ifndef LIBV2ROOT_DEADLINE_H
+#define LIBV2ROOT_DEADLINE_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Adaptive probe deadlines for selection sweeps.
+ *
+ * A deadline tracks the k fastest latencies seen so far in a sweep. Until k probes have
+ * succeeded every probe gets the fixed timeout; after that a probe is abandoned once it has
+ * run longer than factor times the median of the k fastest, but never sooner than
+ * MIN_ADAPTIVE_TIMEOUT_MS. In stop mode no new probe is started once k have succeeded, and
+ * probes still in flight are cut at the k-th best latency, since they can no longer place.
+ * A sweep over a good list therefore ends early instead of waiting out every dead node.
+ *
+ * The state is not locked; callers that probe from several threads guard it themselves.
+ */
+
+typedef struct {
+    int k;                          /* Size of the reference set */
+    double factor;                  /* Deadline as a multiple of the reference median */
+    int stop;                       /* Non-zero to stop once k probes have succeeded */
+    int found;                      /* Successful probes observed */
+    int best[MAX_SELECT_K];         /* Fastest min(found, k) latencies, ascending */
+} ProbeDeadline;
+
+/* Resets a deadline; k is clamped to 1..MAX_SELECT_K and factor to at least 1 */
+void deadline_init(ProbeDeadline* deadline, int k, double factor, int stop);
+
+/* Adds the latency of a successful probe */
+void deadline_observe(ProbeDeadline* deadline, int latency_ms);
+
+/* Current time budget of one probe in milliseconds, at most timeout_ms (all of it if NULL) */
+int deadline_ms(const ProbeDeadline* deadline, int timeout_ms);
+
+/* Returns 1 when no further probe should be started */
+int deadline_done(const ProbeDeadline* deadline);
+
+/* Marks a result as skipped because the sweep had already found its k nodes */
+void deadline_skip(ProbeResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_DEADLINE_H */
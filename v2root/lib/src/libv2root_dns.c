@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <strings.h>
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_dns.h"
+#include "libv2root_utils.h"
+
+#define DNS_CACHE_BUCKETS 256
+#define DNS_CACHE_MAX_ENTRIES 4096
+#define DNS_MAX_ADDRESSES 8
+#define DNS_MAX_HOST_LENGTH 256
+
+#define DNS_ENTRY_PENDING 0
+#define DNS_ENTRY_READY 1
+
+typedef struct {
+    int family;
+    int addrlen;
+    struct sockaddr_storage addr;
+} DnsAddress;
+
+typedef struct DnsEntry {
+    char host[DNS_MAX_HOST_LENGTH];
+    int state;                          /* DNS_ENTRY_PENDING while a thread resolves it */
+    int status;                         /* 0 or the getaddrinfo error of a negative entry */
+    int count;
+    DnsAddress addrs[DNS_MAX_ADDRESSES];
+    long long expires_ms;
+    struct DnsEntry* next;
+} DnsEntry;
+
+static DnsEntry* dns_buckets[DNS_CACHE_BUCKETS];
+static int dns_entry_count = 0;
+static int dns_ttl_ms = DEFAULT_DNS_CACHE_TTL_MS;
+static int dns_negative_ttl_ms = DEFAULT_DNS_NEGATIVE_TTL_MS;
+static pthread_mutex_t dns_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dns_cond = PTHREAD_COND_INITIALIZER;
+
+/* FNV-1a over the lower-cased host name */
+static unsigned int dns_hash(const char* host) {
+    unsigned int h = 2166136261u;
+    for (const char* p = host; *p; p++) {
+        h ^= (unsigned char)tolower((unsigned char)*p);
+        h *= 16777619u;
+    }
+    return h % DNS_CACHE_BUCKETS;
+}
+
+/*
+ * Drops expired, settled entries; called with dns_lock held when the cache is full.
+ * Pending entries are never dropped because other threads may be waiting on them.
+ */
+static void dns_evict_locked(long long now, int expired_only) {
+    for (int b = 0; b < DNS_CACHE_BUCKETS; b++) {
+        DnsEntry** link = &dns_buckets[b];
+        while (*link) {
+            DnsEntry* entry = *link;
+            if (entry->state == DNS_ENTRY_READY && (!expired_only || entry->expires_ms <= now)) {
+                *link = entry->next;
+                free(entry);
+                dns_entry_count--;
+            } else {
+                link = &entry->next;
+            }
+        }
+    }
+}
+
+/*
+ * Builds a getaddrinfo-style list from a cache entry in a single allocation.
+ *
+ * Parameters:
+ *   entry (const DnsEntry*): A ready, positive cache entry.
+ *   port (unsigned short): Port in host byte order to store in each address.
+ *
+ * Returns:
+ *   struct addrinfo*: The list head, or NULL on allocation failure.
+ */
+static struct addrinfo* dns_build_list(const DnsEntry* entry, unsigned short port) {
+    size_t item = sizeof(struct addrinfo) + sizeof(struct sockaddr_storage);
+    unsigned char* block = calloc((size_t)entry->count, item);
+    if (!block) return NULL;
+    struct addrinfo* head = (struct addrinfo*)block;
+    for (int i = 0; i < entry->count; i++) {
+        struct addrinfo* ai = (struct addrinfo*)(block + i * item);
+        struct sockaddr_storage* ss = (struct sockaddr_storage*)(ai + 1);
+        memcpy(ss, &entry->addrs[i].addr, (size_t)entry->addrs[i].addrlen);
+        if (entry->addrs[i].family == AF_INET6) {
+            ((struct sockaddr_in6*)ss)->sin6_port = htons(port);
+        } else {
+            ((struct sockaddr_in*)ss)->sin_port = htons(port);
+        }
+        ai->ai_family = entry->addrs[i].family;
+        ai->ai_socktype = SOCK_STREAM;
+        ai->ai_protocol = IPPROTO_TCP;
+        ai->ai_addrlen = entry->addrs[i].addrlen;
+        ai->ai_addr = (struct sockaddr*)ss;
+        ai->ai_next = i + 1 < entry->count ? (struct addrinfo*)(block + (i + 1) * item) : NULL;
+    }
+    return head;
+}
+
+/*
+ * Resolves a host through the process-wide DNS cache.
+ *
+ * Positive answers are kept for the TTL set with dns_cache_set_ttl and failures for the
+ * negative TTL. Concurrent lookups of the same uncached name are coalesced: one thread queries
+ * the resolver while the others wait for its answer instead of issuing duplicate queries.
+ *
+ * Parameters:
+ *   host (const char*): Hostname or numeric address.
+ *   port (const char*): Numeric port stored into every returned address.
+ *   res (struct addrinfo**): Receives the address list; free with dns_cache_freeaddrinfo.
+ *   cache_hit (int*): Optional; set to 1 if no resolver query was issued for this call.
+ *
+ * Returns:
+ *   int: 0 on success, or a getaddrinfo EAI_* error code.
+ *
+ * Errors:
+ *   Returns EAI_SERVICE for a non-numeric port and EAI_MEMORY on allocation failure.
+ */
+int dns_cache_getaddrinfo(const char* host, const char* port, struct addrinfo** res, int* cache_hit) {
+    if (cache_hit) *cache_hit = 0;
+    if (!host || !port || !res) return EAI_NONAME;
+    *res = NULL;
+    if (!port[0] || strlen(port) > 5) return EAI_SERVICE;
+    for (const char* p = port; *p; p++) {
+        if (!isdigit((unsigned char)*p)) return EAI_SERVICE;
+    }
+    unsigned short port_num = (unsigned short)atoi(port);
+    if (strlen(host) >= DNS_MAX_HOST_LENGTH) return EAI_NONAME;
+
+    unsigned int bucket = dns_hash(host);
+    int resolved_here = 0;
+    DnsEntry* entry;
+
+    pthread_mutex_lock(&dns_lock);
+    for (;;) {
+        long long now = get_monotonic_ms();
+        for (entry = dns_buckets[bucket]; entry; entry = entry->next) {
+            if (strcasecmp(entry->host, host) == 0) break;
+        }
+        if (entry && entry->state == DNS_ENTRY_PENDING) {
+            pthread_cond_wait(&dns_cond, &dns_lock);
+            continue;
+        }
+        if (entry && entry->expires_ms > now) break;
+
+        /* Miss or expired: claim the entry and resolve outside the lock */
+        if (!entry) {
+            if (dns_entry_count >= DNS_CACHE_MAX_ENTRIES) {
+                dns_evict_locked(now, 1);
+                if (dns_entry_count >= DNS_CACHE_MAX_ENTRIES) dns_evict_locked(now, 0);
+            }
+            entry = calloc(1, sizeof(DnsEntry));
+            if (!entry) {
+                pthread_mutex_unlock(&dns_lock);
+                return EAI_MEMORY;
+            }
+            strncpy(entry->host, host, sizeof(entry->host) - 1);
+            entry->next = dns_buckets[bucket];
+            dns_buckets[bucket] = entry;
+            dns_entry_count++;
+        }
+        entry->state = DNS_ENTRY_PENDING;
+        pthread_mutex_unlock(&dns_lock);
+
+        struct addrinfo hints, *result = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        int status = getaddrinfo(host, NULL, &hints, &result);
+
+        pthread_mutex_lock(&dns_lock);
+        entry->status = status;
+        entry->count = 0;
+        for (struct addrinfo* ai = result; status == 0 && ai && entry->count < DNS_MAX_ADDRESSES; ai = ai->ai_next) {
+            if ((ai->ai_family != AF_INET && ai->ai_family != AF_INET6) || ai->ai_addrlen > sizeof(struct sockaddr_storage)) continue;
+            DnsAddress* addr = &entry->addrs[entry->count++];
+            addr->family = ai->ai_family;
+            addr->addrlen = (int)ai->ai_addrlen;
+            memcpy(&addr->addr, ai->ai_addr, ai->ai_addrlen);
+        }
+        if (result) freeaddrinfo(result);
+        if (status == 0 && entry->count == 0) entry->status = EAI_NONAME;
+        entry->expires_ms = get_monotonic_ms() + (entry->status == 0 ? dns_ttl_ms : dns_negative_ttl_ms);
+        entry->state = DNS_ENTRY_READY;
+        pthread_cond_broadcast(&dns_cond);
+        resolved_here = 1;
+        break;
+    }
+
+    int status = entry->status;
+    if (status == 0) {
+        *res = dns_build_list(entry, port_num);
+        if (!*res) status = EAI_MEMORY;
+    }
+    pthread_mutex_unlock(&dns_lock);
+    if (cache_hit) *cache_hit = !resolved_here;
+    return status;
+}
+
+/*
+ * Releases an address list returned by dns_cache_getaddrinfo.
+ */
+void dns_cache_freeaddrinfo(struct addrinfo* res) {
+    free(res);
+}
+
+/*
+ * Sets the cache lifetime of positive and negative DNS answers.
+ *
+ * Parameters:
+ *   ttl_ms (int): Lifetime of successful answers (resets to DEFAULT_DNS_CACHE_TTL_MS if <= 0).
+ *   negative_ttl_ms (int): Lifetime of failed lookups (resets to DEFAULT_DNS_NEGATIVE_TTL_MS if <= 0).
+ *
+ * Returns:
+ *   int: 0 on success.
+ */
+EXPORT int dns_cache_set_ttl(int ttl_ms, int negative_ttl_ms) {
+    pthread_mutex_lock(&dns_lock);
+    dns_ttl_ms = ttl_ms > 0 ? ttl_ms : DEFAULT_DNS_CACHE_TTL_MS;
+    dns_negative_ttl_ms = negative_ttl_ms > 0 ? negative_ttl_ms : DEFAULT_DNS_NEGATIVE_TTL_MS;
+    pthread_mutex_unlock(&dns_lock);
+    return 0;
+}
+
+/*
+ * Drops every settled DNS cache entry so the next lookups query the resolver again.
+ */
+EXPORT void dns_cache_clear(void) {
+    pthread_mutex_lock(&dns_lock);
+    dns_evict_locked(0, 0);
+    pthread_mutex_unlock(&dns_lock);
+    LOG_INFO("DNS cache cleared", NULL);
+}
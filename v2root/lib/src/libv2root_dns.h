@@ -0,0 +1,28 @@
+#ifndef LIBV2ROOT_DNS_H
+#define LIBV2ROOT_DNS_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#endif
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cached resolution; results must be released with dns_cache_freeaddrinfo */
+int dns_cache_getaddrinfo(const char* host, const char* port, struct addrinfo** res, int* cache_hit);
+void dns_cache_freeaddrinfo(struct addrinfo* res);
+
+/* Cache control */
+EXPORT int dns_cache_set_ttl(int ttl_ms, int negative_ttl_ms);
+EXPORT void dns_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_DNS_H */
@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_failover.h"
+#include "libv2root_monitor.h"
+#include "libv2root_pool.h"
+#include "libv2root_utils.h"
+
+static pthread_mutex_t failover_control_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile int failover_running;
+static pthread_t failover_thread;
+static FailoverCallback failover_callback;
+static volatile int failover_active_id = -1;
+static int failover_http_port;
+static int failover_socks_port;
+static int failover_max_ttfb_ms;
+static double failover_max_error_rate;
+static double failover_hysteresis;
+static int failover_hold_ms;
+
+static void failover_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)ms * 1000);
+#endif
+}
+
+static void emit(int event, int from_id, int to_id, const char* reason) {
+    LOG_INFOF("Failover event", "Event %d, from %d to %d: %s", event, from_id, to_id, reason);
+    FailoverCallback callback = __atomic_load_n(&failover_callback, __ATOMIC_ACQUIRE);
+    if (callback) callback(event, from_id, to_id, reason);
+}
+
+/* Returns 1 and describes the crossing in reason if the node is over either threshold */
+static int is_degraded(const MonitorStat* stat, char* reason, size_t size) {
+    if (stat->samples < FAILOVER_MIN_SAMPLES) return 0;
+    double error_rate = 1.0 - stat->success_rate;
+    if (error_rate > failover_max_error_rate) {
+        snprintf(reason, size, "error rate %.0f%% above %.0f%%", error_rate * 100, failover_max_error_rate * 100);
+        return 1;
+    }
+    if (stat->ewma_ms > failover_max_ttfb_ms) {
+        snprintf(reason, size, "latency %.0f ms above %d ms", stat->ewma_ms, failover_max_ttfb_ms);
+        return 1;
+    }
+    return 0;
+}
+
+/* Candidates must clear both thresholds by the hysteresis margin, so a switch is not undone at once */
+static int is_healthy(const MonitorStat* stat) {
+    if (stat->samples < 1 || !stat->last_success) return 0;
+    double margin = 1.0 - failover_hysteresis;
+    return 1.0 - stat->success_rate <= failover_max_error_rate * margin &&
+           stat->ewma_ms <= failover_max_ttfb_ms * margin;
+}
+
+static int pool_start_on(int id) {
+    char* config = monitor_config_dup(id);
+    if (!config) return V2ROOT_ERROR;
+    int result = v2root_pool_start(config, failover_http_port, failover_socks_port, 0);
+    free(config);
+    return result;
+}
+
+static int pool_prepare_on(int id) {
+    char* config = monitor_config_dup(id);
+    if (!config) return V2ROOT_ERROR;
+    int result = v2root_pool_prepare(config);
+    free(config);
+    return result;
+}
+
+/*
+ * Controller loop.
+ *
+ * Every FAILOVER_CHECK_MS the monitor snapshot is scanned for the best healthy node that is not
+ * active. The active node is switched away from when it is degraded, or when the standby's score
+ * beats it by the hysteresis factor and hold_ms has passed since the last switch. The standby is
+ * replaced when it turns unhealthy or, again subject to hysteresis and hold_ms, when a better
+ * node appears. A node whose pool operation failed is skipped for hold_ms.
+ */
+static void* failover_worker(void* arg) {
+    (void)arg;
+    MonitorStat* stats = malloc(MONITOR_MAX_CONFIGS * sizeof(MonitorStat));
+    if (!stats) {
+        log_message("Failed to allocate failover state", __FILE__, __LINE__, 0, NULL);
+        failover_running = 0;
+        return NULL;
+    }
+    int active = -1;
+    int standby = -1;
+    long long last_switch = 0;
+    long long standby_since = 0;
+    int degraded_reported = 0;
+    int failed_id = -1;
+    long long failed_at = 0;
+    char reason[FAILOVER_REASON_LENGTH];
+
+    while (failover_running) {
+        long long now = get_monotonic_ms();
+        if (active >= 0 && !v2root_pool_status(NULL, NULL)) {
+            active = -1;
+            standby = -1;
+        }
+        int count = v2root_monitor_snapshot(stats, MONITOR_MAX_CONFIGS);
+        const MonitorStat* best = NULL;
+        const MonitorStat* active_stat = NULL;
+        const MonitorStat* standby_stat = NULL;
+        for (int i = 0; i < count; i++) {
+            const MonitorStat* stat = &stats[i];
+            if (stat->id == active) {
+                active_stat = stat;
+                continue;
+            }
+            if (stat->id == standby) standby_stat = stat;
+            if (!best && is_healthy(stat) && !(stat->id == failed_id && now - failed_at < failover_hold_ms)) {
+                best = stat;
+            }
+        }
+
+        if (active < 0) {
+            if (best) {
+                int id = best->id;
+                if (pool_start_on(id) == V2ROOT_SUCCESS) {
+                    active = id;
+                    standby = -1;
+                    last_switch = now;
+                    failover_active_id = active;
+                    monitor_watch(active, FAILOVER_WATCH_MS);
+                    snprintf(reason, sizeof(reason), "best score %.2f", best->score);
+                    emit(FAILOVER_EVENT_STARTED, -1, active, reason);
+                } else {
+                    failed_id = id;
+                    failed_at = now;
+                    emit(FAILOVER_EVENT_ERROR, -1, id, "pool start failed");
+                }
+            }
+        } else {
+            int degraded = active_stat ? is_degraded(active_stat, reason, sizeof(reason)) : 1;
+            if (!active_stat) snprintf(reason, sizeof(reason), "node removed from the monitor");
+            int standby_ok = standby_stat && is_healthy(standby_stat);
+            int target = -1;
+            if (degraded) {
+                if (!standby_ok && best) {
+                    if (pool_prepare_on(best->id) == V2ROOT_SUCCESS) {
+                        standby = best->id;
+                        standby_stat = best;
+                        standby_since = now;
+                        standby_ok = 1;
+                    } else {
+                        failed_id = best->id;
+                        failed_at = now;
+                        emit(FAILOVER_EVENT_ERROR, active, best->id, "standby start failed");
+                    }
+                }
+                if (standby_ok) {
+                    target = standby;
+                } else if (!degraded_reported) {
+                    degraded_reported = 1;
+                    emit(FAILOVER_EVENT_DEGRADED, active, -1, reason);
+                }
+            } else {
+                degraded_reported = 0;
+                if (standby_ok && standby_stat->score > active_stat->score * (1.0 + failover_hysteresis) &&
+                    now - last_switch >= failover_hold_ms) {
+                    target = standby;
+                    snprintf(reason, sizeof(reason), "score %.2f over %.2f", standby_stat->score, active_stat->score);
+                }
+            }
+            if (target >= 0) {
+                int from = active;
+                if (v2root_pool_switch() == V2ROOT_SUCCESS) {
+                    active = target;
+                    last_switch = now;
+                    degraded_reported = 0;
+                    failover_active_id = active;
+                    monitor_watch(active, FAILOVER_WATCH_MS);
+                    emit(FAILOVER_EVENT_SWITCHED, from, active, reason);
+                } else {
+                    emit(FAILOVER_EVENT_ERROR, from, target, "switch failed");
+                }
+                standby = -1;
+                standby_stat = NULL;
+            }
+
+            if (best && best->id != active && best->id != standby) {
+                int replace = !standby_stat || !is_healthy(standby_stat) ||
+                              (best->score > standby_stat->score * (1.0 + failover_hysteresis) &&
+                               now - standby_since >= failover_hold_ms);
+                if (replace) {
+                    int id = best->id;
+                    if (pool_prepare_on(id) == V2ROOT_SUCCESS) {
+                        standby = id;
+                        standby_since = get_monotonic_ms();
+                        snprintf(reason, sizeof(reason), "score %.2f", best->score);
+                        emit(FAILOVER_EVENT_STANDBY, active, standby, reason);
+                    } else {
+                        standby = -1;
+                        failed_id = id;
+                        failed_at = now;
+                        emit(FAILOVER_EVENT_ERROR, active, id, "standby start failed");
+                    }
+                }
+            }
+        }
+
+        long long elapsed = get_monotonic_ms() - now;
+        if (elapsed < FAILOVER_CHECK_MS) failover_sleep_ms((int)(FAILOVER_CHECK_MS - elapsed));
+    }
+    free(stats);
+    return NULL;
+}
+
+/*
+ * Sets the callback that receives failover events, or clears it with NULL.
+ *
+ * The callback runs on the controller thread; see FailoverCallback.
+ */
+EXPORT void v2root_failover_set_callback(FailoverCallback callback) {
+    __atomic_store_n(&failover_callback, callback, __ATOMIC_RELEASE);
+}
+
+/*
+ * Starts the failover controller.
+ *
+ * The controller owns the warm pool: once the health monitor (v2root_monitor_start) has a
+ * healthy node, the pool is started on it with the relay on http_port and socks_port, and
+ * from then on nodes are chosen and switched automatically. If the pool is stopped behind the
+ * controller's back it is started again on the best node.
+ *
+ * Parameters:
+ *   http_port (int): User-facing HTTP proxy port (defaults to 2300 if <= 0).
+ *   socks_port (int): User-facing SOCKS proxy port (defaults to 2301 if <= 0).
+ *   max_ttfb_ms (int): Rolling latency above which the active node is degraded
+ *                      (defaults to DEFAULT_FAILOVER_MAX_TTFB_MS if <= 0).
+ *   max_error_rate (double): Rolling error rate above which the active node is degraded
+ *                            (defaults to DEFAULT_FAILOVER_MAX_ERROR_RATE if <= 0).
+ *   hysteresis (double): Margin (0.0-1.0) by which candidates must clear the thresholds and
+ *                        a better node must beat the active score (default if < 0).
+ *   hold_ms (int): Minimum time between switches the active node's health does not force
+ *                  (defaults to DEFAULT_FAILOVER_HOLD_MS if < 0).
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 for invalid input, -7 if the controller or the pool
+ *        is already running.
+ *
+ * Errors:
+ *   Logs errors for invalid arguments or thread creation failures.
+ */
+EXPORT int v2root_failover_start(int http_port, int socks_port, int max_ttfb_ms, double max_error_rate,
+                                 double hysteresis, int hold_ms) {
+    if (hysteresis >= 1.0 || max_error_rate >= 1.0) {
+        log_message("Invalid failover hysteresis or error rate", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    pthread_mutex_lock(&failover_control_lock);
+    if (failover_running || v2root_pool_status(NULL, NULL)) {
+        pthread_mutex_unlock(&failover_control_lock);
+        log_message("Failover or pool already running", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_ALREADY_RUNNING;
+    }
+    failover_http_port = http_port;
+    failover_socks_port = socks_port;
+    failover_max_ttfb_ms = max_ttfb_ms > 0 ? max_ttfb_ms : DEFAULT_FAILOVER_MAX_TTFB_MS;
+    failover_max_error_rate = max_error_rate > 0 ? max_error_rate : DEFAULT_FAILOVER_MAX_ERROR_RATE;
+    failover_hysteresis = hysteresis >= 0 ? hysteresis : DEFAULT_FAILOVER_HYSTERESIS;
+    failover_hold_ms = hold_ms >= 0 ? hold_ms : DEFAULT_FAILOVER_HOLD_MS;
+    failover_active_id = -1;
+    failover_running = 1;
+    if (pthread_create(&failover_thread, NULL, failover_worker, NULL) != 0) {
+        failover_running = 0;
+        pthread_mutex_unlock(&failover_control_lock);
+        log_message("Failed to start failover thread", __FILE__, __LINE__, errno, NULL);
+        return V2ROOT_ERROR;
+    }
+    pthread_mutex_unlock(&failover_control_lock);
+    LOG_INFOF("Failover started", "Max latency %d ms, max error rate %.2f, hysteresis %.2f, hold %d ms",
+              failover_max_ttfb_ms, failover_max_error_rate, failover_hysteresis, failover_hold_ms);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Stops the failover controller and the pool it runs.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the controller is not running.
+ */
+EXPORT int v2root_failover_stop(void) {
+    pthread_mutex_lock(&failover_control_lock);
+    if (!failover_running) {
+        pthread_mutex_unlock(&failover_control_lock);
+        return V2ROOT_ERROR;
+    }
+    failover_running = 0;
+    pthread_join(failover_thread, NULL);
+    if (v2root_pool_status(NULL, NULL)) v2root_pool_stop();
+    monitor_watch(-1, 0);
+    failover_active_id = -1;
+    pthread_mutex_unlock(&failover_control_lock);
+    LOG_INFO("Failover stopped", NULL);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Returns the monitor handle of the node currently serving traffic, or -1 if there is none.
+ */
+EXPORT int v2root_failover_active(void) {
+    return failover_active_id;
+}
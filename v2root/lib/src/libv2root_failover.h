@@ -0,0 +1,47 @@
+#ifndef LIBV2ROOT_FAILOVER_H
+#define LIBV2ROOT_FAILOVER_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Automatic failover.
+ *
+ * A controller thread reads the health monitor's rankings, runs the best node in the warm pool
+ * and keeps the best healthy alternative prepared as the pool's standby. When the active node's
+ * rolling latency or error rate crosses its threshold, traffic is moved to the standby with a
+ * relay retarget, so the switch itself costs no V2Ray start-up time.
+ */
+
+#define FAILOVER_CHECK_MS 100               /* Controller period */
+#define FAILOVER_WATCH_MS 2000              /* Probe interval of the active node */
+#define FAILOVER_MIN_SAMPLES 3              /* Samples before a node may be judged degraded */
+#define FAILOVER_REASON_LENGTH 128
+
+/* Events passed to the failover callback */
+#define FAILOVER_EVENT_STARTED 0            /* The pool was started on to_id */
+#define FAILOVER_EVENT_STANDBY 1            /* to_id was prepared as the standby */
+#define FAILOVER_EVENT_SWITCHED 2           /* Traffic moved from from_id to to_id */
+#define FAILOVER_EVENT_DEGRADED 3           /* from_id crossed a threshold with no healthy alternative */
+#define FAILOVER_EVENT_ERROR 4              /* A pool operation for to_id failed */
+
+/*
+ * Called on the controller thread with monitor handles (-1 where not applicable) and a short
+ * human-readable reason; it must return quickly.
+ */
+typedef void (*FailoverCallback)(int event, int from_id, int to_id, const char* reason);
+
+EXPORT void v2root_failover_set_callback(FailoverCallback callback);
+EXPORT int v2root_failover_start(int http_port, int socks_port, int max_ttfb_ms, double max_error_rate,
+                                 double hysteresis, int hold_ms);
+EXPORT int v2root_failover_stop(void);
+EXPORT int v2root_failover_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_FAILOVER_H */
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cJSON.h"
+#include "libv2root_arena.h"
+#include "libv2root_common.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_uri.h"
+#include "libv2root_base64.h"
+
+/*
+ * Canonical config fingerprints.
+ *
+ * A fingerprint is computed from the parsed fields of a link rather than its text: the remark
+ * (#fragment, remarks= or the VMess "ps" field) is dropped, hosts are lowercased, ports are
+ * normalised, percent-escapes and base64 userinfo are decoded, and each field is hashed on its
+ * own and summed so the order of query parameters or JSON keys does not matter.
+ */
+
+#define FP_SEED 1469598103934665603ULL
+#define FP_PRIME 1099511628211ULL
+
+/* Values longer than this are hashed without percent-decoding */
+#define FP_DECODE_LIMIT 1024
+
+static uint64_t fp_fnv(uint64_t h, const char* s, size_t len, int lower) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        h ^= lower ? (unsigned char)tolower(c) : c;
+        h *= FP_PRIME;
+    }
+    return h;
+}
+
+/* splitmix64 finalizer; spreads each field hash before it is summed */
+static uint64_t fp_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Adds one tag/key/value field to the accumulator; empty values are treated as absent */
+static void fp_field(uint64_t* acc, const char* tag, StrView key, StrView value, int lower) {
+    if (value.len == 0) return;
+    uint64_t h = fp_fnv(FP_SEED, tag, strlen(tag) + 1, 0);
+    h = fp_fnv(h, key.ptr, key.len, 0);
+    h = fp_fnv(h, "", 1, 0);
+    h = fp_fnv(h, value.ptr, value.len, lower);
+    *acc += fp_mix(h);
+}
+
+/* As fp_field, percent-decoding key and value first */
+static void fp_field_decoded(uint64_t* acc, const char* tag, StrView key, StrView value) {
+    char kbuf[128];
+    char vbuf[FP_DECODE_LIMIT];
+    if (key.len < sizeof(kbuf)) key = (StrView){ kbuf, uri_decode(key, kbuf, sizeof(kbuf)) };
+    if (value.len < sizeof(vbuf)) value = (StrView){ vbuf, uri_decode(value, vbuf, sizeof(vbuf)) };
+    fp_field(acc, tag, key, value, 0);
+}
+
+static void fp_port(uint64_t* acc, int port) {
+    char buf[8];
+    int n = snprintf(buf, sizeof(buf), "%d", port);
+    fp_field(acc, "p", SV_LIT(""), (StrView){ buf, (size_t)n }, 0);
+}
+
+/* VMess: every JSON field but the remark, with numbers and numeric strings hashed alike */
+static int fp_vmess(uint64_t* acc, StrView body) {
+    size_t json_len;
+    ArenaMark scratch = arena_begin();
+    char* json_str = base64_decode_scratch(body.ptr, body.len, &json_len);
+    cJSON* json = json_str ? cJSON_Parse(json_str) : NULL;
+    if (!json) {
+        arena_end(scratch);
+        return -1;
+    }
+    for (cJSON* item = json->child; item; item = item->next) {
+        if (!item->string || strcmp(item->string, "ps") == 0 || strcmp(item->string, "v") == 0) continue;
+        StrView key = { item->string, strlen(item->string) };
+        char num[32];
+        StrView value = { NULL, 0 };
+        if (cJSON_IsString(item)) {
+            value = (StrView){ item->valuestring, strlen(item->valuestring) };
+        } else if (cJSON_IsNumber(item)) {
+            value = (StrView){ num, (size_t)snprintf(num, sizeof(num), "%d", item->valueint) };
+        } else {
+            continue;
+        }
+        if (sv_eq(key, "port")) {
+            int port = sv_to_port(value);
+            if (port > 0) fp_port(acc, port);
+        } else {
+            fp_field(acc, "j", key, value, sv_eq(key, "add"));
+        }
+    }
+    cJSON_Delete(json);
+    arena_end(scratch);
+    return 0;
+}
+
+/* URI formats: userinfo, host, port, path and every query parameter but a remark */
+static int fp_uri(uint64_t* acc, const UriParts* split, int is_ss) {
+    UriParts uri = *split;
+    StrView authority = uri.body;
+    const char* slash = memchr(authority.ptr, '/', authority.len);
+    if (slash) {
+        authority.len = (size_t)(slash - authority.ptr);
+        uri.path = (StrView){ slash, uri.body.len - authority.len };
+    }
+
+    char legacy[FP_DECODE_LIMIT];
+    if (is_ss && authority.len < sizeof(legacy) && base64_is_encoded(authority.ptr, authority.len)) {
+        int n = base64_decode_into(authority.ptr, authority.len, (unsigned char*)legacy, sizeof(legacy) - 1);
+        if (n > 0) authority = (StrView){ legacy, (size_t)n };
+    }
+    if (uri_parse_authority(authority.ptr, authority.len, &uri) != 0) return -1;
+    int port = sv_to_port(uri.port);
+    if (port < 0) return -1;
+
+    fp_field(acc, "h", SV_LIT(""), uri.host, 1);
+    fp_port(acc, port);
+
+    char userinfo[FP_DECODE_LIMIT];
+    if (is_ss && uri.userinfo.len < sizeof(userinfo) && memchr(uri.userinfo.ptr, ':', uri.userinfo.len) == NULL) {
+        int n = base64_decode_into(uri.userinfo.ptr, uri.userinfo.len, (unsigned char*)userinfo, sizeof(userinfo) - 1);
+        if (n > 0) uri.userinfo = (StrView){ userinfo, (size_t)n };
+    }
+    fp_field_decoded(acc, "u", SV_LIT(""), uri.userinfo);
+    if (!(uri.path.len == 1 && uri.path.ptr[0] == '/')) fp_field_decoded(acc, "path", SV_LIT(""), uri.path);
+
+    StrView query = uri.query;
+    StrView key, value;
+    while (uri_next_param(&query, &key, &value)) {
+        if (sv_eq(key, "remarks") || sv_eq(key, "remark")) continue;
+        fp_field_decoded(acc, "q", key, value);
+    }
+    return 0;
+}
+
+/*
+ * Computes the canonical fingerprint of a share link.
+ *
+ * Two links whose fingerprints match connect to the same server with the same settings and
+ * differ at most in their remark, parameter order or encoding.
+ *
+ * Parameters:
+ *   config (const char*): The link; need not be NUL-terminated.
+ *   len (size_t): Length of config in bytes.
+ *
+ * Returns:
+ *   uint64_t: The fingerprint (never 0), or 0 if the link cannot be parsed.
+ */
+uint64_t config_fingerprint(const char* config, size_t len) {
+    UriParts uri;
+    if (!config || uri_split(config, len, &uri) != 0) return 0;
+    uint64_t acc = 0;
+    fp_field(&acc, "s", SV_LIT(""), uri.scheme, 1);
+    int rc;
+    if (sv_eq(uri.scheme, "vmess")) {
+        rc = fp_vmess(&acc, uri.body);
+    } else {
+        rc = fp_uri(&acc, &uri, sv_eq(uri.scheme, "ss"));
+    }
+    if (rc != 0) return 0;
+    uint64_t fp = fp_mix(acc);
+    return fp ? fp : 1;
+}
+
+/*
+ * Computes the canonical fingerprint of a NUL-terminated share link.
+ *
+ * Parameters:
+ *   config (const char*): A VLESS, VMess, Shadowsocks or other scheme://host:port link.
+ *
+ * Returns:
+ *   uint64_t: The fingerprint (never 0), or 0 if the link cannot be parsed.
+ */
+EXPORT uint64_t v2root_config_fingerprint(const char* config) {
+    return config ? config_fingerprint(config, strlen(config)) : 0;
+}
+
+/*
+ * Computes the fingerprint of a server endpoint.
+ *
+ * Configs sharing an endpoint fingerprint resolve and connect to the same place, so DNS and
+ * TCP probe results can be shared between them.
+ *
+ * Parameters:
+ *   host (const char*): Host name or address; compared case-insensitively.
+ *   port (int): Server port.
+ *
+ * Returns:
+ *   uint64_t: The fingerprint (never 0), or 0 for a NULL host.
+ */
+EXPORT uint64_t v2root_endpoint_fingerprint(const char* host, int port) {
+    if (!host) return 0;
+    uint64_t h = fp_fnv(FP_SEED, host, strlen(host), 1);
+    h ^= (uint64_t)(unsigned)port;
+    h = fp_mix(h * FP_PRIME);
+    return h ? h : 1;
+}
+
+/*
+ * Allocates an index for up to expected keys.
+ *
+ * Parameters:
+ *   index (FpIndex*): The index to initialise.
+ *   expected (size_t): Upper bound on the number of keys that will be inserted.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on allocation failure.
+ */
+int fp_index_init(FpIndex* index, size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) capacity <<= 1;
+    index->keys = calloc(capacity, sizeof(uint64_t));
+    index->values = malloc(capacity * sizeof(int));
+    if (!index->keys || !index->values) {
+        free(index->keys);
+        free(index->values);
+        memset(index, 0, sizeof(FpIndex));
+        return -1;
+    }
+    index->mask = capacity - 1;
+    index->count = 0;
+    return 0;
+}
+
+void fp_index_free(FpIndex* index) {
+    free(index->keys);
+    free(index->values);
+    memset(index, 0, sizeof(FpIndex));
+}
+
+int fp_index_insert(FpIndex* index, uint64_t key, int value) {
+    if (key == 0) key = 1;
+    for (size_t i = fp_mix(key) & index->mask, probes = 0; probes <= index->mask; i = (i + 1) & index->mask, probes++) {
+        if (index->keys[i] == key) return index->values[i];
+        if (index->keys[i] == 0) {
+            if (index->count * 2 >= index->mask + 1) return -2;
+            index->keys[i] = key;
+            index->values[i] = value;
+            index->count++;
+            return -1;
+        }
+    }
+    return -2;
+}
+
+int fp_index_find(const FpIndex* index, uint64_t key) {
+    if (key == 0) key = 1;
+    for (size_t i = fp_mix(key) & index->mask, probes = 0; probes <= index->mask; i = (i + 1) & index->mask, probes++) {
+        if (index->keys[i] == key) return index->values[i];
+        if (index->keys[i] == 0) return -1;
+    }
+    return -1;
+}
@@ -0,0 +1,44 @@
+#ifndef LIBV2ROOT_FINGERPRINT_H
+#define LIBV2ROOT_FINGERPRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Open-addressing map from 64-bit fingerprints to record indices.
+ *
+ * Sized once for an expected number of keys at a load factor of at most one half, so inserts
+ * and lookups stay O(1) and merging n configs is O(n).
+ */
+typedef struct {
+    uint64_t* keys;             /* 0 marks an empty slot */
+    int* values;
+    size_t mask;                /* Capacity - 1; the capacity is a power of two */
+    size_t count;
+} FpIndex;
+
+int fp_index_init(FpIndex* index, size_t expected);
+void fp_index_free(FpIndex* index);
+
+/* Returns the value already stored for key, or -1 after storing value; -2 if the index is full */
+int fp_index_insert(FpIndex* index, uint64_t key, int value);
+
+/* Returns the value stored for key, or -1 if absent */
+int fp_index_find(const FpIndex* index, uint64_t key);
+
+/* Canonical fingerprint of a share link of len bytes; 0 if it cannot be parsed */
+uint64_t config_fingerprint(const char* config, size_t len);
+
+EXPORT uint64_t v2root_config_fingerprint(const char* config);
+EXPORT uint64_t v2root_endpoint_fingerprint(const char* host, int port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_FINGERPRINT_H */
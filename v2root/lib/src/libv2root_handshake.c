@@ -0,0 +1,931 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET hs_socket_t;
+typedef WSAPOLLFD hs_pollfd_t;
+#define CLOSE_SOCKET closesocket
+#define HS_POLL(fds, n, ms) WSAPoll(fds, (ULONG)(n), ms)
+#define HS_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SEND_FLAGS 0
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+typedef int hs_socket_t;
+typedef struct pollfd hs_pollfd_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#define HS_POLL(fds, n, ms) poll(fds, (nfds_t)(n), ms)
+#define HS_WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS)
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#include <jansson.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include "libv2root_common.h"
+#include "libv2root_handshake.h"
+#include "libv2root_arena.h"
+#include "libv2root_config.h"
+#include "libv2root_dns.h"
+#include "libv2root_metrics.h"
+#include "libv2root_utils.h"
+
+#define HS_VLESS 1
+#define HS_SHADOWSOCKS 2
+
+/* Connection phases, in order */
+#define HS_CONNECT 0
+#define HS_TLS 1
+#define HS_SEND 2                       /* Draining out; then HS_UPGRADE or HS_REPLY */
+#define HS_UPGRADE 3                    /* Waiting for the WebSocket 101 */
+#define HS_REPLY 4                      /* Waiting for the protocol reply */
+#define HS_DONE 5
+
+/* hs_read/hs_write results besides a byte count */
+#define HS_AGAIN 0
+#define HS_EOF (-1)
+#define HS_IO_ERROR (-2)
+
+#define SS_TAG_SIZE 16
+#define SS_NONCE_SIZE 12
+
+/* What to say to one server, taken from the config's rendered outbound */
+typedef struct {
+    int protocol;                   /* HS_VLESS or HS_SHADOWSOCKS */
+    char host[256];
+    char port[16];
+    int tls;                        /* Negotiate TLS first */
+    int tls_only;                   /* Stop after TLS; the protocol cannot be spoken (REALITY) */
+    char sni[256];
+    unsigned char alpn[64];         /* ALPN protocol list in wire format */
+    int alpn_len;
+    int ws;                         /* Upgrade to WebSocket before the protocol */
+    char ws_path[256];
+    char ws_host[256];
+    unsigned char uuid[16];         /* VLESS user */
+    const EVP_CIPHER* cipher;       /* Shadowsocks AEAD cipher */
+    unsigned char key[32];          /* Shadowsocks master key */
+    int key_len;
+} HsTarget;
+
+/* One in-flight handshake */
+typedef struct {
+    HsTarget target;
+    ProbeResult* result;
+    hs_socket_t fd;
+    SSL* ssl;
+    int phase;
+    int next_phase;                 /* Phase entered once out is drained */
+    short events;                   /* Poll events the current phase waits for */
+    long long start_ms;
+    long long protocol_ms;          /* When the transport upgrade or protocol request began */
+    unsigned char out[HANDSHAKE_BUFFER_SIZE];
+    int out_len;
+    int out_sent;
+    unsigned char in[HANDSHAKE_BUFFER_SIZE];
+    int in_len;
+} HsConn;
+
+static void hs_fail(HsConn* conn, const char* error_type, const char* format, ...) {
+    ProbeResult* result = conn->result;
+    result->success = 0;
+    result->score = 0.0;
+    strncpy(result->error_type, error_type, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    va_list args;
+    va_start(args, format);
+    vsnprintf(result->error_details, sizeof(result->error_details), format, args);
+    va_end(args);
+    conn->phase = HS_DONE;
+}
+
+static void hs_mark_unsupported(ProbeResult* result) {
+    result->success = 0;
+    result->attempts = 0;
+    strncpy(result->error_type, PROBE_ERROR_SKIPPED, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    snprintf(result->error_details, sizeof(result->error_details), "Direct handshake not supported for this config");
+}
+
+/* Parses a textual UUID, with or without dashes */
+static int hs_parse_uuid(const char* text, unsigned char* out) {
+    int nibbles = 0;
+    for (const char* p = text; *p; p++) {
+        if (*p == '-') continue;
+        int v;
+        if (*p >= '0' && *p <= '9') v = *p - '0';
+        else if (*p >= 'a' && *p <= 'f') v = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F') v = *p - 'A' + 10;
+        else return -1;
+        if (nibbles >= 32) return -1;
+        if (nibbles % 2 == 0) out[nibbles / 2] = (unsigned char)(v << 4);
+        else out[nibbles / 2] |= (unsigned char)v;
+        nibbles++;
+    }
+    return nibbles == 32 ? 0 : -1;
+}
+
+static const EVP_CIPHER* hs_ss_cipher(const char* method) {
+    if (strcmp(method, "aes-128-gcm") == 0) return EVP_aes_128_gcm();
+    if (strcmp(method, "aes-256-gcm") == 0) return EVP_aes_256_gcm();
+    if (strcmp(method, "chacha20-ietf-poly1305") == 0 || strcmp(method, "chacha20-poly1305") == 0) {
+        return EVP_chacha20_poly1305();
+    }
+    return NULL;
+}
+
+static int hs_copy(char* dst, size_t size, const char* src) {
+    if (!src || strlen(src) >= size) return -1;
+    strcpy(dst, src);
+    return 0;
+}
+
+/* Appends one ALPN protocol in wire format */
+static void hs_add_alpn(HsTarget* target, const char* protocol) {
+    size_t len = strlen(protocol);
+    if (len == 0 || len > 255 || target->alpn_len + 1 + (int)len > (int)sizeof(target->alpn)) return;
+    target->alpn[target->alpn_len++] = (unsigned char)len;
+    memcpy(target->alpn + target->alpn_len, protocol, len);
+    target->alpn_len += (int)len;
+}
+
+/*
+ * Fills the stream part of a target: transport, TLS and its parameters.
+ *
+ * Returns:
+ *   int: 1 if the engine can open the stream, 0 otherwise.
+ */
+static int hs_stream_from_outbound(json_t* stream, const char* address, HsTarget* target) {
+    const char* network = json_string_value(json_object_get(stream, "network"));
+    const char* security = json_string_value(json_object_get(stream, "security"));
+    int tcp = !network || network[0] == '\0' || strcmp(network, "tcp") == 0 || strcmp(network, "raw") == 0;
+    target->ws = network && strcmp(network, "ws") == 0;
+    if (security && strcmp(security, "tls") == 0) {
+        json_t* tls = json_object_get(stream, "tlsSettings");
+        const char* sni = json_string_value(json_object_get(tls, "serverName"));
+        if (hs_copy(target->sni, sizeof(target->sni), sni && sni[0] ? sni : address) != 0) return 0;
+        target->tls = 1;
+        if (target->ws) {
+            /* The upgrade is an HTTP/1.1 request whatever the config offers */
+            hs_add_alpn(target, "http/1.1");
+        } else {
+            size_t i;
+            json_t* item;
+            json_array_foreach(json_object_get(tls, "alpn"), i, item) {
+                if (json_string_value(item)) hs_add_alpn(target, json_string_value(item));
+            }
+        }
+    } else if (security && strcmp(security, "reality") == 0) {
+        json_t* reality = json_object_get(stream, "realitySettings");
+        const char* sni = json_string_value(json_object_get(reality, "serverName"));
+        if (!sni || !sni[0]) sni = json_string_value(json_array_get(json_object_get(reality, "serverNames"), 0));
+        if (hs_copy(target->sni, sizeof(target->sni), sni && sni[0] ? sni : address) != 0) return 0;
+        target->tls = 1;
+        target->tls_only = 1;
+    } else if (security && security[0] && strcmp(security, "none") != 0) {
+        return 0;
+    }
+
+    if (tcp) {
+        const char* header = json_string_value(json_object_get(json_object_get(json_object_get(stream, "tcpSettings"), "header"), "type"));
+        if (header && header[0] && strcmp(header, "none") != 0) target->tls_only = 1;
+    } else if (target->ws) {
+        json_t* ws = json_object_get(stream, "wsSettings");
+        const char* path = json_string_value(json_object_get(ws, "path"));
+        const char* host = json_string_value(json_object_get(json_object_get(ws, "headers"), "Host"));
+        if (hs_copy(target->ws_path, sizeof(target->ws_path), path && path[0] ? path : "/") != 0) return 0;
+        if (hs_copy(target->ws_host, sizeof(target->ws_host), host && host[0] ? host : target->tls ? target->sni : address) != 0) return 0;
+    } else if (strcmp(network, "kcp") == 0 || strcmp(network, "quic") == 0) {
+        return 0;
+    } else {
+        /* gRPC, HTTP/2 and the like: only the TLS handshake can be checked */
+        target->tls_only = 1;
+    }
+    return !target->tls_only || target->tls;
+}
+
+/*
+ * Fills a handshake target from a configuration string.
+ *
+ * Returns:
+ *   int: 1 if the engine can speak for the config, 0 if it must be skipped.
+ */
+static int hs_target_from_config(const char* config_str, HsTarget* target) {
+    memset(target, 0, sizeof(HsTarget));
+    /* Everything is copied out of the rendered outbound, so it lives in the scratch arena */
+    ArenaMark scratch = arena_begin();
+    json_t* outbound = config_str ? render_outbound(config_str) : NULL;
+    if (!outbound) {
+        arena_end(scratch);
+        return 0;
+    }
+    const char* protocol = json_string_value(json_object_get(outbound, "protocol"));
+    json_t* settings = json_object_get(outbound, "settings");
+    json_t* server = NULL;
+    int ok = 0;
+    if (protocol && strcmp(protocol, "vless") == 0) {
+        server = json_array_get(json_object_get(settings, "vnext"), 0);
+        json_t* user = json_array_get(json_object_get(server, "users"), 0);
+        const char* id = json_string_value(json_object_get(user, "id"));
+        const char* flow = json_string_value(json_object_get(user, "flow"));
+        target->protocol = HS_VLESS;
+        /* XTLS flows pad and splice the inner stream; a bare request would be refused */
+        ok = id && hs_parse_uuid(id, target->uuid) == 0 && (!flow || flow[0] == '\0');
+    } else if (protocol && strcmp(protocol, "shadowsocks") == 0) {
+        server = json_array_get(json_object_get(settings, "servers"), 0);
+        const char* method = json_string_value(json_object_get(server, "method"));
+        const char* password = json_string_value(json_object_get(server, "password"));
+        target->protocol = HS_SHADOWSOCKS;
+        target->cipher = method ? hs_ss_cipher(method) : NULL;
+        if (target->cipher && password) {
+            target->key_len = EVP_CIPHER_key_length(target->cipher);
+            ok = EVP_BytesToKey(target->cipher, EVP_md5(), NULL, (const unsigned char*)password, (int)strlen(password),
+                                1, target->key, NULL) == target->key_len;
+        }
+    }
+
+    const char* address = json_string_value(json_object_get(server, "address"));
+    int port = (int)json_integer_value(json_object_get(server, "port"));
+    ok = ok && address && port > 0 && port <= 65535 && hs_copy(target->host, sizeof(target->host), address) == 0 &&
+         hs_stream_from_outbound(json_object_get(outbound, "streamSettings"), address, target);
+    if (ok) snprintf(target->port, sizeof(target->port), "%d", port);
+    json_decref(outbound);
+    arena_end(scratch);
+    return ok;
+}
+
+/* HKDF-SHA1 as Shadowsocks uses it to derive a session subkey from the master key and salt */
+static int hs_hkdf_sha1(const unsigned char* salt, int salt_len, const unsigned char* key, int key_len,
+                        unsigned char* out, int out_len) {
+    static const char info[] = "ss-subkey";
+    unsigned char prk[EVP_MAX_MD_SIZE];
+    unsigned int prk_len = 0;
+    if (!HMAC(EVP_sha1(), salt, salt_len, key, (size_t)key_len, prk, &prk_len)) return -1;
+    unsigned char block[EVP_MAX_MD_SIZE + sizeof(info)];
+    unsigned char t[EVP_MAX_MD_SIZE];
+    unsigned int t_len = 0;
+    for (unsigned char counter = 1; out_len > 0; counter++) {
+        size_t len = 0;
+        memcpy(block, t, t_len);
+        len += t_len;
+        memcpy(block + len, info, sizeof(info) - 1);
+        len += sizeof(info) - 1;
+        block[len++] = counter;
+        if (!HMAC(EVP_sha1(), prk, (int)prk_len, block, len, t, &t_len)) return -1;
+        int take = out_len < (int)t_len ? out_len : (int)t_len;
+        memcpy(out, t, (size_t)take);
+        out += take;
+        out_len -= take;
+    }
+    return 0;
+}
+
+/*
+ * Seals (encrypt != 0) or opens one Shadowsocks AEAD chunk.
+ *
+ * The little-endian nonce counter is advanced after use. Sealing writes len bytes of
+ * ciphertext followed by the tag; opening reads the tag after len bytes of ciphertext.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the cipher failed or the tag did not verify.
+ */
+static int hs_aead(const EVP_CIPHER* cipher, const unsigned char* key, unsigned char* nonce, int encrypt,
+                   const unsigned char* in, int len, unsigned char* out) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int ok = 0, n = 0;
+    if (ctx && EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, encrypt) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, SS_NONCE_SIZE, NULL) == 1 &&
+        EVP_CipherInit_ex(ctx, NULL, NULL, key, nonce, encrypt) == 1) {
+        if (encrypt) {
+            ok = EVP_CipherUpdate(ctx, out, &n, in, len) == 1 && EVP_CipherFinal_ex(ctx, out + n, &n) == 1 &&
+                 EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, SS_TAG_SIZE, out + len) == 1;
+        } else {
+            ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, SS_TAG_SIZE, (void*)(in + len)) == 1 &&
+                 EVP_CipherUpdate(ctx, out, &n, in, len) == 1 && EVP_CipherFinal_ex(ctx, out + n, &n) == 1;
+        }
+    }
+    if (ctx) EVP_CIPHER_CTX_free(ctx);
+    for (int i = 0; i < SS_NONCE_SIZE && ++nonce[i] == 0; i++) {
+    }
+    return ok ? 0 : -1;
+}
+
+/* The request tunnelled to HANDSHAKE_PROBE_HOST, preceded by its SOCKS-style address */
+static int hs_probe_payload(unsigned char* out, int size, int with_address) {
+    int len = 0;
+    if (with_address) {
+        size_t host_len = strlen(HANDSHAKE_PROBE_HOST);
+        out[len++] = 3;
+        out[len++] = (unsigned char)host_len;
+        memcpy(out + len, HANDSHAKE_PROBE_HOST, host_len);
+        len += (int)host_len;
+        out[len++] = (unsigned char)(HANDSHAKE_PROBE_PORT >> 8);
+        out[len++] = (unsigned char)(HANDSHAKE_PROBE_PORT & 0xFF);
+    }
+    int n = snprintf((char*)out + len, (size_t)(size - len),
+                     "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: V2Root-Test/1.0\r\nConnection: close\r\n\r\n",
+                     HANDSHAKE_PROBE_PATH, HANDSHAKE_PROBE_HOST);
+    return n < 0 || n >= size - len ? -1 : len + n;
+}
+
+/*
+ * Builds the protocol's first packet: a VLESS request header or a Shadowsocks AEAD salt and
+ * first chunk, each carrying the probe request.
+ *
+ * Returns:
+ *   int: Bytes written, or -1.
+ */
+static int hs_protocol_packet(const HsTarget* target, unsigned char* out, int size) {
+    unsigned char payload[512];
+    if (target->protocol == HS_VLESS) {
+        int len = 0;
+        out[len++] = 0;                             /* Version */
+        memcpy(out + len, target->uuid, 16);
+        len += 16;
+        out[len++] = 0;                             /* No addons */
+        out[len++] = 1;                             /* TCP */
+        out[len++] = (unsigned char)(HANDSHAKE_PROBE_PORT >> 8);
+        out[len++] = (unsigned char)(HANDSHAKE_PROBE_PORT & 0xFF);
+        out[len++] = 2;                             /* Domain name */
+        size_t host_len = strlen(HANDSHAKE_PROBE_HOST);
+        out[len++] = (unsigned char)host_len;
+        memcpy(out + len, HANDSHAKE_PROBE_HOST, host_len);
+        len += (int)host_len;
+        int n = hs_probe_payload(out + len, size - len, 0);
+        return n < 0 ? -1 : len + n;
+    }
+
+    int payload_len = hs_probe_payload(payload, sizeof(payload), 1);
+    int key_len = target->key_len;
+    if (payload_len < 0 || key_len + 2 + SS_TAG_SIZE + payload_len + SS_TAG_SIZE > size) return -1;
+    unsigned char subkey[32];
+    unsigned char nonce[SS_NONCE_SIZE] = {0};
+    unsigned char length[2] = {(unsigned char)(payload_len >> 8), (unsigned char)(payload_len & 0xFF)};
+    if (RAND_bytes(out, key_len) != 1 || hs_hkdf_sha1(out, key_len, target->key, key_len, subkey, key_len) != 0) return -1;
+    int len = key_len;
+    if (hs_aead(target->cipher, subkey, nonce, 1, length, 2, out + len) != 0) return -1;
+    len += 2 + SS_TAG_SIZE;
+    if (hs_aead(target->cipher, subkey, nonce, 1, payload, payload_len, out + len) != 0) return -1;
+    return len + payload_len + SS_TAG_SIZE;
+}
+
+/* Wraps data in one masked binary WebSocket frame, as a client must */
+static int hs_ws_frame(const unsigned char* data, int len, unsigned char* out, int size) {
+    int header = len < 126 ? 6 : 8;
+    if (len > 0xFFFF || header + len > size) return -1;
+    unsigned char* mask = out + header - 4;
+    out[0] = 0x82;
+    if (len < 126) {
+        out[1] = (unsigned char)(0x80 | len);
+    } else {
+        out[1] = 0x80 | 126;
+        out[2] = (unsigned char)(len >> 8);
+        out[3] = (unsigned char)(len & 0xFF);
+    }
+    if (RAND_bytes(mask, 4) != 1) return -1;
+    for (int i = 0; i < len; i++) out[header + i] = data[i] ^ mask[i % 4];
+    return header + len;
+}
+
+static int hs_ws_upgrade(const HsTarget* target, unsigned char* out, int size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    unsigned char nonce[18] = {0};
+    char key[25];
+    if (RAND_bytes(nonce, 16) != 1) return -1;
+    for (int i = 0, j = 0; i < 18; i += 3) {
+        unsigned int v = (unsigned int)nonce[i] << 16 | (unsigned int)nonce[i + 1] << 8 | nonce[i + 2];
+        key[j++] = alphabet[(v >> 18) & 63];
+        key[j++] = alphabet[(v >> 12) & 63];
+        key[j++] = alphabet[(v >> 6) & 63];
+        key[j++] = alphabet[v & 63];
+    }
+    /* 16 bytes encode to 22 characters and two padding characters */
+    key[22] = '=';
+    key[23] = '=';
+    key[24] = '\0';
+    int n = snprintf((char*)out, (size_t)size,
+                     "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: V2Root-Test/1.0\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n",
+                     target->ws_path, target->ws_host, key);
+    return n < 0 || n >= size ? -1 : n;
+}
+
+/* Writes through TLS or the socket; returns bytes written, HS_AGAIN or HS_IO_ERROR */
+static int hs_write(HsConn* conn, const unsigned char* data, int len) {
+    if (conn->ssl) {
+        int n = SSL_write(conn->ssl, data, len);
+        if (n > 0) return n;
+        int err = SSL_get_error(conn->ssl, n);
+        if (err == SSL_ERROR_WANT_WRITE) conn->events = POLLOUT;
+        else if (err == SSL_ERROR_WANT_READ) conn->events = POLLIN;
+        else return HS_IO_ERROR;
+        return HS_AGAIN;
+    }
+    int n = (int)send(conn->fd, (const char*)data, (size_t)len, SEND_FLAGS);
+    if (n > 0) return n;
+    if (n < 0 && HS_WOULD_BLOCK()) {
+        conn->events = POLLOUT;
+        return HS_AGAIN;
+    }
+    return HS_IO_ERROR;
+}
+
+/* Reads through TLS or the socket into in; returns bytes read, HS_AGAIN, HS_EOF or HS_IO_ERROR */
+static int hs_read(HsConn* conn) {
+    int room = (int)sizeof(conn->in) - conn->in_len;
+    if (room <= 0) return HS_IO_ERROR;
+    unsigned char* dst = conn->in + conn->in_len;
+    int n;
+    if (conn->ssl) {
+        n = SSL_read(conn->ssl, dst, room);
+        if (n <= 0) {
+            int err = SSL_get_error(conn->ssl, n);
+            if (err == SSL_ERROR_WANT_READ) conn->events = POLLIN;
+            else if (err == SSL_ERROR_WANT_WRITE) conn->events = POLLOUT;
+            else return err == SSL_ERROR_ZERO_RETURN || err == SSL_ERROR_SYSCALL ? HS_EOF : HS_IO_ERROR;
+            return HS_AGAIN;
+        }
+    } else {
+        n = (int)recv(conn->fd, (char*)dst, (size_t)room, 0);
+        if (n == 0) return HS_EOF;
+        if (n < 0) {
+            if (!HS_WOULD_BLOCK()) return HS_EOF;
+            conn->events = POLLIN;
+            return HS_AGAIN;
+        }
+    }
+    conn->in_len += n;
+    return n;
+}
+
+static int hs_connected(hs_socket_t fd) {
+    int err = 0;
+#ifdef _WIN32
+    int len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, (char*)&err, &len) != 0) return 0;
+#else
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) return 0;
+#endif
+    return err == 0;
+}
+
+/* Queues the first bytes after the stream is up: the WebSocket upgrade or the protocol packet */
+static void hs_begin_protocol(HsConn* conn) {
+    const HsTarget* target = &conn->target;
+    conn->protocol_ms = get_monotonic_ms();
+    conn->out_sent = 0;
+    conn->in_len = 0;
+    if (target->ws) {
+        conn->out_len = hs_ws_upgrade(target, conn->out, sizeof(conn->out));
+        conn->next_phase = HS_UPGRADE;
+    } else {
+        conn->out_len = hs_protocol_packet(target, conn->out, sizeof(conn->out));
+        conn->next_phase = HS_REPLY;
+    }
+    if (conn->out_len < 0) {
+        hs_fail(conn, PROBE_ERROR_UNKNOWN, "Failed to build the handshake request");
+        return;
+    }
+    conn->phase = HS_SEND;
+    conn->events = POLLOUT;
+}
+
+/* Finishes the stream part once TCP (and TLS, if any) are up */
+static void hs_stream_ready(HsConn* conn) {
+    ProbeResult* result = conn->result;
+    if (conn->target.tls_only) {
+        result->success = 1;
+        result->total_ms = (int)(get_monotonic_ms() - conn->start_ms) + result->dns_ms;
+        result->score = calculate_probe_score(result->total_ms, result->tcp_connect_ms, 1);
+        conn->phase = HS_DONE;
+        return;
+    }
+    hs_begin_protocol(conn);
+}
+
+/*
+ * Checks the server's reply to the protocol packet.
+ *
+ * Returns:
+ *   int: 1 if the server accepted the credentials, 0 if more bytes are needed, -1 if it
+ *        refused them (the failure is recorded).
+ */
+static int hs_check_reply(HsConn* conn) {
+    const HsTarget* target = &conn->target;
+    const unsigned char* payload = conn->in;
+    int avail = conn->in_len;
+    if (target->ws) {
+        if (avail < 2) return 0;
+        if ((conn->in[0] & 0x0F) == 0x8) {
+            hs_fail(conn, PROBE_ERROR_AUTH, "Server closed the WebSocket after the request; credentials rejected");
+            return -1;
+        }
+        int len7 = conn->in[1] & 0x7F;
+        int header = 2 + (len7 == 126 ? 2 : len7 == 127 ? 8 : 0) + ((conn->in[1] & 0x80) ? 4 : 0);
+        if (avail < header) return 0;
+        payload += header;
+        avail -= header;
+    }
+
+    if (target->protocol == HS_VLESS) {
+        if (avail < 1) return 0;
+        if (payload[0] != 0) {
+            hs_fail(conn, PROBE_ERROR_AUTH, "Reply is not a VLESS response; the UUID was rejected or the server is not VLESS");
+            return -1;
+        }
+        return 1;
+    }
+
+    int key_len = target->key_len;
+    if (avail < key_len + 2 + SS_TAG_SIZE) return 0;
+    unsigned char subkey[32];
+    unsigned char nonce[SS_NONCE_SIZE] = {0};
+    unsigned char length[2];
+    if (hs_hkdf_sha1(payload, key_len, target->key, key_len, subkey, key_len) != 0 ||
+        hs_aead(target->cipher, subkey, nonce, 0, payload + key_len, 2, length) != 0) {
+        hs_fail(conn, PROBE_ERROR_AUTH, "Reply failed AEAD authentication; wrong password or method");
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Advances a connection as far as it can go without blocking.
+ *
+ * Parameters:
+ *   conn (HsConn*): The connection; its events are updated when it blocks, and its phase is
+ *                   HS_DONE once the result is final.
+ *   ctx (SSL_CTX*): Context for new TLS sessions.
+ *
+ * Returns:
+ *   None
+ */
+static void hs_step(HsConn* conn, SSL_CTX* ctx) {
+    ProbeResult* result = conn->result;
+    const HsTarget* target = &conn->target;
+    while (conn->phase != HS_DONE) {
+        switch (conn->phase) {
+            case HS_CONNECT:
+                if (!hs_connected(conn->fd)) {
+                    hs_fail(conn, PROBE_ERROR_TCP, "TCP connect failed to %s:%s", target->host, target->port);
+                    return;
+                }
+                result->tcp_connect_ms = (int)(get_monotonic_ms() - conn->start_ms);
+                if (result->tcp_connect_ms < 1) result->tcp_connect_ms = 1;
+                if (!target->tls) {
+                    hs_stream_ready(conn);
+                    break;
+                }
+                conn->ssl = SSL_new(ctx);
+                if (!conn->ssl || SSL_set_fd(conn->ssl, (int)conn->fd) != 1 ||
+                    SSL_set_tlsext_host_name(conn->ssl, target->sni) != 1 ||
+                    (target->alpn_len > 0 && SSL_set_alpn_protos(conn->ssl, target->alpn, (unsigned int)target->alpn_len) != 0)) {
+                    hs_fail(conn, PROBE_ERROR_TLS, "Failed to set up TLS for %s", target->sni);
+                    return;
+                }
+                conn->protocol_ms = get_monotonic_ms();
+                conn->phase = HS_TLS;
+                break;
+
+            case HS_TLS: {
+                int rc = SSL_connect(conn->ssl);
+                if (rc == 1) {
+                    result->tls_handshake_ms = (int)(get_monotonic_ms() - conn->protocol_ms);
+                    if (result->tls_handshake_ms < 1) result->tls_handshake_ms = 1;
+                    hs_stream_ready(conn);
+                    break;
+                }
+                int err = SSL_get_error(conn->ssl, rc);
+                if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+                    conn->events = err == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT;
+                    return;
+                }
+                unsigned long code = ERR_get_error();
+                char reason[160] = "connection closed";
+                if (code) ERR_error_string_n(code, reason, sizeof(reason));
+                ERR_clear_error();
+                hs_fail(conn, PROBE_ERROR_TLS, "TLS handshake with %s failed: %s", target->sni, reason);
+                return;
+            }
+
+            case HS_SEND:
+                while (conn->out_sent < conn->out_len) {
+                    int n = hs_write(conn, conn->out + conn->out_sent, conn->out_len - conn->out_sent);
+                    if (n == HS_AGAIN) return;
+                    if (n < 0) {
+                        hs_fail(conn, PROBE_ERROR_TRANSPORT, "Connection lost while sending the handshake");
+                        return;
+                    }
+                    conn->out_sent += n;
+                }
+                conn->phase = conn->next_phase;
+                conn->events = POLLIN;
+                break;
+
+            case HS_UPGRADE: {
+                int n = hs_read(conn);
+                if (n == HS_AGAIN) return;
+                if (n < 0) {
+                    hs_fail(conn, PROBE_ERROR_TRANSPORT, "Connection closed during the WebSocket upgrade on %s", target->ws_path);
+                    return;
+                }
+                int end = -1;
+                for (int i = 3; i < conn->in_len; i++) {
+                    if (memcmp(conn->in + i - 3, "\r\n\r\n", 4) == 0) {
+                        end = i + 1;
+                        break;
+                    }
+                }
+                if (end < 0) break;
+                if (end < 12 || memcmp(conn->in + 9, "101", 3) != 0) {
+                    int line = 0;
+                    while (line < conn->in_len && conn->in[line] != '\r') line++;
+                    hs_fail(conn, PROBE_ERROR_TRANSPORT, "WebSocket upgrade on %s refused: %.*s", target->ws_path,
+                            line < 96 ? line : 96, (const char*)conn->in);
+                    return;
+                }
+                unsigned char packet[HANDSHAKE_BUFFER_SIZE];
+                int len = hs_protocol_packet(target, packet, sizeof(packet));
+                conn->out_len = len < 0 ? -1 : hs_ws_frame(packet, len, conn->out, sizeof(conn->out));
+                if (conn->out_len < 0) {
+                    hs_fail(conn, PROBE_ERROR_UNKNOWN, "Failed to build the handshake request");
+                    return;
+                }
+                /* Anything after the 101 headers already belongs to the tunnel */
+                memmove(conn->in, conn->in + end, (size_t)(conn->in_len - end));
+                conn->in_len -= end;
+                conn->out_sent = 0;
+                conn->next_phase = HS_REPLY;
+                conn->phase = HS_SEND;
+                break;
+            }
+
+            case HS_REPLY: {
+                int n = conn->in_len > 0 ? 1 : hs_read(conn);
+                if (n == HS_AGAIN) return;
+                if (n < 0) {
+                    hs_fail(conn, PROBE_ERROR_AUTH, target->protocol == HS_VLESS
+                            ? "Server closed the connection after the VLESS request; the UUID was rejected"
+                            : "Server closed the connection after the first packet; wrong password or method");
+                    return;
+                }
+                int verdict = hs_check_reply(conn);
+                if (verdict < 0) return;
+                if (verdict == 0) {
+                    n = hs_read(conn);
+                    if (n == HS_AGAIN) return;
+                    if (n < 0) {
+                        hs_fail(conn, PROBE_ERROR_AUTH, "Server closed the connection mid-reply");
+                        return;
+                    }
+                    break;
+                }
+                long long now = get_monotonic_ms();
+                result->transport_handshake_ms = (int)(now - conn->protocol_ms);
+                if (result->transport_handshake_ms < 1) result->transport_handshake_ms = 1;
+                result->success = 1;
+                result->total_ms = (int)(now - conn->start_ms) + result->dns_ms;
+                result->score = calculate_probe_score(result->total_ms, result->tcp_connect_ms, 1);
+                conn->phase = HS_DONE;
+                return;
+            }
+        }
+    }
+}
+
+/*
+ * Resolves a target and starts its non-blocking connect.
+ *
+ * Returns:
+ *   int: 1 if the connection is in flight, 0 if it already failed.
+ */
+static int hs_begin(HsConn* conn) {
+    ProbeResult* result = conn->result;
+    const HsTarget* target = &conn->target;
+    struct addrinfo* res = NULL;
+    int cache_hit = 0;
+    long long resolve_start = get_monotonic_ms();
+    if (dns_cache_getaddrinfo(target->host, target->port, &res, &cache_hit) != 0 || !res) {
+        hs_fail(conn, PROBE_ERROR_DNS, "Failed to resolve %s", target->host);
+        return 0;
+    }
+    result->dns_ms = (int)(get_monotonic_ms() - resolve_start);
+    result->dns_cache_hit = cache_hit;
+
+    conn->start_ms = get_monotonic_ms();
+    conn->fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (conn->fd == INVALID_SOCKET) {
+        dns_cache_freeaddrinfo(res);
+        hs_fail(conn, PROBE_ERROR_TCP, "Failed to create socket");
+        return 0;
+    }
+    /* The handshake is a few small writes; Nagle would add a delayed ACK to each round trip */
+    int one = 1;
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+#ifdef _WIN32
+    u_long nonblocking = 1;
+    ioctlsocket(conn->fd, FIONBIO, &nonblocking);
+    int rc = connect(conn->fd, res->ai_addr, (int)res->ai_addrlen);
+#else
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL, 0) | O_NONBLOCK);
+    int rc = connect(conn->fd, res->ai_addr, res->ai_addrlen);
+#endif
+    dns_cache_freeaddrinfo(res);
+    if (rc != 0 && !HS_WOULD_BLOCK()) {
+        hs_fail(conn, PROBE_ERROR_TCP, "TCP connect failed to %s:%s", target->host, target->port);
+        return 0;
+    }
+    conn->phase = HS_CONNECT;
+    conn->events = POLLOUT;
+    return 1;
+}
+
+static void hs_release(HsConn* conn) {
+    if (conn->ssl) SSL_free(conn->ssl);
+    conn->ssl = NULL;
+    if (conn->fd != INVALID_SOCKET) CLOSE_SOCKET(conn->fd);
+    conn->fd = INVALID_SOCKET;
+}
+
+/* Records the timeout of a connection that outlived HANDSHAKE_TIMEOUT_MS */
+static void hs_expire(HsConn* conn) {
+    switch (conn->phase) {
+        case HS_CONNECT:
+            hs_fail(conn, PROBE_ERROR_TCP, "TCP connect to %s:%s timed out", conn->target.host, conn->target.port);
+            break;
+        case HS_TLS:
+            hs_fail(conn, PROBE_ERROR_TIMEOUT, "TLS handshake with %s timed out", conn->target.sni);
+            break;
+        case HS_UPGRADE:
+            hs_fail(conn, PROBE_ERROR_TIMEOUT, "WebSocket upgrade on %s timed out", conn->target.ws_path);
+            break;
+        default:
+            hs_fail(conn, PROBE_ERROR_TIMEOUT, "No reply to the handshake within %d ms", HANDSHAKE_TIMEOUT_MS);
+            break;
+    }
+}
+
+/* Runs every supported config through the poll loop */
+static int hs_run(const char** configs, int n, ProbeResult* out, SSL_CTX* ctx) {
+    HsConn* conns = calloc(MAX_CONCURRENT_PROBES, sizeof(HsConn));
+    if (!conns) {
+        log_message("Failed to allocate handshake state", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    hs_pollfd_t fds[MAX_CONCURRENT_PROBES];
+    int fd_slot[MAX_CONCURRENT_PROBES];
+    int in_use[MAX_CONCURRENT_PROBES] = {0};
+    int next = 0, active = 0, succeeded = 0, probed = 0;
+
+    while (next < n || active > 0) {
+        while (active < MAX_CONCURRENT_PROBES && next < n) {
+            int i = next++;
+            int s = 0;
+            while (in_use[s]) s++;
+            HsConn* conn = &conns[s];
+            memset(conn, 0, offsetof(HsConn, out));
+            conn->fd = INVALID_SOCKET;
+            conn->result = &out[i];
+            if (!hs_target_from_config(configs[i], &conn->target)) {
+                hs_mark_unsupported(&out[i]);
+                continue;
+            }
+            probed++;
+            if (!hs_begin(conn)) {
+                hs_release(conn);
+                continue;
+            }
+            in_use[s] = 1;
+            active++;
+        }
+        if (active == 0) continue;
+
+        long long now = get_monotonic_ms();
+        long long earliest = now + HANDSHAKE_TIMEOUT_MS;
+        int nfds = 0;
+        for (int s = 0; s < MAX_CONCURRENT_PROBES; s++) {
+            if (!in_use[s]) continue;
+            if (conns[s].start_ms + HANDSHAKE_TIMEOUT_MS < earliest) earliest = conns[s].start_ms + HANDSHAKE_TIMEOUT_MS;
+            fds[nfds].fd = conns[s].fd;
+            fds[nfds].events = conns[s].events;
+            fds[nfds].revents = 0;
+            fd_slot[nfds++] = s;
+        }
+        int wait_ms = earliest > now ? (int)(earliest - now) : 0;
+        int ready = HS_POLL(fds, nfds, wait_ms);
+
+        now = get_monotonic_ms();
+        for (int k = 0; k < nfds; k++) {
+            int s = fd_slot[k];
+            HsConn* conn = &conns[s];
+            if (ready > 0 && fds[k].revents) {
+                hs_step(conn, ctx);
+            } else if (now - conn->start_ms >= HANDSHAKE_TIMEOUT_MS) {
+                hs_expire(conn);
+            }
+            if (conn->phase != HS_DONE) continue;
+            conn->result->attempts = 1;
+            if (conn->result->success) succeeded++;
+            hs_release(conn);
+            in_use[s] = 0;
+            active--;
+        }
+    }
+    free(conns);
+    metrics_probes_started(probed);
+    metrics_probe_results(out, n);
+    return succeeded;
+}
+
+/*
+ * Performs direct protocol handshakes with the servers of many configs concurrently.
+ *
+ * On success tcp_connect_ms and, with TLS, tls_handshake_ms are filled, and
+ * transport_handshake_ms spans the WebSocket upgrade and the protocol request until the
+ * server's verified reply. Configs the engine cannot speak for are marked PROBE_ERROR_SKIPPED
+ * with attempts = 0 and left for a V2Ray-based probe.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, in configs order.
+ *
+ * Returns:
+ *   int: Number of servers that accepted the handshake, or -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for invalid input or when TLS or Winsock cannot be initialized. Per-config
+ *   failures are recorded in out.
+ */
+EXPORT int probe_config_handshake_many(const char** configs, int n, ProbeResult* out) {
+    if (!configs || !out || n <= 0) {
+        log_message("Invalid arguments to probe_config_handshake_many", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        memset(&out[i], 0, sizeof(ProbeResult));
+        strncpy(out[i].error_type, PROBE_ERROR_NONE, sizeof(out[i].error_type) - 1);
+    }
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        return -1;
+    }
+#else
+    /* OpenSSL writes to the socket directly; a server hanging up must not raise SIGPIPE */
+    sigset_t block, old, pending;
+    sigemptyset(&block);
+    sigaddset(&block, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    sigpending(&pending);
+    int was_pending = sigismember(&pending, SIGPIPE);
+#endif
+
+    int succeeded = -1;
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx) {
+        log_message("Failed to create TLS context", __FILE__, __LINE__, 0, NULL);
+    } else {
+        /* Servers present whatever certificate fits their SNI; only the handshake matters */
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        succeeded = hs_run(configs, n, out, ctx);
+        SSL_CTX_free(ctx);
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#else
+    if (!was_pending) {
+        struct timespec zero = {0, 0};
+        while (sigtimedwait(&block, NULL, &zero) > 0) {
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+#endif
+    if (succeeded >= 0) {
+        LOG_DEBUGF("Direct handshakes completed", "Handshake probe: %d/%d servers accepted", succeeded, n);
+    }
+    return succeeded;
+}
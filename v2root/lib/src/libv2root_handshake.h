@@ -0,0 +1,39 @@
+#ifndef LIBV2ROOT_HANDSHAKE_H
+#define LIBV2ROOT_HANDSHAKE_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Direct protocol handshakes.
+ *
+ * Speaks the proxy protocol to the server the way V2Ray's outbound would, without starting
+ * V2Ray: TCP connect, TLS with the configured server name and ALPN, a WebSocket upgrade on
+ * the configured path and Host, then a VLESS request header or a Shadowsocks AEAD first
+ * packet carrying a small HTTP request to HANDSHAKE_PROBE_HOST. The server's reply proves the
+ * UUID or the password and method were accepted, so wrong credentials and broken transports
+ * are reported as auth/transport/TLS errors at the cost of a few round trips.
+ *
+ * Handshakes run non-blocking, up to MAX_CONCURRENT_PROBES at a time on one poll loop.
+ * Configs the engine cannot speak for are marked skipped: VMess, XTLS flows, transports
+ * other than tcp and ws, and Shadowsocks 2022 or stream ciphers. REALITY configs get the TLS
+ * handshake only, since REALITY authentication cannot be reproduced with OpenSSL, and the
+ * uTLS fingerprint is not imitated.
+ */
+
+#define HANDSHAKE_TIMEOUT_MS 5000
+#define HANDSHAKE_PROBE_HOST "detectportal.firefox.com"
+#define HANDSHAKE_PROBE_PATH "/success.txt"
+#define HANDSHAKE_PROBE_PORT 80
+#define HANDSHAKE_BUFFER_SIZE 2048
+
+EXPORT int probe_config_handshake_many(const char** configs, int n, ProbeResult* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_HANDSHAKE_H */
@@ -0,0 +1,416 @@
+#ifndef _WIN32
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <curl/curl.h>
+
+#include "libv2root_common.h"
+#include "libv2root_deadline.h"
+#include "libv2root_http.h"
+#include "libv2root_utils.h"
+
+#define HTTP_PROBE_TIMEOUT_MS 10000
+#define HTTP_POLL_INTERVAL_MS 100
+
+/* One in-flight probe: a single easy handle re-run for every sample of its inbound */
+typedef struct {
+    CURL* easy;
+    ProbeResult* result;
+    long long start_ms;                 /* When the first sample was issued */
+    int done;                           /* Samples completed so far */
+    int warm[MAX_PROBE_SAMPLES];        /* Request RTT of samples 1..n over the reused connection */
+} HttpProbe;
+
+static pthread_once_t http_once = PTHREAD_ONCE_INIT;
+static CURLSH* http_share = NULL;
+static pthread_mutex_t http_share_locks[CURL_LOCK_DATA_LAST];
+
+static void http_share_lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+    pthread_mutex_lock(&http_share_locks[data]);
+}
+
+static void http_share_unlock(CURL* handle, curl_lock_data data, void* userptr) {
+    pthread_mutex_unlock(&http_share_locks[data]);
+}
+
+/*
+ * Initializes libcurl once per process and creates the shared DNS/TLS session cache.
+ */
+static void http_global_init(void) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&http_share_locks[i], NULL);
+    }
+    http_share = curl_share_init();
+    if (!http_share) {
+        log_message("Failed to initialize curl share handle", __FILE__, __LINE__, 0, NULL);
+        return;
+    }
+    curl_share_setopt(http_share, CURLSHOPT_LOCKFUNC, http_share_lock);
+    curl_share_setopt(http_share, CURLSHOPT_UNLOCKFUNC, http_share_unlock);
+    curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+/*
+ * Returns the process-wide curl share handle, initializing libcurl on first use.
+ *
+ * The handle shares resolved probe hosts and TLS sessions between all easy handles, so
+ * repeated tests resume TLS sessions instead of paying a full handshake every time.
+ *
+ * Returns:
+ *   CURLSH*: The share handle, or NULL if it could not be created.
+ */
+CURLSH* http_shared_handle(void) {
+    pthread_once(&http_once, http_global_init);
+    return http_share;
+}
+
+/* Callback for curl - the probe only needs the timings, not the body */
+static size_t http_discard(void* contents, size_t size, size_t nmemb, void* userp) {
+    return size * nmemb;
+}
+
+static int http_elapsed_ms(CURL* easy, CURLINFO info) {
+    curl_off_t us = 0;
+    curl_easy_getinfo(easy, info, &us);
+    return (int)((us + 500) / 1000);
+}
+
+static void http_fail(ProbeResult* result, CURLcode code) {
+    result->success = 0;
+    result->score = 0.0;
+    const char* error_type = code == CURLE_OPERATION_TIMEDOUT ? PROBE_ERROR_TIMEOUT : PROBE_ERROR_TRANSPORT;
+    strncpy(result->error_type, error_type, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    snprintf(result->error_details, sizeof(result->error_details), "Proxied request failed: %s", curl_easy_strerror(code));
+}
+
+static void http_finish(HttpProbe* probe) {
+    probe->result->attempts = probe->done > 0 ? probe->done : 1;
+    if (probe->done > 1) {
+        probe->result->warm_rtt_ms = percentile_int(probe->warm + 1, probe->done - 1, 50);
+    }
+}
+
+/*
+ * Records one finished sample.
+ *
+ * The first sample pays for the local proxy connect, the CONNECT tunnel through V2Ray and the
+ * TLS handshake; later samples reuse that connection, so pretransfer-to-first-byte is the
+ * steady-state round trip through the node.
+ *
+ * Returns:
+ *   int: 1 if another sample should be issued, 0 if the probe is finished.
+ */
+static int http_record_sample(HttpProbe* probe, CURLcode code, int samples) {
+    ProbeResult* result = probe->result;
+    if (code != CURLE_OK) {
+        if (probe->done == 0) {
+            http_fail(result, code);
+            return 0;
+        }
+        /* A warm sample failing does not undo the cold result; stop sampling */
+        samples = probe->done;
+    } else if (probe->done == 0) {
+        int connect_ms = http_elapsed_ms(probe->easy, CURLINFO_CONNECT_TIME_T);
+        int appconnect_ms = http_elapsed_ms(probe->easy, CURLINFO_APPCONNECT_TIME_T);
+        result->success = 1;
+        result->proxy_setup_ms = appconnect_ms > connect_ms ? appconnect_ms - connect_ms : 0;
+        result->app_connect_ms = appconnect_ms;
+        result->ttfb_ms = http_elapsed_ms(probe->easy, CURLINFO_STARTTRANSFER_TIME_T);
+        result->total_ms = http_elapsed_ms(probe->easy, CURLINFO_TOTAL_TIME_T);
+        if (result->ttfb_ms < 1) result->ttfb_ms = 1;
+        if (result->total_ms < 1) result->total_ms = 1;
+        result->score = calculate_probe_score(result->ttfb_ms, 0, 1);
+        probe->done = 1;
+    } else {
+        int rtt = http_elapsed_ms(probe->easy, CURLINFO_STARTTRANSFER_TIME_T) -
+                  http_elapsed_ms(probe->easy, CURLINFO_PRETRANSFER_TIME_T);
+        probe->warm[probe->done++] = rtt < 1 ? 1 : rtt;
+    }
+
+    if (probe->done < samples) return 1;
+    http_finish(probe);
+    return 0;
+}
+
+static CURL* http_new_probe(HttpProbe* probe, int port, int timeout_ms) {
+    CURL* easy = curl_easy_init();
+    if (!easy) return NULL;
+    char proxy_str[64];
+    snprintf(proxy_str, sizeof(proxy_str), "http://127.0.0.1:%d", port);
+    curl_easy_setopt(easy, CURLOPT_URL, PRIMARY_PROBE_URL);
+    curl_easy_setopt(easy, CURLOPT_PROXY, proxy_str);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, http_discard);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, (long)timeout_ms);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, (long)timeout_ms);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, "V2Root-Test/1.0");
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, probe);
+    CURLSH* share = http_shared_handle();
+    if (share) curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    probe->easy = easy;
+    probe->start_ms = get_monotonic_ms();
+    return easy;
+}
+
+/*
+ * Abandons cold probes that outlived the adaptive deadline.
+ *
+ * Probes that already have their first sample are left to finish sampling; the deadline only
+ * bounds the time to first byte, which is what ranks a node.
+ *
+ * Returns:
+ *   int: Number of probes removed from the multi handle.
+ */
+static int http_expire(CURLM* multi, HttpProbe* probes, int n, const ProbeDeadline* deadline) {
+    long long now = get_monotonic_ms();
+    int limit = deadline_ms(deadline, HTTP_PROBE_TIMEOUT_MS);
+    int expired = 0;
+    for (int i = 0; i < n; i++) {
+        HttpProbe* probe = &probes[i];
+        if (!probe->easy || probe->done > 0 || now - probe->start_ms <= limit) continue;
+        curl_multi_remove_handle(multi, probe->easy);
+        curl_easy_cleanup(probe->easy);
+        probe->easy = NULL;
+        http_fail(probe->result, CURLE_OPERATION_TIMEDOUT);
+        snprintf(probe->result->error_details, sizeof(probe->result->error_details),
+                 "Aborted after %lld ms, slower than the adaptive deadline of %d ms", now - probe->start_ms, limit);
+        probe->result->attempts = 1;
+        expired++;
+    }
+    return expired;
+}
+
+/*
+ * Runs proxied TTFB probes against many local HTTP inbounds on one curl multi handle.
+ *
+ * Up to MAX_CONCURRENT_PROBES transfers are in flight at once from a single thread. With
+ * samples > 1 each inbound is requested repeatedly on its warm connection; the first sample
+ * fills proxy_setup_ms/ttfb_ms/total_ms and the median of the rest fills warm_rtt_ms,
+ * separating tunnel setup cost from steady-state latency.
+ *
+ * With a deadline, each first request is bounded by deadline_ms instead of the fixed timeout
+ * and its TTFB feeds the deadline; in stop mode entries not yet started once the deadline is
+ * done are marked skipped.
+ *
+ * Parameters:
+ *   ports (const int*): Inbound port per entry; entries with a port <= 0 are skipped.
+ *   n (int): Number of entries.
+ *   samples (int): Requests per inbound (clamped to 1..MAX_PROBE_SAMPLES).
+ *   out (ProbeResult*): Result slots updated in place for every probed entry.
+ *   deadline (ProbeDeadline*): Adaptive deadline shared by the sweep, or NULL.
+ *
+ * Returns:
+ *   int: Number of successful probes, or -1 if curl could not be initialized.
+ *
+ * Errors:
+ *   Per-entry failures are recorded in out; initialization failures are logged.
+ */
+int http_probe_ports(const int* ports, int n, int samples, ProbeResult* out, ProbeDeadline* deadline) {
+    if (!ports || !out || n <= 0) return -1;
+    if (samples < 1) samples = 1;
+    if (samples > MAX_PROBE_SAMPLES) samples = MAX_PROBE_SAMPLES;
+    http_shared_handle();
+
+    HttpProbe* probes = calloc((size_t)n, sizeof(HttpProbe));
+    CURLM* multi = curl_multi_init();
+    if (!probes || !multi) {
+        log_message("Failed to initialize curl multi handle", __FILE__, __LINE__, 0, NULL);
+        free(probes);
+        if (multi) curl_multi_cleanup(multi);
+        return -1;
+    }
+
+    int next = 0, active = 0, succeeded = 0;
+    while ((next < n && !deadline_done(deadline)) || active > 0) {
+        while (next < n && active < MAX_CONCURRENT_PROBES && !deadline_done(deadline)) {
+            int i = next++;
+            if (ports[i] <= 0) continue;
+            probes[i].result = &out[i];
+            if (!http_new_probe(&probes[i], ports[i], deadline_ms(deadline, HTTP_PROBE_TIMEOUT_MS)) || curl_multi_add_handle(multi, probes[i].easy) != CURLM_OK) {
+                http_fail(&out[i], CURLE_FAILED_INIT);
+                if (probes[i].easy) curl_easy_cleanup(probes[i].easy);
+                probes[i].easy = NULL;
+                continue;
+            }
+            active++;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int left;
+        while ((msg = curl_multi_info_read(multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL* easy = msg->easy_handle;
+            CURLcode code = msg->data.result;
+            HttpProbe* probe = NULL;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char**)&probe);
+            curl_multi_remove_handle(multi, easy);
+            int cold = probe && probe->done == 0;
+            int more = probe && http_record_sample(probe, code, samples);
+            if (cold && deadline && probe->result->success) deadline_observe(deadline, probe->result->ttfb_ms);
+            if (more) {
+                if (curl_multi_add_handle(multi, easy) == CURLM_OK) continue;
+                http_finish(probe);
+            }
+            if (probe && probe->result->success) succeeded++;
+            curl_easy_cleanup(easy);
+            if (probe) probe->easy = NULL;
+            active--;
+        }
+
+        if (deadline && active > 0) active -= http_expire(multi, probes, next, deadline);
+        if (active > 0) {
+            curl_multi_poll(multi, NULL, 0, HTTP_POLL_INTERVAL_MS, NULL);
+        }
+    }
+    for (int i = next; i < n; i++) {
+        if (ports[i] > 0) deadline_skip(&out[i]);
+    }
+
+    curl_multi_cleanup(multi);
+    free(probes);
+
+    LOG_DEBUGF("Proxied TTFB probes completed", "HTTP probe: %d/%d inbounds reachable, %d sample(s) each", succeeded, n, samples);
+    return succeeded;
+}
+
+static void tls_fail(ProbeResult* result, CURLcode code) {
+    const char* error_type = PROBE_ERROR_TLS;
+    if (code == CURLE_OPERATION_TIMEDOUT) error_type = PROBE_ERROR_TIMEOUT;
+    else if (code == CURLE_COULDNT_RESOLVE_HOST) error_type = PROBE_ERROR_DNS;
+    else if (code == CURLE_COULDNT_CONNECT) error_type = PROBE_ERROR_TCP;
+    result->success = 0;
+    result->score = 0.0;
+    strncpy(result->error_type, error_type, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    snprintf(result->error_details, sizeof(result->error_details), "TLS handshake failed: %s", curl_easy_strerror(code));
+}
+
+/* Builds a connect-only handle that opens target and stops once its TLS session is up */
+static CURL* tls_new_handle(const TlsTarget* target, ProbeResult* result, int timeout_ms, struct curl_slist** connect_to) {
+    CURL* easy = curl_easy_init();
+    if (!easy) return NULL;
+    /* The URL carries the SNI; CONNECT_TO sends the connection to the server itself */
+    int ipv6 = strchr(target->host, ':') != NULL;
+    char url[320];
+    char route[600];
+    snprintf(url, sizeof(url), "https://%s:%d/", target->sni, target->port);
+    snprintf(route, sizeof(route), "%s:%d:%s%s%s:%d", target->sni, target->port,
+             ipv6 ? "[" : "", target->host, ipv6 ? "]" : "", target->port);
+    *connect_to = curl_slist_append(NULL, route);
+    curl_easy_setopt(easy, CURLOPT_URL, url);
+    curl_easy_setopt(easy, CURLOPT_CONNECT_TO, *connect_to);
+    curl_easy_setopt(easy, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, (long)timeout_ms);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, (long)timeout_ms);
+    /* Proxy servers present whatever certificate fits their SNI; only reachability matters */
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, result);
+    return easy;
+}
+
+/*
+ * Performs direct TLS handshakes with many proxy servers on one curl multi handle.
+ *
+ * Each entry connects to host:port and negotiates TLS with sni as the server name, the way
+ * V2Ray would open a TLS or REALITY outbound, but without a V2Ray process and without sending
+ * a request. Session resumption is disabled so every entry pays a full handshake. Up to
+ * MAX_CONCURRENT_PROBES handshakes are in flight at once.
+ *
+ * Parameters:
+ *   targets (const TlsTarget*): Servers to contact; entries with a port <= 0 are skipped.
+ *   n (int): Number of entries.
+ *   timeout_ms (int): Budget of each handshake, connect included.
+ *   out (ProbeResult*): Result slots; dns_ms, tcp_connect_ms, tls_handshake_ms and total_ms
+ *                       are filled on success, the error fields on failure.
+ *
+ * Returns:
+ *   int: Number of completed handshakes, or -1 if curl could not be initialized.
+ *
+ * Errors:
+ *   Per-entry failures are recorded in out; initialization failures are logged.
+ */
+int http_tls_handshakes(const TlsTarget* targets, int n, int timeout_ms, ProbeResult* out) {
+    if (!targets || !out || n <= 0) return -1;
+    http_shared_handle();
+
+    struct curl_slist** routes = calloc((size_t)n, sizeof(struct curl_slist*));
+    CURLM* multi = curl_multi_init();
+    if (!routes || !multi) {
+        log_message("Failed to initialize curl multi handle", __FILE__, __LINE__, 0, NULL);
+        free(routes);
+        if (multi) curl_multi_cleanup(multi);
+        return -1;
+    }
+
+    int next = 0, active = 0, succeeded = 0;
+    while (next < n || active > 0) {
+        while (next < n && active < MAX_CONCURRENT_PROBES) {
+            int i = next++;
+            if (targets[i].port <= 0) continue;
+            CURL* easy = tls_new_handle(&targets[i], &out[i], timeout_ms, &routes[i]);
+            if (!easy || curl_multi_add_handle(multi, easy) != CURLM_OK) {
+                tls_fail(&out[i], CURLE_FAILED_INIT);
+                if (easy) curl_easy_cleanup(easy);
+                continue;
+            }
+            active++;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int left;
+        while ((msg = curl_multi_info_read(multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL* easy = msg->easy_handle;
+            ProbeResult* result = NULL;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char**)&result);
+            if (result && msg->data.result == CURLE_OK) {
+                int dns_ms = http_elapsed_ms(easy, CURLINFO_NAMELOOKUP_TIME_T);
+                int connect_ms = http_elapsed_ms(easy, CURLINFO_CONNECT_TIME_T);
+                int appconnect_ms = http_elapsed_ms(easy, CURLINFO_APPCONNECT_TIME_T);
+                result->success = 1;
+                result->dns_ms = dns_ms;
+                result->tcp_connect_ms = connect_ms > dns_ms ? connect_ms - dns_ms : 0;
+                result->tls_handshake_ms = appconnect_ms > connect_ms ? appconnect_ms - connect_ms : 1;
+                result->total_ms = appconnect_ms > 0 ? appconnect_ms : 1;
+                result->attempts = 1;
+                succeeded++;
+            } else if (result) {
+                tls_fail(result, msg->data.result);
+                result->attempts = 1;
+            }
+            curl_multi_remove_handle(multi, easy);
+            curl_easy_cleanup(easy);
+            active--;
+        }
+
+        if (active > 0) {
+            curl_multi_poll(multi, NULL, 0, HTTP_POLL_INTERVAL_MS, NULL);
+        }
+    }
+
+    curl_multi_cleanup(multi);
+    for (int i = 0; i < n; i++) curl_slist_free_all(routes[i]);
+    free(routes);
+
+    LOG_DEBUGF("Direct TLS handshakes completed", "TLS probe: %d/%d servers completed a handshake", succeeded, n);
+    return succeeded;
+}
+
+#endif /* !_WIN32 */
@@ -0,0 +1,36 @@
+#ifndef LIBV2ROOT_HTTP_H
+#define LIBV2ROOT_HTTP_H
+
+#ifndef _WIN32
+
+#include <curl/curl.h>
+#include "libv2root_common.h"
+#include "libv2root_deadline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One direct TLS handshake: connect to host:port and negotiate TLS for sni */
+typedef struct {
+    char host[256];                 /* Server address */
+    int port;                       /* Server port, <= 0 to skip the entry */
+    char sni[256];                  /* Server name sent in the ClientHello */
+} TlsTarget;
+
+/* Process-wide curl state shared by every proxied request */
+CURLSH* http_shared_handle(void);
+
+/* Concurrent proxied TTFB requests against local HTTP inbounds, optionally under a deadline */
+int http_probe_ports(const int* ports, int n, int samples, ProbeResult* out, ProbeDeadline* deadline);
+
+/* Concurrent direct TLS handshakes to proxy servers, without V2Ray */
+int http_tls_handshakes(const TlsTarget* targets, int n, int timeout_ms, ProbeResult* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_WIN32 */
+
+#endif /* LIBV2ROOT_HTTP_H */
@@ -1,5 +1,6 @@
 #ifndef _WIN32
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,12 +13,307 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/syscall.h>
 #include <curl/curl.h>
 #include "libv2root_linux.h"
+#include "libv2root_http.h"
+#include "libv2root_metrics.h"
+#include "libv2root_records.h"
 #include "libv2root_utils.h"
 
+#define MAX_STDOUT_WATCHES 64
+#define READY_POLL_INTERVAL_MS 25
+#define STOP_GRACE_MS 1000                  /* SIGTERM to SIGKILL */
+#define EXIT_POLL_INTERVAL_MS 10            /* Exit polling where pidfds are not available */
+
+extern char** environ;
+
+/* Stdout pipe of a spawned V2Ray process, drained by a watcher thread */
+typedef struct {
+    pid_t pid;
+    int fd;
+    int started;
+} StdoutWatch;
+
+static StdoutWatch stdout_watches[MAX_STDOUT_WATCHES];
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watch_cond = PTHREAD_COND_INITIALIZER;
+
 /*
- * Starts a V2Ray process using fork/exec.
+ * Watcher thread: drains a V2Ray stdout pipe until EOF.
+ *
+ * Flags the slot once V2Ray prints its "started" line and releases it when the child
+ * closes stdout (i.e. exits), waking any thread blocked in linux_wait_for_ready.
+ * Draining for the whole process lifetime keeps a chatty V2Ray from blocking on a full pipe.
+ */
+static void* stdout_watch_thread(void* arg) {
+    StdoutWatch* watch = (StdoutWatch*)arg;
+    char buffer[1024];
+    char tail[16] = "";
+    ssize_t n;
+    while ((n = read(watch->fd, buffer, sizeof(buffer) - 1)) > 0 || (n < 0 && errno == EINTR)) {
+        if (n <= 0 || watch->started) continue;
+        buffer[n] = '\0';
+        /* Keep a short tail so a line split across reads is still matched */
+        char joined[sizeof(tail) + sizeof(buffer)];
+        snprintf(joined, sizeof(joined), "%s%s", tail, buffer);
+        if (strstr(joined, " started")) {
+            pthread_mutex_lock(&watch_lock);
+            watch->started = 1;
+            pthread_cond_broadcast(&watch_cond);
+            pthread_mutex_unlock(&watch_lock);
+        }
+        size_t len = strlen(joined);
+        snprintf(tail, sizeof(tail), "%s", joined + (len > sizeof(tail) - 1 ? len - (sizeof(tail) - 1) : 0));
+    }
+    close(watch->fd);
+    pthread_mutex_lock(&watch_lock);
+    watch->pid = 0;
+    watch->fd = -1;
+    watch->started = 0;
+    pthread_cond_broadcast(&watch_cond);
+    pthread_mutex_unlock(&watch_lock);
+    return NULL;
+}
+
+/*
+ * Starts a watcher thread for the read end of a child's stdout pipe.
+ * Returns 0 on success, -1 if no slot or thread is available (the fd is closed then).
+ */
+static int start_stdout_watch(pid_t pid, int fd) {
+    StdoutWatch* watch = NULL;
+    pthread_mutex_lock(&watch_lock);
+    for (int i = 0; i < MAX_STDOUT_WATCHES; i++) {
+        if (stdout_watches[i].pid == 0) {
+            watch = &stdout_watches[i];
+            watch->pid = pid;
+            watch->fd = fd;
+            watch->started = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&watch_lock);
+    if (!watch) {
+        log_message("No free stdout watch slot, readiness falls back to port polling", __FILE__, __LINE__, 0, NULL);
+        close(fd);
+        return -1;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, stdout_watch_thread, watch) != 0) {
+        log_message("Failed to create stdout watch thread", __FILE__, __LINE__, errno, NULL);
+        pthread_mutex_lock(&watch_lock);
+        watch->pid = 0;
+        watch->fd = -1;
+        pthread_mutex_unlock(&watch_lock);
+        close(fd);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+/*
+ * Checks whether a local inbound accepts TCP connections.
+ * Connections to 127.0.0.1 are refused immediately when nothing listens, so a blocking connect is fine.
+ */
+static int inbound_accepts(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return 0;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int ok = connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    close(sock);
+    return ok;
+}
+
+/*
+ * Opens a pidfd for a child process; it polls readable once the child has exited.
+ * Returns -1 where the kernel predates pidfd_open (Linux 5.3) or the pid is gone.
+ */
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*
+ * Waits until a child process has exited, without reaping it.
+ *
+ * Sleeps on a pidfd, so the exit wakes the caller as an event and no SIGCHLD handler has to be
+ * installed in the host process. Without pidfd support, the exit status is polled every
+ * EXIT_POLL_INTERVAL_MS instead.
+ *
+ * Returns:
+ *   int: 1 once the child has exited (or is not ours to wait for), 0 on timeout.
+ */
+static int wait_for_exit(pid_t pid, int timeout_ms) {
+    long long deadline = get_monotonic_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+    int fd = open_pidfd(pid);
+    for (;;) {
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0) {
+            if (errno != EINTR) break;
+            continue;
+        }
+        if (info.si_pid == pid) break;
+        long long now = get_monotonic_ms();
+        if (now >= deadline) {
+            if (fd >= 0) close(fd);
+            return 0;
+        }
+        int wait_ms = (int)(deadline - now);
+        if (fd >= 0) {
+            struct pollfd p = {fd, POLLIN, 0};
+            poll(&p, 1, wait_ms);
+        } else {
+            usleep((useconds_t)(wait_ms < EXIT_POLL_INTERVAL_MS ? wait_ms : EXIT_POLL_INTERVAL_MS) * 1000);
+        }
+    }
+    if (fd >= 0) close(fd);
+    return 1;
+}
+
+/*
+ * Writes a whole buffer to a pipe without raising SIGPIPE if the reader is gone.
+ *
+ * SIGPIPE is blocked for the calling thread only and a signal raised by the write is consumed,
+ * so the host process's signal disposition is left untouched.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on write failure (errno is set).
+ */
+static int write_all_nosigpipe(int fd, const char* data, size_t len) {
+    sigset_t block, old, pending;
+    sigemptyset(&block);
+    sigaddset(&block, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    sigpending(&pending);
+    int was_pending = sigismember(&pending, SIGPIPE);
+
+    int rc = 0;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            rc = -1;
+            break;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    if (rc != 0 && errno == EPIPE && !was_pending) {
+        int saved = errno;
+        struct timespec zero = {0, 0};
+        sigtimedwait(&block, NULL, &zero);
+        errno = saved;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return rc;
+}
+
+/*
+ * Spawns "v2ray run -c <config_arg>", capturing stdout for readiness detection.
+ *
+ * Parameters:
+ *   config_arg (const char*): Config path, or "stdin:" when config_data is given.
+ *   config_data (const char*): Config fed to the child's stdin, or NULL.
+ *   config_len (size_t): Length of config_data.
+ *   pid (pid_t*): Receives the child process ID.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+static int linux_spawn_v2ray(const char* config_arg, const char* config_data, size_t config_len, pid_t* pid) {
+    /* Capture stdout so readiness can be detected from V2Ray's "started" line */
+    int out_pipe[2] = {-1, -1};
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        log_message("Failed to create stdout pipe, readiness falls back to port polling", __FILE__, __LINE__, errno, NULL);
+        out_pipe[0] = out_pipe[1] = -1;
+    }
+    int in_pipe[2] = {-1, -1};
+    if (config_data && pipe2(in_pipe, O_CLOEXEC) != 0) {
+        log_message("Failed to create stdin pipe for V2Ray config", __FILE__, __LINE__, errno, NULL);
+        if (out_pipe[0] >= 0) {
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+        }
+        return -1;
+    }
+    
+    /*
+     * posix_spawnp runs the child on a CLONE_VM | CLONE_VFORK clone in glibc, so no page tables
+     * are copied and spawning costs the same in a small tool as in a large Python process.
+     * The pipes are close-on-exec; only the dup2'd copies reach V2Ray.
+     */
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+    if (out_pipe[1] >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    }
+    if (in_pipe[0] >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO);
+    }
+    /* Probe threads block SIGPIPE; V2Ray starts with an empty signal mask */
+    sigset_t no_signals;
+    sigemptyset(&no_signals);
+    posix_spawnattr_setsigmask(&attr, &no_signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    
+    /* IMPORTANT: Always use "v2ray" command from system PATH on Linux */
+    /* This ensures we use the package manager-installed V2Ray */
+    char* args[] = {"v2ray", "run", "-c", (char*)config_arg, NULL};
+    int spawn_error = posix_spawnp(pid, args[0], &actions, &attr, args, environ);  /* Searches PATH for "v2ray" */
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    
+    if (spawn_error != 0) {
+        log_message("Failed to execute V2Ray - ensure V2Ray is installed via package manager", __FILE__, __LINE__, spawn_error, NULL);
+        if (out_pipe[0] >= 0) {
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+        }
+        if (in_pipe[0] >= 0) {
+            close(in_pipe[0]);
+            close(in_pipe[1]);
+        }
+        return -1;
+    }
+    
+    /* Parent process */
+    if (out_pipe[0] >= 0) {
+        close(out_pipe[1]);
+        start_stdout_watch(*pid, out_pipe[0]);
+    }
+    if (in_pipe[1] >= 0) {
+        close(in_pipe[0]);
+        /* V2Ray reads the whole config before starting; EOF tells it the document is complete */
+        if (write_all_nosigpipe(in_pipe[1], config_data, config_len) != 0) {
+            log_message("Failed to feed config to V2Ray stdin", __FILE__, __LINE__, errno, NULL);
+        }
+        close(in_pipe[1]);
+    }
+    
+    LOG_INFOF("Linux V2Ray process started", "V2Ray process started with PID: %d using system-installed v2ray", *pid);
+    
+    return 0;
+}
+
+/*
+ * Starts a V2Ray process using posix_spawnp.
  * 
  * NOTE: On Linux, this function ALWAYS uses the system-installed 'v2ray' command
  * found in PATH. The config_file parameter is used, but the v2ray executable
@@ -30,38 +326,103 @@ int linux_start_v2ray_process(const char* config_file, pid_t* pid) {
         log_message("Invalid arguments to linux_start_v2ray_process", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
-    
-    *pid = fork();
-    
-    if (*pid == -1) {
-        log_message("Failed to fork process", __FILE__, __LINE__, errno, NULL);
+    long long start_us = get_monotonic_us();
+    int rc = linux_spawn_v2ray(config_file, NULL, 0, pid);
+    metrics_spawn_finished(rc == 0, start_us);
+    return rc;
+}
+
+/*
+ * Starts a V2Ray process with an in-memory config passed over stdin ("run -c stdin:").
+ *
+ * Nothing touches the filesystem, so concurrent tests from one working directory cannot
+ * clobber each other's configs.
+ *
+ * Parameters:
+ *   config_data (const char*): The complete JSON config.
+ *   config_len (size_t): Length of config_data in bytes.
+ *   pid (pid_t*): Receives the child process ID.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+int linux_start_v2ray_process_stdin(const char* config_data, size_t config_len, pid_t* pid) {
+    if (!config_data || !pid) {
+        log_message("Invalid arguments to linux_start_v2ray_process_stdin", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
-    
-    if (*pid == 0) {
-        /* Child process */
-        /* IMPORTANT: Always use "v2ray" command from system PATH on Linux */
-        /* This ensures we use the package manager-installed V2Ray */
-        char* args[] = {"v2ray", "run", "-c", (char*)config_file, NULL};
-        execvp(args[0], args);  /* execvp searches PATH for "v2ray" */
-        
-        /* If execvp returns, it failed */
-        log_message("Failed to execute V2Ray - ensure V2Ray is installed via package manager", __FILE__, __LINE__, errno, NULL);
-        _exit(1);
+    long long start_us = get_monotonic_us();
+    int rc = linux_spawn_v2ray("stdin:", config_data, config_len, pid);
+    metrics_spawn_finished(rc == 0, start_us);
+    return rc;
+}
+
+/*
+ * Waits until a freshly started V2Ray process accepts connections on an inbound port.
+ *
+ * Wakes on the "started" line or EOF from the stdout watcher, or on the process's pidfd when
+ * stdout is not watched, and otherwise re-checks every READY_POLL_INTERVAL_MS. The child is never reaped here (waitid with WNOWAIT), so callers
+ * can still collect its exit status.
+ *
+ * Parameters:
+ *   pid (pid_t): The V2Ray process ID returned by linux_start_v2ray_process.
+ *   port (int): A local inbound port from the process config.
+ *   timeout_ms (int): Upper bound for the wait in milliseconds.
+ *
+ * Returns:
+ *   int: 0 once the inbound accepts, -1 on timeout, -2 if the process exited.
+ */
+int linux_wait_for_ready(pid_t pid, int port, int timeout_ms) {
+    if (pid <= 0 || port <= 0) {
+        log_message("Invalid arguments to linux_wait_for_ready", __FILE__, __LINE__, 0, NULL);
+        return -1;
     }
-    
-    /* Parent process */
-    usleep(500000); /* Wait 500ms for process to start */
-    
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "V2Ray process started with PID: %d using system-installed v2ray", *pid);
-    log_message("Linux V2Ray process started", __FILE__, __LINE__, 0, extra_info);
-    
-    return 0;
+    long long start = get_monotonic_ms();
+    long long deadline = start + (timeout_ms > 0 ? timeout_ms : 0);
+    for (;;) {
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == pid) {
+            log_message("V2Ray exited before becoming ready", __FILE__, __LINE__, 0, NULL);
+            return -2;
+        }
+        if (inbound_accepts(port)) {
+            LOG_DEBUGF("V2Ray inbound ready", "Port %d ready after %lld ms", port, get_monotonic_ms() - start);
+            return 0;
+        }
+        long long now = get_monotonic_ms();
+        if (now >= deadline) break;
+        long long wait_ms = deadline - now < READY_POLL_INTERVAL_MS ? deadline - now : READY_POLL_INTERVAL_MS;
+
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += (long)(wait_ms * 1000000LL);
+        until.tv_sec += until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        pthread_mutex_lock(&watch_lock);
+        int watched = 0;
+        for (int i = 0; i < MAX_STDOUT_WATCHES; i++) {
+            if (stdout_watches[i].pid == pid) {
+                watched = !stdout_watches[i].started;
+                break;
+            }
+        }
+        /* Once "started" was seen, only the listener race is left: poll at the short interval */
+        if (watched) {
+            pthread_cond_timedwait(&watch_cond, &watch_lock, &until);
+        }
+        pthread_mutex_unlock(&watch_lock);
+        if (!watched) {
+            wait_for_exit(pid, (int)wait_ms);
+        }
+    }
+    LOG_WARNINGF("V2Ray readiness timed out", "Port %d not ready within %d ms", port, timeout_ms);
+    return -1;
 }
 
 /*
- * Stops a V2Ray process by sending SIGTERM.
+ * Stops a V2Ray process by sending SIGTERM, and SIGKILL if it has not exited after
+ * STOP_GRACE_MS. Returns as soon as the process exits (see wait_for_exit) and reaps it.
  */
 int linux_stop_v2ray_process(pid_t pid) {
     if (pid <= 0) {
@@ -71,7 +432,7 @@ int linux_stop_v2ray_process(pid_t pid) {
     
     if (kill(pid, SIGTERM) == -1) {
         if (errno == ESRCH) {
-            log_message("Process not found", __FILE__, __LINE__, errno, NULL);
+            LOG_DEBUG("Process not found", NULL);
             return 0;
         }
         log_message("Failed to stop V2Ray process", __FILE__, __LINE__, errno, NULL);
@@ -80,19 +441,17 @@ int linux_stop_v2ray_process(pid_t pid) {
     
     /* Wait for process to terminate */
     int status;
-    for (int i = 0; i < 10; i++) {
-        if (waitpid(pid, &status, WNOHANG) == pid) {
-            log_message("V2Ray process terminated", __FILE__, __LINE__, 0, NULL);
-            return 0;
-        }
-        usleep(100000); /* Wait 100ms */
+    if (wait_for_exit(pid, STOP_GRACE_MS)) {
+        waitpid(pid, &status, 0);
+        LOG_DEBUG("V2Ray process terminated", NULL);
+        return 0;
     }
     
     /* Force kill if still running */
     kill(pid, SIGKILL);
     waitpid(pid, &status, 0);
     
-    log_message("V2Ray process force killed", __FILE__, __LINE__, 0, NULL);
+    LOG_WARNING("V2Ray process force killed", NULL);
     return 0;
 }
 
@@ -112,9 +471,7 @@ int linux_enable_system_proxy(int http_port, int socks_port) {
     setenv("socks_proxy", socks_proxy, 1);
     setenv("SOCKS_PROXY", socks_proxy, 1);
     
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "HTTP: %s, SOCKS: %s", http_proxy, socks_proxy);
-    log_message("Linux system proxy enabled", __FILE__, __LINE__, 0, extra_info);
+    LOG_INFOF("Linux system proxy enabled", "HTTP: %s, SOCKS: %s", http_proxy, socks_proxy);
     
     return 0;
 }
@@ -130,7 +487,7 @@ int linux_disable_system_proxy(void) {
     unsetenv("socks_proxy");
     unsetenv("SOCKS_PROXY");
     
-    log_message("Linux system proxy disabled", __FILE__, __LINE__, 0, NULL);
+    LOG_INFO("Linux system proxy disabled", NULL);
     return 0;
 }
 
@@ -158,7 +515,8 @@ int linux_test_connection(int http_port, int socks_port, int* latency, pid_t pid
     
     CURL *curl;
     CURLcode res;
-    struct timeval start, end;
+    long long start_us, end_us;
+    CURLSH *share = http_shared_handle();
     
     curl = curl_easy_init();
     if (!curl) {
@@ -180,15 +538,17 @@ int linux_test_connection(int http_port, int socks_port, int* latency, pid_t pid
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "V2Root-Test/1.0");
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    if (share) curl_easy_setopt(curl, CURLOPT_SHARE, share);  /* Reuse DNS and TLS sessions */
     
     // Start timing
-    gettimeofday(&start, NULL);
+    start_us = get_monotonic_us();
     
     // Perform the request
     res = curl_easy_perform(curl);
     
     // Stop timing
-    gettimeofday(&end, NULL);
+    end_us = get_monotonic_us();
     
     if (res != CURLE_OK) {
         char err_msg[256];
@@ -199,9 +559,7 @@ int linux_test_connection(int http_port, int socks_port, int* latency, pid_t pid
     }
     
     // Calculate latency
-    long seconds = end.tv_sec - start.tv_sec;
-    long microseconds = end.tv_usec - start.tv_usec;
-    double elapsed_ms = (seconds * 1000.0) + (microseconds / 1000.0);
+    double elapsed_ms = (end_us - start_us) / 1000.0;
     
     *latency = (int)(elapsed_ms + 0.5);
     
@@ -219,31 +577,102 @@ int linux_test_connection(int http_port, int socks_port, int* latency, pid_t pid
     
     curl_easy_cleanup(curl);
     
-    char extra_info[512];
-    snprintf(extra_info, sizeof(extra_info), 
-             "Real connection latency: %d ms (DNS: %.0fms, Connect: %.0fms, Total: %.0fms)", 
+    LOG_INFOF("Connection test successful via proxy", "Real connection latency: %d ms (DNS: %.0fms, Connect: %.0fms, Total: %.0fms)", 
              *latency, namelookup_time * 1000, connect_time * 1000, total_time * 1000);
-    log_message("Connection test successful via proxy", __FILE__, __LINE__, 0, extra_info);
     
     return 0;
 }
 
+/* Header callback of linux_probe_sample: the first header line is V2Ray's CONNECT response */
+static size_t sample_header_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    long long* tunnel_us = (long long*)userdata;
+    if (*tunnel_us == 0) *tunnel_us = get_monotonic_us();
+    return size * nitems;
+}
+
+static int sample_ms(CURL* curl, CURLINFO info) {
+    curl_off_t us = 0;
+    curl_easy_getinfo(curl, info, &us);
+    return (int)((us + 500) / 1000);
+}
+
+/*
+ * Performs one HTTPS request through the V2Ray proxy and records its phase timings.
+ *
+ * Each sample uses a new connection and no TLS session cache, so every sample pays for the
+ * full CONNECT tunnel and TLS handshake. curl reports the local connect, TLS and first-byte
+ * times; the CONNECT response is timed by the header callback, which sees the proxy's
+ * response before the tunnelled request starts.
+ *
+ * Parameters:
+ *   http_port (int): HTTP inbound port of the V2Ray process.
+ *   sample (ProbeSample*): Receives the phase timings.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the request failed.
+ */
+int linux_probe_sample(int http_port, ProbeSample* sample) {
+    memset(sample, 0, sizeof(ProbeSample));
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        log_message("Failed to initialize curl", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    char proxy_str[64];
+    snprintf(proxy_str, sizeof(proxy_str), "http://127.0.0.1:%d", http_port);
+    long long tunnel_us = 0;
+    curl_easy_setopt(curl, CURLOPT_URL, PRIMARY_PROBE_URL);
+    curl_easy_setopt(curl, CURLOPT_PROXY, proxy_str);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, sample_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &tunnel_us);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)DEFAULT_TTFB_TIMEOUT_MS);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)DEFAULT_TTFB_TIMEOUT_MS);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "V2Root-Probe/1.0");
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    long long start_us = get_monotonic_us();
+    CURLcode res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        LOG_DEBUG("Probe sample failed", curl_easy_strerror(res));
+        curl_easy_cleanup(curl);
+        return -1;
+    }
+    sample->connect_ms = sample_ms(curl, CURLINFO_CONNECT_TIME_T);
+    sample->app_connect_ms = sample_ms(curl, CURLINFO_APPCONNECT_TIME_T);
+    sample->ttfb_ms = sample_ms(curl, CURLINFO_STARTTRANSFER_TIME_T);
+    sample->total_ms = sample_ms(curl, CURLINFO_TOTAL_TIME_T);
+    curl_easy_cleanup(curl);
+
+    /* Keep the tunnel time inside the phases curl measured on its own clock */
+    int tunnel_ms = tunnel_us > 0 ? (int)((tunnel_us - start_us + 500) / 1000) : sample->app_connect_ms;
+    if (tunnel_ms < sample->connect_ms) tunnel_ms = sample->connect_ms;
+    if (tunnel_ms > sample->app_connect_ms) tunnel_ms = sample->app_connect_ms;
+    sample->tunnel_ms = tunnel_ms;
+    if (sample->ttfb_ms < 1) sample->ttfb_ms = 1;
+    return 0;
+}
+
 /*
  * Performs a single HTTP request through the V2Ray proxy and measures TTFB.
- * Returns JSON with platform, success, ttfb_ms, http_status, and error_message.
+ * Fills success, ttfb_ms, http_status and, on failure, error_code and error_details of
+ * record; returns 0 on success and -1 on failure.
  */
-EXPORT char* linux_measure_ttfb(int http_port) {
-    static char result[1024];
+int linux_measure_ttfb_record(int http_port, ProbeRecord* record) {
     CURL *curl;
     CURLcode res;
     long http_code = 0;
     double total_time = 0;
+    CURLSH *share = http_shared_handle();
     
     curl = curl_easy_init();
     if (!curl) {
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"linux\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to initialize curl\"}");
-        return result;
+        record->error_code = PROBE_CODE_UNKNOWN;
+        strncpy(record->error_details, "Failed to initialize curl", sizeof(record->error_details) - 1);
+        return -1;
     }
     
     // Configure proxy
@@ -261,6 +690,7 @@ EXPORT char* linux_measure_ttfb(int http_port) {
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "V2Root-TTFBTest/1.0");
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);  /* Prevent signals from interrupting */
+    if (share) curl_easy_setopt(curl, CURLOPT_SHARE, share);  /* Reuse DNS and TLS sessions */
     
     // Perform the request
     res = curl_easy_perform(curl);
@@ -268,10 +698,9 @@ EXPORT char* linux_measure_ttfb(int http_port) {
     if (res != CURLE_OK) {
         const char* error_str = curl_easy_strerror(res);
         curl_easy_cleanup(curl);
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"linux\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"%s\"}", 
-                 error_str);
-        return result;
+        record->error_code = res == CURLE_OPERATION_TIMEDOUT ? PROBE_CODE_TIMEOUT : PROBE_CODE_TRANSPORT;
+        strncpy(record->error_details, error_str, sizeof(record->error_details) - 1);
+        return -1;
     }
     
     // Get HTTP status code
@@ -289,11 +718,19 @@ EXPORT char* linux_measure_ttfb(int http_port) {
     // Cleanup
     curl_easy_cleanup(curl);
     
-    // Return formatted result
-    snprintf(result, sizeof(result),
-             "{\"platform\": \"linux\", \"success\": true, \"ttfb_ms\": %d, \"http_status\": %ld, \"error_message\": null}", 
-             ttfb_ms, http_code);
-    
+    record->success = 1;
+    record->ttfb_ms = ttfb_ms;
+    record->http_status = (int32_t)http_code;
+    return 0;
+}
+
+/* As linux_measure_ttfb_record, returning the result as JSON in a per-thread buffer */
+EXPORT char* linux_measure_ttfb(int http_port) {
+    static THREAD_LOCAL char result[1024];
+    ProbeRecord record;
+    probe_record_init(&record, 0);
+    linux_measure_ttfb_record(http_port, &record);
+    probe_record_ttfb_json(&record, result, sizeof(result));
     return result;
 }
 
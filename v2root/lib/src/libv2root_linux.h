@@ -12,7 +12,9 @@ extern "C" {
 
 /* Process management */
 int linux_start_v2ray_process(const char* config_file, pid_t* pid);
+int linux_start_v2ray_process_stdin(const char* config_data, size_t config_len, pid_t* pid);
 int linux_stop_v2ray_process(pid_t pid);
+int linux_wait_for_ready(pid_t pid, int port, int timeout_ms);
 
 /* Proxy settings */
 int linux_enable_system_proxy(int http_port, int socks_port);
@@ -21,6 +23,8 @@ int linux_reset_network_proxy(void);
 
 /* Connection testing */
 int linux_test_connection(int http_port, int socks_port, int* latency, pid_t pid);
+int linux_probe_sample(int http_port, ProbeSample* sample);
+int linux_measure_ttfb_record(int http_port, ProbeRecord* record);
 EXPORT char* linux_measure_ttfb(int http_port);
 
 #ifdef __cplusplus
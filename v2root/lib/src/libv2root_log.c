@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "libv2root_log.h"
+
+/*
+ * Buffered, asynchronous logger.
+ *
+ * Callers format a line into a slot of a bounded lock-free ring (Vyukov's MPMC queue, used
+ * here with many producers and one consumer) and return; a writer thread drains the ring into
+ * v2root.log through one persistent file handle every LOG_FLUSH_INTERVAL_MS. Errors drain the
+ * ring immediately when no other drain is running. Only when the ring is full does a caller
+ * wait, draining it itself, so bursts apply backpressure instead of losing lines.
+ */
+
+#define LOG_FILE "v2root.log"
+#define LOG_RING_SIZE 512                   /* Power of two */
+#define LOG_LINE_LENGTH 1024
+#define LOG_FLUSH_INTERVAL_MS 100
+
+typedef struct {
+    size_t seq;                             /* Vyukov sequence number; see log_reserve */
+    int len;
+    char text[LOG_LINE_LENGTH];
+} LogSlot;
+
+volatile int log_threshold = LOG_LEVEL_INFO;
+
+static LogSlot log_ring[LOG_RING_SIZE];
+static size_t log_enqueue_pos;
+static size_t log_dequeue_pos;              /* Guarded by log_drain_lock */
+static FILE* log_fp;
+static int log_stopped;                     /* Guarded by log_drain_lock */
+static pthread_mutex_t log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+static const char* const log_level_names[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+static void log_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* Writes every published slot to the file; caller holds log_drain_lock */
+static void log_drain(void) {
+    for (;;) {
+        LogSlot* slot = &log_ring[log_dequeue_pos & (LOG_RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq != log_dequeue_pos + 1) break;
+        if (log_fp) fwrite(slot->text, 1, (size_t)slot->len, log_fp);
+        __atomic_store_n(&slot->seq, log_dequeue_pos + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        log_dequeue_pos++;
+    }
+    if (log_fp) fflush(log_fp);
+}
+
+static void* log_writer(void* arg) {
+    (void)arg;
+    for (;;) {
+        log_sleep_ms(LOG_FLUSH_INTERVAL_MS);
+        pthread_mutex_lock(&log_drain_lock);
+        int stopped = log_stopped;
+        if (!stopped) log_drain();
+        pthread_mutex_unlock(&log_drain_lock);
+        if (stopped) return NULL;
+    }
+}
+
+/*
+ * Flushes and closes the log at exit.
+ *
+ * The writer is not joined: on Windows this runs under the loader lock while the DLL unloads,
+ * where waiting for a thread would deadlock. Taking log_drain_lock is enough to keep the writer
+ * out of the file once log_stopped is set.
+ */
+static void log_shutdown(void) {
+    pthread_mutex_lock(&log_drain_lock);
+    log_drain();
+    log_stopped = 1;
+    if (log_fp) {
+        fclose(log_fp);
+        log_fp = NULL;
+    }
+    pthread_mutex_unlock(&log_drain_lock);
+}
+
+static void log_init(void) {
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) log_ring[i].seq = i;
+    log_fp = fopen(LOG_FILE, "a");
+    if (log_fp) setvbuf(log_fp, NULL, _IOFBF, 64 * 1024);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, log_writer, NULL) == 0) {
+        pthread_detach(thread);
+    }
+    atexit(log_shutdown);
+}
+
+/* Claims the next free slot, or returns NULL if the ring is full */
+static LogSlot* log_reserve(size_t* pos_out) {
+    size_t pos = __atomic_load_n(&log_enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        LogSlot* slot = &log_ring[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&log_enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return slot;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&log_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * Queues a log line with timestamp, level, file location, and optional error information.
+ * Writes to v2root.log only - no terminal output. Callers normally go through log_message or
+ * the LOG_* macros, which skip disabled levels before any formatting happens.
+ *
+ * Parameters:
+ *   level (int): One of the LOG_LEVEL_* constants.
+ *   message (const char*): The message.
+ *   file (const char*): Source file, usually __FILE__.
+ *   line (int): Source line, usually __LINE__.
+ *   error_code (int): Error code to append, or 0.
+ *   extra_info (const char*): Extra detail to append, or NULL.
+ *
+ * Returns:
+ *   None
+ */
+void log_write(int level, const char* message, const char* file, int line, int error_code, const char* extra_info) {
+    if (level < log_threshold || !message) return;
+    pthread_once(&log_once, log_init);
+
+    size_t pos;
+    LogSlot* slot;
+    while ((slot = log_reserve(&pos)) == NULL) {
+        pthread_mutex_lock(&log_drain_lock);
+        int stopped = log_stopped;
+        if (!stopped) log_drain();
+        pthread_mutex_unlock(&log_drain_lock);
+        if (stopped) return;
+    }
+
+    time_t now = time(NULL);
+    struct tm tm_now;
+#ifdef _WIN32
+    localtime_s(&tm_now, &now);
+#else
+    localtime_r(&now, &tm_now);
+#endif
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm_now);
+    if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    if (level > LOG_LEVEL_ERROR) level = LOG_LEVEL_ERROR;
+
+    char error_part[32] = "";
+    if (error_code != 0) snprintf(error_part, sizeof(error_part), " (Error code: %d)", error_code);
+    int has_extra = extra_info != NULL && extra_info[0] != '\0';
+    int len = snprintf(slot->text, sizeof(slot->text), "[%s] %s %s:%d - %s%s%s%s\n",
+                       timestamp, log_level_names[level], file, line, message, error_part,
+                       has_extra ? " - " : "", has_extra ? extra_info : "");
+    if (len < 0) len = 0;
+    if ((size_t)len >= sizeof(slot->text)) {
+        len = (int)sizeof(slot->text) - 1;
+        slot->text[len - 1] = '\n';
+    }
+    slot->len = len;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    if (level >= LOG_LEVEL_ERROR && pthread_mutex_trylock(&log_drain_lock) == 0) {
+        if (!log_stopped) log_drain();
+        pthread_mutex_unlock(&log_drain_lock);
+    }
+}
+
+/*
+ * Logs a failure with timestamp, file location, and optional error information.
+ */
+void log_message(const char* message, const char* file, int line, int error_code, const char* extra_info) {
+    log_write(LOG_LEVEL_ERROR, message, file, line, error_code, extra_info);
+}
+
+/*
+ * Sets the minimum level written to the log.
+ *
+ * Parameters:
+ *   level (int): LOG_LEVEL_DEBUG to LOG_LEVEL_ERROR; values outside the range are clamped.
+ *
+ * Returns:
+ *   None
+ */
+EXPORT void v2root_set_log_level(int level) {
+    if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    if (level > LOG_LEVEL_ERROR) level = LOG_LEVEL_ERROR;
+    log_threshold = level;
+}
+
+/* Returns the minimum level written to the log */
+EXPORT int v2root_get_log_level(void) {
+    return log_threshold;
+}
+
+/*
+ * Writes every queued line to v2root.log before returning.
+ *
+ * Returns:
+ *   None
+ */
+EXPORT void v2root_flush_log(void) {
+    pthread_once(&log_once, log_init);
+    pthread_mutex_lock(&log_drain_lock);
+    if (!log_stopped) log_drain();
+    pthread_mutex_unlock(&log_drain_lock);
+}
@@ -0,0 +1,56 @@
+#ifndef LIBV2ROOT_LOG_H
+#define LIBV2ROOT_LOG_H
+
+#include <stdio.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest extra_info the formatting macros build; longer text is truncated */
+#define LOG_EXTRA_LENGTH 512
+
+/* Minimum level written to v2root.log; read without a lock by the LOG_* macros */
+extern volatile int log_threshold;
+
+#define LOG_ENABLED(level) ((level) >= log_threshold)
+
+/* Logs at level; arguments are not evaluated when the level is disabled */
+#define LOG_AT(level, message, error_code, extra_info) \
+    do { \
+        if (LOG_ENABLED(level)) log_write((level), (message), __FILE__, __LINE__, (error_code), (extra_info)); \
+    } while (0)
+
+#define LOG_DEBUG(message, extra_info) LOG_AT(LOG_LEVEL_DEBUG, message, 0, extra_info)
+#define LOG_INFO(message, extra_info) LOG_AT(LOG_LEVEL_INFO, message, 0, extra_info)
+#define LOG_WARNING(message, extra_info) LOG_AT(LOG_LEVEL_WARNING, message, 0, extra_info)
+
+/* As LOG_AT with printf-style extra info, formatted only when the level is enabled */
+#define LOG_ATF(level, message, ...) \
+    do { \
+        if (LOG_ENABLED(level)) { \
+            char log_extra_[LOG_EXTRA_LENGTH]; \
+            snprintf(log_extra_, sizeof(log_extra_), __VA_ARGS__); \
+            log_write((level), (message), __FILE__, __LINE__, 0, log_extra_); \
+        } \
+    } while (0)
+
+#define LOG_DEBUGF(message, ...) LOG_ATF(LOG_LEVEL_DEBUG, message, __VA_ARGS__)
+#define LOG_INFOF(message, ...) LOG_ATF(LOG_LEVEL_INFO, message, __VA_ARGS__)
+#define LOG_WARNINGF(message, ...) LOG_ATF(LOG_LEVEL_WARNING, message, __VA_ARGS__)
+
+void log_write(int level, const char* message, const char* file, int line, int error_code, const char* extra_info);
+
+/* Logs at LOG_LEVEL_ERROR; the entry point for failure paths */
+void log_message(const char* message, const char* file, int line, int error_code, const char* extra_info);
+
+EXPORT void v2root_set_log_level(int level);
+EXPORT int v2root_get_log_level(void);
+EXPORT void v2root_flush_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_LOG_H */
@@ -2,8 +2,6 @@
 #include <string.h>
 #include <errno.h>
 #include <jansson.h>
-#include <stdint.h>
-#include <ctype.h>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -38,9 +36,19 @@
 #include "libv2root_vmess.h"
 #include "libv2root_shadowsocks.h"
 #include "libv2root_utils.h"
+#include "libv2root_dns.h"
+#include "libv2root_config.h"
+#include "libv2root_uri.h"
+#include "libv2root_base64.h"
+#include "libv2root_balancer.h"
+#include "libv2root_context.h"
+#include "libv2root_ports.h"
+#include "libv2root_records.h"
+#include "libv2root_metrics.h"
+#include "libv2root_throughput.h"
+#include "libv2root_arena.h"
 
 /* Forward declarations */
-static char* base64_decode(const char* input);
 #ifndef _WIN32
 static int is_wsl(void);
 #endif
@@ -48,9 +56,8 @@ static int is_wsl(void);
 /* Declare start_v2ray_with_pid before start_v2ray uses it */
 EXPORT int start_v2ray_with_pid(int http_port, int socks_port, PID_TYPE* pid);
 
-static PID_TYPE v2ray_pid = 0;
-static char v2ray_config_file[1024];
-static char v2ray_executable_path[1024];
+/* Legacy exports return results in a per-thread buffer, so concurrent callers cannot clobber them */
+static THREAD_LOCAL char ttfb_result_buffer[CONTEXT_SCRATCH_LENGTH];
 
 /*
  * Checks if the system is running under Windows Subsystem for Linux (WSL).
@@ -83,91 +90,13 @@ static int is_wsl() {
 #endif
 
 /*
- * Decodes a base64-encoded string.
- *
- * Filters out invalid characters, validates the input length, and decodes the base64 string into a null-terminated string.
- * Logs the decoded output for debugging.
- *
- * Parameters:
- *   input (const char*): The base64-encoded string to decode.
- *
- * Returns:
- *   char*: A pointer to the decoded string on success, NULL on failure.
- *
- * Errors:
- *   Logs errors for null input, memory allocation failures, invalid base64 length, or invalid characters.
- *   Frees allocated memory and returns NULL on failure.
- */
-static char* base64_decode(const char* input) {
-    if (!input) {
-        log_message("Null input for base64 decode", __FILE__, __LINE__, 0, NULL);
-        return NULL;
-    }
-    size_t len = strlen(input);
-    size_t clean_len = 0;
-    char* clean_input = malloc(len + 1);
-    if (!clean_input) {
-        log_message("Failed to allocate memory for clean base64 input", __FILE__, __LINE__, 0, NULL);
-        return NULL;
-    }
-    for (size_t i = 0; i < len; i++) {
-        if (isalnum(input[i]) || input[i] == '+' || input[i] == '/' || input[i] == '=') {
-            clean_input[clean_len++] = input[i];
-        }
-    }
-    clean_input[clean_len] = '\0';
-    if (clean_len % 4 != 0) {
-        log_message("Invalid base64 length", __FILE__, __LINE__, 0, clean_input);
-        free(clean_input);
-        return NULL;
-    }
-    size_t padding = 0;
-    if (clean_len > 0 && clean_input[clean_len - 1] == '=') padding++;
-    if (clean_len > 1 && clean_input[clean_len - 2] == '=') padding++;
-    size_t out_len = ((clean_len * 3) / 4) - padding;
-    char* output = malloc(out_len + 1);
-    if (!output) {
-        log_message("Failed to allocate memory for base64 decode", __FILE__, __LINE__, 0, NULL);
-        free(clean_input);
-        return NULL;
-    }
-    size_t i, j;
-    for (i = 0, j = 0; i < clean_len; i += 4) {
-        uint32_t val = 0;
-        for (int k = 0; k < 4 && i + k < clean_len; k++) {
-            char c = clean_input[i + k];
-            if (c >= 'A' && c <= 'Z') val = (val << 6) | (c - 'A');
-            else if (c >= 'a' && c <= 'z') val = (val << 6) | (c - 'a' + 26);
-            else if (c >= '0' && c <= '9') val = (val << 6) | (c - '0' + 52);
-            else if (c == '+') val = (val << 6) | 62;
-            else if (c == '/') val = (val << 6) | 63;
-            else if (c == '=') continue;
-            else {
-                log_message("Invalid base64 character", __FILE__, __LINE__, 0, clean_input);
-                free(output);
-                free(clean_input);
-                return NULL;
-            }
-        }
-        if (j + 2 < out_len) output[j++] = (val >> 16) & 0xFF;
-        if (j + 1 < out_len) output[j++] = (val >> 8) & 0xFF;
-        if (j < out_len) output[j++] = val & 0xFF;
-    }
-    output[j] = '\0';
-    char debug_msg[512];
-    snprintf(debug_msg, sizeof(debug_msg), "Base64 decoded: %s", output);
-    log_message(debug_msg, __FILE__, __LINE__, 0, NULL);
-    free(clean_input);
-    return output;
-}
-
-/*
- * Initializes the V2Ray environment with configuration and executable paths.
+ * Initializes a context with configuration and executable paths.
  *
  * On Windows: Validates and stores the user-provided v2ray_path.
  * On Linux: Validates that v2ray exists in system PATH (ignores v2ray_path if provided).
  *
  * Parameters:
+ *   ctx (v2root_ctx_t*): The context to initialize.
  *   config_file (const char*): Path to the V2Ray configuration file.
  *   v2ray_path (const char*): Path to the V2Ray executable (Windows only; ignored on Linux).
  *
@@ -177,8 +106,8 @@ static char* base64_decode(const char* input) {
  * Errors:
  *   Logs errors for null or overly long paths, or if the executable is not found.
  */
-EXPORT int init_v2ray(const char* config_file, const char* v2ray_path) {
-    if (!config_file) {
+EXPORT int v2root_ctx_init(v2root_ctx_t* ctx, const char* config_file, const char* v2ray_path) {
+    if (!ctx || !config_file) {
         log_message("Invalid config file", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
@@ -189,7 +118,7 @@ EXPORT int init_v2ray(const char* config_file, const char* v2ray_path) {
         log_message("V2Ray path is required on Windows", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
-    if (strlen(v2ray_path) >= sizeof(v2ray_executable_path)) {
+    if (strlen(v2ray_path) >= sizeof(ctx->executable_path)) {
         log_message("V2Ray executable path too long", __FILE__, __LINE__, 0, v2ray_path);
         return -1;
     }
@@ -197,18 +126,12 @@ EXPORT int init_v2ray(const char* config_file, const char* v2ray_path) {
         log_message("V2Ray executable not found", __FILE__, __LINE__, errno, v2ray_path);
         return -1;
     }
-    strncpy(v2ray_executable_path, v2ray_path, sizeof(v2ray_executable_path) - 1);
-    v2ray_executable_path[sizeof(v2ray_executable_path) - 1] = '\0';
 #else
     /* Linux: Ignore v2ray_path, always use system-installed v2ray */
     if (v2ray_path) {
-        log_message("v2ray_path ignored on Linux - using system-installed V2Ray", __FILE__, __LINE__, 0, v2ray_path);
+        LOG_WARNING("v2ray_path ignored on Linux - using system-installed V2Ray", v2ray_path);
     }
     
-    /* Store "v2ray" as the executable path - system will find it via PATH */
-    strncpy(v2ray_executable_path, "v2ray", sizeof(v2ray_executable_path) - 1);
-    v2ray_executable_path[sizeof(v2ray_executable_path) - 1] = '\0';
-    
     /* Verify v2ray is accessible in PATH */
     if (system("which v2ray > /dev/null 2>&1") != 0) {
         log_message("V2Ray not found in system PATH - install via package manager (apt/dnf/pacman)", __FILE__, __LINE__, 0, NULL);
@@ -216,18 +139,33 @@ EXPORT int init_v2ray(const char* config_file, const char* v2ray_path) {
     }
 #endif
     
-    if (strlen(config_file) >= sizeof(v2ray_config_file)) {
+    if (strlen(config_file) >= sizeof(ctx->config_file)) {
         log_message("Config file path too long", __FILE__, __LINE__, 0, config_file);
         return -1;
     }
     
-    strncpy(v2ray_config_file, config_file, sizeof(v2ray_config_file) - 1);
-    v2ray_config_file[sizeof(v2ray_config_file) - 1] = '\0';
+    pthread_mutex_lock(&ctx->lock);
+#ifdef _WIN32
+    strncpy(ctx->executable_path, v2ray_path, sizeof(ctx->executable_path) - 1);
+#else
+    /* Store "v2ray" as the executable path - system will find it via PATH */
+    strncpy(ctx->executable_path, "v2ray", sizeof(ctx->executable_path) - 1);
+#endif
+    ctx->executable_path[sizeof(ctx->executable_path) - 1] = '\0';
+    strncpy(ctx->config_file, config_file, sizeof(ctx->config_file) - 1);
+    ctx->config_file[sizeof(ctx->config_file) - 1] = '\0';
+    __atomic_store_n(&ctx->initialized, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&ctx->lock);
     
-    log_message("V2Ray initialized with config and executable", __FILE__, __LINE__, 0, v2ray_executable_path);
+    LOG_INFO("V2Ray initialized with config and executable", ctx->executable_path);
     return 0;
 }
 
+/* Initializes the default context; see v2root_ctx_init */
+EXPORT int init_v2ray(const char* config_file, const char* v2ray_path) {
+    return v2root_ctx_init(v2root_ctx_default(), config_file, v2ray_path);
+}
+
 /*
  * Resets the system proxy settings.
  *
@@ -275,42 +213,41 @@ EXPORT int start_v2ray(int http_port, int socks_port) {
 }
 
 /*
- * Starts the V2Ray process with specified ports and stores the process ID.
+ * Starts a context's V2Ray process with specified ports and stores the process ID.
  *
  * Validates initialization, configuration file, and starts the V2Ray process using platform-specific functions.
  * Enables system proxy and logs the process ID.
  *
  * Parameters:
+ *   ctx (v2root_ctx_t*): The context.
  *   http_port (int): HTTP proxy port (defaults to 2300 if <= 0).
  *   socks_port (int): SOCKS proxy port (defaults to 2301 if <= 0).
  *   pid (PID_TYPE*): Pointer to store the process ID.
  *
  * Returns:
- *   int: 0 on success, -1 on failure, -4 if config file is missing.
+ *   int: 0 on success, -1 on failure, -4 if config file is missing, -7 if already running.
  *
  * Errors:
  *   Logs errors for uninitialized V2Ray, missing config file, or platform-specific failures.
  */
-EXPORT int start_v2ray_with_pid(int http_port, int socks_port, PID_TYPE* pid) {
-    if (v2ray_config_file[0] == '\0' || v2ray_executable_path[0] == '\0') {
+static int ctx_start(v2root_ctx_t* ctx, int http_port, int socks_port, PID_TYPE* pid) {
+    if (ctx->config_file[0] == '\0' || ctx->executable_path[0] == '\0') {
         log_message("V2Ray not initialized", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
-    if (ACCESS(v2ray_config_file, F_OK) == -1) {
-        log_message("Config file not found for V2Ray start", __FILE__, __LINE__, errno, v2ray_config_file);
+    if (ACCESS(ctx->config_file, F_OK) == -1) {
+        log_message("Config file not found for V2Ray start", __FILE__, __LINE__, errno, ctx->config_file);
         return -4;
     }
     if (http_port <= 0) http_port = 2300;
     if (socks_port <= 0) socks_port = 2301;
-    char port_info[256];
-    snprintf(port_info, sizeof(port_info), "Starting V2Ray with HTTP Port: %d, SOCKS Port: %d", http_port, socks_port);
-    log_message(port_info, __FILE__, __LINE__, 0, NULL);
+    LOG_INFOF("Starting V2Ray", "HTTP Port: %d, SOCKS Port: %d", http_port, socks_port);
 #ifdef _WIN32
     if (win_enable_system_proxy(http_port, socks_port) != 0) {
         log_message("Failed to enable system proxy in Windows", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
-    int start_result = start_v2ray_process(v2ray_config_file, v2ray_executable_path, &v2ray_pid);
+    int start_result = start_v2ray_process(ctx->config_file, ctx->executable_path, &ctx->pid);
     if (start_result == -2) {
         log_message("Cannot start V2Ray - process already running", __FILE__, __LINE__, 0, NULL);
         return -7;
@@ -319,22 +256,28 @@ EXPORT int start_v2ray_with_pid(int http_port, int socks_port, PID_TYPE* pid) {
         win_disable_system_proxy();
         return -1;
     }
-    save_pid_to_registry(v2ray_pid);
-    *pid = v2ray_pid;
+    save_pid_to_registry(ctx->pid);
+    *pid = ctx->pid;
 #else
     if (is_wsl()) {
         if (linux_enable_system_proxy(http_port, socks_port) != 0) {
             log_message("Failed to enable system proxy in WSL", __FILE__, __LINE__, 0, NULL);
             return -1;
         }
-        if (linux_start_v2ray_process(v2ray_config_file, pid) != 0) {
+        if (linux_start_v2ray_process(ctx->config_file, pid) != 0) {
             log_message("Failed to start V2Ray process in WSL", __FILE__, __LINE__, 0, NULL);
             linux_disable_system_proxy();
             return -1;
         }
-        v2ray_pid = *pid;
+        if (ctx_wait_for_ready(ctx, *pid, http_port) != 0) {
+            log_message("V2Ray process in WSL did not become ready", __FILE__, __LINE__, 0, NULL);
+            linux_stop_v2ray_process(*pid);
+            linux_disable_system_proxy();
+            return -1;
+        }
+        ctx->pid = *pid;
     } else {
-        if (create_v2ray_service(v2ray_config_file, http_port, socks_port) != 0) {
+        if (create_v2ray_service(ctx->config_file, http_port, socks_port) != 0) {
             log_message("Failed to create V2Ray service in Linux", __FILE__, __LINE__, 0, NULL);
             return -1;
         }
@@ -349,22 +292,52 @@ EXPORT int start_v2ray_with_pid(int http_port, int socks_port, PID_TYPE* pid) {
             remove_v2ray_service();
             return -1;
         }
-        v2ray_pid = *pid;
+        ctx->pid = *pid;
     }
 #endif
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "V2Ray started with PID: %lu", (unsigned long)v2ray_pid);
-    log_message("V2Ray started successfully", __FILE__, __LINE__, 0, extra_info);
+    if (ctx->starts++ > 0) metrics_count(METRIC_PROCESS_RESTARTS, 1);
+    LOG_INFOF("V2Ray started successfully", "V2Ray started with PID: %lu", (unsigned long)ctx->pid);
     return 0;
 }
 
 /*
- * Stops the running V2Ray process.
+ * Starts V2Ray for a context on the context's ports.
+ *
+ * Parameters:
+ *   ctx (v2root_ctx_t*): An initialized context.
+ *   pid (PID_TYPE*): Receives the process ID; may be NULL.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 for a NULL context, -4 if the config file is missing,
+ *        -7 if the context already runs V2Ray.
+ */
+EXPORT int v2root_ctx_start(v2root_ctx_t* ctx, PID_TYPE* pid) {
+    if (!ctx) return V2ROOT_ERROR_INVALID_INPUT;
+    PID_TYPE started = 0;
+    pthread_mutex_lock(&ctx->lock);
+    int result = V2ROOT_ERROR_ALREADY_RUNNING;
+    if (ctx->pid == 0) result = ctx_start(ctx, ctx->http_port, ctx->socks_port, &started);
+    pthread_mutex_unlock(&ctx->lock);
+    if (result == V2ROOT_SUCCESS && pid) *pid = started;
+    return result;
+}
+
+/* Starts V2Ray for the default context; see ctx_start */
+EXPORT int start_v2ray_with_pid(int http_port, int socks_port, PID_TYPE* pid) {
+    v2root_ctx_t* ctx = v2root_ctx_default();
+    pthread_mutex_lock(&ctx->lock);
+    int result = ctx_start(ctx, http_port, socks_port, pid);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+/*
+ * Stops a context's running V2Ray process.
  *
  * Terminates the V2Ray process using platform-specific functions and disables the system proxy.
  *
  * Parameters:
- *   None
+ *   ctx (v2root_ctx_t*): The context.
  *
  * Returns:
  *   int: 0 on success, -1 on failure.
@@ -372,22 +345,22 @@ EXPORT int start_v2ray_with_pid(int http_port, int socks_port, PID_TYPE* pid) {
  * Errors:
  *   Logs errors if V2Ray is not initialized or if stopping the process fails.
  */
-EXPORT int stop_v2ray() {
-    if (v2ray_config_file[0] == '\0') {
+static int ctx_stop(v2root_ctx_t* ctx) {
+    if (ctx->config_file[0] == '\0') {
         log_message("V2Ray not initialized", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
 #ifdef _WIN32
     PID_TYPE pid_from_registry = load_pid_from_registry();
     if (pid_from_registry == 0) {
-        log_message("No V2Ray process found in registry", __FILE__, __LINE__, 0, NULL);
+        LOG_INFO("No V2Ray process found in registry", NULL);
         win_disable_system_proxy();
         return 0;
     }
     if (win_stop_v2ray_process(pid_from_registry) == 0) {
-        v2ray_pid = 0;
+        ctx->pid = 0;
         win_disable_system_proxy();
-        log_message("V2Ray process stopped successfully", __FILE__, __LINE__, 0, NULL);
+        LOG_INFO("V2Ray process stopped successfully", NULL);
         return 0;
     } else {
         log_message("Failed to stop V2Ray process", __FILE__, __LINE__, 0, NULL);
@@ -395,7 +368,7 @@ EXPORT int stop_v2ray() {
     }
 #else
     if (is_wsl()) {
-        if (linux_stop_v2ray_process(v2ray_pid) != 0) {
+        if (linux_stop_v2ray_process(ctx->pid) != 0) {
             log_message("Failed to stop V2Ray process in WSL", __FILE__, __LINE__, 0, NULL);
             return -1;
         }
@@ -403,7 +376,7 @@ EXPORT int stop_v2ray() {
     } else {
         if (stop_v2ray_service() == 0) {
             remove_v2ray_service();
-            log_message("V2Ray service stopped successfully", __FILE__, __LINE__, 0, NULL);
+            LOG_INFO("V2Ray service stopped successfully", NULL);
         } else {
             log_message("Failed to stop V2Ray service", __FILE__, __LINE__, 0, NULL);
             return -1;
@@ -411,16 +384,132 @@ EXPORT int stop_v2ray() {
         linux_reset_network_proxy();
     }
 #endif
-    v2ray_pid = 0;
+    ctx->pid = 0;
     return 0;
 }
 
+/* Stops the V2Ray process of ctx; see ctx_stop */
+EXPORT int v2root_ctx_stop(v2root_ctx_t* ctx) {
+    if (!ctx) return V2ROOT_ERROR_INVALID_INPUT;
+    pthread_mutex_lock(&ctx->lock);
+    int result = ctx_stop(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+/* Stops the V2Ray process of the default context */
+EXPORT int stop_v2ray() {
+    return v2root_ctx_stop(v2root_ctx_default());
+}
+
+/*
+ * Returns the V2Ray executable path stored by init_v2ray.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   const char*: The executable path, or an empty string if V2Ray is not initialized.
+ */
+const char* get_v2ray_executable_path(void) {
+    return v2root_ctx_default()->executable_path;
+}
+
+/*
+ * Sets the default context's upper bound for waiting on a freshly started V2Ray process.
+ *
+ * Parameters:
+ *   timeout_ms (int): Readiness timeout in milliseconds (resets to DEFAULT_READY_TIMEOUT_MS if <= 0).
+ *
+ * Returns:
+ *   int: 0 on success.
+ */
+EXPORT int set_ready_timeout(int timeout_ms) {
+    return v2root_ctx_set_ready_timeout(v2root_ctx_default(), timeout_ms);
+}
+
+/*
+ * Waits until a freshly started V2Ray process accepts connections on an inbound port.
+ *
+ * Returns as soon as the inbound accepts, bounded by the context's readiness timeout.
+ *
+ * Parameters:
+ *   ctx (const v2root_ctx_t*): The context the process was started for.
+ *   pid (PID_TYPE): The V2Ray process ID.
+ *   port (int): A local inbound port from the process config.
+ *
+ * Returns:
+ *   int: 0 once ready, -1 on timeout, -2 if the process exited.
+ */
+int ctx_wait_for_ready(const v2root_ctx_t* ctx, PID_TYPE pid, int port) {
+    long long start_us = get_monotonic_us();
+#ifdef _WIN32
+    int rc = win_wait_for_ready(pid, port, ctx->ready_timeout_ms);
+#else
+    int rc = linux_wait_for_ready(pid, port, ctx->ready_timeout_ms);
+#endif
+    if (rc == 0) {
+        metrics_observe_us(METRIC_HIST_READY, get_monotonic_us() - start_us);
+    } else {
+        metrics_count(METRIC_READY_FAILURES, 1);
+    }
+    return rc;
+}
+
+/* Waits for a process started by the shared batch, pool, or probe paths (default context) */
+int wait_for_v2ray_ready(PID_TYPE pid, int port) {
+    return ctx_wait_for_ready(v2root_ctx_default(), pid, port);
+}
+
+/*
+ * Writes the V2Ray JSON configuration for a VLESS, VMess, or Shadowsocks string.
+ *
+ * Dispatches on the protocol prefix to the matching parser, so every caller shares one
+ * protocol switch instead of repeating it.
+ *
+ * Parameters:
+ *   config_str (const char*): The configuration string to parse.
+ *   fp (FILE*): File pointer to write the resulting JSON configuration.
+ *   http_port (int): HTTP proxy port for the generated inbound.
+ *   socks_port (int): SOCKS proxy port for the generated inbound.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for null inputs or unknown protocols; parser errors are logged by the parsers.
+ */
+int write_config_for_protocol(const char* config_str, FILE* fp, int http_port, int socks_port) {
+    if (!config_str || !fp) {
+        log_message("Null config string or file pointer", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    long long start_us = get_monotonic_us();
+    int rc = -1;
+    if (strncmp(config_str, PROTOCOL_VLESS, 8) == 0) {
+        rc = parse_vless_string(config_str, fp, http_port, socks_port);
+    } else if (strncmp(config_str, PROTOCOL_VMESS, 8) == 0) {
+        rc = parse_vmess_string(config_str, fp, http_port, socks_port);
+    } else if (strncmp(config_str, PROTOCOL_SHADOWSOCKS, 5) == 0) {
+        rc = parse_shadowsocks_string(config_str, fp, http_port, socks_port);
+    } else {
+        log_message("Unknown protocol", __FILE__, __LINE__, 0, config_str);
+    }
+    if (rc == 0) {
+        metrics_observe_us(METRIC_HIST_PARSE, get_monotonic_us() - start_us);
+    } else {
+        metrics_count(METRIC_PARSE_FAILURES, 1);
+    }
+    return rc;
+}
+
 /*
  * Parses a V2Ray configuration string and writes it to the configuration file.
  *
- * Supports VLESS, VMess, and Shadowsocks protocols, writing the parsed configuration to the file specified in init_v2ray.
+ * Supports VLESS, VMess, and Shadowsocks protocols, writing the parsed configuration to the context's config file.
  *
  * Parameters:
+ *   ctx (v2root_ctx_t*): The context.
  *   config_str (const char*): The configuration string to parse.
  *   http_port (int): HTTP proxy port (defaults to 2300 if <= 0).
  *   socks_port (int): SOCKS proxy port (defaults to 2301 if <= 0).
@@ -431,36 +520,25 @@ EXPORT int stop_v2ray() {
  * Errors:
  *   Logs errors for null input, file opening failures, unknown protocols, or parsing failures.
  */
-EXPORT int parse_config_string(const char* config_str, int http_port, int socks_port) {
+static int ctx_parse_config_string(v2root_ctx_t* ctx, const char* config_str, int http_port, int socks_port) {
     if (config_str == NULL) {
         log_message("Null config string", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
     if (http_port <= 0) {
         http_port = 2300;
-        log_message("No HTTP port provided for config parsing, using default", __FILE__, __LINE__, 0, "2300");
+        LOG_WARNING("No HTTP port provided for config parsing, using default", "2300");
     }
     if (socks_port <= 0) {
         socks_port = 2301;
-        log_message("No SOCKS port provided for config parsing, using default", __FILE__, __LINE__, 0, "2301");
+        LOG_WARNING("No SOCKS port provided for config parsing, using default", "2301");
     }
-    FILE* fp = fopen(v2ray_config_file, "w");
+    FILE* fp = fopen(ctx->config_file, "w");
     if (!fp) {
-        log_message("Failed to open config file", __FILE__, __LINE__, errno, v2ray_config_file);
-        return -1;
-    }
-    int result = -1;
-    if (strncmp(config_str, "vless://", 8) == 0) {
-        result = parse_vless_string(config_str, fp, http_port, socks_port);
-    } else if (strncmp(config_str, "vmess://", 8) == 0) {
-        result = parse_vmess_string(config_str, fp, http_port, socks_port);
-    } else if (strncmp(config_str, "ss://", 5) == 0) {
-        result = parse_shadowsocks_string(config_str, fp, http_port, socks_port);
-    } else {
-        fclose(fp);
-        log_message("Unknown protocol", __FILE__, __LINE__, 0, config_str);
+        log_message("Failed to open config file", __FILE__, __LINE__, errno, ctx->config_file);
         return -1;
     }
+    int result = write_config_for_protocol(config_str, fp, http_port, socks_port);
     fclose(fp);
     if (result != 0) {
         log_message("Config parsing failed", __FILE__, __LINE__, result, config_str);
@@ -469,74 +547,108 @@ EXPORT int parse_config_string(const char* config_str, int http_port, int socks_
     return 0;
 }
 
+/* Parses config_str into the context's config file using the context's ports */
+EXPORT int v2root_ctx_parse_config_string(v2root_ctx_t* ctx, const char* config_str) {
+    if (!ctx) return V2ROOT_ERROR_INVALID_INPUT;
+    return ctx_parse_config_string(ctx, config_str, ctx->http_port, ctx->socks_port);
+}
+
+/* Parses config_str into the default context's config file */
+EXPORT int parse_config_string(const char* config_str, int http_port, int socks_port) {
+    return ctx_parse_config_string(v2root_ctx_default(), config_str, http_port, socks_port);
+}
+
 /*
- * Tests a V2Ray configuration by starting a temporary process and measuring latency.
+ * Parses several configuration strings into one load-balanced configuration file.
  *
- * Parses the configuration string, starts a V2Ray process, and tests the connection latency.
- * Supports VLESS, VMess, and Shadowsocks protocols.
+ * Writes one outbound per config behind a routing balancer to the file specified in
+ * init_v2ray, so concurrent connections through the proxy ports are spread over the nodes.
  *
  * Parameters:
- *   config_str (const char*): The configuration string to test.
- *   latency (int*): Pointer to store the measured latency in milliseconds.
+ *   configs (const char**): The configuration strings, e.g. the top k by probe score.
+ *   k (int): Number of configs (1..MAX_BALANCED_CONFIGS).
  *   http_port (int): HTTP proxy port (defaults to 2300 if <= 0).
  *   socks_port (int): SOCKS proxy port (defaults to 2301 if <= 0).
+ *   strategy (int): BALANCER_STRATEGY_RANDOM (0) or BALANCER_STRATEGY_LEAST_PING (1).
  *
  * Returns:
- *   int: 0 on success, -1 on failure, -2 if the V2Ray process fails to start.
+ *   int: Number of nodes written on success, -1 on failure, -2 for invalid input.
  *
  * Errors:
- *   Logs errors for null inputs, invalid configurations, JSON parsing failures, or process failures.
- *   Skips invalid VMess configurations and continues with other protocols.
+ *   Logs errors for invalid input, render failures, or file write failures. Configs that fail
+ *   to render are skipped with a warning.
  */
-EXPORT int test_config_connection(const char* config_str, int* latency, int http_port, int socks_port) {
-    if (config_str == NULL || latency == NULL) {
-        log_message("Null config string or latency pointer", __FILE__, __LINE__, 0, NULL);
+EXPORT int parse_config_strings_balanced(const char** configs, int k, int http_port, int socks_port, int strategy) {
+    if (!configs || k <= 0 || k > MAX_BALANCED_CONFIGS) {
+        log_message("Invalid config list for balanced config", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    if (http_port <= 0) http_port = DEFAULT_HTTP_PORT;
+    if (socks_port <= 0) socks_port = DEFAULT_SOCKS_PORT;
+    int written = 0;
+    json_t* root = build_balanced_config(configs, k, http_port, socks_port, strategy, &written);
+    if (!root) return -1;
+    const char* config_file = v2root_ctx_default()->config_file;
+    int result = json_dump_file(root, config_file, JSON_INDENT(2));
+    json_decref(root);
+    if (result != 0) {
+        log_message("Failed to write balanced config file", __FILE__, __LINE__, errno, config_file);
         return -1;
     }
-    if (http_port <= 0) {
-        http_port = 2300;
-        log_message("No HTTP port provided for test, using default", __FILE__, __LINE__, 0, "2300");
-    }
-    if (socks_port <= 0) {
-        socks_port = 2301;
-        log_message("No SOCKS port provided for test, using default", __FILE__, __LINE__, 0, "2301");
+    return written;
+}
+
+/*
+ * Extracts the server address and port from a configuration string.
+ *
+ * Supports VLESS, VMess (base64 JSON), and Shadowsocks strings; shared by the connection test
+ * and probe paths so they agree on which endpoint a config points at.
+ *
+ * Parameters:
+ *   config_str (const char*): The configuration string.
+ *   address (char*): Buffer receiving the server address.
+ *   address_size (size_t): Size of the address buffer.
+ *   port_str (char*): Buffer receiving the server port as a string.
+ *   port_size (size_t): Size of the port buffer.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for malformed strings, oversize fields, VMess decode failures, or unknown protocols.
+ */
+int extract_config_endpoint(const char* config_str, char* address, size_t address_size, char* port_str, size_t port_size) {
+    if (!config_str || !address || !port_str || address_size == 0 || port_size == 0) {
+        log_message("Invalid arguments to extract_config_endpoint", __FILE__, __LINE__, 0, NULL);
+        return -1;
     }
-    char address[2048] = "";
-    char port_str[16] = "";
-    if (strncmp(config_str, "vless://", 8) == 0) {
-        const char* at_sign = strchr(config_str, '@');
-        if (!at_sign) {
-            log_message("No @ found in VLESS config string", __FILE__, __LINE__, 0, config_str);
+    address[0] = '\0';
+    port_str[0] = '\0';
+    if (strncmp(config_str, "vless://", 8) == 0 || strncmp(config_str, "ss://", 5) == 0) {
+        UriParts uri;
+        if (uri_parse(config_str, strlen(config_str), &uri) != 0 || uri.userinfo.len == 0) {
+            log_message("No address:port found in config string", __FILE__, __LINE__, 0, config_str);
             return -1;
         }
-        const char* colon = strchr(at_sign + 1, ':');
-        if (!colon) {
-            log_message("No port found in VLESS config string", __FILE__, __LINE__, 0, config_str);
+        if (sv_copy(uri.host, address, address_size) != 0) {
+            log_message("Address too long in config", __FILE__, __LINE__, 0, config_str);
             return -1;
         }
-        const char* question_mark = strchr(colon, '?');
-        size_t addr_len = colon - (at_sign + 1);
-        if (addr_len >= sizeof(address)) {
-            log_message("Address too long in VLESS config", __FILE__, __LINE__, 0, config_str);
+        if (sv_copy(uri.port, port_str, port_size) != 0) {
+            log_message("Port too long in config", __FILE__, __LINE__, 0, config_str);
             return -1;
         }
-        strncpy(address, at_sign + 1, addr_len);
-        address[addr_len] = '\0';
-        size_t port_len = (question_mark ? question_mark : strchr(colon, '\0')) - (colon + 1);
-        if (port_len >= sizeof(port_str)) {
-            log_message("Port too long in VLESS config", __FILE__, __LINE__, 0, config_str);
-            return -1;
-        }
-        strncpy(port_str, colon + 1, port_len);
-        port_str[port_len] = '\0';
     } else if (strncmp(config_str, "vmess://", 8) == 0) {
-        const char* base64_str = config_str + 8;
-        char debug_msg[512];
-        snprintf(debug_msg, sizeof(debug_msg), "Processing VMess config: %s", config_str);
-        log_message(debug_msg, __FILE__, __LINE__, 0, NULL);
-        char* decoded = base64_decode(base64_str);
+        UriParts uri;
+        char* decoded = NULL;
+        /* The decoded payload and its jansson tree live in the thread's scratch arena */
+        ArenaMark scratch = arena_begin();
+        if (uri_split(config_str, strlen(config_str), &uri) == 0) {
+            decoded = base64_decode_scratch(uri.body.ptr, uri.body.len, NULL);
+        }
         if (!decoded) {
             log_message("Failed to decode VMess base64, skipping VMess config", __FILE__, __LINE__, 0, config_str);
+            arena_end(scratch);
             return -1;
         }
         int is_valid_utf8 = 1;
@@ -548,7 +660,7 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
         }
         if (!is_valid_utf8) {
             log_message("Decoded VMess string is not valid UTF-8, skipping", __FILE__, __LINE__, 0, decoded);
-            free(decoded);
+            arena_end(scratch);
             return -1;
         }
         json_error_t error;
@@ -557,7 +669,7 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
             char err_msg[256];
             snprintf(err_msg, sizeof(err_msg), "JSON error: %s (line %d, column %d)", error.text, error.line, error.column);
             log_message("Failed to parse VMess JSON, skipping VMess config", __FILE__, __LINE__, 0, err_msg);
-            free(decoded);
+            arena_end(scratch);
             return -1;
         }
         const char* addr = json_string_value(json_object_get(json, "add"));
@@ -565,52 +677,58 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
         if (!addr || port <= 0) {
             log_message("Missing address or port in VMess JSON, skipping", __FILE__, __LINE__, 0, config_str);
             json_decref(json);
-            free(decoded);
+            arena_end(scratch);
             return -1;
         }
-        strncpy(address, addr, sizeof(address) - 1);
-        address[sizeof(address) - 1] = '\0';
-        snprintf(port_str, sizeof(port_str), "%d", port);
-        json_decref(json);
-        free(decoded);
-    } else if (strncmp(config_str, "ss://", 5) == 0) {
-        const char* at_sign = strchr(config_str, '@');
-        if (!at_sign) {
-            log_message("Invalid Shadowsocks config format", __FILE__, __LINE__, 0, config_str);
-            return -1;
-        }
-        const char* colon = strchr(at_sign + 1, ':');
-        if (!colon) {
-            log_message("No port found in Shadowsocks config", __FILE__, __LINE__, 0, config_str);
-            return -1;
-        }
-
-        size_t addr_len = colon - (at_sign + 1);
-        if (addr_len >= sizeof(address)) {
-            log_message("Address too long in Shadowsocks config", __FILE__, __LINE__, 0, config_str);
-            return -1;
-        }
-        strncpy(address, at_sign + 1, addr_len);
-        address[addr_len] = '\0';
-    
-        const char* port_end = colon + 1;
-        while (isdigit(*port_end)) {
-            port_end++;
-        }
-        size_t port_len = port_end - (colon + 1);
-        if (port_len == 0 || port_len >= sizeof(port_str)) {
-            log_message("Port too long or invalid in Shadowsocks config", __FILE__, __LINE__, 0, config_str);
+        if (strlen(addr) >= address_size) {
+            log_message("Address too long in VMess config", __FILE__, __LINE__, 0, config_str);
+            json_decref(json);
+            arena_end(scratch);
             return -1;
         }
-        strncpy(port_str, colon + 1, port_len);
-        port_str[port_len] = '\0';
+        strncpy(address, addr, address_size - 1);
+        address[address_size - 1] = '\0';
+        snprintf(port_str, port_size, "%d", port);
+        json_decref(json);
+        arena_end(scratch);
     } else {
-        log_message("Unknown protocol in test", __FILE__, __LINE__, 0, config_str);
+        log_message("Unknown protocol for endpoint extraction", __FILE__, __LINE__, 0, config_str);
         return -1;
     }
-    char addr_info[256];
-    snprintf(addr_info, sizeof(addr_info), "Extracted address: %s, port: %s", address, port_str);
-    log_message(addr_info, __FILE__, __LINE__, 0, NULL);
+    return 0;
+}
+
+/*
+ * Tests a V2Ray configuration by starting a temporary process and measuring latency.
+ *
+ * Parses the configuration string, starts a V2Ray process, and tests the connection latency.
+ * Supports VLESS, VMess, and Shadowsocks protocols.
+ *
+ * Parameters:
+ *   ctx (const v2root_ctx_t*): The context supplying the executable and readiness timeout.
+ *   config_str (const char*): The configuration string to test.
+ *   latency (int*): Pointer to store the measured latency in milliseconds.
+ *   http_port (int): HTTP proxy port of the test instance.
+ *   socks_port (int): SOCKS proxy port of the test instance.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 if the V2Ray process fails to start.
+ *
+ * Errors:
+ *   Logs errors for null inputs, invalid configurations, JSON parsing failures, or process failures.
+ *   Skips invalid VMess configurations and continues with other protocols.
+ */
+static int run_test_connection(const v2root_ctx_t* ctx, const char* config_str, int* latency, int http_port, int socks_port) {
+    if (config_str == NULL || latency == NULL) {
+        log_message("Null config string or latency pointer", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    char address[2048] = "";
+    char port_str[16] = "";
+    if (extract_config_endpoint(config_str, address, sizeof(address), port_str, sizeof(port_str)) != 0) {
+        return -1;
+    }
+    LOG_DEBUGF("Extracted test endpoint", "Address: %s, Port: %s", address, port_str);
     if (!validate_address(address)) {
         log_message("Invalid address in config", __FILE__, __LINE__, 0, address);
         return -1;
@@ -619,44 +737,30 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
         log_message("Invalid port in config", __FILE__, __LINE__, 0, port_str);
         return -1;
     }
-    FILE* fp = fopen("config_test.json", "w");
-    if (!fp) {
-        log_message("Failed to open config_test.json", __FILE__, __LINE__, errno, NULL);
-        return -1;
-    }
-    int parse_result = -1;
-    if (strncmp(config_str, "vless://", 8) == 0) {
-        log_message("Parsing VLESS config", __FILE__, __LINE__, 0, config_str);
-        parse_result = parse_vless_string(config_str, fp, http_port, socks_port);
-    } else if (strncmp(config_str, "vmess://", 8) == 0) {
-        log_message("Parsing VMess config", __FILE__, __LINE__, 0, config_str);
-        parse_result = parse_vmess_string(config_str, fp, http_port, socks_port);
-    } else if (strncmp(config_str, "ss://", 5) == 0) {
-        log_message("Parsing Shadowsocks config", __FILE__, __LINE__, 0, config_str);
-        parse_result = parse_shadowsocks_string(config_str, fp, http_port, socks_port);
-    }
-    fclose(fp);
-    if (parse_result != 0) {
-        log_message("Test config parsing failed", __FILE__, __LINE__, parse_result, config_str);
+    /* The test config stays in memory, so parallel tests cannot clobber each other's files */
+    ConfigBuffer config;
+    LOG_DEBUG("Parsing test config", config_str);
+    if (render_config_buffer(config_str, http_port, socks_port, &config) != 0) {
+        log_message("Test config parsing failed", __FILE__, __LINE__, 0, config_str);
         return -1;
     }
     PID_TYPE test_pid = 0;
-#ifdef _WIN32
-    if (start_v2ray_process("config_test.json", v2ray_executable_path, &test_pid) != 0) {
+    if (start_v2ray_from_buffer_with(&config, ctx->executable_path, &test_pid) != 0) {
         log_message("Failed to start V2Ray process for test", __FILE__, __LINE__, 0, NULL);
+        config_buffer_free(&config);
         return -2;
     }
-#else
-    if (linux_start_v2ray_process("config_test.json", &test_pid) != 0) {
-        log_message("Failed to start V2Ray process for test", __FILE__, __LINE__, 0, NULL);
-        return -2;
-    }
-#endif
     if (test_pid == 0) {
         log_message("Invalid PID returned from start_v2ray_process", __FILE__, __LINE__, 0, NULL);
+        config_buffer_free(&config);
+        return -1;
+    }
+    if (ctx_wait_for_ready(ctx, test_pid, http_port) == -1) {
+        log_message("V2Ray did not become ready for test", __FILE__, __LINE__, 0, NULL);
+        stop_v2ray_process(test_pid);
+        config_buffer_free(&config);
         return -1;
     }
-    SLEEP(2000);
     int result = -1;
 #ifdef _WIN32
     HANDLE hProcess = OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE, FALSE, test_pid);
@@ -666,6 +770,7 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
         snprintf(err_msg, sizeof(err_msg), "Failed to open V2Ray process for termination (PID: %lu)", (unsigned long)test_pid);
         log_message(err_msg, __FILE__, __LINE__, error, NULL);
         stop_v2ray_process(test_pid);
+        config_buffer_free(&config);
         return -1;
     }
     DWORD exitCode;
@@ -675,6 +780,7 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
         log_message("V2Ray process exited prematurely", __FILE__, __LINE__, 0, extra_info);
         CloseHandle(hProcess);
         stop_v2ray_process(test_pid);
+        config_buffer_free(&config);
         return -1;
     }
     result = test_connection(http_port, latency, hProcess);
@@ -687,19 +793,45 @@ EXPORT int test_config_connection(const char* config_str, int* latency, int http
         snprintf(extra_info, sizeof(extra_info), "V2Ray exited with code: %d", WEXITSTATUS(status));
         log_message("V2Ray process exited prematurely", __FILE__, __LINE__, 0, extra_info);
         stop_v2ray_process(test_pid);
+        config_buffer_free(&config);
         return -1;
     }
     result = test_connection(http_port, socks_port, latency, test_pid);
     stop_v2ray_process(test_pid);
 #endif
-    if (unlink("config_test.json") != 0) {
-        char err_msg[256];
-        snprintf(err_msg, sizeof(err_msg), "Failed to delete config_test.json, errno: %d", errno);
-        log_message(err_msg, __FILE__, __LINE__, errno, NULL);
+    config_buffer_free(&config);
+    return result;
+}
+
+/*
+ * Runs run_test_connection, leasing a free port pair for the test instance unless both ports
+ * are given; the lease is returned once the instance has been stopped.
+ */
+static int ctx_test_connection(const v2root_ctx_t* ctx, const char* config_str, int* latency, int http_port, int socks_port) {
+    if (http_port > 0 && socks_port > 0) {
+        return run_test_connection(ctx, config_str, latency, http_port, socks_port);
+    }
+    int first = port_lease(2);
+    if (first < 0) {
+        log_message("No free port pair for test", __FILE__, __LINE__, 0, NULL);
+        return -1;
     }
+    int result = run_test_connection(ctx, config_str, latency, first, first + 1);
+    port_release(first, 2);
     return result;
 }
 
+/* Tests config_str through a temporary V2Ray process on leased ports */
+EXPORT int v2root_ctx_test_connection(v2root_ctx_t* ctx, const char* config_str, int* latency) {
+    if (!ctx) return V2ROOT_ERROR_INVALID_INPUT;
+    return ctx_test_connection(ctx, config_str, latency, 0, 0);
+}
+
+/* Tests config_str with the default context's settings; ports <= 0 are leased */
+EXPORT int test_config_connection(const char* config_str, int* latency, int http_port, int socks_port) {
+    return ctx_test_connection(v2root_ctx_default(), config_str, latency, http_port, socks_port);
+}
+
 /*
  * Pings a server to measure network latency.
  *
@@ -751,19 +883,16 @@ EXPORT int ping_server(const char* address, int port) {
     LARGE_INTEGER freq, start, end;
     QueryPerformanceFrequency(&freq);
 
-    struct addrinfo hints, *result = NULL;
-    ZeroMemory(&hints, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
+    struct addrinfo *result = NULL;
 
     char port_str[16];
     snprintf(port_str, sizeof(port_str), "%d", port);
 
     QueryPerformanceCounter(&start);
 
-    if (getaddrinfo(address, port_str, &hints, &result) != 0) {
-        log_message("Failed to resolve address", __FILE__, __LINE__, WSAGetLastError(), address);
+    int gai_status = dns_cache_getaddrinfo(address, port_str, &result, NULL);
+    if (gai_status != 0) {
+        log_message("Failed to resolve address", __FILE__, __LINE__, gai_status, address);
         WSACleanup();
         return -1;
     }
@@ -771,7 +900,7 @@ EXPORT int ping_server(const char* address, int port) {
     SOCKET sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
     if (sock == INVALID_SOCKET) {
         log_message("Failed to create socket", __FILE__, __LINE__, WSAGetLastError(), NULL);
-        freeaddrinfo(result);
+        dns_cache_freeaddrinfo(result);
         WSACleanup();
         return -1;
     }
@@ -780,7 +909,7 @@ EXPORT int ping_server(const char* address, int port) {
         DWORD error = WSAGetLastError();
         log_message("Failed to connect to server", __FILE__, __LINE__, error, address);
         closesocket(sock);
-        freeaddrinfo(result);
+        dns_cache_freeaddrinfo(result);
         WSACleanup();
         return -1;
     }
@@ -797,53 +926,43 @@ EXPORT int ping_server(const char* address, int port) {
     }
 
     closesocket(sock);
-    freeaddrinfo(result);
+    dns_cache_freeaddrinfo(result);
     WSACleanup();
 
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "Ping to %s:%d successful, latency: %d ms (actual: %.2f ms)", address, port, latency, elapsed_ms);
-    log_message("Ping successful", __FILE__, __LINE__, 0, extra_info);
+    LOG_DEBUGF("Ping successful", "Ping to %s:%d successful, latency: %d ms (actual: %.2f ms)", address, port, latency, elapsed_ms);
 
     return latency;
 
 #else
-    struct timeval start, end;
-    struct addrinfo hints, *result = NULL;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
+    struct addrinfo *result = NULL;
 
     char port_str[16];
     snprintf(port_str, sizeof(port_str), "%d", port);
 
-    gettimeofday(&start, NULL);
+    long long start_us = get_monotonic_us();
 
-    if (getaddrinfo(address, port_str, &hints, &result) != 0) {
-        log_message("Failed to resolve address", __FILE__, __LINE__, errno, address);
+    int gai_status = dns_cache_getaddrinfo(address, port_str, &result, NULL);
+    if (gai_status != 0) {
+        log_message("Failed to resolve address", __FILE__, __LINE__, gai_status, address);
         return -1;
     }
 
     int sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
     if (sock < 0) {
         log_message("Failed to create socket", __FILE__, __LINE__, errno, NULL);
-        freeaddrinfo(result);
+        dns_cache_freeaddrinfo(result);
         return -1;
     }
 
     if (connect(sock, result->ai_addr, result->ai_addrlen) < 0) {
         log_message("Failed to connect to server", __FILE__, __LINE__, errno, address);
         close(sock);
-        freeaddrinfo(result);
+        dns_cache_freeaddrinfo(result);
         return -1;
     }
 
-    gettimeofday(&end, NULL);
-
     /* Calculate latency with microsecond precision */
-    long seconds = end.tv_sec - start.tv_sec;
-    long microseconds = end.tv_usec - start.tv_usec;
-    double elapsed_ms = (seconds * 1000.0) + (microseconds / 1000.0);
+    double elapsed_ms = (get_monotonic_us() - start_us) / 1000.0;
     
     int latency = (int)(elapsed_ms + 0.5);
     
@@ -853,11 +972,9 @@ EXPORT int ping_server(const char* address, int port) {
     }
 
     close(sock);
-    freeaddrinfo(result);
+    dns_cache_freeaddrinfo(result);
 
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "Ping to %s:%d successful, latency: %d ms (actual: %.2f ms)", address, port, latency, elapsed_ms);
-    log_message("Ping successful", __FILE__, __LINE__, 0, extra_info);
+    LOG_DEBUGF("Ping successful", "Ping to %s:%d successful, latency: %d ms (actual: %.2f ms)", address, port, latency, elapsed_ms);
 
     return latency;
 #endif
@@ -867,12 +984,7 @@ EXPORT int ping_server(const char* address, int port) {
  * Performs quick lightweight probe (DNS + TCP only).
  * Used for fast filtering before full probe.
  */
-EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int http_port, int socks_port) {
-    if (!config_str || !result) {
-        log_message("Null config or result pointer for quick probe", __FILE__, __LINE__, 0, NULL);
-        return -1;
-    }
-    
+static int run_probe_quick(const char* config_str, ProbeResult* result, int http_port, int socks_port) {
     /* Initialize result */
     memset(result, 0, sizeof(ProbeResult));
     result->attempts = 1;
@@ -882,31 +994,9 @@ EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int h
     char address[2048] = "";
     char port_str[16] = "";
     
-    /* Parse based on protocol (similar to test_config_connection) */
-    if (strncmp(config_str, "vless://", 8) == 0) {
-        const char* at_sign = strchr(config_str, '@');
-        if (!at_sign) {
-            strncpy(result->error_type, PROBE_ERROR_UNKNOWN, sizeof(result->error_type) - 1);
-            return -1;
-        }
-        const char* colon = strchr(at_sign + 1, ':');
-        if (!colon) {
-            strncpy(result->error_type, PROBE_ERROR_UNKNOWN, sizeof(result->error_type) - 1);
-            return -1;
-        }
-        const char* question_mark = strchr(colon, '?');
-        size_t addr_len = colon - (at_sign + 1);
-        if (addr_len >= sizeof(address)) addr_len = sizeof(address) - 1;
-        strncpy(address, at_sign + 1, addr_len);
-        address[addr_len] = '\0';
-        size_t port_len = (question_mark ? question_mark : strchr(colon, '\0')) - (colon + 1);
-        if (port_len >= sizeof(port_str)) port_len = sizeof(port_str) - 1;
-        strncpy(port_str, colon + 1, port_len);
-        port_str[port_len] = '\0';
-    } else {
-        /* Add similar parsing for vmess/ss if needed */
+    if (extract_config_endpoint(config_str, address, sizeof(address), port_str, sizeof(port_str)) != 0) {
         strncpy(result->error_type, PROBE_ERROR_UNKNOWN, sizeof(result->error_type) - 1);
-        snprintf(result->error_details, sizeof(result->error_details), "Unsupported protocol for quick probe");
+        snprintf(result->error_details, sizeof(result->error_details), "Failed to extract address and port");
         return -1;
     }
     
@@ -916,12 +1006,9 @@ EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int h
     QueryPerformanceFrequency(&freq);
     QueryPerformanceCounter(&dns_start);
     
-    struct addrinfo hints, *res = NULL;
-    ZeroMemory(&hints, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
     
-    if (getaddrinfo(address, port_str, &hints, &res) != 0) {
+    if (dns_cache_getaddrinfo(address, port_str, &res, &result->dns_cache_hit) != 0) {
         QueryPerformanceCounter(&dns_end);
         result->dns_ms = (int)(((dns_end.QuadPart - dns_start.QuadPart) * 1000) / freq.QuadPart);
         strncpy(result->error_type, PROBE_ERROR_DNS, sizeof(result->error_type) - 1);
@@ -938,7 +1025,7 @@ EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int h
     
     SOCKET sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
     if (sock == INVALID_SOCKET) {
-        freeaddrinfo(res);
+        dns_cache_freeaddrinfo(res);
         strncpy(result->error_type, PROBE_ERROR_TCP, sizeof(result->error_type) - 1);
         return -1;
     }
@@ -954,7 +1041,7 @@ EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int h
         strncpy(result->error_type, PROBE_ERROR_TCP, sizeof(result->error_type) - 1);
         snprintf(result->error_details, sizeof(result->error_details), "TCP connect failed to %s:%s", address, port_str);
         closesocket(sock);
-        freeaddrinfo(res);
+        dns_cache_freeaddrinfo(res);
         return -1;
     }
     
@@ -963,39 +1050,29 @@ EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int h
     if (result->tcp_connect_ms < 1) result->tcp_connect_ms = 1;
     
     closesocket(sock);
-    freeaddrinfo(res);
+    dns_cache_freeaddrinfo(res);
     
 #else
-    struct timeval dns_start, dns_end, tcp_start, tcp_end;
-    gettimeofday(&dns_start, NULL);
+    long long dns_start = get_monotonic_us();
     
-    struct addrinfo hints, *res = NULL;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
     
-    if (getaddrinfo(address, port_str, &hints, &res) != 0) {
-        gettimeofday(&dns_end, NULL);
-        long sec = dns_end.tv_sec - dns_start.tv_sec;
-        long usec = dns_end.tv_usec - dns_start.tv_usec;
-        result->dns_ms = (int)((sec * 1000) + (usec / 1000));
+    if (dns_cache_getaddrinfo(address, port_str, &res, &result->dns_cache_hit) != 0) {
+        result->dns_ms = (int)((get_monotonic_us() - dns_start) / 1000);
         strncpy(result->error_type, PROBE_ERROR_DNS, sizeof(result->error_type) - 1);
         snprintf(result->error_details, sizeof(result->error_details), "DNS resolution failed for %s", address);
         return -1;
     }
     
-    gettimeofday(&dns_end, NULL);
-    long sec = dns_end.tv_sec - dns_start.tv_sec;
-    long usec = dns_end.tv_usec - dns_start.tv_usec;
-    result->dns_ms = (int)((sec * 1000) + (usec / 1000));
+    result->dns_ms = (int)((get_monotonic_us() - dns_start) / 1000);
     if (result->dns_ms < 1) result->dns_ms = 1;
     
     /* TCP connect with timing */
-    gettimeofday(&tcp_start, NULL);
+    long long tcp_start = get_monotonic_us();
     
     int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
     if (sock < 0) {
-        freeaddrinfo(res);
+        dns_cache_freeaddrinfo(res);
         strncpy(result->error_type, PROBE_ERROR_TCP, sizeof(result->error_type) - 1);
         return -1;
     }
@@ -1008,52 +1085,151 @@ EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int h
     setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
     
     if (connect(sock, res->ai_addr, res->ai_addrlen) < 0) {
-        gettimeofday(&tcp_end, NULL);
-        sec = tcp_end.tv_sec - tcp_start.tv_sec;
-        usec = tcp_end.tv_usec - tcp_start.tv_usec;
-        result->tcp_connect_ms = (int)((sec * 1000) + (usec / 1000));
+        result->tcp_connect_ms = (int)((get_monotonic_us() - tcp_start) / 1000);
         strncpy(result->error_type, PROBE_ERROR_TCP, sizeof(result->error_type) - 1);
         snprintf(result->error_details, sizeof(result->error_details), "TCP connect failed to %s:%s", address, port_str);
         close(sock);
-        freeaddrinfo(res);
+        dns_cache_freeaddrinfo(res);
         return -1;
     }
     
-    gettimeofday(&tcp_end, NULL);
-    sec = tcp_end.tv_sec - tcp_start.tv_sec;
-    usec = tcp_end.tv_usec - tcp_start.tv_usec;
-    result->tcp_connect_ms = (int)((sec * 1000) + (usec / 1000));
+    result->tcp_connect_ms = (int)((get_monotonic_us() - tcp_start) / 1000);
     if (result->tcp_connect_ms < 1) result->tcp_connect_ms = 1;
     
     close(sock);
-    freeaddrinfo(res);
+    dns_cache_freeaddrinfo(res);
 #endif
     
     result->success = 1;
     result->total_ms = result->dns_ms + result->tcp_connect_ms;
     result->score = calculate_probe_score(result->total_ms, result->tcp_connect_ms, 1);
     
-    char extra_info[512];
-    snprintf(extra_info, sizeof(extra_info), 
-             "Quick probe: DNS=%dms, TCP=%dms, Total=%dms, Score=%.3f",
+    LOG_DEBUGF("Quick probe completed", "Quick probe: DNS=%dms, TCP=%dms, Total=%dms, Score=%.3f",
              result->dns_ms, result->tcp_connect_ms, result->total_ms, result->score);
-    log_message("Quick probe completed", __FILE__, __LINE__, 0, extra_info);
     
     return 0;
 }
 
 /*
- * Performs full end-to-end probe including actual HTTP request through proxy.
- * This is the V2rayNG-style comprehensive test.
+ * Renders config_str for the given ports, starts a temporary V2Ray process for it and waits
+ * until the HTTP inbound accepts connections.
+ *
+ * Returns:
+ *   int: 0 on success (release with stop_v2ray_process and config_buffer_free), -1 if the
+ *        config cannot be rendered, -2 if V2Ray cannot be started, -3 if it never became ready.
  */
-EXPORT int probe_config_full(const char* config_str, ProbeResult* result, int http_port, int socks_port, int attempts) {
+static int start_test_instance(const v2root_ctx_t* ctx, const char* config_str, int http_port, int socks_port,
+                               ConfigBuffer* config, PID_TYPE* pid) {
+    if (render_config_buffer(config_str, http_port, socks_port, config) != 0) return -1;
+    *pid = 0;
+    if (start_v2ray_from_buffer_with(config, ctx->executable_path, pid) != 0) {
+        config_buffer_free(config);
+        return -2;
+    }
+    if (ctx_wait_for_ready(ctx, *pid, http_port) != 0) {
+        stop_v2ray_process(*pid);
+        config_buffer_free(config);
+        return -3;
+    }
+    return 0;
+}
+
+static const char* test_instance_error(int code) {
+    switch (code) {
+        case -1: return "Failed to parse configuration";
+        case -2: return "Failed to start V2Ray process";
+        default: return "V2Ray did not become ready";
+    }
+}
+
+/* Quick probe of config_str, recorded in the metrics registry */
+EXPORT int probe_config_quick(const char* config_str, ProbeResult* result, int http_port, int socks_port) {
     if (!config_str || !result) {
-        log_message("Null config or result pointer for full probe", __FILE__, __LINE__, 0, NULL);
+        log_message("Null config or result pointer for quick probe", __FILE__, __LINE__, 0, NULL);
         return -1;
     }
-    
+    metrics_probes_started(1);
+    int rc = run_probe_quick(config_str, result, http_port, socks_port);
+    metrics_probe_results(result, 1);
+    return rc;
+}
+
+/*
+ * Measures the proxied phases of a full probe on one temporary V2Ray process.
+ *
+ * Times V2Ray from start until its inbound is ready, then issues attempts requests, each on
+ * a fresh connection, and stores the per-phase medians: the CONNECT through V2Ray and the
+ * node (transport_handshake_ms), TLS through the tunnel (tls_handshake_ms), both together
+ * (proxy_setup_ms), the time to the tunnelled TLS session (app_connect_ms) and the first byte
+ * (ttfb_ms, with its 90th percentile in ttfb_p90_ms). attempts is set to the number of
+ * requests that completed.
+ *
+ * Returns:
+ *   int: 0 if at least one request completed, -1 otherwise.
+ */
+static int run_probe_full(const v2root_ctx_t* ctx, const char* config_str, ProbeResult* result,
+                          int http_port, int socks_port, int attempts) {
+    ConfigBuffer config;
+    PID_TYPE pid = 0;
+    long long start_us = get_monotonic_us();
+    int started = start_test_instance(ctx, config_str, http_port, socks_port, &config, &pid);
+    if (started != 0) {
+        strncpy(result->error_type, PROBE_ERROR_TRANSPORT, sizeof(result->error_type) - 1);
+        strncpy(result->error_details, test_instance_error(started), sizeof(result->error_details) - 1);
+        return -1;
+    }
+    result->v2ray_ready_ms = (int)((get_monotonic_us() - start_us + 500) / 1000);
+
+    int transport[MAX_PROBE_SAMPLES], tls[MAX_PROBE_SAMPLES], setup[MAX_PROBE_SAMPLES];
+    int app_connect[MAX_PROBE_SAMPLES], ttfb[MAX_PROBE_SAMPLES];
+    int completed = 0;
+    int tunnel_seen = 0;
+    for (int i = 0; i < attempts; i++) {
+        ProbeSample sample;
+#ifdef _WIN32
+        if (win_probe_sample(http_port, &sample) != 0) continue;
+#else
+        if (linux_probe_sample(http_port, &sample) != 0) continue;
+#endif
+        if (sample.tunnel_ms > 0) tunnel_seen = 1;
+        transport[completed] = sample.tunnel_ms - sample.connect_ms;
+        tls[completed] = sample.app_connect_ms - sample.tunnel_ms;
+        setup[completed] = sample.app_connect_ms - sample.connect_ms;
+        app_connect[completed] = sample.app_connect_ms;
+        ttfb[completed] = sample.ttfb_ms;
+        completed++;
+    }
+    stop_v2ray_process(pid);
+    config_buffer_free(&config);
+
+    result->attempts = completed;
+    if (completed == 0) {
+        strncpy(result->error_type, PROBE_ERROR_TRANSPORT, sizeof(result->error_type) - 1);
+        snprintf(result->error_details, sizeof(result->error_details),
+                 "No proxied request succeeded in %d attempts", attempts);
+        return -1;
+    }
+    if (tunnel_seen) {
+        result->transport_handshake_ms = percentile_int(transport, completed, 50);
+        result->tls_handshake_ms = percentile_int(tls, completed, 50);
+    }
+    result->proxy_setup_ms = percentile_int(setup, completed, 50);
+    result->app_connect_ms = percentile_int(app_connect, completed, 50);
+    result->ttfb_ms = percentile_int(ttfb, completed, 50);
+    result->ttfb_p90_ms = percentile_int(ttfb, completed, 90);
+    return 0;
+}
+
+/*
+ * Performs a full end-to-end probe: a quick DNS + TCP pre-check of the node, then run_probe_full
+ * through a temporary V2Ray process on leased ports (unless both ports are given).
+ *
+ * Parameters:
+ *   attempts (int): Proxied requests to sample (clamped to 1..MAX_PROBE_SAMPLES).
+ */
+static int probe_full_steps(const v2root_ctx_t* ctx, const char* config_str, ProbeResult* result, int http_port, int socks_port, int attempts) {
     if (attempts < 1) attempts = 1;
-    if (attempts > 5) attempts = 5;
+    if (attempts > MAX_PROBE_SAMPLES) attempts = MAX_PROBE_SAMPLES;
     
     /* Initialize result */
     memset(result, 0, sizeof(ProbeResult));
@@ -1062,7 +1238,7 @@ EXPORT int probe_config_full(const char* config_str, ProbeResult* result, int ht
     
     /* Step 1: Quick pre-check (DNS + TCP) */
     ProbeResult quick_result;
-    if (probe_config_quick(config_str, &quick_result, http_port, socks_port) != 0) {
+    if (run_probe_quick(config_str, &quick_result, http_port, socks_port) != 0) {
         /* Quick check failed, copy results and return */
         memcpy(result, &quick_result, sizeof(ProbeResult));
         log_message("Quick probe failed, skipping full probe", __FILE__, __LINE__, 0, result->error_details);
@@ -1071,130 +1247,272 @@ EXPORT int probe_config_full(const char* config_str, ProbeResult* result, int ht
     
     /* Copy quick check results */
     result->dns_ms = quick_result.dns_ms;
+    result->dns_cache_hit = quick_result.dns_cache_hit;
     result->tcp_connect_ms = quick_result.tcp_connect_ms;
     
-    /* Step 2: Full app-level probe through proxy */
-    /* Reuse existing test_config_connection but capture more timing details */
-    int latency = 0;
-    int test_result = test_config_connection(config_str, &latency, http_port, socks_port);
-    
-    if (test_result != 0) {
-        strncpy(result->error_type, PROBE_ERROR_TRANSPORT, sizeof(result->error_type) - 1);
-        snprintf(result->error_details, sizeof(result->error_details), 
-                 "Proxy connection test failed (code %d)", test_result);
+    /* Step 2: Phase-timed requests through a temporary V2Ray process */
+    int probed;
+    if (http_port > 0 && socks_port > 0) {
+        probed = run_probe_full(ctx, config_str, result, http_port, socks_port, attempts);
+    } else {
+        int first = port_lease(2);
+        if (first < 0) {
+            strncpy(result->error_type, PROBE_ERROR_UNKNOWN, sizeof(result->error_type) - 1);
+            strncpy(result->error_details, "No free port pair for probe", sizeof(result->error_details) - 1);
+            return -1;
+        }
+        probed = run_probe_full(ctx, config_str, result, first, first + 1, attempts);
+        port_release(first, 2);
+    }
+    if (probed != 0) {
+        log_message("Full probe failed", __FILE__, __LINE__, 0, result->error_details);
         return -1;
     }
     
     /* Step 3: Record results */
-    result->ttfb_ms = latency;
-    result->proxy_setup_ms = latency; /* Approximation */
     result->total_ms = result->dns_ms + result->tcp_connect_ms + result->ttfb_ms;
     result->success = 1;
     result->score = calculate_probe_score(result->ttfb_ms, result->tcp_connect_ms, 1);
     
-    char extra_info[512];
-    snprintf(extra_info, sizeof(extra_info),
-             "Full probe: DNS=%dms, TCP=%dms, TTFB=%dms, Total=%dms, Score=%.3f",
-             result->dns_ms, result->tcp_connect_ms, result->ttfb_ms, 
-             result->total_ms, result->score);
-    log_message("Full probe completed successfully", __FILE__, __LINE__, 0, extra_info);
+    LOG_DEBUGF("Full probe completed successfully",
+               "Full probe: DNS=%dms, TCP=%dms, V2Ray ready=%dms, CONNECT=%dms, TLS=%dms, TTFB p50=%dms p90=%dms, %d samples, Score=%.3f",
+               result->dns_ms, result->tcp_connect_ms, result->v2ray_ready_ms, result->transport_handshake_ms,
+               result->tls_handshake_ms, result->ttfb_ms, result->ttfb_p90_ms, result->attempts, result->score);
     
     return 0;
 }
 
+/* Full probe of config_str (see probe_full_steps), recorded in the metrics registry */
+static int ctx_probe_full(const v2root_ctx_t* ctx, const char* config_str, ProbeResult* result, int http_port, int socks_port, int attempts) {
+    if (!config_str || !result) {
+        log_message("Null config or result pointer for full probe", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    metrics_probes_started(1);
+    int rc = probe_full_steps(ctx, config_str, result, http_port, socks_port, attempts);
+    metrics_probe_results(result, 1);
+    return rc;
+}
+
+/* Full probe of config_str on leased ports */
+EXPORT int v2root_ctx_probe_full(v2root_ctx_t* ctx, const char* config_str, ProbeResult* result, int attempts) {
+    if (!ctx) return V2ROOT_ERROR_INVALID_INPUT;
+    return ctx_probe_full(ctx, config_str, result, 0, 0, attempts);
+}
+
+/* Full probe with the default context's settings; ports <= 0 are leased */
+EXPORT int probe_config_full(const char* config_str, ProbeResult* result, int http_port, int socks_port, int attempts) {
+    return ctx_probe_full(v2root_ctx_default(), config_str, result, http_port, socks_port, attempts);
+}
+
 /*
- * Performs a single HTTP request to measure TTFB through the proxy.
- * Returns a JSON string with platform, success, ttfb_ms, http_status, and error_message.
+ * Measures bandwidth through one temporary V2Ray process with throughput_measure.
+ *
+ * Returns:
+ *   int: 0 if any data arrived, -1 otherwise.
  */
-EXPORT char* measure_ttfb(const char* config_str, int http_port) {
-    static char result_buffer[1024];  /* Static buffer for return value */
-    
-    if (!config_str) {
-        snprintf(result_buffer, sizeof(result_buffer),
-                 "{\"platform\": \"unknown\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Null config string\"}");
-        return result_buffer;
+static int run_probe_throughput(const v2root_ctx_t* ctx, const char* config_str, ProbeResult* result,
+                                int http_port, int socks_port, int streams, int bytes, int budget_ms) {
+    ConfigBuffer config;
+    PID_TYPE pid = 0;
+    long long start_us = get_monotonic_us();
+    int started = start_test_instance(ctx, config_str, http_port, socks_port, &config, &pid);
+    if (started != 0) {
+        strncpy(result->error_type, PROBE_ERROR_TRANSPORT, sizeof(result->error_type) - 1);
+        strncpy(result->error_details, test_instance_error(started), sizeof(result->error_details) - 1);
+        return -1;
     }
-    
-    if (http_port <= 0) {
-        http_port = DEFAULT_HTTP_PORT;
-        log_message("No HTTP port provided for TTFB test, using default", __FILE__, __LINE__, 0, "2300");
+    result->v2ray_ready_ms = (int)((get_monotonic_us() - start_us + 500) / 1000);
+    int measured = throughput_measure(http_port, streams, bytes, budget_ms, result);
+    stop_v2ray_process(pid);
+    config_buffer_free(&config);
+    return measured;
+}
+
+/*
+ * Performs a bandwidth probe: the quick DNS + TCP pre-check of the node, then a sized download
+ * on parallel streams through a temporary V2Ray process (see libv2root_throughput.h).
+ *
+ * Parameters:
+ *   config_str (const char*): VLESS, VMess, or Shadowsocks configuration string.
+ *   result (ProbeResult*): Receives throughput_mbps, stalls, ttfb_ms and a bandwidth-weighted score.
+ *   http_port, socks_port (int): Inbound ports of the test instance; leased unless both are > 0.
+ *   streams (int): Parallel downloads, <= 0 for DEFAULT_THROUGHPUT_STREAMS.
+ *   bytes (int): Size of each download, <= 0 for DEFAULT_THROUGHPUT_BYTES.
+ *   budget_ms (int): Longest measurement, <= 0 for DEFAULT_THROUGHPUT_BUDGET_MS.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Failures are classified in result->error_type and logged.
+ */
+EXPORT int probe_config_throughput(const char* config_str, ProbeResult* result, int http_port, int socks_port,
+                                   int streams, int bytes, int budget_ms) {
+    if (!config_str || !result) {
+        log_message("Null config or result pointer for bandwidth probe", __FILE__, __LINE__, 0, NULL);
+        return -1;
     }
-    
-    /* Write config to a temporary file */
-    FILE* fp = fopen("ttfb_test_config.json", "w");
-    if (!fp) {
-        snprintf(result_buffer, sizeof(result_buffer),
-                 "{\"platform\": \"unknown\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to create temp config file\"}");
-        return result_buffer;
+    const v2root_ctx_t* ctx = v2root_ctx_default();
+    metrics_probes_started(1);
+    memset(result, 0, sizeof(ProbeResult));
+    strncpy(result->error_type, PROBE_ERROR_NONE, sizeof(result->error_type) - 1);
+
+    ProbeResult quick_result;
+    if (run_probe_quick(config_str, &quick_result, http_port, socks_port) != 0) {
+        memcpy(result, &quick_result, sizeof(ProbeResult));
+        log_message("Quick probe failed, skipping bandwidth probe", __FILE__, __LINE__, 0, result->error_details);
+        metrics_probe_results(result, 1);
+        return -1;
     }
-    
-    /* Parse the configuration */
-    int parse_result = -1;
-    if (strncmp(config_str, "vless://", 8) == 0) {
-        parse_result = parse_vless_string(config_str, fp, http_port, DEFAULT_SOCKS_PORT);
-    } else if (strncmp(config_str, "vmess://", 8) == 0) {
-        parse_result = parse_vmess_string(config_str, fp, http_port, DEFAULT_SOCKS_PORT);
-    } else if (strncmp(config_str, "ss://", 5) == 0) {
-        parse_result = parse_shadowsocks_string(config_str, fp, http_port, DEFAULT_SOCKS_PORT);
+    result->dns_ms = quick_result.dns_ms;
+    result->dns_cache_hit = quick_result.dns_cache_hit;
+    result->tcp_connect_ms = quick_result.tcp_connect_ms;
+
+    int measured;
+    if (http_port > 0 && socks_port > 0) {
+        measured = run_probe_throughput(ctx, config_str, result, http_port, socks_port, streams, bytes, budget_ms);
+    } else {
+        int first = port_lease(2);
+        if (first < 0) {
+            strncpy(result->error_type, PROBE_ERROR_UNKNOWN, sizeof(result->error_type) - 1);
+            strncpy(result->error_details, "No free port pair for probe", sizeof(result->error_details) - 1);
+            metrics_probe_results(result, 1);
+            return -1;
+        }
+        measured = run_probe_throughput(ctx, config_str, result, first, first + 1, streams, bytes, budget_ms);
+        port_release(first, 2);
     }
-    fclose(fp);
-    
-    if (parse_result != 0) {
-        unlink("ttfb_test_config.json");
-        snprintf(result_buffer, sizeof(result_buffer),
-                 "{\"platform\": \"unknown\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to parse configuration\"}");
-        return result_buffer;
+    if (measured != 0) {
+        result->success = 0;
+        log_message("Bandwidth probe failed", __FILE__, __LINE__, 0, result->error_details);
+        metrics_probe_results(result, 1);
+        return -1;
     }
+
+    result->score = calculate_probe_score_bw(result->ttfb_ms, result->tcp_connect_ms, result->throughput_mbps, 1);
+    LOG_DEBUGF("Bandwidth probe completed successfully",
+               "Bandwidth probe: TCP=%dms, TTFB=%dms, %.2f Mbps on %d stream(s), %d stall(s), Score=%.3f",
+               result->tcp_connect_ms, result->ttfb_ms, result->throughput_mbps, result->attempts,
+               result->stalls, result->score);
+    metrics_probe_results(result, 1);
+    return 0;
+}
+
+/* Records a TTFB failure in record; returns -1 */
+static int ttfb_fail(ProbeRecord* record, int error_code, const char* details) {
+    record->error_code = error_code;
+    strncpy(record->error_details, details, sizeof(record->error_details) - 1);
+    return -1;
+}
+
+/*
+ * Starts a temporary V2Ray process for config_str and performs a single HTTP request through
+ * it to measure TTFB. Fills record as the platform *_measure_ttfb_record functions do.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+static int run_measure_ttfb(const v2root_ctx_t* ctx, const char* config_str, int http_port, int socks_port,
+                            ProbeRecord* record) {
+    if (!config_str) return ttfb_fail(record, PROBE_CODE_UNKNOWN, "Null config string");
     
-    /* Start V2Ray process with the config */
+    /* Start V2Ray with the configuration rendered in memory */
+    ConfigBuffer config;
     PID_TYPE pid = 0;
-    char* ttfb_result;
+    int started = start_test_instance(ctx, config_str, http_port, socks_port, &config, &pid);
+    if (started != 0) {
+        return ttfb_fail(record, started == -1 ? PROBE_CODE_UNKNOWN : PROBE_CODE_TRANSPORT,
+                         test_instance_error(started));
+    }
     
 #ifdef _WIN32
-    if (start_v2ray_process("ttfb_test_config.json", v2ray_executable_path, &pid) != 0) {
-        unlink("ttfb_test_config.json");
-        snprintf(result_buffer, sizeof(result_buffer),
-                 "{\"platform\": \"windows\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to start V2Ray process\"}");
-        return result_buffer;
-    }
-    SLEEP(2000); /* Wait for V2Ray to initialize */
-    ttfb_result = win_measure_ttfb(http_port);
-    
-    /* Copy result to static buffer before stopping process */
-    strncpy(result_buffer, ttfb_result, sizeof(result_buffer) - 1);
-    result_buffer[sizeof(result_buffer) - 1] = '\0';
-    
-    stop_v2ray_process(pid);
+    int result = win_measure_ttfb_record(http_port, record);
 #else
-    if (linux_start_v2ray_process("ttfb_test_config.json", &pid) != 0) {
-        unlink("ttfb_test_config.json");
-        snprintf(result_buffer, sizeof(result_buffer),
-                 "{\"platform\": \"linux\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to start V2Ray process\"}");
-        return result_buffer;
-    }
-    
-    SLEEP(2000); /* Wait for V2Ray to initialize */
-    
     /* Check if process is still running */
     int status;
     if (waitpid(pid, &status, WNOHANG) == pid) {
-        unlink("ttfb_test_config.json");
-        snprintf(result_buffer, sizeof(result_buffer),
-                 "{\"platform\": \"linux\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"V2Ray process exited prematurely\"}");
-        return result_buffer;
+        config_buffer_free(&config);
+        return ttfb_fail(record, PROBE_CODE_TRANSPORT, "V2Ray process exited prematurely");
     }
-    
-    ttfb_result = linux_measure_ttfb(http_port);
-    
-    /* Copy result to static buffer before stopping process */
-    strncpy(result_buffer, ttfb_result, sizeof(result_buffer) - 1);
-    result_buffer[sizeof(result_buffer) - 1] = '\0';
-    
-    stop_v2ray_process(pid);
+    int result = linux_measure_ttfb_record(http_port, record);
 #endif
+    stop_v2ray_process(pid);
 
-    /* Clean up the temporary config file */
-    unlink("ttfb_test_config.json");
-    
-    return result_buffer;
-}
\ No newline at end of file
+    /* Release the in-memory config */
+    config_buffer_free(&config);
+    return result;
+}
+
+/*
+ * Runs run_measure_ttfb on leased ports. With http_port <= 0 both inbound ports are leased,
+ * otherwise only the SOCKS port, which the test instance must not share with a running proxy.
+ */
+static int ctx_measure_ttfb(const v2root_ctx_t* ctx, const char* config_str, int http_port, ProbeRecord* record) {
+    probe_record_init(record, 0);
+    metrics_probes_started(1);
+    int count = http_port > 0 ? 1 : 2;
+    int first = port_lease(count);
+    int result;
+    if (first < 0) {
+        result = ttfb_fail(record, PROBE_CODE_UNKNOWN, "No free ports for test");
+    } else {
+        result = http_port > 0 ? run_measure_ttfb(ctx, config_str, http_port, first, record)
+                               : run_measure_ttfb(ctx, config_str, first, first + 1, record);
+        port_release(first, count);
+    }
+    metrics_probe_finished(result == 0 && record->success, record->error_code, record->ttfb_ms);
+    return result;
+}
+
+/* Measures TTFB of config_str on leased ports; the JSON result lives in the context */
+EXPORT const char* v2root_ctx_measure_ttfb(v2root_ctx_t* ctx, const char* config_str) {
+    if (!ctx) return NULL;
+    ProbeRecord record;
+    ctx_measure_ttfb(ctx, config_str, 0, &record);
+    probe_record_ttfb_json(&record, ctx->scratch, sizeof(ctx->scratch));
+    return ctx->scratch;
+}
+
+/*
+ * Measures TTFB of config_str with the default context's settings into a per-thread buffer.
+ *
+ * Returns a JSON string with platform, success, ttfb_ms, http_status, and error_message;
+ * v2root_measure_ttfb_record returns the same measurement without formatting. http_port <= 0
+ * is leased.
+ */
+EXPORT char* measure_ttfb(const char* config_str, int http_port) {
+    ProbeRecord record;
+    ctx_measure_ttfb(v2root_ctx_default(), config_str, http_port, &record);
+    probe_record_ttfb_json(&record, ttfb_result_buffer, sizeof(ttfb_result_buffer));
+    return ttfb_result_buffer;
+}
+
+/*
+ * Measures TTFB of config_str into a caller-owned ProbeRecord.
+ *
+ * Parameters:
+ *   ctx (v2root_ctx_t*): The context supplying the executable and readiness timeout.
+ *   config_str (const char*): The configuration string to test.
+ *   out (void*): Caller record of record_size bytes.
+ *   record_size (size_t): The caller's sizeof(ProbeRecord) (at least PROBE_RECORD_MIN_SIZE).
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the measurement failed (see error_code), -2 for invalid input.
+ */
+EXPORT int v2root_ctx_measure_ttfb_record(v2root_ctx_t* ctx, const char* config_str, void* out, size_t record_size) {
+    if (!ctx || !out || record_size < PROBE_RECORD_MIN_SIZE) return V2ROOT_ERROR_INVALID_INPUT;
+    ProbeRecord record;
+    int result = ctx_measure_ttfb(ctx, config_str, 0, &record);
+    probe_record_store(out, record_size, 0, &record);
+    return result;
+}
+
+/* As v2root_ctx_measure_ttfb_record with the default context's settings; http_port <= 0 is leased */
+EXPORT int v2root_measure_ttfb_record(const char* config_str, int http_port, void* out, size_t record_size) {
+    if (!out || record_size < PROBE_RECORD_MIN_SIZE) return V2ROOT_ERROR_INVALID_INPUT;
+    ProbeRecord record;
+    int result = ctx_measure_ttfb(v2root_ctx_default(), config_str, http_port, &record);
+    probe_record_store(out, record_size, 0, &record);
+    return result;
+}
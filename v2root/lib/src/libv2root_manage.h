@@ -1,6 +1,7 @@
 #ifndef LIBV2ROOT_MANAGE_H
 #define LIBV2ROOT_MANAGE_H
 
+#include <stdio.h>
 #include "libv2root_common.h"
 
 #ifdef __cplusplus
@@ -12,6 +13,14 @@ extern "C" {
  * These are declared here and implemented in libv2root_manage.c
  */
 EXPORT char* measure_ttfb(const char* config_str, int http_port);
+EXPORT int v2root_measure_ttfb_record(const char* config_str, int http_port, void* out, size_t record_size);
+EXPORT int set_ready_timeout(int timeout_ms);
+
+/* Internal helpers shared with the batch and probe modules */
+int write_config_for_protocol(const char* config_str, FILE* fp, int http_port, int socks_port);
+int extract_config_endpoint(const char* config_str, char* address, size_t address_size, char* port_str, size_t port_size);
+const char* get_v2ray_executable_path(void);
+int wait_for_v2ray_ready(PID_TYPE pid, int port);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET metrics_socket_t;
+#define CLOSE_SOCKET closesocket
+#define poll WSAPoll
+#define SEND_FLAGS 0
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+typedef int metrics_socket_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_metrics.h"
+#include "libv2root_records.h"
+#include "libv2root_utils.h"
+
+static MetricsSnapshot metrics_registry;
+
+/* Server state, guarded by metrics_server_lock except for the running flag */
+static pthread_mutex_t metrics_server_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t metrics_server_thread;
+static metrics_socket_t metrics_listener = INVALID_SOCKET;
+static int metrics_server_running = 0;
+
+static const struct {
+    const char* name;
+    const char* help;
+} metrics_counter_info[] = {
+    { "v2root_probes_started_total", "Probes started." },
+    { "v2root_probes_succeeded_total", "Probes that reached the probe URL." },
+    { "v2root_v2ray_spawns_total", "V2Ray processes started." },
+    { "v2root_v2ray_spawn_failures_total", "V2Ray processes that could not be started." },
+    { "v2root_v2ray_ready_failures_total", "V2Ray processes that exited or timed out before their inbound accepted." },
+    { "v2root_config_parse_failures_total", "Configuration strings that could not be rendered." },
+    { "v2root_process_restarts_total", "Proxy processes replaced by a restart or a pool switch." },
+};
+
+static const int metrics_counter_ids[] = {
+    METRIC_PROBES_STARTED, METRIC_PROBES_SUCCEEDED, METRIC_V2RAY_SPAWNS, METRIC_V2RAY_SPAWN_FAILURES,
+    METRIC_READY_FAILURES, METRIC_PARSE_FAILURES, METRIC_PROCESS_RESTARTS
+};
+
+static const struct {
+    const char* name;
+    const char* help;
+} metrics_histogram_info[METRIC_HISTOGRAM_COUNT] = {
+    { "v2root_v2ray_spawn_seconds", "Time to create a V2Ray process." },
+    { "v2root_v2ray_ready_seconds", "Time from process start until its inbound accepts connections." },
+    { "v2root_probe_ttfb_seconds", "Time to first byte of successful proxied probes." },
+    { "v2root_config_parse_seconds", "Time to render a share link into a V2Ray config." },
+};
+
+/* Maps a value in microseconds to its log-linear bucket */
+static int bucket_index(uint64_t us) {
+    if (us < METRICS_SUB_BUCKETS) return (int)us;
+    int msb = 63 - __builtin_clzll(us);
+    int index = METRICS_SUB_BUCKETS * (msb - METRICS_SUB_BITS + 1) +
+                (int)((us >> (msb - METRICS_SUB_BITS)) & (METRICS_SUB_BUCKETS - 1));
+    return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+void metrics_count(int counter, uint64_t n) {
+    if (counter < 0 || counter >= METRIC_COUNTER_COUNT) return;
+    __atomic_fetch_add(&metrics_registry.counters[counter], n, __ATOMIC_RELAXED);
+}
+
+void metrics_observe_us(int histogram, long long us) {
+    if (histogram < 0 || histogram >= METRIC_HISTOGRAM_COUNT) return;
+    if (us < 0) us = 0;
+    MetricsHistogram* h = &metrics_registry.histograms[histogram];
+    __atomic_fetch_add(&h->buckets[bucket_index((uint64_t)us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_us, (uint64_t)us, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+}
+
+/* Records a V2Ray process creation that began at start_us (get_monotonic_us) */
+void metrics_spawn_finished(int success, long long start_us) {
+    if (!success) {
+        metrics_count(METRIC_V2RAY_SPAWN_FAILURES, 1);
+        return;
+    }
+    metrics_count(METRIC_V2RAY_SPAWNS, 1);
+    metrics_observe_us(METRIC_HIST_SPAWN, get_monotonic_us() - start_us);
+}
+
+void metrics_probes_started(int n) {
+    if (n > 0) metrics_count(METRIC_PROBES_STARTED, (uint64_t)n);
+}
+
+/*
+ * Records the outcome of one probe.
+ *
+ * Parameters:
+ *   success (int): Non-zero if the probe succeeded.
+ *   error_code (int): PROBE_CODE_* class of a failure.
+ *   ttfb_ms (int): Time to first byte of a successful proxied probe, 0 if none was measured.
+ */
+void metrics_probe_finished(int success, int error_code, int ttfb_ms) {
+    if (success) {
+        metrics_count(METRIC_PROBES_SUCCEEDED, 1);
+        if (ttfb_ms > 0) metrics_observe_us(METRIC_HIST_TTFB, (long long)ttfb_ms * 1000);
+        return;
+    }
+    if (error_code == PROBE_CODE_SKIPPED) return;   /* Never ran; not counted as started either */
+    if (error_code <= PROBE_CODE_NONE || error_code >= PROBE_CODE_COUNT) error_code = PROBE_CODE_UNKNOWN;
+    metrics_count(METRIC_PROBES_FAILED + error_code, 1);
+}
+
+/* Records the outcomes of n probe results */
+void metrics_probe_results(const ProbeResult* results, int n) {
+    if (!results) return;
+    for (int i = 0; i < n; i++) {
+        metrics_probe_finished(results[i].success, probe_error_code(results[i].error_type), results[i].ttfb_ms);
+    }
+}
+
+/*
+ * Copies the registry.
+ *
+ * Each value is read atomically; the copy as a whole is not a single point in time, so a
+ * histogram's count may differ slightly from the sum of its buckets under load.
+ *
+ * Parameters:
+ *   out (MetricsSnapshot*): Receives the counters and histograms.
+ *
+ * Returns:
+ *   int: 0 on success, -1 for a NULL pointer.
+ */
+EXPORT int v2root_metrics_snapshot(MetricsSnapshot* out) {
+    if (!out) {
+        log_message("Null metrics snapshot pointer", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        out->counters[i] = __atomic_load_n(&metrics_registry.counters[i], __ATOMIC_RELAXED);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        const MetricsHistogram* src = &metrics_registry.histograms[h];
+        MetricsHistogram* dst = &out->histograms[h];
+        dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+        dst->sum_us = __atomic_load_n(&src->sum_us, __ATOMIC_RELAXED);
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            dst->buckets[b] = __atomic_load_n(&src->buckets[b], __ATOMIC_RELAXED);
+        }
+    }
+    return V2ROOT_SUCCESS;
+}
+
+/* Clears every counter and histogram */
+EXPORT void v2root_metrics_reset(void) {
+    uint64_t* values = (uint64_t*)&metrics_registry;
+    for (size_t i = 0; i < sizeof(metrics_registry) / sizeof(uint64_t); i++) {
+        __atomic_store_n(&values[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Returns the exclusive upper bound of a histogram bucket in microseconds, or -1 for an
+ * invalid bucket. The last bucket also holds every larger value.
+ */
+EXPORT long long v2root_metrics_bucket_upper_us(int bucket) {
+    if (bucket < 0 || bucket >= METRICS_BUCKETS) return -1;
+    if (bucket < METRICS_SUB_BUCKETS) return bucket + 1;
+    int msb = bucket / METRICS_SUB_BUCKETS - 1 + METRICS_SUB_BITS;
+    long long sub = bucket % METRICS_SUB_BUCKETS;
+    return (METRICS_SUB_BUCKETS + sub + 1) << (msb - METRICS_SUB_BITS);
+}
+
+/*
+ * Estimates a quantile from a histogram.
+ *
+ * Parameters:
+ *   histogram (const MetricsHistogram*): A histogram from v2root_metrics_snapshot.
+ *   quantile (double): Quantile in 0..1.
+ *
+ * Returns:
+ *   long long: The highest value in the bucket holding the nearest-rank quantile, in
+ *              microseconds, or -1 if the histogram is empty or the arguments are invalid.
+ */
+EXPORT long long v2root_metrics_quantile_us(const MetricsHistogram* histogram, double quantile) {
+    if (!histogram || quantile < 0.0 || quantile > 1.0) return -1;
+    uint64_t total = 0;
+    for (int b = 0; b < METRICS_BUCKETS; b++) total += histogram->buckets[b];
+    if (total == 0) return -1;
+    uint64_t rank = (uint64_t)(quantile * (double)total + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen >= rank) return v2root_metrics_bucket_upper_us(b) - 1;
+    }
+    return v2root_metrics_bucket_upper_us(METRICS_BUCKETS - 1) - 1;
+}
+
+/* Appends to a bounded buffer; *len goes past size once the buffer is too small */
+#define METRICS_APPEND(buffer, size, len, ...) do { \
+    if (*(len) < (size)) { \
+        int written_ = snprintf((buffer) + *(len), (size) - *(len), __VA_ARGS__); \
+        *(len) += written_ > 0 ? (size_t)written_ : 0; \
+    } \
+} while (0)
+
+static void format_histogram(char* buffer, size_t size, size_t* len, int h, const MetricsHistogram* histogram) {
+    const char* name = metrics_histogram_info[h].name;
+    METRICS_APPEND(buffer, size, len, "# HELP %s %s\n# TYPE %s histogram\n", name, metrics_histogram_info[h].help, name);
+    /* Cumulative counts at the power-of-two bucket boundaries keep the series count small */
+    uint64_t cumulative = 0;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        cumulative += histogram->buckets[b];
+        long long upper = v2root_metrics_bucket_upper_us(b);
+        if (b == METRICS_BUCKETS - 1 || (upper & (upper - 1)) != 0) continue;
+        METRICS_APPEND(buffer, size, len, "%s_bucket{le=\"%.6f\"} %llu\n", name, upper / 1e6, (unsigned long long)cumulative);
+    }
+    METRICS_APPEND(buffer, size, len, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+    METRICS_APPEND(buffer, size, len, "%s_sum %.6f\n", name, histogram->sum_us / 1e6);
+    METRICS_APPEND(buffer, size, len, "%s_count %llu\n", name, (unsigned long long)cumulative);
+}
+
+/*
+ * Writes the registry in the Prometheus text exposition format.
+ *
+ * Parameters:
+ *   buffer (char*): Receives the NUL-terminated text.
+ *   size (size_t): Capacity of buffer.
+ *
+ * Returns:
+ *   int: Length of the text on success, -1 if buffer is NULL or too small.
+ */
+EXPORT int v2root_metrics_format(char* buffer, size_t size) {
+    if (!buffer || size == 0) return V2ROOT_ERROR;
+    MetricsSnapshot* snapshot = malloc(sizeof(MetricsSnapshot));
+    if (!snapshot) {
+        log_message("Failed to allocate metrics snapshot", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    v2root_metrics_snapshot(snapshot);
+    size_t len = 0;
+    for (int i = 0; i < (int)(sizeof(metrics_counter_ids) / sizeof(metrics_counter_ids[0])); i++) {
+        const char* name = metrics_counter_info[i].name;
+        METRICS_APPEND(buffer, size, &len, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, metrics_counter_info[i].help,
+                       name, name, (unsigned long long)snapshot->counters[metrics_counter_ids[i]]);
+    }
+    METRICS_APPEND(buffer, size, &len, "# HELP v2root_probes_failed_total Failed probes by error type.\n"
+                                       "# TYPE v2root_probes_failed_total counter\n");
+    for (int code = PROBE_CODE_NONE + 1; code < PROBE_CODE_COUNT; code++) {
+        if (code == PROBE_CODE_SKIPPED) continue;
+        METRICS_APPEND(buffer, size, &len, "v2root_probes_failed_total{error_type=\"%s\"} %llu\n",
+                       probe_error_name(code), (unsigned long long)snapshot->counters[METRIC_PROBES_FAILED + code]);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        format_histogram(buffer, size, &len, h, &snapshot->histograms[h]);
+    }
+    free(snapshot);
+    if (len >= size) {
+        log_message("Metrics buffer too small", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    return (int)len;
+}
+
+/*
+ * Answers one scrape with the current metrics, whatever the request path. A client that sends
+ * nothing, or stops reading the reply, is dropped after METRICS_CLIENT_TIMEOUT_MS so it cannot
+ * stall the server thread.
+ */
+static void serve_scrape(metrics_socket_t client, char* text) {
+#ifdef _WIN32
+    DWORD timeout = METRICS_CLIENT_TIMEOUT_MS;
+#else
+    struct timeval timeout = { METRICS_CLIENT_TIMEOUT_MS / 1000, (METRICS_CLIENT_TIMEOUT_MS % 1000) * 1000 };
+#endif
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+    struct pollfd pfd;
+    pfd.fd = client;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    char request[1024];
+    if (poll(&pfd, 1, METRICS_CLIENT_TIMEOUT_MS) <= 0 || recv(client, request, sizeof(request), 0) <= 0) {
+        CLOSE_SOCKET(client);
+        return;
+    }
+    int len = v2root_metrics_format(text, METRICS_TEXT_MAX);
+    char header[160];
+    int header_len;
+    if (len < 0) {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        len = 0;
+    } else {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %d\r\nConnection: close\r\n\r\n", len);
+    }
+    send(client, header, header_len, SEND_FLAGS);
+    for (int sent = 0; sent < len;) {
+        int n = send(client, text + sent, len - sent, SEND_FLAGS);
+        if (n <= 0) break;
+        sent += n;
+    }
+    CLOSE_SOCKET(client);
+}
+
+static void* metrics_server_main(void* arg) {
+    (void)arg;
+    char* text = malloc(METRICS_TEXT_MAX);
+    if (!text) {
+        log_message("Failed to allocate metrics buffer", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    while (__atomic_load_n(&metrics_server_running, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd;
+        pfd.fd = metrics_listener;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, METRICS_POLL_MS) <= 0 || !(pfd.revents & POLLIN)) continue;
+        metrics_socket_t client = accept(metrics_listener, NULL, NULL);
+        if (client != INVALID_SOCKET) serve_scrape(client, text);
+    }
+    free(text);
+    return NULL;
+}
+
+/*
+ * Serves the metrics in the Prometheus text format on 127.0.0.1:port from a background thread.
+ *
+ * Every request, whatever its path, is answered with the output of v2root_metrics_format.
+ *
+ * Parameters:
+ *   port (int): Loopback port to listen on (1..65535).
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 for an invalid port, -7 if already serving.
+ *
+ * Errors:
+ *   Logs errors for socket, bind, or thread creation failures.
+ */
+EXPORT int v2root_metrics_serve(int port) {
+    if (port <= 0 || port > 65535) {
+        log_message("Invalid metrics port", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    pthread_mutex_lock(&metrics_server_lock);
+    if (metrics_server_running) {
+        pthread_mutex_unlock(&metrics_server_lock);
+        log_message("Metrics server already running", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_ALREADY_RUNNING;
+    }
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        pthread_mutex_unlock(&metrics_server_lock);
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        return V2ROOT_ERROR;
+    }
+#endif
+    metrics_socket_t fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd != INVALID_SOCKET) {
+        /* Keep the listener out of V2Ray processes started later */
+#ifdef _WIN32
+        SetHandleInformation((HANDLE)fd, HANDLE_FLAG_INHERIT, 0);
+#else
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+            CLOSE_SOCKET(fd);
+            fd = INVALID_SOCKET;
+        }
+    }
+    if (fd == INVALID_SOCKET) {
+        char port_str[16];
+        snprintf(port_str, sizeof(port_str), "%d", port);
+        log_message("Failed to listen on metrics port", __FILE__, __LINE__, errno, port_str);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        pthread_mutex_unlock(&metrics_server_lock);
+        return V2ROOT_ERROR;
+    }
+    metrics_listener = fd;
+    __atomic_store_n(&metrics_server_running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&metrics_server_thread, NULL, metrics_server_main, NULL) != 0) {
+        __atomic_store_n(&metrics_server_running, 0, __ATOMIC_RELEASE);
+        CLOSE_SOCKET(metrics_listener);
+        metrics_listener = INVALID_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        pthread_mutex_unlock(&metrics_server_lock);
+        log_message("Failed to start metrics server thread", __FILE__, __LINE__, errno, NULL);
+        return V2ROOT_ERROR;
+    }
+    pthread_mutex_unlock(&metrics_server_lock);
+    LOG_INFOF("Metrics server started", "Serving Prometheus metrics on 127.0.0.1:%d", port);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Stops the metrics server, waiting for an in-flight scrape to finish.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the server is not running.
+ */
+EXPORT int v2root_metrics_stop_server(void) {
+    pthread_mutex_lock(&metrics_server_lock);
+    if (!metrics_server_running) {
+        pthread_mutex_unlock(&metrics_server_lock);
+        return V2ROOT_ERROR;
+    }
+    __atomic_store_n(&metrics_server_running, 0, __ATOMIC_RELEASE);
+    pthread_join(metrics_server_thread, NULL);
+    CLOSE_SOCKET(metrics_listener);
+    metrics_listener = INVALID_SOCKET;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    pthread_mutex_unlock(&metrics_server_lock);
+    LOG_INFO("Metrics server stopped", NULL);
+    return V2ROOT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#ifndef LIBV2ROOT_METRICS_H
+#define LIBV2ROOT_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Runtime metrics.
+ *
+ * A process-wide registry of counters and fixed-bucket latency histograms. Recording is a few
+ * relaxed atomic additions, with no locks and no formatting, so it is safe on every hot path.
+ * v2root_metrics_snapshot copies the registry out; v2root_metrics_serve exposes it in the
+ * Prometheus text format on a loopback port.
+ *
+ * Histograms are log-linear (HDR-style) in microseconds: values below METRICS_SUB_BUCKETS get
+ * a bucket each, and every power of two above is split into METRICS_SUB_BUCKETS buckets, so
+ * the relative error stays under 25% up to 2^METRICS_MAX_EXPONENT us (about 67s). Larger
+ * values land in the last bucket.
+ */
+
+#define METRICS_SUB_BITS 2
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BITS)
+#define METRICS_MAX_EXPONENT 26
+#define METRICS_BUCKETS (METRICS_SUB_BUCKETS * (METRICS_MAX_EXPONENT - METRICS_SUB_BITS + 1))
+#define METRICS_TEXT_MAX 65536              /* Bytes of Prometheus text per scrape */
+#define METRICS_POLL_MS 200                 /* Server accept poll period */
+#define METRICS_CLIENT_TIMEOUT_MS 2000      /* Longest wait for a scraper's request or for it to take the reply */
+
+/* Counters */
+#define METRIC_PROBES_STARTED 0
+#define METRIC_PROBES_SUCCEEDED 1
+#define METRIC_PROBES_FAILED 2              /* METRIC_PROBES_FAILED + PROBE_CODE_* per error type */
+#define METRIC_V2RAY_SPAWNS (METRIC_PROBES_FAILED + PROBE_CODE_COUNT)
+#define METRIC_V2RAY_SPAWN_FAILURES (METRIC_V2RAY_SPAWNS + 1)
+#define METRIC_READY_FAILURES (METRIC_V2RAY_SPAWNS + 2)
+#define METRIC_PARSE_FAILURES (METRIC_V2RAY_SPAWNS + 3)
+#define METRIC_PROCESS_RESTARTS (METRIC_V2RAY_SPAWNS + 4)
+#define METRIC_COUNTER_COUNT (METRIC_V2RAY_SPAWNS + 5)
+
+/* Histograms */
+#define METRIC_HIST_SPAWN 0                 /* Process creation */
+#define METRIC_HIST_READY 1                 /* Start until the inbound accepts */
+#define METRIC_HIST_TTFB 2                  /* Time to first byte of successful probes */
+#define METRIC_HIST_PARSE 3                 /* Share link to V2Ray config */
+#define METRIC_HISTOGRAM_COUNT 4
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t buckets[METRICS_BUCKETS];      /* Per-bucket counts; see v2root_metrics_bucket_upper_us */
+} MetricsHistogram;
+
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    MetricsHistogram histograms[METRIC_HISTOGRAM_COUNT];
+} MetricsSnapshot;
+
+EXPORT int v2root_metrics_snapshot(MetricsSnapshot* out);
+EXPORT void v2root_metrics_reset(void);
+EXPORT long long v2root_metrics_bucket_upper_us(int bucket);
+EXPORT long long v2root_metrics_quantile_us(const MetricsHistogram* histogram, double quantile);
+EXPORT int v2root_metrics_format(char* buffer, size_t size);
+EXPORT int v2root_metrics_serve(int port);
+EXPORT int v2root_metrics_stop_server(void);
+
+/* Recording; safe from any thread */
+void metrics_count(int counter, uint64_t n);
+void metrics_observe_us(int histogram, long long us);
+void metrics_spawn_finished(int success, long long start_us);
+void metrics_probes_started(int n);
+void metrics_probe_finished(int success, int error_code, int ttfb_ms);
+void metrics_probe_results(const ProbeResult* results, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_METRICS_H */
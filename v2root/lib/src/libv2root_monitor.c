@@ -0,0 +1,578 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_monitor.h"
+#include "libv2root_batch.h"
+#include "libv2root_cache.h"
+#include "libv2root_probe.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_utils.h"
+
+#define MONITOR_TICK_MS 1000
+#define MONITOR_SLEEP_STEP_MS 100
+#define MONITOR_EWMA_ALPHA 0.25
+#define MONITOR_JITTER_GAIN (1.0 / 16.0)
+#define MONITOR_THRESHOLD_BAND 0.1          /* Scores this close to the threshold are re-probed sooner */
+
+/* Summary fields as published; every field is read and written with relaxed atomics */
+typedef struct {
+    int active;
+    int samples;
+    int last_success;
+    int probes;
+    uint64_t fingerprint;
+    double ewma_ms;
+    double ewma_tcp_ms;
+    double jitter_ms;
+    double success_rate;
+    double score;
+    long long last_probe_ms;                /* 0 if never probed */
+} MonitorSummary;
+
+typedef struct {
+    /* Prober state, guarded by monitor_lock */
+    char* config;
+    unsigned generation;                    /* Bumped on add so in-flight results for a reused slot are dropped */
+    unsigned char ok[MONITOR_WINDOW];       /* Success flags of the latest samples */
+    int window_pos;
+    int window_count;
+    int last_latency;                       /* Previous successful latency, -1 if none */
+    MonitorSummary state;
+
+    /* Published copy; readers retry while seq is odd or changes under them */
+    size_t seq;
+    MonitorSummary pub;
+} MonitorEntry;
+
+/* monitor_control_lock serialises start and stop; monitor_lock guards the prober state */
+static pthread_mutex_t monitor_control_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t monitor_lock = PTHREAD_MUTEX_INITIALIZER;
+static MonitorEntry* monitor_entries;       /* MONITOR_MAX_CONFIGS entries, allocated once and never freed */
+static int monitor_high_water;              /* Entries [0, high_water) may be active */
+static volatile int monitor_running;
+static pthread_t monitor_thread;
+static int monitor_budget;
+static int monitor_stale_ms;
+static double monitor_threshold;
+static int monitor_mode;
+static int monitor_watch_id = -1;           /* Entry probed at least every monitor_watch_ms, -1 if none */
+static int monitor_watch_ms;
+
+static void monitor_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)ms * 1000);
+#endif
+}
+
+#define PUB_STORE(entry, field) __atomic_store(&(entry)->pub.field, &(entry)->state.field, __ATOMIC_RELAXED)
+#define PUB_LOAD(entry, field, out) __atomic_load(&(entry)->pub.field, &(out)->field, __ATOMIC_RELAXED)
+
+/* Publishes entry->state; called with monitor_lock held, so there is one writer at a time */
+static void publish(MonitorEntry* entry) {
+    size_t seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    PUB_STORE(entry, active);
+    PUB_STORE(entry, samples);
+    PUB_STORE(entry, last_success);
+    PUB_STORE(entry, probes);
+    PUB_STORE(entry, fingerprint);
+    PUB_STORE(entry, ewma_ms);
+    PUB_STORE(entry, ewma_tcp_ms);
+    PUB_STORE(entry, jitter_ms);
+    PUB_STORE(entry, success_rate);
+    PUB_STORE(entry, score);
+    PUB_STORE(entry, last_probe_ms);
+    __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Copies the published summary of entry without taking a lock */
+static void read_published(MonitorEntry* entry, MonitorSummary* out) {
+    for (;;) {
+        size_t before = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        PUB_LOAD(entry, active, out);
+        PUB_LOAD(entry, samples, out);
+        PUB_LOAD(entry, last_success, out);
+        PUB_LOAD(entry, probes, out);
+        PUB_LOAD(entry, fingerprint, out);
+        PUB_LOAD(entry, ewma_ms, out);
+        PUB_LOAD(entry, ewma_tcp_ms, out);
+        PUB_LOAD(entry, jitter_ms, out);
+        PUB_LOAD(entry, success_rate, out);
+        PUB_LOAD(entry, score, out);
+        PUB_LOAD(entry, last_probe_ms, out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == before) return;
+    }
+}
+
+static void to_stat(int id, const MonitorSummary* summary, long long now, MonitorStat* out) {
+    out->id = id;
+    out->samples = summary->samples;
+    out->last_success = summary->last_success;
+    out->probes = summary->probes;
+    out->fingerprint = summary->fingerprint;
+    out->ewma_ms = summary->ewma_ms;
+    out->ewma_tcp_ms = summary->ewma_tcp_ms;
+    out->jitter_ms = summary->jitter_ms;
+    out->success_rate = summary->success_rate;
+    out->score = summary->score;
+    out->age_ms = summary->last_probe_ms > 0 ? now - summary->last_probe_ms : -1;
+}
+
+/*
+ * Folds one probe result into an entry's window and averages.
+ *
+ * Latency is the TTFB when the probe measured one and the total probe time otherwise, so
+ * quick (DNS + TCP) probes and proxied probes feed the same EWMA.
+ *
+ * Parameters:
+ *   entry (MonitorEntry*): The entry to update; monitor_lock must be held.
+ *   result (const ProbeResult*): The probe outcome.
+ *   now (long long): Monotonic time of the probe in milliseconds.
+ *
+ * Returns:
+ *   None
+ */
+static void record_sample(MonitorEntry* entry, const ProbeResult* result, long long now) {
+    MonitorSummary* s = &entry->state;
+    int latency = result->ttfb_ms > 0 ? result->ttfb_ms : result->total_ms;
+    entry->ok[entry->window_pos] = result->success ? 1 : 0;
+    entry->window_pos = (entry->window_pos + 1) % MONITOR_WINDOW;
+    if (entry->window_count < MONITOR_WINDOW) entry->window_count++;
+
+    if (result->success) {
+        if (entry->last_latency < 0) {
+            s->ewma_ms = latency;
+            s->ewma_tcp_ms = result->tcp_connect_ms;
+        } else {
+            s->ewma_ms += MONITOR_EWMA_ALPHA * (latency - s->ewma_ms);
+            s->ewma_tcp_ms += MONITOR_EWMA_ALPHA * (result->tcp_connect_ms - s->ewma_tcp_ms);
+            double delta = latency - entry->last_latency;
+            if (delta < 0) delta = -delta;
+            s->jitter_ms += MONITOR_JITTER_GAIN * (delta - s->jitter_ms);
+        }
+        entry->last_latency = latency;
+    }
+
+    int successes = 0;
+    for (int i = 0; i < entry->window_count; i++) successes += entry->ok[i];
+    s->samples = entry->window_count;
+    s->success_rate = (double)successes / entry->window_count;
+    s->last_success = result->success ? 1 : 0;
+    s->probes++;
+    s->last_probe_ms = now;
+    s->score = entry->last_latency < 0 ? 0.0
+             : calculate_probe_score((int)s->ewma_ms, (int)s->ewma_tcp_ms, 1) * s->success_rate;
+    publish(entry);
+}
+
+/*
+ * Replays the cached samples of a newly added entry.
+ *
+ * The entry then ranks on its persisted history before its first probe in this process. The
+ * samples keep their age, so an entry whose history is older than stale_ms is still re-probed
+ * at the next tick; probes is left at 0.
+ *
+ * Parameters:
+ *   entry (MonitorEntry*): The new entry; monitor_lock must be held.
+ *
+ * Returns:
+ *   None
+ */
+static void seed_from_cache(MonitorEntry* entry) {
+    CacheSample samples[CACHE_SAMPLES];
+    int count = cache_samples(entry->state.fingerprint, samples, CACHE_SAMPLES);
+    if (count == 0) return;
+    long long now = get_monotonic_ms();
+    long long wall = cache_wall_ms();
+    for (int i = 0; i < count; i++) {
+        ProbeResult result;
+        memset(&result, 0, sizeof(result));
+        result.success = samples[i].success;
+        result.ttfb_ms = samples[i].ttfb_ms;
+        result.tcp_connect_ms = samples[i].tcp_connect_ms;
+        result.total_ms = samples[i].total_ms;
+        long long age = wall - samples[i].time_ms;
+        long long at = now - (age > 0 ? age : 0);
+        record_sample(entry, &result, at > 0 ? at : 1);
+    }
+    entry->state.probes = 0;
+    publish(entry);
+}
+
+/* Orders candidates by how overdue they are */
+typedef struct {
+    int index;
+    long long priority;
+} MonitorCandidate;
+
+static int compare_candidates(const void* a, const void* b) {
+    long long pa = ((const MonitorCandidate*)a)->priority;
+    long long pb = ((const MonitorCandidate*)b)->priority;
+    return pa < pb ? 1 : (pa > pb ? -1 : 0);
+}
+
+/*
+ * Chooses the entries to probe this tick.
+ *
+ * Never-probed entries come first, then entries older than stale_ms together with the watched
+ * entry once its interval has passed, then entries within MONITOR_THRESHOLD_BAND of the
+ * threshold that are older than a quarter of stale_ms; within each group the oldest data wins. At most budget entries are returned.
+ *
+ * Parameters:
+ *   picked (int*): Receives the chosen entry indices.
+ *   generations (unsigned*): Receives each chosen entry's generation.
+ *   configs (char**): Receives a copy of each chosen config; release with free.
+ *   budget (int): Maximum number of entries to choose.
+ *   now (long long): Current monotonic time in milliseconds.
+ *
+ * Returns:
+ *   int: Number of entries chosen.
+ */
+static int pick_due(int* picked, unsigned* generations, char** configs, int budget, long long now) {
+    MonitorCandidate* candidates = malloc(MONITOR_MAX_CONFIGS * sizeof(MonitorCandidate));
+    if (!candidates) return 0;
+    int n = 0;
+    pthread_mutex_lock(&monitor_lock);
+    for (int i = 0; i < monitor_high_water; i++) {
+        MonitorEntry* entry = &monitor_entries[i];
+        if (!entry->state.active) continue;
+        long long age = entry->state.last_probe_ms > 0 ? now - entry->state.last_probe_ms : -1;
+        long long priority;
+        if (age < 0) {
+            priority = 3LL << 60;
+        } else if (age >= monitor_stale_ms || (i == monitor_watch_id && age >= monitor_watch_ms)) {
+            priority = (2LL << 60) + age;
+        } else if (entry->state.score > monitor_threshold - MONITOR_THRESHOLD_BAND &&
+                   entry->state.score < monitor_threshold + MONITOR_THRESHOLD_BAND &&
+                   age >= monitor_stale_ms / 4) {
+            priority = (1LL << 60) + age;
+        } else {
+            continue;
+        }
+        candidates[n].index = i;
+        candidates[n].priority = priority;
+        n++;
+    }
+    qsort(candidates, (size_t)n, sizeof(MonitorCandidate), compare_candidates);
+    int count = 0;
+    for (int k = 0; k < n && count < budget; k++) {
+        MonitorEntry* entry = &monitor_entries[candidates[k].index];
+        char* copy = strdup(entry->config);
+        if (!copy) break;
+        picked[count] = candidates[k].index;
+        generations[count] = entry->generation;
+        configs[count] = copy;
+        count++;
+    }
+    pthread_mutex_unlock(&monitor_lock);
+    free(candidates);
+    return count;
+}
+
+static void* monitor_worker(void* arg) {
+    (void)arg;
+    int budget = monitor_budget;
+    int* picked = malloc((size_t)budget * sizeof(int));
+    unsigned* generations = malloc((size_t)budget * sizeof(unsigned));
+    char** configs = malloc((size_t)budget * sizeof(char*));
+    ProbeResult* results = malloc((size_t)budget * sizeof(ProbeResult));
+    if (!picked || !generations || !configs || !results) {
+        log_message("Failed to allocate monitor state", __FILE__, __LINE__, 0, NULL);
+        monitor_running = 0;
+    }
+
+    while (monitor_running) {
+        long long tick_start = get_monotonic_ms();
+        int count = pick_due(picked, generations, configs, budget, tick_start);
+        if (count > 0) {
+            if (monitor_mode == MONITOR_PROBE_BATCH) {
+                probe_configs_batch((const char**)configs, count, results, 0);
+            } else if (monitor_mode == MONITOR_PROBE_OBSERVATORY) {
+                probe_configs_observatory((const char**)configs, count, results, 0);
+            } else {
+                probe_config_quick_many((const char**)configs, count, results);
+            }
+            long long now = get_monotonic_ms();
+            pthread_mutex_lock(&monitor_lock);
+            for (int k = 0; k < count; k++) {
+                MonitorEntry* entry = &monitor_entries[picked[k]];
+                if (entry->state.active && entry->generation == generations[k]) {
+                    record_sample(entry, &results[k], now);
+                    cache_record_fingerprint(entry->state.fingerprint, &results[k]);
+                }
+            }
+            pthread_mutex_unlock(&monitor_lock);
+            for (int k = 0; k < count; k++) free(configs[k]);
+            LOG_DEBUGF("Monitor tick", "Probed %d configs in %lld ms", count, now - tick_start);
+        }
+        /* Stay within probes_per_second; long ticks are not made up for */
+        long long elapsed = get_monotonic_ms() - tick_start;
+        for (long long waited = elapsed; waited < MONITOR_TICK_MS && monitor_running; waited += MONITOR_SLEEP_STEP_MS) {
+            monitor_sleep_ms(MONITOR_SLEEP_STEP_MS);
+        }
+    }
+    free(picked);
+    free(generations);
+    free(configs);
+    free(results);
+    return NULL;
+}
+
+/*
+ * Registers a config with the monitor.
+ *
+ * The config is probed at the next tick of a running monitor. Adding a config that is
+ * already registered under the same fingerprint returns the existing handle. With a probe
+ * cache open, the config starts out with its cached samples (see seed_from_cache).
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *
+ * Returns:
+ *   int: A handle >= 0 on success, -1 on failure, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input, allocation failures, or a full table.
+ */
+EXPORT int v2root_monitor_add(const char* config_str) {
+    if (!config_str || config_str[0] == '\0') {
+        log_message("Null or empty config string for monitor", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    uint64_t fingerprint = v2root_config_fingerprint(config_str);
+    pthread_mutex_lock(&monitor_lock);
+    if (!monitor_entries) {
+        MonitorEntry* entries = calloc(MONITOR_MAX_CONFIGS, sizeof(MonitorEntry));
+        if (!entries) {
+            pthread_mutex_unlock(&monitor_lock);
+            log_message("Failed to allocate monitor table", __FILE__, __LINE__, 0, NULL);
+            return V2ROOT_ERROR;
+        }
+        __atomic_store_n(&monitor_entries, entries, __ATOMIC_RELEASE);
+    }
+    int free_index = -1;
+    for (int i = 0; i < monitor_high_water; i++) {
+        MonitorEntry* entry = &monitor_entries[i];
+        if (!entry->state.active) {
+            if (free_index < 0) free_index = i;
+        } else if (fingerprint != 0 ? entry->state.fingerprint == fingerprint : strcmp(entry->config, config_str) == 0) {
+            pthread_mutex_unlock(&monitor_lock);
+            return i;
+        }
+    }
+    if (free_index < 0 && monitor_high_water < MONITOR_MAX_CONFIGS) free_index = monitor_high_water;
+    char* copy = free_index >= 0 ? strdup(config_str) : NULL;
+    if (!copy) {
+        pthread_mutex_unlock(&monitor_lock);
+        log_message("Monitor table full or out of memory", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    MonitorEntry* entry = &monitor_entries[free_index];
+    entry->config = copy;
+    entry->generation++;
+    entry->window_pos = 0;
+    entry->window_count = 0;
+    entry->last_latency = -1;
+    memset(&entry->state, 0, sizeof(MonitorSummary));
+    entry->state.active = 1;
+    entry->state.fingerprint = fingerprint;
+    publish(entry);
+    seed_from_cache(entry);
+    if (free_index == monitor_high_water) __atomic_store_n(&monitor_high_water, free_index + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&monitor_lock);
+    return free_index;
+}
+
+/*
+ * Unregisters a config.
+ *
+ * Parameters:
+ *   id (int): Handle returned by v2root_monitor_add.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if id is not registered.
+ */
+EXPORT int v2root_monitor_remove(int id) {
+    pthread_mutex_lock(&monitor_lock);
+    if (!monitor_entries || id < 0 || id >= monitor_high_water || !monitor_entries[id].state.active) {
+        pthread_mutex_unlock(&monitor_lock);
+        return V2ROOT_ERROR;
+    }
+    MonitorEntry* entry = &monitor_entries[id];
+    free(entry->config);
+    entry->config = NULL;
+    entry->state.active = 0;
+    publish(entry);
+    pthread_mutex_unlock(&monitor_lock);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Returns a copy of the config string registered under id, or NULL if there is none.
+ */
+char* monitor_config_dup(int id) {
+    char* copy = NULL;
+    pthread_mutex_lock(&monitor_lock);
+    if (monitor_entries && id >= 0 && id < monitor_high_water && monitor_entries[id].state.active) {
+        copy = strdup(monitor_entries[id].config);
+    }
+    pthread_mutex_unlock(&monitor_lock);
+    return copy;
+}
+
+/*
+ * Keeps one config's data fresh independently of stale_ms, e.g. the node currently in use.
+ */
+void monitor_watch(int id, int interval_ms) {
+    pthread_mutex_lock(&monitor_lock);
+    monitor_watch_id = id;
+    monitor_watch_ms = interval_ms;
+    pthread_mutex_unlock(&monitor_lock);
+}
+
+/* Unregisters every config */
+EXPORT void v2root_monitor_clear(void) {
+    pthread_mutex_lock(&monitor_lock);
+    for (int i = 0; i < monitor_high_water; i++) {
+        MonitorEntry* entry = &monitor_entries[i];
+        if (!entry->state.active) continue;
+        free(entry->config);
+        entry->config = NULL;
+        entry->state.active = 0;
+        publish(entry);
+    }
+    pthread_mutex_unlock(&monitor_lock);
+}
+
+/*
+ * Starts the monitor thread.
+ *
+ * Parameters:
+ *   probes_per_second (int): Probe budget per second (1..MAX_BATCH_CONFIGS, defaults to 10 if <= 0).
+ *   stale_ms (int): Age after which a config is re-probed (defaults to 60000 if <= 0).
+ *   threshold (double): Selection score threshold; configs scoring within
+ *                       MONITOR_THRESHOLD_BAND of it are re-probed four times as often.
+ *   mode (int): One of the MONITOR_PROBE_* constants.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 for an invalid mode, -7 if already running.
+ *
+ * Errors:
+ *   Logs errors for invalid arguments or thread creation failures.
+ */
+EXPORT int v2root_monitor_start(int probes_per_second, int stale_ms, double threshold, int mode) {
+    if (mode < MONITOR_PROBE_QUICK || mode > MONITOR_PROBE_OBSERVATORY) {
+        log_message("Invalid monitor probe mode", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    pthread_mutex_lock(&monitor_control_lock);
+    if (monitor_running) {
+        pthread_mutex_unlock(&monitor_control_lock);
+        log_message("Monitor already running", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_ALREADY_RUNNING;
+    }
+    if (probes_per_second <= 0) probes_per_second = DEFAULT_MONITOR_PROBES_PER_SECOND;
+    if (probes_per_second > MAX_BATCH_CONFIGS) probes_per_second = MAX_BATCH_CONFIGS;
+    monitor_budget = probes_per_second;
+    monitor_stale_ms = stale_ms > 0 ? stale_ms : DEFAULT_MONITOR_STALE_MS;
+    monitor_threshold = threshold;
+    monitor_mode = mode;
+    monitor_running = 1;
+    if (pthread_create(&monitor_thread, NULL, monitor_worker, NULL) != 0) {
+        monitor_running = 0;
+        pthread_mutex_unlock(&monitor_control_lock);
+        log_message("Failed to start monitor thread", __FILE__, __LINE__, errno, NULL);
+        return V2ROOT_ERROR;
+    }
+    pthread_mutex_unlock(&monitor_control_lock);
+    LOG_INFOF("Health monitor started", "Budget: %d/s, stale after %d ms, threshold %.2f, mode %d",
+              monitor_budget, monitor_stale_ms, monitor_threshold, monitor_mode);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Stops the monitor thread, waiting for an in-flight probe round to finish.
+ *
+ * Registered configs and their summaries are kept.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the monitor is not running.
+ */
+EXPORT int v2root_monitor_stop(void) {
+    pthread_mutex_lock(&monitor_control_lock);
+    if (!monitor_running) {
+        pthread_mutex_unlock(&monitor_control_lock);
+        return V2ROOT_ERROR;
+    }
+    monitor_running = 0;
+    pthread_join(monitor_thread, NULL);
+    pthread_mutex_unlock(&monitor_control_lock);
+    LOG_INFO("Health monitor stopped", NULL);
+    return V2ROOT_SUCCESS;
+}
+
+static int compare_stats(const void* a, const void* b) {
+    double sa = ((const MonitorStat*)a)->score;
+    double sb = ((const MonitorStat*)b)->score;
+    return sa < sb ? 1 : (sa > sb ? -1 : 0);
+}
+
+/*
+ * Copies the current summaries, best score first, without blocking the prober.
+ *
+ * Parameters:
+ *   out (MonitorStat*): Receives up to max summaries.
+ *   max (int): Capacity of out.
+ *
+ * Returns:
+ *   int: Number of summaries written.
+ */
+EXPORT int v2root_monitor_snapshot(MonitorStat* out, int max) {
+    MonitorEntry* entries = __atomic_load_n(&monitor_entries, __ATOMIC_ACQUIRE);
+    if (!entries || !out || max <= 0) return 0;
+    int high_water = __atomic_load_n(&monitor_high_water, __ATOMIC_ACQUIRE);
+    long long now = get_monotonic_ms();
+    int count = 0;
+    for (int i = 0; i < high_water && count < max; i++) {
+        MonitorSummary summary;
+        read_published(&entries[i], &summary);
+        if (summary.active) to_stat(i, &summary, now, &out[count++]);
+    }
+    qsort(out, (size_t)count, sizeof(MonitorStat), compare_stats);
+    return count;
+}
+
+/*
+ * Copies the current summary of one config without blocking the prober.
+ *
+ * Parameters:
+ *   id (int): Handle returned by v2root_monitor_add.
+ *   out (MonitorStat*): Receives the summary.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if id is not registered.
+ */
+EXPORT int v2root_monitor_get(int id, MonitorStat* out) {
+    MonitorEntry* entries = __atomic_load_n(&monitor_entries, __ATOMIC_ACQUIRE);
+    if (!entries || !out || id < 0 || id >= __atomic_load_n(&monitor_high_water, __ATOMIC_ACQUIRE)) return V2ROOT_ERROR;
+    MonitorSummary summary;
+    read_published(&entries[id], &summary);
+    if (!summary.active) return V2ROOT_ERROR;
+    to_stat(id, &summary, get_monotonic_ms(), out);
+    return V2ROOT_SUCCESS;
+}
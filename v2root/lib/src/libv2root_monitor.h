@@ -0,0 +1,61 @@
+#ifndef LIBV2ROOT_MONITOR_H
+#define LIBV2ROOT_MONITOR_H
+
+#include <stdint.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Background health monitor.
+ *
+ * A native thread keeps a rolling window of probe samples per registered config and re-probes
+ * only the configs whose data is stale, or whose score sits close to the selection threshold,
+ * within a probe budget per second. Summaries are published per config under a sequence lock,
+ * so v2root_monitor_snapshot never blocks, or is blocked by, the prober.
+ */
+
+#define MONITOR_MAX_CONFIGS 4096
+#define MONITOR_WINDOW 16                   /* Samples kept per config for the success rate */
+
+/* Probe modes for v2root_monitor_start */
+#define MONITOR_PROBE_QUICK 0               /* DNS + TCP (probe_config_quick_many) */
+#define MONITOR_PROBE_BATCH 1               /* Proxied request through V2Ray (probe_configs_batch) */
+#define MONITOR_PROBE_OBSERVATORY 2         /* V2Ray observatory (probe_configs_observatory) */
+
+/* Published health summary of one config */
+typedef struct {
+    int id;                         /* Handle returned by v2root_monitor_add */
+    int samples;                    /* Samples in the window */
+    int last_success;               /* 1 if the latest probe succeeded */
+    int probes;                     /* Probes since the config was added */
+    uint64_t fingerprint;           /* Canonical config fingerprint */
+    double ewma_ms;                 /* EWMA of successful probe latency */
+    double ewma_tcp_ms;             /* EWMA of the TCP connect time */
+    double jitter_ms;               /* Smoothed latency variation (RFC 3550 estimator) */
+    double success_rate;            /* Successes over the window */
+    double score;                   /* calculate_probe_score of the EWMAs, times success_rate */
+    long long age_ms;               /* Time since the latest probe, -1 if never probed */
+} MonitorStat;
+
+EXPORT int v2root_monitor_add(const char* config_str);
+EXPORT int v2root_monitor_remove(int id);
+EXPORT void v2root_monitor_clear(void);
+EXPORT int v2root_monitor_start(int probes_per_second, int stale_ms, double threshold, int mode);
+EXPORT int v2root_monitor_stop(void);
+EXPORT int v2root_monitor_snapshot(MonitorStat* out, int max);
+EXPORT int v2root_monitor_get(int id, MonitorStat* out);
+
+/* Returns a copy of a registered config string (release with free), or NULL */
+char* monitor_config_dup(int id);
+
+/* Re-probes config id at least every interval_ms regardless of staleness; id -1 clears it */
+void monitor_watch(int id, int interval_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_MONITOR_H */
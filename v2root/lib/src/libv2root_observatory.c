@@ -0,0 +1,477 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET obs_socket_t;
+#define CLOSE_SOCKET closesocket
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+typedef int obs_socket_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_observatory.h"
+#include "libv2root_utils.h"
+
+#define OBSERVATORY_PATH "/v2ray.core.app.observatory.command.ObservatoryService/GetOutboundStatus"
+#define OBSERVATORY_API_TAG "api"
+#define OBSERVATORY_API_INBOUND "api-in"
+#define OBSERVATORY_IO_TIMEOUT_MS 2000
+#define OBSERVATORY_MAX_RESPONSE (4 * 1024 * 1024)
+
+/* HTTP/2 frame types and flags used by the client */
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+#define H2_WINDOW_UPDATE 0x8
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_WINDOW (1u << 24)
+
+/*
+ * Adds the observatory, the API service and its loopback inbound to a V2Ray config.
+ *
+ * The observatory probes every outbound whose tag starts with prefix concurrently, once at
+ * start-up and then every probeInterval. The API inbound is routed ahead of every other rule.
+ *
+ * Parameters:
+ *   root (json_t*): The config document to extend.
+ *   prefix (const char*): Outbound tag prefix selecting the observed outbounds.
+ *   api_port (int): Loopback port for the API inbound, or 0 for the observatory alone
+ *                   (e.g. to drive a leastPing balancer).
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs an error if the JSON objects cannot be created.
+ */
+int observatory_attach(json_t* root, const char* prefix, int api_port) {
+    json_t* observatory = json_object();
+    json_t* selector = json_array();
+    if (!observatory || !selector) {
+        json_decref(observatory);
+        json_decref(selector);
+        log_message("Failed to allocate observatory config", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    json_array_append_new(selector, json_string(prefix));
+    json_object_set_new(observatory, "subjectSelector", selector);
+    json_object_set_new(observatory, "probeURL", json_string(PRIMARY_PROBE_URL));
+    json_object_set_new(observatory, "probeInterval", json_string("60s"));
+    json_object_set_new(observatory, "enableConcurrency", json_true());
+    json_object_set_new(root, "observatory", observatory);
+    if (api_port <= 0) return 0;
+
+    json_t* api = json_object();
+    json_t* services = json_array();
+    json_t* inbound = json_object();
+    json_t* inbound_settings = json_object();
+    json_t* rule = json_object();
+    json_t* rule_tags = json_array();
+    if (!api || !services || !inbound || !inbound_settings || !rule || !rule_tags) {
+        json_decref(api);
+        json_decref(services);
+        json_decref(inbound);
+        json_decref(inbound_settings);
+        json_decref(rule);
+        json_decref(rule_tags);
+        log_message("Failed to allocate observatory config", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    json_array_append_new(services, json_string("ObservatoryService"));
+    json_object_set_new(api, "tag", json_string(OBSERVATORY_API_TAG));
+    json_object_set_new(api, "services", services);
+    json_object_set_new(root, "api", api);
+
+    json_object_set_new(inbound_settings, "address", json_string("127.0.0.1"));
+    json_object_set_new(inbound, "tag", json_string(OBSERVATORY_API_INBOUND));
+    json_object_set_new(inbound, "listen", json_string("127.0.0.1"));
+    json_object_set_new(inbound, "port", json_integer(api_port));
+    json_object_set_new(inbound, "protocol", json_string("dokodemo-door"));
+    json_object_set_new(inbound, "settings", inbound_settings);
+    json_t* inbounds = json_object_get(root, "inbounds");
+    if (!json_is_array(inbounds)) {
+        inbounds = json_array();
+        json_object_set_new(root, "inbounds", inbounds);
+    }
+    json_array_append_new(inbounds, inbound);
+
+    json_array_append_new(rule_tags, json_string(OBSERVATORY_API_INBOUND));
+    json_object_set_new(rule, "type", json_string("field"));
+    json_object_set_new(rule, "inboundTag", rule_tags);
+    json_object_set_new(rule, "outboundTag", json_string(OBSERVATORY_API_TAG));
+    json_t* routing = json_object_get(root, "routing");
+    if (!json_is_object(routing)) {
+        routing = json_object();
+        json_object_set_new(root, "routing", routing);
+    }
+    json_t* rules = json_object_get(routing, "rules");
+    if (!json_is_array(rules)) {
+        rules = json_array();
+        json_object_set_new(routing, "rules", rules);
+    }
+    json_array_insert_new(rules, 0, rule);
+    return 0;
+}
+
+static int send_all(obs_socket_t fd, const unsigned char* data, size_t len) {
+    while (len > 0) {
+        int n = (int)send(fd, (const char*)data, (int)len, 0);
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int recv_all(obs_socket_t fd, unsigned char* data, size_t len) {
+    while (len > 0) {
+        int n = (int)recv(fd, (char*)data, (int)len, 0);
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void h2_frame_header(unsigned char* out, size_t len, int type, int flags, uint32_t stream) {
+    out[0] = (unsigned char)(len >> 16);
+    out[1] = (unsigned char)(len >> 8);
+    out[2] = (unsigned char)len;
+    out[3] = (unsigned char)type;
+    out[4] = (unsigned char)flags;
+    out[5] = (unsigned char)((stream >> 24) & 0x7f);
+    out[6] = (unsigned char)(stream >> 16);
+    out[7] = (unsigned char)(stream >> 8);
+    out[8] = (unsigned char)stream;
+}
+
+static int h2_send_frame(obs_socket_t fd, int type, int flags, uint32_t stream, const unsigned char* payload, size_t len) {
+    unsigned char header[9];
+    h2_frame_header(header, len, type, flags, stream);
+    if (send_all(fd, header, sizeof(header)) != 0) return -1;
+    return len > 0 ? send_all(fd, payload, len) : 0;
+}
+
+/* HPACK integer with an n-bit prefix (RFC 7541 5.1) */
+static size_t hpack_int(unsigned char* out, size_t value, int prefix_bits, unsigned char first) {
+    size_t max = ((size_t)1 << prefix_bits) - 1;
+    if (value < max) {
+        out[0] = (unsigned char)(first | value);
+        return 1;
+    }
+    size_t n = 0;
+    out[n++] = (unsigned char)(first | max);
+    value -= max;
+    while (value >= 128) {
+        out[n++] = (unsigned char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+/* HPACK string literal without Huffman coding */
+static size_t hpack_string(unsigned char* out, const char* s) {
+    size_t len = strlen(s);
+    size_t n = hpack_int(out, len, 7, 0);
+    memcpy(out + n, s, len);
+    return n + len;
+}
+
+/*
+ * Issues one unary gRPC call over HTTP/2 with prior knowledge on a loopback port.
+ *
+ * Only what a single request on stream 1 needs is implemented: the request headers are sent
+ * as literals, and of the response only the DATA frames are used, so the HPACK-coded response
+ * headers never have to be decoded. A call that returns no message counts as failed.
+ *
+ * Parameters:
+ *   port (int): Loopback port of the V2Ray API inbound.
+ *   path (const char*): The method path, /package.Service/Method.
+ *   request (const unsigned char*): Serialized request message.
+ *   request_len (size_t): Length of request in bytes.
+ *   response (unsigned char**): Receives the serialized response message; release with free.
+ *   response_len (size_t*): Receives the length of *response.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+static int grpc_unary_call(int port, const char* path, const unsigned char* request, size_t request_len,
+                           unsigned char** response, size_t* response_len) {
+    *response = NULL;
+    *response_len = 0;
+    obs_socket_t fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd == INVALID_SOCKET) return -1;
+#ifdef _WIN32
+    DWORD timeout = OBSERVATORY_IO_TIMEOUT_MS;
+#else
+    struct timeval timeout = { OBSERVATORY_IO_TIMEOUT_MS / 1000, (OBSERVATORY_IO_TIMEOUT_MS % 1000) * 1000 };
+#endif
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        CLOSE_SOCKET(fd);
+        return -1;
+    }
+
+    static const char preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    unsigned char settings[6] = { 0x00, 0x04, (H2_WINDOW >> 24) & 0xff, (H2_WINDOW >> 16) & 0xff, (H2_WINDOW >> 8) & 0xff, H2_WINDOW & 0xff };
+    unsigned char window[4] = { (H2_WINDOW >> 24) & 0x7f, (H2_WINDOW >> 16) & 0xff, (H2_WINDOW >> 8) & 0xff, H2_WINDOW & 0xff };
+
+    char authority[32];
+    snprintf(authority, sizeof(authority), "127.0.0.1:%d", port);
+    unsigned char headers[512];
+    size_t hlen = 0;
+    if (strlen(path) > sizeof(headers) - 128) {
+        CLOSE_SOCKET(fd);
+        return -1;
+    }
+    headers[hlen++] = 0x83;                                 /* :method POST */
+    headers[hlen++] = 0x86;                                 /* :scheme http */
+    hlen += hpack_int(headers + hlen, 4, 4, 0x00);          /* :path, literal without indexing */
+    hlen += hpack_string(headers + hlen, path);
+    hlen += hpack_int(headers + hlen, 1, 4, 0x00);          /* :authority */
+    hlen += hpack_string(headers + hlen, authority);
+    headers[hlen++] = 0x00;
+    hlen += hpack_string(headers + hlen, "content-type");
+    hlen += hpack_string(headers + hlen, "application/grpc");
+    headers[hlen++] = 0x00;
+    hlen += hpack_string(headers + hlen, "te");
+    hlen += hpack_string(headers + hlen, "trailers");
+
+    unsigned char* message = malloc(request_len + 5);
+    if (!message) {
+        CLOSE_SOCKET(fd);
+        return -1;
+    }
+    message[0] = 0;                                         /* Not compressed */
+    message[1] = (unsigned char)(request_len >> 24);
+    message[2] = (unsigned char)(request_len >> 16);
+    message[3] = (unsigned char)(request_len >> 8);
+    message[4] = (unsigned char)request_len;
+    if (request_len > 0) memcpy(message + 5, request, request_len);
+
+    int rc = -1;
+    unsigned char* body = NULL;
+    size_t body_len = 0;
+    if (send_all(fd, (const unsigned char*)preface, sizeof(preface) - 1) != 0 ||
+        h2_send_frame(fd, H2_SETTINGS, 0, 0, settings, sizeof(settings)) != 0 ||
+        h2_send_frame(fd, H2_WINDOW_UPDATE, 0, 0, window, sizeof(window)) != 0 ||
+        h2_send_frame(fd, H2_HEADERS, H2_FLAG_END_HEADERS, 1, headers, hlen) != 0 ||
+        h2_send_frame(fd, H2_DATA, H2_FLAG_END_STREAM, 1, message, request_len + 5) != 0) {
+        goto done;
+    }
+
+    for (;;) {
+        unsigned char header[9];
+        if (recv_all(fd, header, sizeof(header)) != 0) goto done;
+        size_t len = ((size_t)header[0] << 16) | ((size_t)header[1] << 8) | header[2];
+        int type = header[3], flags = header[4];
+        uint32_t stream = ((uint32_t)(header[5] & 0x7f) << 24) | ((uint32_t)header[6] << 16) | ((uint32_t)header[7] << 8) | header[8];
+        if (len > OBSERVATORY_MAX_RESPONSE || body_len + len > OBSERVATORY_MAX_RESPONSE) goto done;
+        unsigned char* payload = malloc(len ? len : 1);
+        if (!payload) goto done;
+        if (len > 0 && recv_all(fd, payload, len) != 0) {
+            free(payload);
+            goto done;
+        }
+
+        int finished = 0, failed = 0;
+        if (type == H2_SETTINGS && !(flags & H2_FLAG_ACK)) {
+            failed = h2_send_frame(fd, H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0) != 0;
+        } else if (type == H2_PING && !(flags & H2_FLAG_ACK)) {
+            failed = h2_send_frame(fd, H2_PING, H2_FLAG_ACK, 0, payload, len) != 0;
+        } else if (type == H2_DATA && stream == 1) {
+            unsigned char* grown = realloc(body, body_len + len + 1);
+            if (grown) {
+                body = grown;
+                memcpy(body + body_len, payload, len);
+                body_len += len;
+            } else {
+                failed = 1;
+            }
+            finished = (flags & H2_FLAG_END_STREAM) != 0;
+        } else if (type == H2_HEADERS && stream == 1) {
+            finished = (flags & H2_FLAG_END_STREAM) != 0;
+        } else if ((type == H2_RST_STREAM && stream == 1) || type == H2_GOAWAY) {
+            failed = 1;
+        }
+        free(payload);
+        if (failed) goto done;
+        if (finished) break;
+    }
+
+    /* One length-prefixed message; a trailers-only reply carries none */
+    if (body_len >= 5 && body[0] == 0) {
+        size_t mlen = ((size_t)body[1] << 24) | ((size_t)body[2] << 16) | ((size_t)body[3] << 8) | body[4];
+        if (mlen <= body_len - 5) {
+            memmove(body, body + 5, mlen);
+            *response = body;
+            *response_len = mlen;
+            body = NULL;
+            rc = 0;
+        }
+    }
+
+done:
+    free(body);
+    free(message);
+    CLOSE_SOCKET(fd);
+    return rc;
+}
+
+/* Protocol buffers wire format: one field of a message */
+typedef struct {
+    uint32_t number;
+    int wire_type;
+    uint64_t value;                 /* Varint fields */
+    const unsigned char* data;      /* Length-delimited fields */
+    size_t len;
+} PbField;
+
+static const unsigned char* pb_varint(const unsigned char* p, const unsigned char* end, uint64_t* value) {
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* Reads the next field at *p; returns 1 on success, 0 at the end or on malformed input */
+static int pb_next(const unsigned char** p, const unsigned char* end, PbField* field) {
+    uint64_t key;
+    const unsigned char* q = *p < end ? pb_varint(*p, end, &key) : NULL;
+    if (!q) return 0;
+    field->number = (uint32_t)(key >> 3);
+    field->wire_type = (int)(key & 7);
+    field->value = 0;
+    field->data = NULL;
+    field->len = 0;
+    switch (field->wire_type) {
+        case 0:
+            q = pb_varint(q, end, &field->value);
+            break;
+        case 1:
+            q = end - q >= 8 ? q + 8 : NULL;
+            break;
+        case 2: {
+            uint64_t len;
+            q = pb_varint(q, end, &len);
+            if (q && len <= (uint64_t)(end - q)) {
+                field->data = q;
+                field->len = (size_t)len;
+                q += len;
+            } else {
+                q = NULL;
+            }
+            break;
+        }
+        case 5:
+            q = end - q >= 4 ? q + 4 : NULL;
+            break;
+        default:
+            q = NULL;
+    }
+    if (!q) return 0;
+    *p = q;
+    return 1;
+}
+
+static void pb_copy_string(char* out, size_t size, const PbField* field) {
+    size_t n = field->len < size - 1 ? field->len : size - 1;
+    memcpy(out, field->data, n);
+    out[n] = '\0';
+}
+
+/* Decodes one OutboundStatus message */
+static void parse_outbound_status(const unsigned char* p, size_t len, ObservatoryStatus* status) {
+    memset(status, 0, sizeof(ObservatoryStatus));
+    const unsigned char* end = p + len;
+    PbField field;
+    while (pb_next(&p, end, &field)) {
+        switch (field.number) {
+            case 1: status->alive = field.wire_type == 0 && field.value != 0; break;
+            case 2: if (field.wire_type == 0) status->delay_ms = (long long)field.value; break;
+            case 3: if (field.wire_type == 2) pb_copy_string(status->error, sizeof(status->error), &field); break;
+            case 4: if (field.wire_type == 2) pb_copy_string(status->tag, sizeof(status->tag), &field); break;
+            case 6: if (field.wire_type == 0) status->last_try_time = (long long)field.value; break;
+            default: break;
+        }
+    }
+}
+
+/*
+ * Reads the observatory's current view of every observed outbound.
+ *
+ * Parameters:
+ *   api_port (int): Loopback port of the API inbound added by observatory_attach.
+ *   out (ObservatoryStatus*): Receives up to max statuses.
+ *   max (int): Capacity of out.
+ *
+ * Returns:
+ *   int: Number of statuses written, or -1 if the API call fails.
+ */
+int observatory_query(int api_port, ObservatoryStatus* out, int max) {
+    unsigned char* response;
+    size_t len;
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        return -1;
+    }
+#endif
+    int rc = grpc_unary_call(api_port, OBSERVATORY_PATH, NULL, 0, &response, &len);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    if (rc != 0) {
+        LOG_DEBUGF("Observatory query failed", "API port %d", api_port);
+        return -1;
+    }
+    /* GetOutboundStatusResponse.status (1) -> ObservationResult.status (1, repeated) */
+    int count = 0;
+    const unsigned char* p = response;
+    const unsigned char* end = response + len;
+    PbField field;
+    while (pb_next(&p, end, &field)) {
+        if (field.number != 1 || field.wire_type != 2) continue;
+        const unsigned char* q = field.data;
+        const unsigned char* qend = field.data + field.len;
+        PbField entry;
+        while (pb_next(&q, qend, &entry)) {
+            if (entry.number != 1 || entry.wire_type != 2 || count >= max) continue;
+            parse_outbound_status(entry.data, entry.len, &out[count++]);
+        }
+    }
+    free(response);
+    return count;
+}
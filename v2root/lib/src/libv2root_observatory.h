@@ -0,0 +1,41 @@
+#ifndef LIBV2ROOT_OBSERVATORY_H
+#define LIBV2ROOT_OBSERVATORY_H
+
+#include <jansson.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * V2Ray observatory support.
+ *
+ * With the observatory enabled V2Ray probes its own outbounds; the results are read back from
+ * ObservatoryService.GetOutboundStatus through the API inbound, using a minimal gRPC client
+ * (HTTP/2 over cleartext loopback TCP) so no gRPC or protobuf library is needed.
+ */
+
+#define OBSERVATORY_TAG_LENGTH 64
+#define OBSERVATORY_ERROR_LENGTH 192
+
+/* One outbound's entry of GetOutboundStatusResponse */
+typedef struct {
+    char tag[OBSERVATORY_TAG_LENGTH];
+    int alive;
+    long long delay_ms;
+    long long last_try_time;            /* Unix seconds; 0 until the outbound has been probed */
+    char error[OBSERVATORY_ERROR_LENGTH];
+} ObservatoryStatus;
+
+/* Adds the observatory for outbounds tagged with prefix plus, if api_port > 0, an API inbound on it */
+int observatory_attach(json_t* root, const char* prefix, int api_port);
+
+/* Fills up to max entries of out; returns the number of outbounds reported, or -1 */
+int observatory_query(int api_port, ObservatoryStatus* out, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_OBSERVATORY_H */
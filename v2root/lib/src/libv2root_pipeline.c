@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "libv2root_common.h"
+#include "libv2root_pipeline.h"
+#include "libv2root_batch.h"
+#include "libv2root_cache.h"
+#include "libv2root_config.h"
+#include "libv2root_handshake.h"
+#include "libv2root_probe.h"
+#include "libv2root_records.h"
+#include "libv2root_utils.h"
+#ifndef _WIN32
+#include "libv2root_http.h"
+#endif
+
+/* Per-wave working set, allocated once per call */
+typedef struct {
+    ProbeResult results[PIPELINE_WAVE_SIZE];    /* Merged result of each config so far */
+    ProbeResult scratch[PIPELINE_WAVE_SIZE];    /* Output of the stage being run */
+    int advance[PIPELINE_WAVE_SIZE];            /* 1 while the config is still in the pipeline */
+    int tls[PIPELINE_WAVE_SIZE];                /* 1 if stage 2 measures the config */
+    int order[PIPELINE_WAVE_SIZE];
+    const char* inputs[PIPELINE_WAVE_SIZE];
+#ifndef _WIN32
+    TlsTarget targets[PIPELINE_WAVE_SIZE];
+#endif
+} PipelineWave;
+
+typedef struct {
+    int index;
+    int latency_ms;
+} PipelineRank;
+
+static int compare_rank(const void* a, const void* b) {
+    const PipelineRank* x = (const PipelineRank*)a;
+    const PipelineRank* y = (const PipelineRank*)b;
+    if (x->latency_ms != y->latency_ms) return x->latency_ms < y->latency_ms ? -1 : 1;
+    return x->index - y->index;
+}
+
+/* Number of the eligible configs a stage passes on: the keep fraction, rounded up, at least 1 */
+static int survivor_count(int eligible, double keep) {
+    if (eligible <= 0) return 0;
+    if (keep <= 0.0 || keep >= 1.0) return eligible;
+    double wanted = keep * eligible;
+    int count = (int)wanted;
+    if (count < wanted) count++;
+    return count < 1 ? 1 : count;
+}
+
+static void emit(const ProbeResult* result, int index, int stage, ProbeRecordCallback callback, void* user_data) {
+    ProbeRecord record;
+    probe_record_from_result(result, index, &record);
+    record.stage = stage;
+    callback(&record, user_data);
+}
+
+/*
+ * Keeps the fastest configs among the ranked candidates and delivers the rest.
+ *
+ * Parameters:
+ *   wave (PipelineWave*): The wave; advance is cleared for every config cut.
+ *   ranks (PipelineRank*): Candidates to rank, sorted in place.
+ *   count (int): Number of candidates.
+ *   keep (double): Fraction to keep.
+ *   start (int): Index of the wave's first config in the request.
+ *   stage (int): PROBE_STAGE_* reported for the configs cut.
+ *
+ * Returns:
+ *   int: Number of candidates kept.
+ */
+static int keep_fastest(PipelineWave* wave, PipelineRank* ranks, int count, double keep, int start, int stage,
+                        ProbeRecordCallback callback, void* user_data) {
+    int kept = survivor_count(count, keep);
+    qsort(ranks, (size_t)count, sizeof(PipelineRank), compare_rank);
+    for (int r = kept; r < count; r++) {
+        int i = ranks[r].index;
+        wave->advance[i] = 0;
+        emit(&wave->results[i], start + i, stage, callback, user_data);
+    }
+    return kept;
+}
+
+#ifndef _WIN32
+/*
+ * Fills a direct TLS target from a config's rendered outbound.
+ *
+ * The server name is the one V2Ray would send: tlsSettings.serverName for TLS, the first
+ * REALITY server name for REALITY, and the server address when neither is set.
+ *
+ * Returns:
+ *   int: 1 if the config opens TLS or REALITY over TCP to its server, 0 otherwise.
+ */
+static int tls_target_from_config(const char* config_str, TlsTarget* target) {
+    json_t* outbound = render_outbound(config_str);
+    if (!outbound) return 0;
+    json_t* stream = json_object_get(outbound, "streamSettings");
+    const char* security = json_string_value(json_object_get(stream, "security"));
+    const char* network = json_string_value(json_object_get(stream, "network"));
+    int reality = security && strcmp(security, "reality") == 0;
+    if (!security || (!reality && strcmp(security, "tls") != 0) ||
+        (network && (strcmp(network, "kcp") == 0 || strcmp(network, "quic") == 0))) {
+        json_decref(outbound);
+        return 0;
+    }
+
+    json_t* settings = json_object_get(outbound, "settings");
+    json_t* server = json_array_get(json_object_get(settings, "vnext"), 0);
+    if (!server) server = json_array_get(json_object_get(settings, "servers"), 0);
+    const char* address = json_string_value(json_object_get(server, "address"));
+    int port = (int)json_integer_value(json_object_get(server, "port"));
+    const char* sni = NULL;
+    if (reality) {
+        json_t* reality_settings = json_object_get(stream, "realitySettings");
+        sni = json_string_value(json_object_get(reality_settings, "serverName"));
+        if (!sni || !sni[0]) sni = json_string_value(json_array_get(json_object_get(reality_settings, "serverNames"), 0));
+    } else {
+        sni = json_string_value(json_object_get(json_object_get(stream, "tlsSettings"), "serverName"));
+    }
+    if (!sni || !sni[0]) sni = address;
+
+    int ok = address && address[0] && port > 0 && port <= 65535 &&
+             strlen(address) < sizeof(target->host) && strlen(sni) < sizeof(target->sni);
+    if (ok) {
+        strcpy(target->host, address);
+        strcpy(target->sni, sni);
+        target->port = port;
+    }
+    json_decref(outbound);
+    return ok;
+}
+#endif
+
+/*
+ * Stage 2: direct handshakes with the servers of the survivors.
+ *
+ * VLESS and Shadowsocks configs get the full protocol handshake; configs the handshake
+ * engine skips fall back to a bare TLS handshake when they use TLS, and pass unmeasured
+ * otherwise. scratch receives the result of each measured config at its wave position.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+static int run_tls_stage(PipelineWave* wave, const char** configs, int count) {
+    int m = 0;
+    for (int i = 0; i < count; i++) {
+        wave->tls[i] = 0;
+        if (!wave->advance[i]) continue;
+        wave->order[m] = i;
+        wave->inputs[m] = configs[i];
+        m++;
+    }
+    if (m == 0) return 0;
+    if (probe_config_handshake_many(wave->inputs, m, wave->scratch) < 0) return -1;
+    /* Spread the compacted results out; order[j] >= j, so walking back never overwrites one unread */
+    for (int j = m - 1; j >= 0; j--) {
+        int i = wave->order[j];
+        if (i != j) wave->scratch[i] = wave->scratch[j];
+        wave->tls[i] = wave->scratch[i].attempts > 0;
+    }
+#ifndef _WIN32
+    int fallback = 0;
+    for (int i = 0; i < count; i++) {
+        wave->targets[i].port = 0;
+        if (!wave->advance[i] || wave->tls[i] || !tls_target_from_config(configs[i], &wave->targets[i])) continue;
+        memset(&wave->scratch[i], 0, sizeof(ProbeResult));
+        wave->tls[i] = 1;
+        fallback++;
+    }
+    if (fallback > 0 && http_tls_handshakes(wave->targets, count, DEFAULT_TLS_TIMEOUT_MS, wave->scratch) < 0) return -1;
+#endif
+    return 0;
+}
+
+/*
+ * Runs one wave of up to PIPELINE_WAVE_SIZE configs through the three stages.
+ *
+ * Returns:
+ *   int: Number of configs that passed stage 3, or -1 on failure.
+ */
+static int run_wave(PipelineWave* wave, const char** configs, int start, int count, double tcp_keep, double tls_keep,
+                    ProbeRecordCallback callback, void* user_data, int* passed_tcp, int* passed_tls) {
+    PipelineRank ranks[PIPELINE_WAVE_SIZE];
+    const char** wave_configs = configs + start;
+
+    /* Stage 1: DNS + TCP */
+    memset(wave->results, 0, sizeof(ProbeResult) * (size_t)count);
+    if (probe_config_quick_many(wave_configs, count, wave->results) < 0) return -1;
+    int ranked = 0;
+    for (int i = 0; i < count; i++) {
+        wave->advance[i] = wave->results[i].success;
+        if (!wave->advance[i]) {
+            emit(&wave->results[i], start + i, PROBE_STAGE_TCP, callback, user_data);
+            continue;
+        }
+        ranks[ranked].index = i;
+        ranks[ranked].latency_ms = wave->results[i].tcp_connect_ms;
+        ranked++;
+    }
+    *passed_tcp += keep_fastest(wave, ranks, ranked, tcp_keep, start, PROBE_STAGE_TCP, callback, user_data);
+
+    /* Stage 2: direct protocol or TLS handshake */
+    if (run_tls_stage(wave, wave_configs, count) != 0) return -1;
+    ranked = 0;
+    for (int i = 0; i < count; i++) {
+        if (!wave->advance[i] || !wave->tls[i]) continue;
+        ProbeResult* result = &wave->results[i];
+        const ProbeResult* handshake = &wave->scratch[i];
+        if (!handshake->success) {
+            result->success = 0;
+            result->score = 0.0;
+            memcpy(result->error_type, handshake->error_type, sizeof(result->error_type));
+            memcpy(result->error_details, handshake->error_details, sizeof(result->error_details));
+            wave->advance[i] = 0;
+            emit(result, start + i, PROBE_STAGE_TLS, callback, user_data);
+            continue;
+        }
+        result->tls_handshake_ms = handshake->tls_handshake_ms;
+        result->transport_handshake_ms = handshake->transport_handshake_ms;
+        ranks[ranked].index = i;
+        ranks[ranked].latency_ms = handshake->tls_handshake_ms + handshake->transport_handshake_ms;
+        ranked++;
+    }
+    keep_fastest(wave, ranks, ranked, tls_keep, start, PROBE_STAGE_TLS, callback, user_data);
+
+    /* Stage 3: batched in-tunnel TTFB for the survivors only */
+    int m = 0;
+    for (int i = 0; i < count; i++) {
+        if (!wave->advance[i]) continue;
+        wave->order[m] = i;
+        wave->inputs[m] = wave_configs[i];
+        m++;
+    }
+    *passed_tls += m;
+    if (m == 0) return 0;
+    memset(wave->scratch, 0, sizeof(ProbeResult) * (size_t)m);
+    int succeeded = probe_configs_batch(wave->inputs, m, wave->scratch, 0);
+    if (succeeded < 0) return -1;
+    for (int j = 0; j < m; j++) {
+        int i = wave->order[j];
+        ProbeResult merged = wave->scratch[j];
+        /* The proxied probe cannot see the direct timings; keep those of the earlier stages */
+        merged.dns_ms = wave->results[i].dns_ms;
+        merged.dns_cache_hit = wave->results[i].dns_cache_hit;
+        merged.tcp_connect_ms = wave->results[i].tcp_connect_ms;
+        if (merged.tls_handshake_ms == 0) merged.tls_handshake_ms = wave->results[i].tls_handshake_ms;
+        wave->results[i] = merged;
+        emit(&merged, start + i, PROBE_STAGE_TTFB, callback, user_data);
+    }
+    return succeeded;
+}
+
+/*
+ * Probes configs through the staged pipeline, delivering each record as its config leaves.
+ *
+ * A config leaves at the first stage it fails or is cut at; the record's stage field names
+ * that stage. Records of configs cut for being slow have success set, since they passed the
+ * stage, but carry only that stage's timings. Only records with stage PROBE_STAGE_TTFB have
+ * the in-tunnel timings and score of a full probe.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   tcp_keep (double): Fraction of the TCP survivors of each wave passed to stage 2;
+ *                      values outside (0, 1) keep all of them.
+ *   tls_keep (double): Fraction of the stage 2 survivors of each wave passed to stage 3, as
+ *                      for tcp_keep. Configs stage 2 cannot measure are not counted and always pass.
+ *   callback (ProbeRecordCallback): Receives every record; index gives its position in configs.
+ *   user_data (void*): Passed through to callback.
+ *
+ * Returns:
+ *   int: Number of configs that succeeded at stage 3, -1 on failure, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input or allocation failures. A failed stage stops the pipeline.
+ */
+EXPORT int v2root_probe_pipeline(const char** configs, int n, double tcp_keep, double tls_keep,
+                                 ProbeRecordCallback callback, void* user_data) {
+    if (!configs || n <= 0 || !callback) {
+        log_message("Invalid arguments to v2root_probe_pipeline", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    PipelineWave* wave = malloc(sizeof(PipelineWave));
+    if (!wave) {
+        log_message("Failed to allocate pipeline state", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+
+    int succeeded = 0, passed_tcp = 0, passed_tls = 0;
+    for (int start = 0; start < n; start += PIPELINE_WAVE_SIZE) {
+        int count = n - start < PIPELINE_WAVE_SIZE ? n - start : PIPELINE_WAVE_SIZE;
+        int rc = run_wave(wave, configs, start, count, tcp_keep, tls_keep, callback, user_data, &passed_tcp, &passed_tls);
+        if (rc < 0) {
+            log_message("Pipeline stage failed", __FILE__, __LINE__, 0, NULL);
+            free(wave);
+            return V2ROOT_ERROR;
+        }
+        succeeded += rc;
+        cache_record_results(configs + start, wave->results, count);
+    }
+    free(wave);
+
+    LOG_INFOF("Pipeline probe completed", "%d configs: %d passed TCP, %d passed TLS, %d succeeded",
+              n, passed_tcp, passed_tls, succeeded);
+    return succeeded;
+}
@@ -0,0 +1,38 @@
+#ifndef LIBV2ROOT_PIPELINE_H
+#define LIBV2ROOT_PIPELINE_H
+
+#include "libv2root_common.h"
+#include "libv2root_records.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Staged probe pipeline.
+ *
+ * Spawning V2Ray is the expensive part of a probe, so cheap direct checks run first and only
+ * their survivors reach it. Stage 1 is the parallel DNS + TCP connect of every config; stage
+ * 2 is a direct handshake with each surviving server, without V2Ray: the full VLESS or
+ * Shadowsocks handshake of probe_config_handshake_many where it applies, and a bare TLS/REALITY
+ * handshake with the server's SNI otherwise; stage 3 is the batched in-tunnel TTFB probe. Each stage passes on only the fastest fraction of
+ * the configs that passed it. Configs are fed through the stages in waves of
+ * PIPELINE_WAVE_SIZE, and every config's record is delivered as soon as it leaves the
+ * pipeline, with the stage it reached.
+ *
+ * Configs neither handshake applies to pass stage 2 unmeasured. On Windows the bare TLS
+ * fallback is not available, so only VLESS and Shadowsocks configs are measured there.
+ */
+
+#define PIPELINE_WAVE_SIZE MAX_BATCH_CONFIGS
+#define DEFAULT_PIPELINE_TCP_KEEP 0.5       /* Fraction of TCP survivors passed to stage 2 */
+#define DEFAULT_PIPELINE_TLS_KEEP 0.5       /* Fraction of TLS survivors passed to stage 3 */
+
+EXPORT int v2root_probe_pipeline(const char** configs, int n, double tcp_keep, double tls_keep,
+                                 ProbeRecordCallback callback, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_PIPELINE_H */
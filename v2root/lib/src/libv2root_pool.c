@@ -0,0 +1,725 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include "libv2root_win.h"
+typedef SOCKET pool_socket_t;
+#define CLOSE_SOCKET closesocket
+#define SHUT_WR SD_SEND
+#define SHUT_RDWR SD_BOTH
+#define poll WSAPoll
+#define SEND_FLAGS 0
+#define stop_v2ray_process win_stop_v2ray_process
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "libv2root_linux.h"
+typedef int pool_socket_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#define SEND_FLAGS MSG_NOSIGNAL
+#define stop_v2ray_process linux_stop_v2ray_process
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_pool.h"
+#include "libv2root_config.h"
+#include "libv2root_manage.h"
+#include "libv2root_metrics.h"
+#include "libv2root_ports.h"
+#include "libv2root_utils.h"
+
+#define POOL_RELAY_BUFFER 16384
+#define POOL_POLL_MS 100
+
+enum {
+    POOL_SLOT_FREE = 0,
+    POOL_SLOT_STARTING,
+    POOL_SLOT_STANDBY,
+    POOL_SLOT_ACTIVE,
+    POOL_SLOT_DRAINING,
+    POOL_SLOT_STOPPING
+};
+
+/* One V2Ray process listening on its slot's internal ports */
+typedef struct {
+    int state;
+    PID_TYPE pid;
+    int http_port;
+    int socks_port;
+    int connections;                /* Relayed connections currently open through this slot */
+    long long drain_deadline;
+    ConfigBuffer config;            /* Kept until the process exits; owns the Windows temp file */
+} PoolSlot;
+
+/* A relayed connection; the upstream is the slot's port of the same kind as the listener */
+typedef struct PoolRelay {
+    pool_socket_t client;
+    pool_socket_t upstream;
+    int slot;
+    struct PoolRelay* prev;         /* Links of pool_relays, guarded by pool_lock */
+    struct PoolRelay* next;
+} PoolRelay;
+
+/*
+ * pool_admin_lock serialises start, prepare, switch and stop, which may block on process start
+ * or exit. pool_lock guards the slot table and is only held briefly, so the accept loop never
+ * waits behind a process operation.
+ */
+static pthread_mutex_t pool_admin_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static PoolSlot pool_slots[POOL_SLOTS];
+static int pool_active = -1;
+static int pool_standby = -1;
+static volatile int pool_running;
+static pool_socket_t pool_listeners[2] = { INVALID_SOCKET, INVALID_SOCKET };
+static pthread_t pool_accept_thread;
+static pthread_t pool_reaper_thread;
+static int pool_leased_port;            /* First internal port leased by v2root_pool_start, 0 if none */
+static PoolRelay* pool_relays;          /* Live relay threads, guarded by pool_lock */
+static pthread_cond_t pool_relays_done = PTHREAD_COND_INITIALIZER;
+
+static void pool_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)ms * 1000);
+#endif
+}
+
+/*
+ * Records the pool's V2Ray process IDs, one per line, active first.
+ *
+ * Called with pool_lock held. Like the service PID file, this lets an operator find processes
+ * left behind by a crashed host; the file is removed when the pool stops.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   None
+ */
+static void write_pool_pid_file(void) {
+    FILE* fp = fopen(POOL_PID_FILE, "w");
+    if (!fp) {
+        log_message("Failed to write pool PID file", __FILE__, __LINE__, errno, POOL_PID_FILE);
+        return;
+    }
+    if (pool_active >= 0) fprintf(fp, "%lu\n", (unsigned long)pool_slots[pool_active].pid);
+    for (int i = 0; i < POOL_SLOTS; i++) {
+        if (i != pool_active && pool_slots[i].state != POOL_SLOT_FREE && pool_slots[i].pid > 0) {
+            fprintf(fp, "%lu\n", (unsigned long)pool_slots[i].pid);
+        }
+    }
+    fclose(fp);
+}
+
+static void remove_pool_pid_file(void) {
+    if (remove(POOL_PID_FILE) != 0 && errno != ENOENT) {
+        log_message("Failed to remove pool PID file", __FILE__, __LINE__, errno, POOL_PID_FILE);
+    }
+}
+
+/*
+ * Stops a slot's process and returns the slot to the free list.
+ *
+ * The caller must already have moved the slot out of the active, standby and draining states
+ * so that neither the relay nor the reaper touches it while the process exits.
+ *
+ * Parameters:
+ *   index (int): The slot to release.
+ *
+ * Returns:
+ *   None
+ */
+static void release_slot(int index) {
+    PoolSlot* slot = &pool_slots[index];
+    if (slot->pid > 0) {
+        LOG_INFOF("Stopping pooled V2Ray process", "PID: %lu", (unsigned long)slot->pid);
+        stop_v2ray_process(slot->pid);
+    }
+    config_buffer_free(&slot->config);
+    pthread_mutex_lock(&pool_lock);
+    slot->pid = 0;
+    slot->state = POOL_SLOT_FREE;
+    if (pool_running) write_pool_pid_file();
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/*
+ * Starts a V2Ray process for config_str on a free slot and waits until its inbound accepts.
+ *
+ * Called with pool_admin_lock held. Waits for a draining slot to be reaped if none is free.
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *
+ * Returns:
+ *   int: The slot index on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for render, start, or readiness failures.
+ */
+static int spawn_slot(const char* config_str) {
+    int index = -1;
+    long long deadline = get_monotonic_ms() + POOL_DRAIN_MS + DEFAULT_READY_TIMEOUT_MS;
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        for (int i = 0; i < POOL_SLOTS && index < 0; i++) {
+            if (pool_slots[i].state == POOL_SLOT_FREE) index = i;
+        }
+        if (index >= 0) pool_slots[index].state = POOL_SLOT_STARTING;
+        pthread_mutex_unlock(&pool_lock);
+        if (index >= 0) break;
+        if (get_monotonic_ms() >= deadline) {
+            log_message("No free pool slot", __FILE__, __LINE__, 0, NULL);
+            return -1;
+        }
+        pool_sleep_ms(POOL_POLL_MS);
+    }
+
+    PoolSlot* slot = &pool_slots[index];
+    if (render_config_buffer(config_str, slot->http_port, slot->socks_port, &slot->config) != 0) {
+        log_message("Failed to render pooled config", __FILE__, __LINE__, 0, NULL);
+        release_slot(index);
+        return -1;
+    }
+    PID_TYPE pid = 0;
+    if (start_v2ray_from_buffer(&slot->config, &pid) != 0) {
+        log_message("Failed to start pooled V2Ray process", __FILE__, __LINE__, 0, NULL);
+        release_slot(index);
+        return -1;
+    }
+    pthread_mutex_lock(&pool_lock);
+    slot->pid = pid;
+    pthread_mutex_unlock(&pool_lock);
+    if (wait_for_v2ray_ready(pid, slot->http_port) != 0) {
+        log_message("Pooled V2Ray process did not become ready", __FILE__, __LINE__, 0, NULL);
+        release_slot(index);
+        return -1;
+    }
+    LOG_INFOF("Pooled V2Ray process ready", "PID: %lu, HTTP Port: %d, SOCKS Port: %d",
+              (unsigned long)pid, slot->http_port, slot->socks_port);
+    return index;
+}
+
+/* Keeps relay sockets out of the V2Ray processes started later, which would hold them open */
+static pool_socket_t no_inherit(pool_socket_t fd) {
+    if (fd == INVALID_SOCKET) return fd;
+#ifdef _WIN32
+    SetHandleInformation((HANDLE)fd, HANDLE_FLAG_INHERIT, 0);
+#else
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    return fd;
+}
+
+static pool_socket_t open_listener(int port) {
+    pool_socket_t fd = no_inherit(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (fd == INVALID_SOCKET) {
+        log_message("Failed to create pool listener", __FILE__, __LINE__, errno, NULL);
+        return INVALID_SOCKET;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        char port_str[16];
+        snprintf(port_str, sizeof(port_str), "%d", port);
+        log_message("Failed to listen on pool port", __FILE__, __LINE__, errno, port_str);
+        CLOSE_SOCKET(fd);
+        return INVALID_SOCKET;
+    }
+    return fd;
+}
+
+static pool_socket_t connect_upstream(int port) {
+    pool_socket_t fd = no_inherit(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (fd == INVALID_SOCKET) return INVALID_SOCKET;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        CLOSE_SOCKET(fd);
+        return INVALID_SOCKET;
+    }
+    return fd;
+}
+
+/*
+ * Relay thread: copies bytes both ways until both directions are closed.
+ *
+ * A close from one side is passed on as a half-close so request/response protocols that shut
+ * down their write side still receive the reply.
+ *
+ * Parameters:
+ *   arg (void*): A heap-allocated PoolRelay, freed here.
+ *
+ * Returns:
+ *   void*: Always NULL.
+ */
+static void* relay_thread(void* arg) {
+    PoolRelay* relay = (PoolRelay*)arg;
+    pool_socket_t fds[2] = { relay->client, relay->upstream };
+    int open[2] = { 1, 1 };
+    char* buffer = malloc(POOL_RELAY_BUFFER);
+    while (buffer && (open[0] || open[1])) {
+        struct pollfd pfd[2];
+        int map[2], n = 0;
+        for (int i = 0; i < 2; i++) {
+            if (!open[i]) continue;
+            pfd[n].fd = fds[i];
+            pfd[n].events = POLLIN;
+            pfd[n].revents = 0;
+            map[n++] = i;
+        }
+        if (poll(pfd, (unsigned)n, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int failed = 0;
+        for (int k = 0; k < n && !failed; k++) {
+            if (!(pfd[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            int from = map[k], to = 1 - from;
+            int got = (int)recv(fds[from], buffer, POOL_RELAY_BUFFER, 0);
+            if (got <= 0) {
+                if (got < 0) failed = 1;
+                open[from] = 0;
+                shutdown(fds[to], SHUT_WR);
+                continue;
+            }
+            for (int sent = 0; sent < got && !failed;) {
+                int w = (int)send(fds[to], buffer + sent, got - sent, SEND_FLAGS);
+                if (w <= 0) failed = 1;
+                else sent += w;
+            }
+        }
+        if (failed) break;
+    }
+    free(buffer);
+    /* Unlinked before the sockets close, so shutdown_relays never touches a closed socket */
+    pthread_mutex_lock(&pool_lock);
+    if (relay->prev) relay->prev->next = relay->next;
+    else pool_relays = relay->next;
+    if (relay->next) relay->next->prev = relay->prev;
+    pool_slots[relay->slot].connections--;
+    if (!pool_relays) pthread_cond_broadcast(&pool_relays_done);
+    pthread_mutex_unlock(&pool_lock);
+    CLOSE_SOCKET(relay->client);
+    CLOSE_SOCKET(relay->upstream);
+    free(relay);
+    return NULL;
+}
+
+/*
+ * Hands an accepted client to a relay thread bound to the active slot.
+ *
+ * Parameters:
+ *   client (pool_socket_t): The accepted connection; closed here on failure.
+ *   socks (int): 1 for the SOCKS listener, 0 for HTTP.
+ *
+ * Returns:
+ *   None
+ */
+static void relay_client(pool_socket_t client, int socks) {
+    pthread_mutex_lock(&pool_lock);
+    int index = pool_active;
+    int port = 0;
+    if (index >= 0) {
+        port = socks ? pool_slots[index].socks_port : pool_slots[index].http_port;
+        pool_slots[index].connections++;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    if (index < 0) {
+        CLOSE_SOCKET(client);
+        return;
+    }
+
+    PoolRelay* relay = malloc(sizeof(PoolRelay));
+    pool_socket_t upstream = connect_upstream(port);
+    pthread_t thread;
+    if (relay && upstream != INVALID_SOCKET) {
+        int on = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        setsockopt(upstream, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        relay->client = client;
+        relay->upstream = upstream;
+        relay->slot = index;
+        relay->prev = NULL;
+        pthread_mutex_lock(&pool_lock);
+        relay->next = pool_relays;
+        if (pool_relays) pool_relays->prev = relay;
+        pool_relays = relay;
+        pthread_mutex_unlock(&pool_lock);
+        if (pthread_create(&thread, NULL, relay_thread, relay) == 0) {
+            pthread_detach(thread);
+            return;
+        }
+        pthread_mutex_lock(&pool_lock);
+        pool_relays = relay->next;
+        if (pool_relays) pool_relays->prev = NULL;
+        pthread_mutex_unlock(&pool_lock);
+    }
+    log_message("Failed to relay pool connection", __FILE__, __LINE__, errno, NULL);
+    free(relay);
+    if (upstream != INVALID_SOCKET) CLOSE_SOCKET(upstream);
+    CLOSE_SOCKET(client);
+    pthread_mutex_lock(&pool_lock);
+    pool_slots[index].connections--;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+static void* accept_thread(void* arg) {
+    (void)arg;
+    while (pool_running) {
+        struct pollfd pfd[2];
+        for (int i = 0; i < 2; i++) {
+            pfd[i].fd = pool_listeners[i];
+            pfd[i].events = POLLIN;
+            pfd[i].revents = 0;
+        }
+        if (poll(pfd, 2, POOL_POLL_MS) <= 0) continue;
+        for (int i = 0; i < 2; i++) {
+            if (!(pfd[i].revents & POLLIN)) continue;
+            pool_socket_t client = no_inherit(accept(pool_listeners[i], NULL, NULL));
+            if (client != INVALID_SOCKET) relay_client(client, i);
+        }
+    }
+    return NULL;
+}
+
+/* Stops draining processes once their last connection closes or POOL_DRAIN_MS has passed */
+static void* reaper_thread(void* arg) {
+    (void)arg;
+    while (pool_running) {
+        pool_sleep_ms(POOL_POLL_MS);
+        int index = -1;
+        long long now = get_monotonic_ms();
+        pthread_mutex_lock(&pool_lock);
+        for (int i = 0; i < POOL_SLOTS && index < 0; i++) {
+            PoolSlot* slot = &pool_slots[i];
+            if (slot->state == POOL_SLOT_DRAINING && (slot->connections <= 0 || now >= slot->drain_deadline)) {
+                slot->state = POOL_SLOT_STOPPING;
+                index = i;
+            }
+        }
+        pthread_mutex_unlock(&pool_lock);
+        if (index >= 0) release_slot(index);
+    }
+    return NULL;
+}
+
+/*
+ * Ends every relayed connection and waits for the relay threads to exit.
+ *
+ * Called after the accept thread has exited, so no new relay can start. Shutting both
+ * sockets of a relay down wakes its poll; the thread then unlinks itself and releases its
+ * slot's connection count, which must happen before the slots are reused by a later start.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   None
+ */
+static void shutdown_relays(void) {
+    pthread_mutex_lock(&pool_lock);
+    for (PoolRelay* relay = pool_relays; relay; relay = relay->next) {
+        shutdown(relay->client, SHUT_RDWR);
+        shutdown(relay->upstream, SHUT_RDWR);
+    }
+    while (pool_relays) pthread_cond_wait(&pool_relays_done, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/*
+ * Closes the listeners and stops every pooled process once the pool threads have exited.
+ *
+ * Called with pool_admin_lock held and pool_running cleared.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   None
+ */
+static void shutdown_pool(void) {
+    for (int i = 0; i < 2; i++) {
+        CLOSE_SOCKET(pool_listeners[i]);
+        pool_listeners[i] = INVALID_SOCKET;
+    }
+    shutdown_relays();
+    pthread_mutex_lock(&pool_lock);
+    pool_active = -1;
+    pool_standby = -1;
+    for (int i = 0; i < POOL_SLOTS; i++) {
+        if (pool_slots[i].state != POOL_SLOT_FREE) pool_slots[i].state = POOL_SLOT_STOPPING;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    for (int i = 0; i < POOL_SLOTS; i++) {
+        if (pool_slots[i].state == POOL_SLOT_STOPPING) release_slot(i);
+    }
+    remove_pool_pid_file();
+    port_release(pool_leased_port, 2 * POOL_SLOTS);
+    pool_leased_port = 0;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+/*
+ * Starts the pool with an active V2Ray process for config_str.
+ *
+ * The relay listens on 127.0.0.1 at http_port and socks_port. Slot i of the pool uses the
+ * internal ports base_port + 2 * i (HTTP) and base_port + 2 * i + 1 (SOCKS).
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *   http_port (int): User-facing HTTP proxy port (defaults to 2300 if <= 0).
+ *   socks_port (int): User-facing SOCKS proxy port (defaults to 2301 if <= 0).
+ *   base_port (int): First internal port (leased from the port allocator if <= 0).
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure, -2 for invalid input, -7 if the pool is already running.
+ *
+ * Errors:
+ *   Logs errors for listener, render, start, or readiness failures.
+ */
+EXPORT int v2root_pool_start(const char* config_str, int http_port, int socks_port, int base_port) {
+    if (!config_str || config_str[0] == '\0') {
+        log_message("Null or empty config string for pool", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    if (http_port <= 0) http_port = DEFAULT_HTTP_PORT;
+    if (socks_port <= 0) socks_port = DEFAULT_SOCKS_PORT;
+    if (base_port + 2 * POOL_SLOTS > 65535) {
+        log_message("Pool base port out of range", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+
+    pthread_mutex_lock(&pool_admin_lock);
+    if (pool_running) {
+        pthread_mutex_unlock(&pool_admin_lock);
+        log_message("Pool already running", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_ALREADY_RUNNING;
+    }
+    if (base_port <= 0) {
+        base_port = port_lease(2 * POOL_SLOTS);
+        if (base_port < 0) {
+            pthread_mutex_unlock(&pool_admin_lock);
+            log_message("No free internal ports for pool", __FILE__, __LINE__, 0, NULL);
+            return V2ROOT_ERROR;
+        }
+        pool_leased_port = base_port;
+    }
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        port_release(pool_leased_port, 2 * POOL_SLOTS);
+        pool_leased_port = 0;
+        pthread_mutex_unlock(&pool_admin_lock);
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        return V2ROOT_ERROR;
+    }
+#endif
+    for (int i = 0; i < POOL_SLOTS; i++) {
+        memset(&pool_slots[i], 0, sizeof(PoolSlot));
+        pool_slots[i].http_port = base_port + 2 * i;
+        pool_slots[i].socks_port = base_port + 2 * i + 1;
+    }
+    pool_active = -1;
+    pool_standby = -1;
+
+    pool_listeners[0] = open_listener(http_port);
+    pool_listeners[1] = open_listener(socks_port);
+    int index = -1;
+    if (pool_listeners[0] != INVALID_SOCKET && pool_listeners[1] != INVALID_SOCKET) {
+        index = spawn_slot(config_str);
+    }
+    if (index < 0) {
+        for (int i = 0; i < 2; i++) {
+            if (pool_listeners[i] != INVALID_SOCKET) CLOSE_SOCKET(pool_listeners[i]);
+            pool_listeners[i] = INVALID_SOCKET;
+        }
+        port_release(pool_leased_port, 2 * POOL_SLOTS);
+        pool_leased_port = 0;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        pthread_mutex_unlock(&pool_admin_lock);
+        return V2ROOT_ERROR;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    pool_slots[index].state = POOL_SLOT_ACTIVE;
+    pool_active = index;
+    pool_running = 1;
+    write_pool_pid_file();
+    pthread_mutex_unlock(&pool_lock);
+    int have_accept = pthread_create(&pool_accept_thread, NULL, accept_thread, NULL) == 0;
+    int have_reaper = have_accept && pthread_create(&pool_reaper_thread, NULL, reaper_thread, NULL) == 0;
+    if (!have_reaper) {
+        log_message("Failed to start pool threads", __FILE__, __LINE__, errno, NULL);
+        pool_running = 0;
+        if (have_accept) pthread_join(pool_accept_thread, NULL);
+        shutdown_pool();
+        pthread_mutex_unlock(&pool_admin_lock);
+        return V2ROOT_ERROR;
+    }
+    pthread_mutex_unlock(&pool_admin_lock);
+    LOG_INFOF("V2Ray pool started", "HTTP Port: %d, SOCKS Port: %d, PID: %lu",
+              http_port, socks_port, (unsigned long)pool_slots[index].pid);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Starts a standby process for the next candidate config, replacing any existing standby.
+ *
+ * Returns once the standby accepts connections, so a following v2root_pool_switch takes
+ * effect immediately.
+ *
+ * Parameters:
+ *   config_str (const char*): The VLESS, VMess, or Shadowsocks configuration string.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure or if the pool is not running, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for render, start, or readiness failures.
+ */
+EXPORT int v2root_pool_prepare(const char* config_str) {
+    if (!config_str || config_str[0] == '\0') {
+        log_message("Null or empty config string for pool standby", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    pthread_mutex_lock(&pool_admin_lock);
+    if (!pool_running) {
+        pthread_mutex_unlock(&pool_admin_lock);
+        log_message("Pool not running", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    pthread_mutex_lock(&pool_lock);
+    int old = pool_standby;
+    if (old >= 0) pool_slots[old].state = POOL_SLOT_STOPPING;
+    pool_standby = -1;
+    pthread_mutex_unlock(&pool_lock);
+    if (old >= 0) release_slot(old);
+
+    int index = spawn_slot(config_str);
+    if (index >= 0) {
+        pthread_mutex_lock(&pool_lock);
+        pool_slots[index].state = POOL_SLOT_STANDBY;
+        pool_standby = index;
+        write_pool_pid_file();
+        pthread_mutex_unlock(&pool_lock);
+    }
+    pthread_mutex_unlock(&pool_admin_lock);
+    return index >= 0 ? V2ROOT_SUCCESS : V2ROOT_ERROR;
+}
+
+/*
+ * Makes the standby process active.
+ *
+ * New connections are relayed to the standby from this point on. The previous active process
+ * keeps serving the connections it already has until they close or POOL_DRAIN_MS passes.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the pool is not running or has no standby.
+ *
+ * Errors:
+ *   Logs an error if there is nothing to switch to.
+ */
+EXPORT int v2root_pool_switch(void) {
+    pthread_mutex_lock(&pool_admin_lock);
+    pthread_mutex_lock(&pool_lock);
+    int next = pool_running ? pool_standby : -1;
+    int old = pool_active;
+    unsigned long active_pid = 0;
+    unsigned long draining_pid = 0;
+    if (next >= 0) {
+        active_pid = (unsigned long)pool_slots[next].pid;
+        draining_pid = (unsigned long)pool_slots[old].pid;
+        pool_slots[next].state = POOL_SLOT_ACTIVE;
+        pool_active = next;
+        pool_standby = -1;
+        pool_slots[old].state = POOL_SLOT_DRAINING;
+        pool_slots[old].drain_deadline = get_monotonic_ms() + POOL_DRAIN_MS;
+        write_pool_pid_file();
+    }
+    pthread_mutex_unlock(&pool_lock);
+    pthread_mutex_unlock(&pool_admin_lock);
+    if (next < 0) {
+        log_message("No standby process to switch to", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    metrics_count(METRIC_PROCESS_RESTARTS, 1);
+    LOG_INFOF("Switched pool to standby", "Active PID: %lu, draining PID: %lu", active_pid, draining_pid);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Stops the relay and every pooled V2Ray process.
+ *
+ * Connections still open through the pool are closed, and their relay threads have exited
+ * when this returns.
+ *
+ * Parameters:
+ *   None
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the pool is not running.
+ */
+EXPORT int v2root_pool_stop(void) {
+    pthread_mutex_lock(&pool_admin_lock);
+    if (!pool_running) {
+        pthread_mutex_unlock(&pool_admin_lock);
+        log_message("Pool not running", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    pool_running = 0;
+    pthread_join(pool_accept_thread, NULL);
+    pthread_join(pool_reaper_thread, NULL);
+    shutdown_pool();
+    pthread_mutex_unlock(&pool_admin_lock);
+    LOG_INFO("V2Ray pool stopped", NULL);
+    return V2ROOT_SUCCESS;
+}
+
+/*
+ * Reports the pool's active and standby process IDs.
+ *
+ * Parameters:
+ *   active_pid (PID_TYPE*): Receives the active PID, or 0; may be NULL.
+ *   standby_pid (PID_TYPE*): Receives the standby PID, or 0 if none is ready; may be NULL.
+ *
+ * Returns:
+ *   int: 1 if the pool is running, 0 otherwise.
+ */
+EXPORT int v2root_pool_status(PID_TYPE* active_pid, PID_TYPE* standby_pid) {
+    pthread_mutex_lock(&pool_lock);
+    int running = pool_running;
+    if (active_pid) *active_pid = pool_active >= 0 ? pool_slots[pool_active].pid : 0;
+    if (standby_pid) *standby_pid = pool_standby >= 0 ? pool_slots[pool_standby].pid : 0;
+    pthread_mutex_unlock(&pool_lock);
+    return running;
+}
@@ -0,0 +1,33 @@
+#ifndef LIBV2ROOT_POOL_H
+#define LIBV2ROOT_POOL_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Warm process pool for node switching.
+ *
+ * The pool owns the user-facing HTTP and SOCKS ports and relays every accepted connection to
+ * the active V2Ray process, which listens on internal loopback ports. A standby process with
+ * the next candidate config is started and checked for readiness ahead of time; switching only
+ * retargets the relay, so new connections move over at once and connections already open on the
+ * previous process are allowed to finish before it is stopped.
+ */
+
+#define POOL_SLOTS 3                    /* Active, standby and one draining process */
+#define POOL_PID_FILE "v2root_pool.pid"
+
+EXPORT int v2root_pool_start(const char* config_str, int http_port, int socks_port, int base_port);
+EXPORT int v2root_pool_prepare(const char* config_str);
+EXPORT int v2root_pool_switch(void);
+EXPORT int v2root_pool_stop(void);
+EXPORT int v2root_pool_status(PID_TYPE* active_pid, PID_TYPE* standby_pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_POOL_H */
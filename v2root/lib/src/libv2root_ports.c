@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET port_socket_t;
+#define CLOSE_SOCKET closesocket
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+typedef int port_socket_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_ports.h"
+#include "libv2root_utils.h"
+
+static pthread_mutex_t ports_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char ports_leased[65536 / 8];
+static int ports_first = DEFAULT_PORT_RANGE_FIRST;
+static int ports_last = DEFAULT_PORT_RANGE_LAST;
+static int ports_cursor = DEFAULT_PORT_RANGE_FIRST;
+static int ports_leased_count = 0;
+
+static int is_leased(int port) {
+    return (ports_leased[port >> 3] >> (port & 7)) & 1;
+}
+
+static void set_leased(int port, int leased) {
+    if (leased) ports_leased[port >> 3] |= (unsigned char)(1 << (port & 7));
+    else ports_leased[port >> 3] &= (unsigned char)~(1 << (port & 7));
+}
+
+/*
+ * Checks that nothing is bound to 127.0.0.1:port with the given socket type.
+ *
+ * SO_REUSEADDR is deliberately not set, so ports with lingering TIME_WAIT connections are
+ * reported as busy as well and are not handed to a V2Ray inbound that would fail to bind.
+ */
+static int can_bind(int port, int type) {
+    port_socket_t fd = socket(AF_INET, type, 0);
+    if (fd == INVALID_SOCKET) return 0;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int ok = bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    CLOSE_SOCKET(fd);
+    return ok;
+}
+
+/* SOCKS inbounds also listen for UDP, so every port must be free for both */
+static int port_is_free(int port) {
+    return can_bind(port, SOCK_STREAM) && can_bind(port, SOCK_DGRAM);
+}
+
+/*
+ * Leases count contiguous loopback ports from the configured range.
+ *
+ * The search starts after the most recently leased run and wraps once around the range, so a
+ * port that was just released rests for a full cycle before it is reused. Ports are marked
+ * leased before the lock is dropped.
+ *
+ * Parameters:
+ *   count (int): Number of contiguous ports (1..PORT_LEASE_MAX).
+ *
+ * Returns:
+ *   int: The first leased port, or -1 if the range holds no free run of that length.
+ *
+ * Errors:
+ *   Logs errors for an invalid count or an exhausted range.
+ */
+int port_lease(int count) {
+    if (count <= 0 || count > PORT_LEASE_MAX) {
+        log_message("Invalid port lease size", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        return -1;
+    }
+#endif
+    pthread_mutex_lock(&ports_lock);
+    int span = ports_last - ports_first + 1;
+    int first = -1;
+    int start = ports_cursor;
+    int scanned = 0;
+    while (count <= span && scanned < span) {
+        if (start + count - 1 > ports_last) {
+            scanned += ports_last - start + 1;
+            start = ports_first;
+            continue;
+        }
+        int busy = -1;
+        for (int port = start; port < start + count && busy < 0; port++) {
+            if (is_leased(port) || !port_is_free(port)) busy = port;
+        }
+        if (busy < 0) {
+            first = start;
+            break;
+        }
+        scanned += busy - start + 1;
+        start = busy + 1 > ports_last ? ports_first : busy + 1;
+    }
+    if (first >= 0) {
+        for (int port = first; port < first + count; port++) set_leased(port, 1);
+        ports_leased_count += count;
+        ports_cursor = first + count > ports_last ? ports_first : first + count;
+    }
+    pthread_mutex_unlock(&ports_lock);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    if (first < 0) {
+        LOG_WARNINGF("Port range exhausted", "No %d free ports in %d-%d", count, ports_first, ports_last);
+        return -1;
+    }
+    LOG_DEBUGF("Ports leased", "Ports %d-%d", first, first + count - 1);
+    return first;
+}
+
+/* Releases a lease taken with port_lease; ports outside any lease are ignored */
+void port_release(int first_port, int count) {
+    if (first_port <= 0 || count <= 0 || first_port + count - 1 > 65535) return;
+    pthread_mutex_lock(&ports_lock);
+    for (int port = first_port; port < first_port + count; port++) {
+        if (!is_leased(port)) continue;
+        set_leased(port, 0);
+        ports_leased_count--;
+    }
+    pthread_mutex_unlock(&ports_lock);
+}
+
+/*
+ * Sets the loopback port range the allocator leases from.
+ *
+ * Existing leases stay valid and are released normally even if they fall outside the new
+ * range.
+ *
+ * Parameters:
+ *   first_port (int): Lowest port of the range (1024..65535).
+ *   last_port (int): Highest port of the range (first_port..65535).
+ *
+ * Returns:
+ *   int: 0 on success, -2 for an invalid range.
+ *
+ * Errors:
+ *   Logs an error for an invalid range.
+ */
+EXPORT int v2root_ports_set_range(int first_port, int last_port) {
+    if (first_port < 1024 || last_port > 65535 || last_port < first_port) {
+        log_message("Invalid port range", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    pthread_mutex_lock(&ports_lock);
+    ports_first = first_port;
+    ports_last = last_port;
+    ports_cursor = first_port;
+    pthread_mutex_unlock(&ports_lock);
+    LOG_INFOF("Port range set", "Ports %d-%d", first_port, last_port);
+    return V2ROOT_SUCCESS;
+}
+
+/* Returns the number of ports currently leased */
+EXPORT int v2root_ports_leased(void) {
+    pthread_mutex_lock(&ports_lock);
+    int leased = ports_leased_count;
+    pthread_mutex_unlock(&ports_lock);
+    return leased;
+}
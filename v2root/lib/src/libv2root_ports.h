@@ -0,0 +1,36 @@
+#ifndef LIBV2ROOT_PORTS_H
+#define LIBV2ROOT_PORTS_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Loopback port allocator.
+ *
+ * Temporary V2Ray instances (connection tests, batch probes, pooled processes) lease their
+ * inbound ports here instead of using fixed defaults, so overlapping tests and a running proxy
+ * never share a port. A lease is recorded under the allocator lock before it is handed out, so
+ * two callers in this process can never receive the same port; candidate ports are also
+ * bind-checked for TCP and UDP to skip ports held by other processes. Leases go back to the
+ * pool with port_release once the instance has exited.
+ */
+
+#define PORT_LEASE_MAX 512          /* Largest contiguous run one lease may request */
+
+EXPORT int v2root_ports_set_range(int first_port, int last_port);
+EXPORT int v2root_ports_leased(void);
+
+/* Leases count contiguous free loopback ports; returns the first port, or -1 if none are free */
+int port_lease(int count);
+
+/* Returns ports first_port .. first_port + count - 1 to the allocator */
+void port_release(int first_port, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_PORTS_H */
@@ -0,0 +1,576 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET probe_socket_t;
+#define CLOSE_SOCKET closesocket
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+typedef int probe_socket_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_probe.h"
+#include "libv2root_manage.h"
+#include "libv2root_metrics.h"
+#include "libv2root_deadline.h"
+#include "libv2root_dns.h"
+#include "libv2root_subscription.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_utils.h"
+
+/* Hostnames are at most 253 characters; keeps the per-target state small for large lists */
+#define QUICK_ADDRESS_LENGTH 256
+
+typedef struct {
+    char address[QUICK_ADDRESS_LENGTH];
+    char port[16];
+    struct addrinfo* res;
+    int ready;                      /* Endpoint extracted and, after resolution, resolved */
+    int leader;                     /* Target probed on this one's behalf, or -1 */
+} QuickTarget;
+
+/* Shared cursor for the resolver pool */
+typedef struct {
+    QuickTarget* targets;
+    ProbeResult* out;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+} ResolveWork;
+
+/* An in-flight non-blocking connect */
+typedef struct {
+    probe_socket_t fd;
+    int index;
+    long long start;
+} ConnectSlot;
+
+/*
+ * Marks a quick probe result as failed.
+ *
+ * Parameters:
+ *   result (ProbeResult*): The result slot to update.
+ *   error_type (const char*): One of the PROBE_ERROR_* classifications.
+ *   details (const char*): Human-readable failure description.
+ *
+ * Returns:
+ *   None
+ */
+static void quick_fail(ProbeResult* result, const char* error_type, const char* details) {
+    result->success = 0;
+    strncpy(result->error_type, error_type, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    size_t n = strlen(details);
+    if (n >= sizeof(result->error_details)) n = sizeof(result->error_details) - 1;
+    memcpy(result->error_details, details, n);
+    result->error_details[n] = '\0';
+}
+
+/*
+ * Resolver thread: resolves targets until the shared cursor is exhausted.
+ *
+ * getaddrinfo has no non-blocking form, so resolution runs in a bounded pool ahead of the
+ * connect loop. Lookups go through the shared DNS cache, which also coalesces concurrent
+ * queries for the same name; dns_ms is measured per target as in probe_config_quick.
+ *
+ * Parameters:
+ *   arg (void*): Pointer to the shared ResolveWork.
+ *
+ * Returns:
+ *   void*: Always NULL.
+ */
+static void* resolve_worker(void* arg) {
+    ResolveWork* work = (ResolveWork*)arg;
+    for (;;) {
+        pthread_mutex_lock(&work->lock);
+        int i = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (i >= work->count) break;
+        QuickTarget* target = &work->targets[i];
+        if (!target->ready) continue;
+
+        ProbeResult* result = &work->out[i];
+        long long start = get_monotonic_ms();
+        int rc = dns_cache_getaddrinfo(target->address, target->port, &target->res, &result->dns_cache_hit);
+        result->dns_ms = (int)(get_monotonic_ms() - start);
+        if (rc != 0) {
+            char details[512];
+            snprintf(details, sizeof(details), "DNS resolution failed for %s", target->address);
+            quick_fail(result, PROBE_ERROR_DNS, details);
+            target->res = NULL;
+            target->ready = 0;
+            continue;
+        }
+        if (result->dns_ms < 1) result->dns_ms = 1;
+    }
+    return NULL;
+}
+
+/*
+ * Resolves all extracted targets with up to MAX_CONCURRENT_PROBES resolver threads.
+ *
+ * Parameters:
+ *   targets (QuickTarget*): Targets to resolve; failures clear their ready flag.
+ *   out (ProbeResult*): Result slots receiving dns_ms and DNS errors.
+ *   n (int): Number of targets.
+ *
+ * Returns:
+ *   None
+ */
+static void resolve_targets(QuickTarget* targets, ProbeResult* out, int n) {
+    ResolveWork work;
+    work.targets = targets;
+    work.out = out;
+    work.count = n;
+    work.next = 0;
+    pthread_mutex_init(&work.lock, NULL);
+
+    int nthreads = n < MAX_CONCURRENT_PROBES ? n : MAX_CONCURRENT_PROBES;
+    pthread_t threads[MAX_CONCURRENT_PROBES];
+    int started = 0;
+    for (int t = 0; t < nthreads; t++) {
+        if (pthread_create(&threads[t], NULL, resolve_worker, &work) != 0) {
+            log_message("Failed to create resolver thread", __FILE__, __LINE__, errno, NULL);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        resolve_worker(&work);
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    pthread_mutex_destroy(&work.lock);
+}
+
+/*
+ * Records the outcome of a connect attempt and closes its socket.
+ *
+ * Parameters:
+ *   target (QuickTarget*): The probed target.
+ *   result (ProbeResult*): The result slot to fill.
+ *   slot (ConnectSlot*): The in-flight connect.
+ *   ok (int): Non-zero if the connection was established.
+ *   reason (const char*): Failure description prefix, ignored on success.
+ *   deadline (ProbeDeadline*): Selection deadline fed with the connect time, or NULL.
+ *
+ * Returns:
+ *   None
+ */
+static void finish_connect(QuickTarget* target, ProbeResult* result, ConnectSlot* slot, int ok, const char* reason,
+                           ProbeDeadline* deadline) {
+    result->tcp_connect_ms = (int)(get_monotonic_ms() - slot->start);
+    CLOSE_SOCKET(slot->fd);
+    slot->fd = INVALID_SOCKET;
+    if (!ok) {
+        char details[512];
+        snprintf(details, sizeof(details), "%s to %s:%s", reason, target->address, target->port);
+        quick_fail(result, PROBE_ERROR_TCP, details);
+        return;
+    }
+    if (result->tcp_connect_ms < 1) result->tcp_connect_ms = 1;
+    result->success = 1;
+    result->total_ms = result->dns_ms + result->tcp_connect_ms;
+    result->score = calculate_probe_score(result->total_ms, result->tcp_connect_ms, 1);
+    if (deadline) deadline_observe(deadline, result->tcp_connect_ms);
+}
+
+/*
+ * Starts a non-blocking connect to the first resolved address of a target.
+ *
+ * Parameters:
+ *   target (QuickTarget*): The resolved target.
+ *   result (ProbeResult*): The result slot, filled if the connect completes or fails immediately.
+ *   slot (ConnectSlot*): Slot receiving the socket and start time.
+ *   index (int): Index of the target in the caller's arrays.
+ *   deadline (ProbeDeadline*): Selection deadline, or NULL.
+ *
+ * Returns:
+ *   int: 1 if the connect is in progress, 0 if it already finished.
+ */
+static int begin_connect(QuickTarget* target, ProbeResult* result, ConnectSlot* slot, int index, ProbeDeadline* deadline) {
+    struct addrinfo* res = target->res;
+    slot->index = index;
+    slot->start = get_monotonic_ms();
+    slot->fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (slot->fd == INVALID_SOCKET) {
+        quick_fail(result, PROBE_ERROR_TCP, "Failed to create socket");
+        return 0;
+    }
+#ifdef _WIN32
+    u_long nonblocking = 1;
+    ioctlsocket(slot->fd, FIONBIO, &nonblocking);
+    if (connect(slot->fd, res->ai_addr, (int)res->ai_addrlen) == 0) {
+        finish_connect(target, result, slot, 1, NULL, deadline);
+        return 0;
+    }
+    if (WSAGetLastError() != WSAEWOULDBLOCK) {
+        finish_connect(target, result, slot, 0, "TCP connect failed", deadline);
+        return 0;
+    }
+#else
+    fcntl(slot->fd, F_SETFL, fcntl(slot->fd, F_GETFL, 0) | O_NONBLOCK);
+    if (connect(slot->fd, res->ai_addr, res->ai_addrlen) == 0) {
+        finish_connect(target, result, slot, 1, NULL, deadline);
+        return 0;
+    }
+    if (errno != EINPROGRESS) {
+        finish_connect(target, result, slot, 0, "TCP connect failed", deadline);
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+/*
+ * Returns whether a completed non-blocking connect succeeded, via SO_ERROR.
+ */
+static int connect_succeeded(probe_socket_t fd) {
+    int err = 0;
+#ifdef _WIN32
+    int len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, (char*)&err, &len) != 0) return 0;
+#else
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) return 0;
+#endif
+    return err == 0;
+}
+
+/*
+ * Drives all connects through one event loop with at most MAX_CONCURRENT_PROBES in flight.
+ *
+ * Uses epoll on Linux and WSAPoll on Windows. Each connect is bounded by DEFAULT_TCP_TIMEOUT_MS,
+ * or by the deadline's current budget, so a dead node costs one timeout slot instead of
+ * serializing the whole list. Targets not started once a stop-mode deadline is done are
+ * marked skipped.
+ *
+ * Parameters:
+ *   targets (QuickTarget*): Resolved targets; only entries with ready set are probed.
+ *   out (ProbeResult*): Result slots to fill.
+ *   n (int): Number of targets.
+ *   deadline (ProbeDeadline*): Selection deadline fed with connect times, or NULL.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the event loop could not be created.
+ */
+static int connect_targets(QuickTarget* targets, ProbeResult* out, int n, ProbeDeadline* deadline) {
+    ConnectSlot slots[MAX_CONCURRENT_PROBES];
+    int in_use[MAX_CONCURRENT_PROBES] = {0};
+    int active = 0;
+    int next = 0;
+#ifdef _WIN32
+    WSAPOLLFD fds[MAX_CONCURRENT_PROBES];
+    int fd_slot[MAX_CONCURRENT_PROBES];
+#else
+    struct epoll_event events[MAX_CONCURRENT_PROBES];
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        log_message("Failed to create epoll instance", __FILE__, __LINE__, errno, NULL);
+        return -1;
+    }
+#endif
+
+    while ((next < n && !deadline_done(deadline)) || active > 0) {
+        /* Refill free slots */
+        while (active < MAX_CONCURRENT_PROBES && next < n && !deadline_done(deadline)) {
+            int i = next++;
+            if (!targets[i].ready) continue;
+            int s = 0;
+            while (in_use[s]) s++;
+            if (!begin_connect(&targets[i], &out[i], &slots[s], i, deadline)) continue;
+#ifndef _WIN32
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLOUT;
+            ev.data.u32 = (unsigned int)s;
+            if (epoll_ctl(ep, EPOLL_CTL_ADD, slots[s].fd, &ev) != 0) {
+                finish_connect(&targets[i], &out[i], &slots[s], 0, "Failed to register connect", deadline);
+                continue;
+            }
+#endif
+            in_use[s] = 1;
+            active++;
+        }
+        if (active == 0) continue;
+
+        int timeout = deadline_ms(deadline, DEFAULT_TCP_TIMEOUT_MS);
+        long long now = get_monotonic_ms();
+        long long earliest = now + timeout;
+        for (int s = 0; s < MAX_CONCURRENT_PROBES; s++) {
+            if (in_use[s] && slots[s].start + timeout < earliest) {
+                earliest = slots[s].start + timeout;
+            }
+        }
+        int wait_ms = earliest > now ? (int)(earliest - now) : 0;
+
+#ifdef _WIN32
+        int nfds = 0;
+        for (int s = 0; s < MAX_CONCURRENT_PROBES; s++) {
+            if (!in_use[s]) continue;
+            fds[nfds].fd = slots[s].fd;
+            fds[nfds].events = POLLWRNORM;
+            fds[nfds].revents = 0;
+            fd_slot[nfds++] = s;
+        }
+        int ready = WSAPoll(fds, (ULONG)nfds, wait_ms);
+        for (int k = 0; ready > 0 && k < nfds; k++) {
+            if (!fds[k].revents) continue;
+            int s = fd_slot[k];
+            int ok = !(fds[k].revents & (POLLERR | POLLHUP)) && connect_succeeded(slots[s].fd);
+            finish_connect(&targets[slots[s].index], &out[slots[s].index], &slots[s], ok, "TCP connect failed", deadline);
+            in_use[s] = 0;
+            active--;
+        }
+#else
+        int ready = epoll_wait(ep, events, MAX_CONCURRENT_PROBES, wait_ms);
+        for (int k = 0; k < ready; k++) {
+            int s = (int)events[k].data.u32;
+            int ok = connect_succeeded(slots[s].fd);
+            epoll_ctl(ep, EPOLL_CTL_DEL, slots[s].fd, NULL);
+            finish_connect(&targets[slots[s].index], &out[slots[s].index], &slots[s], ok, "TCP connect failed", deadline);
+            in_use[s] = 0;
+            active--;
+        }
+#endif
+
+        /* Expire connects that exceeded the timeout */
+        timeout = deadline_ms(deadline, DEFAULT_TCP_TIMEOUT_MS);
+        const char* reason = timeout < DEFAULT_TCP_TIMEOUT_MS ? "TCP connect exceeded the adaptive deadline" : "TCP connect timed out";
+        now = get_monotonic_ms();
+        for (int s = 0; s < MAX_CONCURRENT_PROBES; s++) {
+            if (!in_use[s] || now - slots[s].start < timeout) continue;
+#ifndef _WIN32
+            epoll_ctl(ep, EPOLL_CTL_DEL, slots[s].fd, NULL);
+#endif
+            finish_connect(&targets[slots[s].index], &out[slots[s].index], &slots[s], 0, reason, deadline);
+            in_use[s] = 0;
+            active--;
+        }
+    }
+    for (int i = next; i < n; i++) {
+        if (targets[i].ready) deadline_skip(&out[i]);
+    }
+
+#ifndef _WIN32
+    close(ep);
+#endif
+    return 0;
+}
+
+/*
+ * Resolves, connects and releases a prepared target list.
+ *
+ * Shared tail of probe_config_quick_many and probe_table_quick: targets with ready set have
+ * their endpoint filled in and out[i] initialised. Targets sharing an endpoint fingerprint are
+ * probed once and the result is copied to the others.
+ *
+ * Parameters:
+ *   targets (QuickTarget*): Prepared targets; freed by the caller.
+ *   out (ProbeResult*): Array of n results.
+ *   n (int): Number of targets.
+ *   deadline (ProbeDeadline*): Selection deadline, or NULL for fixed timeouts.
+ *
+ * Returns:
+ *   int: Number of reachable targets on success, -1 if Winsock could not be started.
+ */
+static int run_quick_targets(QuickTarget* targets, ProbeResult* out, int n, ProbeDeadline* deadline) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        return -1;
+    }
+#endif
+    int shared = 0;
+    FpIndex index;
+    int have_index = fp_index_init(&index, (size_t)n) == 0;
+    for (int i = 0; i < n; i++) {
+        targets[i].leader = -1;
+        if (!have_index || !targets[i].ready) continue;
+        uint64_t key = v2root_endpoint_fingerprint(targets[i].address, atoi(targets[i].port));
+        int leader = fp_index_insert(&index, key, i);
+        if (leader >= 0) {
+            targets[i].leader = leader;
+            targets[i].ready = 0;
+            shared++;
+        }
+    }
+    if (have_index) fp_index_free(&index);
+
+    resolve_targets(targets, out, n);
+    int rc = connect_targets(targets, out, n, deadline);
+
+    int succeeded = 0;
+    for (int i = 0; i < n; i++) {
+        if (targets[i].res) dns_cache_freeaddrinfo(targets[i].res);
+        if (rc != 0 && targets[i].ready && !out[i].success) {
+            quick_fail(&out[i], PROBE_ERROR_UNKNOWN, "Connect loop unavailable");
+        }
+    }
+    int probed = 0;
+    for (int i = 0; i < n; i++) {
+        /* Leaders always precede their followers and are never followers themselves */
+        if (targets[i].leader >= 0) {
+            out[i] = out[targets[i].leader];
+        } else {
+            if (strcmp(out[i].error_type, PROBE_ERROR_SKIPPED) != 0) probed++;
+            metrics_probe_results(&out[i], 1);
+        }
+        if (out[i].success) succeeded++;
+    }
+    metrics_probes_started(probed);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    LOG_DEBUGF("Concurrent quick probe completed", "Quick probe: %d/%d configs reachable, %d shared endpoints", succeeded, n, shared);
+    return succeeded;
+}
+
+/* Resets a result before a quick probe */
+static void quick_init(ProbeResult* result) {
+    memset(result, 0, sizeof(ProbeResult));
+    result->attempts = 1;
+    strncpy(result->error_type, PROBE_ERROR_NONE, sizeof(result->error_type) - 1);
+}
+
+/* Extracts the endpoints of configs and runs the quick probe over them */
+static int quick_many(const char** configs, int n, ProbeResult* out, ProbeDeadline* deadline) {
+    if (!configs || !out || n <= 0) {
+        log_message("Invalid arguments to probe_config_quick_many", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    QuickTarget* targets = calloc((size_t)n, sizeof(QuickTarget));
+    if (!targets) {
+        log_message("Failed to allocate quick probe targets", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        quick_init(&out[i]);
+        if (!configs[i] || extract_config_endpoint(configs[i], targets[i].address, sizeof(targets[i].address),
+                                                   targets[i].port, sizeof(targets[i].port)) != 0) {
+            quick_fail(&out[i], PROBE_ERROR_UNKNOWN, "Failed to extract address and port");
+            continue;
+        }
+        targets[i].ready = 1;
+    }
+
+    int succeeded = run_quick_targets(targets, out, n, deadline);
+    free(targets);
+    return succeeded;
+}
+
+/*
+ * Performs quick DNS + TCP probes for many configurations concurrently.
+ *
+ * Equivalent to calling probe_config_quick for every entry, but resolution runs in a bounded
+ * resolver pool and connects are multiplexed over a single non-blocking event loop, with at
+ * most MAX_CONCURRENT_PROBES operations in flight.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, filled in the same order as configs.
+ *
+ * Returns:
+ *   int: Number of reachable configurations on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for invalid input or allocation failures. Per-config failures are reported
+ *   through error_type/error_details in out.
+ */
+EXPORT int probe_config_quick_many(const char** configs, int n, ProbeResult* out) {
+    return quick_many(configs, n, out, NULL);
+}
+
+/*
+ * Quick DNS + TCP probe for picking the fastest nodes of a list, with adaptive deadlines.
+ *
+ * As probe_config_quick_many, but once k configs have connected, a connect still pending after
+ * factor times the median connect time of the k fastest is abandoned (never sooner than
+ * MIN_ADAPTIVE_TIMEOUT_MS). With stop set, no connect is started once k configs have
+ * connected and the rest are marked PROBE_ERROR_SKIPPED; pending connects are cut at the
+ * k-th best connect time. Name resolution still runs for every config up front.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   out (ProbeResult*): Array of n results, filled in the same order as configs.
+ *   k (int): Size of the reference set (clamped to 1..MAX_SELECT_K), e.g. DEFAULT_SELECT_K.
+ *   factor (double): Deadline as a multiple of the reference median, e.g. DEFAULT_SELECT_FACTOR.
+ *   stop (int): Non-zero to stop once k configs have connected.
+ *
+ * Returns:
+ *   int: Number of reachable configurations on success, -1 on failure.
+ *
+ * Errors:
+ *   As probe_config_quick_many.
+ */
+EXPORT int probe_config_quick_select(const char** configs, int n, ProbeResult* out, int k, double factor, int stop) {
+    ProbeDeadline deadline;
+    deadline_init(&deadline, k, factor, stop);
+    return quick_many(configs, n, out, &deadline);
+}
+
+/*
+ * Performs quick DNS + TCP probes for every record of a parsed subscription.
+ *
+ * Uses the host and port already extracted by v2root_parse_subscription, so no configuration
+ * string is parsed again. Records whose endpoint could not be parsed fail without a probe.
+ *
+ * Parameters:
+ *   table (const V2ConfigTable*): Table returned by v2root_parse_subscription.
+ *   out (ProbeResult*): Array of v2root_config_count(table) results, in record order.
+ *
+ * Returns:
+ *   int: Number of reachable records on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for invalid input or allocation failures.
+ */
+EXPORT int probe_table_quick(const V2ConfigTable* table, ProbeResult* out) {
+    if (!table || !out) {
+        log_message("Invalid arguments to probe_table_quick", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    int n = table->count;
+    if (n == 0) return 0;
+    QuickTarget* targets = calloc((size_t)n, sizeof(QuickTarget));
+    if (!targets) {
+        log_message("Failed to allocate quick probe targets", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        quick_init(&out[i]);
+        const char* host = table->pool + table->host_offset[i];
+        if (table->port[i] == 0 || strlen(host) >= sizeof(targets[i].address)) {
+            quick_fail(&out[i], PROBE_ERROR_UNKNOWN, "Failed to extract address and port");
+            continue;
+        }
+        strcpy(targets[i].address, host);
+        snprintf(targets[i].port, sizeof(targets[i].port), "%u", (unsigned)table->port[i]);
+        targets[i].ready = 1;
+    }
+
+    int succeeded = run_quick_targets(targets, out, n, NULL);
+    free(targets);
+    return succeeded;
+}
@@ -0,0 +1,24 @@
+#ifndef LIBV2ROOT_PROBE_H
+#define LIBV2ROOT_PROBE_H
+
+#include "libv2root_common.h"
+#include "libv2root_subscription.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Concurrent DNS + TCP pre-filtering of many configurations */
+EXPORT int probe_config_quick_many(const char** configs, int n, ProbeResult* out);
+
+/* Same probe for node selection: adaptive deadlines and an optional stop after k good nodes */
+EXPORT int probe_config_quick_select(const char** configs, int n, ProbeResult* out, int k, double factor, int stop);
+
+/* Same probe over a parsed subscription table, reusing its extracted endpoints */
+EXPORT int probe_table_quick(const V2ConfigTable* table, ProbeResult* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_PROBE_H */
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libv2root_common.h"
+#include "libv2root_records.h"
+#include "libv2root_batch.h"
+#include "libv2root_cache.h"
+#include "libv2root_handshake.h"
+#include "libv2root_probe.h"
+#include "libv2root_utils.h"
+
+#ifdef _WIN32
+#define RECORD_PLATFORM "windows"
+#else
+#define RECORD_PLATFORM "linux"
+#endif
+
+/* PROBE_ERROR_* strings, indexed by PROBE_CODE_* */
+static const char* const probe_error_names[PROBE_CODE_COUNT] = {
+    PROBE_ERROR_NONE, PROBE_ERROR_DNS, PROBE_ERROR_TCP, PROBE_ERROR_TLS, PROBE_ERROR_TRANSPORT,
+    PROBE_ERROR_AUTH, PROBE_ERROR_UPSTREAM_BLOCKED, PROBE_ERROR_TIMEOUT, PROBE_ERROR_UNKNOWN,
+    PROBE_ERROR_SKIPPED
+};
+
+int probe_error_code(const char* error_type) {
+    if (!error_type || error_type[0] == '\0') return PROBE_CODE_NONE;
+    for (int i = 0; i < PROBE_CODE_COUNT; i++) {
+        if (strcmp(error_type, probe_error_names[i]) == 0) return i;
+    }
+    return PROBE_CODE_UNKNOWN;
+}
+
+const char* probe_error_name(int code) {
+    return code >= 0 && code < PROBE_CODE_COUNT ? probe_error_names[code] : PROBE_ERROR_UNKNOWN;
+}
+
+void probe_record_init(ProbeRecord* record, int index) {
+    memset(record, 0, sizeof(ProbeRecord));
+    record->size = (uint32_t)sizeof(ProbeRecord);
+    record->version = PROBE_RECORD_VERSION;
+    record->index = index;
+}
+
+void probe_record_from_result(const ProbeResult* result, int index, ProbeRecord* record) {
+    probe_record_init(record, index);
+    record->success = result->success;
+    record->error_code = result->success ? PROBE_CODE_NONE : probe_error_code(result->error_type);
+    record->dns_ms = result->dns_ms;
+    record->tcp_connect_ms = result->tcp_connect_ms;
+    record->tls_handshake_ms = result->tls_handshake_ms;
+    record->transport_handshake_ms = result->transport_handshake_ms;
+    record->proxy_setup_ms = result->proxy_setup_ms;
+    record->app_connect_ms = result->app_connect_ms;
+    record->ttfb_ms = result->ttfb_ms;
+    record->total_ms = result->total_ms;
+    record->attempts = result->attempts;
+    record->dns_cache_hit = result->dns_cache_hit;
+    record->warm_rtt_ms = result->warm_rtt_ms;
+    record->score = result->score;
+    record->v2ray_ready_ms = result->v2ray_ready_ms;
+    record->ttfb_p90_ms = result->ttfb_p90_ms;
+    record->throughput_mbps = result->throughput_mbps;
+    record->stalls = result->stalls;
+    memcpy(record->error_details, result->error_details, sizeof(record->error_details));
+    record->error_details[sizeof(record->error_details) - 1] = '\0';
+}
+
+void probe_record_store(void* out, size_t record_size, int index, const ProbeRecord* record) {
+    size_t bytes = record_size < sizeof(ProbeRecord) ? record_size : sizeof(ProbeRecord);
+    char* slot = (char*)out + (size_t)index * record_size;
+    memcpy(slot, record, bytes);
+    ((ProbeRecord*)slot)->size = (uint32_t)bytes;
+    /* A truncated error_details must stay terminated */
+    if (bytes > PROBE_RECORD_MIN_SIZE && bytes < PROBE_RECORD_MIN_SIZE + sizeof(record->error_details)) {
+        slot[bytes - 1] = '\0';
+    }
+}
+
+void probe_record_ttfb_json(const ProbeRecord* record, char* buffer, size_t size) {
+    if (record->success) {
+        snprintf(buffer, size,
+                 "{\"platform\": \"%s\", \"success\": true, \"ttfb_ms\": %d, \"http_status\": %d, \"error_message\": null}",
+                 RECORD_PLATFORM, (int)record->ttfb_ms, (int)record->http_status);
+    } else {
+        snprintf(buffer, size,
+                 "{\"platform\": \"%s\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"%s\"}",
+                 RECORD_PLATFORM, record->error_details);
+    }
+}
+
+/* Runs one probe call of the given mode over n configs */
+static int run_probe_mode(const char** configs, int n, int mode, ProbeResult* results) {
+    switch (mode) {
+        case PROBE_MODE_QUICK:
+            return probe_config_quick_many(configs, n, results);
+        case PROBE_MODE_BATCH:
+            return probe_configs_batch(configs, n, results, 0);
+        case PROBE_MODE_OBSERVATORY:
+            return probe_configs_observatory(configs, n, results, 0);
+        case PROBE_MODE_HANDSHAKE:
+            return probe_config_handshake_many(configs, n, results);
+        default:
+            log_message("Invalid probe mode", __FILE__, __LINE__, 0, NULL);
+            return -1;
+    }
+}
+
+/* Converts n results into the caller's record array */
+static void store_results(const ProbeResult* results, int n, void* out, size_t record_size) {
+    ProbeRecord record;
+    for (int i = 0; i < n; i++) {
+        probe_record_from_result(&results[i], i, &record);
+        probe_record_store(out, record_size, i, &record);
+    }
+}
+
+/*
+ * Probes configs and writes one record per config into a caller-owned array.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   mode (int): One of the PROBE_MODE_* constants.
+ *   out (void*): Caller array of n records of record_size bytes each, in configs order.
+ *   record_size (size_t): The caller's sizeof(ProbeRecord) (at least PROBE_RECORD_MIN_SIZE).
+ *
+ * Returns:
+ *   int: Number of successful probes, -1 on failure, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input or allocation failures.
+ */
+EXPORT int v2root_probe_records(const char** configs, int n, int mode, void* out, size_t record_size) {
+    if (!configs || n <= 0 || !out || record_size < PROBE_RECORD_MIN_SIZE) {
+        log_message("Invalid arguments to v2root_probe_records", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    ProbeResult* results = malloc((size_t)n * sizeof(ProbeResult));
+    if (!results) {
+        log_message("Failed to allocate probe results", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    int succeeded = run_probe_mode(configs, n, mode, results);
+    if (succeeded >= 0) {
+        store_results(results, n, out, record_size);
+        cache_record_results(configs, results, n);
+    }
+    free(results);
+    return succeeded;
+}
+
+/*
+ * Selection probe with adaptive deadlines, writing one record per config.
+ *
+ * Runs probe_config_quick_select (PROBE_MODE_QUICK) or probe_configs_select (PROBE_MODE_BATCH).
+ * Configs the sweep never reached have error_code PROBE_CODE_SKIPPED.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   mode (int): PROBE_MODE_QUICK or PROBE_MODE_BATCH.
+ *   k (int): Size of the reference set (clamped to 1..MAX_SELECT_K).
+ *   factor (double): Deadline as a multiple of the reference median.
+ *   stop (int): Non-zero to stop once k configs have succeeded.
+ *   out (void*): Caller array of n records of record_size bytes each, in configs order.
+ *   record_size (size_t): The caller's sizeof(ProbeRecord) (at least PROBE_RECORD_MIN_SIZE).
+ *
+ * Returns:
+ *   int: Number of successful probes, -1 on failure, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input, including the observatory mode, or allocation failures.
+ */
+EXPORT int v2root_probe_select_records(const char** configs, int n, int mode, int k, double factor, int stop,
+                                       void* out, size_t record_size) {
+    if (!configs || n <= 0 || !out || record_size < PROBE_RECORD_MIN_SIZE ||
+        (mode != PROBE_MODE_QUICK && mode != PROBE_MODE_BATCH)) {
+        log_message("Invalid arguments to v2root_probe_select_records", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    ProbeResult* results = malloc((size_t)n * sizeof(ProbeResult));
+    if (!results) {
+        log_message("Failed to allocate probe results", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    int succeeded = mode == PROBE_MODE_QUICK ? probe_config_quick_select(configs, n, results, k, factor, stop)
+                                             : probe_configs_select(configs, n, results, 0, k, factor, stop);
+    if (succeeded >= 0) {
+        store_results(results, n, out, record_size);
+        cache_record_results(configs, results, n);
+    }
+    free(results);
+    return succeeded;
+}
+
+/*
+ * Probes configs group by group and passes each record to callback as its group completes.
+ *
+ * Quick probes run in groups of MAX_CONCURRENT_PROBES, the probe concurrency, so records
+ * arrive as fast as the probes finish. Batch and observatory probes start one V2Ray process
+ * per PROBE_STREAM_BATCH_GROUP configs, trading a little start-up time for earlier results.
+ * Records are delivered on the calling thread.
+ *
+ * Parameters:
+ *   configs (const char**): Array of VLESS, VMess, or Shadowsocks configuration strings.
+ *   n (int): Number of configurations.
+ *   mode (int): One of the PROBE_MODE_* constants.
+ *   callback (ProbeRecordCallback): Receives every record; index gives its position in configs.
+ *   user_data (void*): Passed through to callback.
+ *
+ * Returns:
+ *   int: Number of successful probes, -1 on failure, -2 for invalid input.
+ *
+ * Errors:
+ *   Logs errors for invalid input or allocation failures. A failed group stops the stream.
+ */
+EXPORT int v2root_probe_stream(const char** configs, int n, int mode, ProbeRecordCallback callback, void* user_data) {
+    if (!configs || n <= 0 || !callback) {
+        log_message("Invalid arguments to v2root_probe_stream", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    int group = mode == PROBE_MODE_QUICK || mode == PROBE_MODE_HANDSHAKE ? MAX_CONCURRENT_PROBES : PROBE_STREAM_BATCH_GROUP;
+    ProbeResult* results = malloc((size_t)group * sizeof(ProbeResult));
+    if (!results) {
+        log_message("Failed to allocate probe results", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR;
+    }
+    int succeeded = 0;
+    ProbeRecord record;
+    for (int start = 0; start < n; start += group) {
+        int count = n - start < group ? n - start : group;
+        int rc = run_probe_mode(configs + start, count, mode, results);
+        if (rc < 0) {
+            free(results);
+            return rc;
+        }
+        succeeded += rc;
+        cache_record_results(configs + start, results, count);
+        for (int i = 0; i < count; i++) {
+            probe_record_from_result(&results[i], start + i, &record);
+            callback(&record, user_data);
+        }
+    }
+    free(results);
+    return succeeded;
+}
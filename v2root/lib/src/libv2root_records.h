@@ -0,0 +1,60 @@
+#ifndef LIBV2ROOT_RECORDS_H
+#define LIBV2ROOT_RECORDS_H
+
+#include <stddef.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Probe record APIs.
+ *
+ * Bulk probes write ProbeRecords into caller-owned arrays, or hand them to a callback as each
+ * group of probes completes, so results cross the library boundary without being formatted
+ * or parsed as strings. Every call takes the caller's record size: at most that many bytes
+ * are written per record, the caller's array is strided by it, and each record's size field
+ * reports the bytes actually filled.
+ */
+
+/* Probe modes for the record APIs */
+#define PROBE_MODE_QUICK 0                  /* DNS + TCP (probe_config_quick_many) */
+#define PROBE_MODE_BATCH 1                  /* Proxied request through V2Ray (probe_configs_batch) */
+#define PROBE_MODE_OBSERVATORY 2            /* V2Ray observatory (probe_configs_observatory) */
+#define PROBE_MODE_HANDSHAKE 3              /* Direct protocol handshake (probe_config_handshake_many) */
+
+#define PROBE_RECORD_MIN_SIZE offsetof(ProbeRecord, error_details)
+#define PROBE_STREAM_BATCH_GROUP 32         /* Configs per V2Ray process when streaming batch probes */
+
+/* Called once per record, in request order within each group; it must return quickly */
+typedef void (*ProbeRecordCallback)(const ProbeRecord* record, void* user_data);
+
+EXPORT int v2root_probe_records(const char** configs, int n, int mode, void* out, size_t record_size);
+EXPORT int v2root_probe_stream(const char** configs, int n, int mode, ProbeRecordCallback callback, void* user_data);
+EXPORT int v2root_probe_select_records(const char** configs, int n, int mode, int k, double factor, int stop,
+                                       void* out, size_t record_size);
+
+/* Maps a PROBE_ERROR_* string to its PROBE_CODE_* value */
+int probe_error_code(const char* error_type);
+
+/* Maps a PROBE_CODE_* value to its PROBE_ERROR_* string; PROBE_ERROR_UNKNOWN when out of range */
+const char* probe_error_name(int code);
+
+/* Clears record and fills its header for the config at index */
+void probe_record_init(ProbeRecord* record, int index);
+
+/* Converts a ProbeResult into a record for the config at index */
+void probe_record_from_result(const ProbeResult* result, int index, ProbeRecord* record);
+
+/* Copies record into slot index of a caller array of record_size-byte records */
+void probe_record_store(void* out, size_t record_size, int index, const ProbeRecord* record);
+
+/* Formats a TTFB record as the JSON document returned by measure_ttfb */
+void probe_record_ttfb_json(const ProbeRecord* record, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_RECORDS_H */
@@ -209,7 +209,7 @@ static int save_service_json(const char* config_file, int http_port, int socks_p
     }
 
     json_decref(root);
-    log_message("Service JSON saved successfully", __FILE__, __LINE__, 0, service_json_path);
+    LOG_INFO("Service JSON saved successfully", service_json_path);
     return 0;
 }
 
@@ -265,7 +265,7 @@ static int remove_service_json() {
         log_message("Failed to remove service JSON file", __FILE__, __LINE__, errno, service_json_path);
         return -1;
     }
-    log_message("Service JSON file removed", __FILE__, __LINE__, 0, NULL);
+    LOG_INFO("Service JSON file removed", NULL);
     return 0;
 }
 
@@ -327,9 +327,7 @@ EXPORT int set_system_proxy(int http_port, int socks_port) {
         return -1;
     }
 
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "Set system proxy: HTTP=%s, SOCKS=%s", http_proxy, socks_proxy);
-    log_message("System proxy set successfully", __FILE__, __LINE__, 0, extra_info);
+    LOG_INFOF("System proxy set successfully", "Set system proxy: HTTP=%s, SOCKS=%s", http_proxy, socks_proxy);
     return 0;
 }
 
@@ -374,9 +372,7 @@ EXPORT int unset_system_proxy() {
         return -1;
     }
 
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "System proxy cleared");
-    log_message("System proxy environment variables cleared", __FILE__, __LINE__, 0, extra_info);
+    LOG_INFO("System proxy environment variables cleared", "System proxy cleared");
     return 0;
 }
 
@@ -398,7 +394,7 @@ EXPORT int create_v2ray_service(const char* config_file, int http_port, int sock
         return -1;
     }
 
-    log_message("V2Ray service configuration created successfully", __FILE__, __LINE__, 0, service_json_path);
+    LOG_INFO("V2Ray service configuration created successfully", service_json_path);
     return 0;
 }
 
@@ -418,7 +414,7 @@ EXPORT int remove_v2ray_service() {
         return -1;
     }
 
-    log_message("V2Ray service configuration removed successfully", __FILE__, __LINE__, 0, NULL);
+    LOG_INFO("V2Ray service configuration removed successfully", NULL);
     return 0;
 }
 
@@ -446,9 +442,7 @@ EXPORT int start_v2ray_service(pid_t* pid) {
     }
 
     if (existing_pid > 0 && is_pid_running(existing_pid)) {
-        char extra_info[256];
-        snprintf(extra_info, sizeof(extra_info), "V2Ray already running with PID: %d", existing_pid);
-        log_message("V2Ray service already running", __FILE__, __LINE__, 0, extra_info);
+        LOG_INFOF("V2Ray service already running", "V2Ray already running with PID: %d", existing_pid);
         *pid = existing_pid;
         return 0;
     }
@@ -491,9 +485,7 @@ EXPORT int start_v2ray_service(pid_t* pid) {
         return -1;
     }
 
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "V2Ray started with PID: %d", *pid);
-    log_message("V2Ray service started", __FILE__, __LINE__, 0, extra_info);
+    LOG_INFOF("V2Ray service started", "V2Ray started with PID: %d", *pid);
     return 0;
 }
 
@@ -519,7 +511,7 @@ EXPORT int stop_v2ray_service() {
 
     if (pid > 0 && is_pid_running(pid)) {
         if (kill(pid, SIGTERM) == 0) {
-            log_message("V2Ray process stopped", __FILE__, __LINE__, 0, NULL);
+            LOG_INFO("V2Ray process stopped", NULL);
         } else {
             log_message("Failed to stop V2Ray process", __FILE__, __LINE__, errno, NULL);
             return -1;
@@ -536,7 +528,7 @@ EXPORT int stop_v2ray_service() {
         return -1;
     }
 
-    log_message("V2Ray service stopped", __FILE__, __LINE__, 0, NULL);
+    LOG_INFO("V2Ray service stopped", NULL);
     return 0;
 }
 
@@ -560,9 +552,7 @@ EXPORT int is_v2ray_service_running() {
     }
 
     if (pid > 0 && is_pid_running(pid)) {
-        char extra_info[256];
-        snprintf(extra_info, sizeof(extra_info), "V2Ray process detected with PID: %d", pid);
-        log_message("V2Ray process detected", __FILE__, __LINE__, 0, extra_info);
+        LOG_DEBUGF("V2Ray process detected", "V2Ray process detected with PID: %d", pid);
         return 1;
     }
 
@@ -1,11 +1,3 @@
-#ifdef _WIN32
-#include <windows.h>
-#include <wincrypt.h>
-#else
-#include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
-#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,125 +5,97 @@
 #include "libv2root_shadowsocks.h"
 #include "libv2root_core.h"
 #include "libv2root_utils.h"
+#include "libv2root_uri.h"
+#include "libv2root_base64.h"
 
-/*
- * Checks if a given string is a valid Base64-encoded string.
- *
- * Validates that the input string contains only characters allowed in Base64 encoding, which includes:
- * - Alphanumeric characters (A-Z, a-z, 0-9).
- * - Plus sign (+) and forward slash (/) as special characters.
- * - Equal sign (=) for padding at the end of the string.
- *
- * This function is used to verify the Base64-encoded method:password segment in Shadowsocks configuration strings
- * (e.g., the part after "ss://" in ss://base64(method:password)@address:port) or other encoded data in protocols
- * like VLESS or VMess. It ensures the string is safe for decoding before further processing.
- *
- * Parameters:
- *   str (const char*): The input string to check for valid Base64 encoding.
- *   len (size_t): The length of the input string to check (number of characters to process).
- *
- * Returns:
- *   int: 1 if the string is a valid Base64-encoded string, 0 otherwise.
- *
- * Errors:
- *   - Returns 0 if any character in the string is not a valid Base64 character (i.e., not alphanumeric, +, /, or =).
- *   - No logging or memory allocation is performed to keep the function lightweight.
- *
- * Notes:
- *   - The function does not verify if the string is properly padded (e.g., correct number of = characters) or decodable.
- *     It only checks character validity.
- *   - The len parameter allows checking a substring without requiring a null-terminated string.
- */
-
-static int is_base64(const char* str, size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        if (!isalnum(str[i]) && str[i] != '+' && str[i] != '/' && str[i] != '=') {
-            return 0;
-        }
-    }
-    return 1;
-}
+enum {
+    SP_PLUGIN, SP_PLUGIN_OPTS, SP_TAG, SP_LEVEL, SP_OTA, SP_TYPE, SP_NETWORK, SP_SECURITY,
+    SP_HOST, SP_SNI, SP_FP, SP_PBK, SP_HEADER_TYPE, SP_COUNT
+};
 
 /*
- * Extracts and validates a query parameter value from a URL query string.
+ * Validates the value of a Shadowsocks query parameter that only accepts a fixed set of values.
  *
- * Parses the query string to find a parameter matching the specified key and extracts its value. The function supports
- * Shadowsocks and VLESS configuration strings by handling query parameters (e.g., plugin=v2ray-plugin or network=tcp)
- * after the ? in URLs like ss://base64(method:password)@address:port?params or vless://uuid@address:port?params.
- *
- * Validates specific parameters to ensure they contain allowed values:
+ * Parameters are tokenized by uri_next_param; this check restricts specific keys to allowed values:
  * - plugin: Only allows "v2ray-plugin" or "obfs".
  * - network or type: Only allows "tcp", "ws", or "http".
  * - security: Only allows "tls", "none", or "reality".
  * - headerType: Only allows "http" or "none".
  *
- * If the parameter is found and its value is valid, the value is copied to the provided buffer. If the parameter is missing,
- * malformed, or has an invalid value, an error is logged, and NULL is returned.
- *
  * Parameters:
- *   query (const char*): The query string containing parameters (e.g., "plugin=v2ray-plugin&network=tcp").
- *   key (const char*): The parameter key to search for (e.g., "plugin", "network").
- *   value (char*): Buffer to store the extracted parameter value.
- *   value_size (size_t): Size of the value buffer to prevent overflow.
+ *   id (int): The parameter slot (SP_PLUGIN, SP_TYPE, SP_NETWORK, SP_SECURITY, SP_HEADER_TYPE).
+ *   value (StrView): The raw parameter value.
  *
  * Returns:
- *   char*: Pointer to the value buffer if the parameter is found and valid, NULL otherwise.
+ *   int: 1 if the value is allowed, 0 otherwise.
  *
  * Errors:
- *   - Returns NULL if the key is not found in the query string.
- *   - Returns NULL if the parameter is malformed (e.g., missing '=' after the key).
- *   - Returns NULL and logs an error if the value is invalid for specific keys (e.g., plugin=invalid-plugin).
- *   - Truncates the value to fit within value_size to prevent buffer overflow.
- *   - Handles query strings ending with '#' or '&' correctly by stopping at the appropriate delimiter.
+ *   - Logs an error naming the parameter if the value is not allowed; the caller keeps its default.
  *
  * Notes:
- *   - The function modifies the value buffer by copying the extracted parameter value into it.
  *   - Validation is case-sensitive (e.g., "TCP" is not accepted for network; it must be "tcp").
- *   - The function assumes the query string is null-terminated.
  */
 
-static char* get_query_param(const char* query, const char* key, char* value, size_t value_size) {
-    const char* param = strstr(query, key);
-    if (!param) return NULL;
-
-    param += strlen(key);
-    if (*param != '=') return NULL;
-    param++;
-
-    const char* end = strchr(param, '&');
-    const char* hash = strchr(param, '#');
-    if (!end || (hash && hash < end)) end = hash;
-    if (!end) end = param + strlen(param);
-
-    size_t len = end - param;
-    if (len >= value_size) len = value_size - 1;
-
-    strncpy(value, param, len);
-    value[len] = '\0';
-
-    if (strcmp(key, "plugin") == 0) {
-        if (strcmp(value, "v2ray-plugin") != 0 && strcmp(value, "obfs") != 0) {
-            log_message("Invalid plugin value", __FILE__, __LINE__, 0, value);
-            return NULL;
-        }
-    } else if (strcmp(key, "network") == 0 || strcmp(key, "type") == 0) {
-        if (strcmp(value, "tcp") != 0 && strcmp(value, "ws") != 0 && strcmp(value, "http") != 0) {
-            log_message("Invalid network value", __FILE__, __LINE__, 0, value);
-            return NULL;
-        }
-    } else if (strcmp(key, "security") == 0) {
-        if (strcmp(value, "tls") != 0 && strcmp(value, "none") != 0 && strcmp(value, "reality") != 0) {
-            log_message("Invalid security value", __FILE__, __LINE__, 0, value);
-            return NULL;
-        }
-    } else if (strcmp(key, "headerType") == 0) {
-        if (strcmp(value, "http") != 0 && strcmp(value, "none") != 0) {
-            log_message("Invalid headerType value", __FILE__, __LINE__, 0, value);
-            return NULL;
-        }
+static int ss_param_valid(int id, StrView value) {
+    const char* error = NULL;
+    switch (id) {
+    case SP_PLUGIN:
+        if (!sv_eq(value, "v2ray-plugin") && !sv_eq(value, "obfs")) error = "Invalid plugin value";
+        break;
+    case SP_TYPE:
+    case SP_NETWORK:
+        if (!sv_eq(value, "tcp") && !sv_eq(value, "ws") && !sv_eq(value, "http")) error = "Invalid network value";
+        break;
+    case SP_SECURITY:
+        if (!sv_eq(value, "tls") && !sv_eq(value, "none") && !sv_eq(value, "reality")) error = "Invalid security value";
+        break;
+    case SP_HEADER_TYPE:
+        if (!sv_eq(value, "http") && !sv_eq(value, "none")) error = "Invalid headerType value";
+        break;
     }
+    if (!error) return 1;
+    char extra_info[128];
+    snprintf(extra_info, sizeof(extra_info), "%.*s", SV_FMT(value));
+    log_message(error, __FILE__, __LINE__, 0, extra_info);
+    return 0;
+}
 
-    return value;
+/* Maps a query key to its slot with a switch on the key length; -1 for unused keys */
+static int ss_param_id(StrView key) {
+    switch (key.len) {
+    case 2:
+        if (sv_eq(key, "fp")) return SP_FP;
+        break;
+    case 3:
+        if (sv_eq(key, "tag")) return SP_TAG;
+        if (sv_eq(key, "ota")) return SP_OTA;
+        if (sv_eq(key, "sni")) return SP_SNI;
+        if (sv_eq(key, "pbk")) return SP_PBK;
+        break;
+    case 4:
+        if (sv_eq(key, "type")) return SP_TYPE;
+        if (sv_eq(key, "host")) return SP_HOST;
+        break;
+    case 5:
+        if (sv_eq(key, "level")) return SP_LEVEL;
+        break;
+    case 6:
+        if (sv_eq(key, "plugin")) return SP_PLUGIN;
+        break;
+    case 7:
+        if (sv_eq(key, "network")) return SP_NETWORK;
+        break;
+    case 8:
+        if (sv_eq(key, "security")) return SP_SECURITY;
+        break;
+    case 10:
+        if (sv_eq(key, "headerType")) return SP_HEADER_TYPE;
+        break;
+    case 11:
+        if (sv_eq(key, "plugin-opts")) return SP_PLUGIN_OPTS;
+        break;
+    }
+    return -1;
 }
 
 /*
@@ -225,7 +189,7 @@ static int is_valid_uuid(const char* str) {
  *   - Invalid method:password format or unsupported encryption method.
  *   - Parsing failures (incorrect format, invalid address, port, or query parameters).
  *   - Invalid port or address (validated using validate_port and validate_address).
- *   - Parameter buffer overflow (query parameters exceeding allocated buffer size).
+ *   - Oversized fields (method or password over 127 bytes, address over 255 bytes).
  *   - Memory allocation failures during parsing or JSON generation.
  *   - Plugin configuration errors (e.g., missing plugin-opts for specified plugin).
  */
@@ -248,193 +212,102 @@ EXPORT int parse_shadowsocks_string(const char* ss_str, FILE* fp, int http_port,
     int final_http_port = (http_port > 0 && validate_port(http_port_str)) ? http_port : DEFAULT_HTTP_PORT;
     int final_socks_port = (socks_port > 0 && validate_port(socks_port_str)) ? socks_port : DEFAULT_SOCKS_PORT;
 
-    const char* base64_data = ss_str + 5;
-    const char* query_start = strchr(base64_data, '?');
-    const char* remark_start = strchr(base64_data, '#');
-    if (!query_start) query_start = base64_data + strlen(base64_data);
-    if (!remark_start) remark_start = base64_data + strlen(base64_data);
+    UriParts uri;
+    if (uri_split(ss_str, strlen(ss_str), &uri) != 0) {
+        log_message("Invalid Shadowsocks format", __FILE__, __LINE__, 0, ss_str);
+        return -1;
+    }
 
-    size_t base64_len = (query_start < remark_start ? query_start : remark_start) - base64_data;
+    /* SIP002 servers may end the authority with '/' before the query */
+    StrView authority = uri.body;
+    if (authority.len > 0 && authority.ptr[authority.len - 1] == '/') authority.len--;
+    const char* authority_data = authority.ptr;
+    size_t authority_len = authority.len;
     char* decoded = NULL;
-    int decoded_len = 0;
 
-    char base64_copy[1024];
-    if (base64_len >= sizeof(base64_copy)) {
-        log_message("Base64 data too long", __FILE__, __LINE__, 0, base64_data);
-        return -1;
-    }
-    strncpy(base64_copy, base64_data, base64_len);
-    base64_copy[base64_len] = '\0';
-
-    if (is_base64(base64_copy, base64_len)) {
-        #ifdef _WIN32
-        DWORD dwDecodedLen = 0;
-        if (!CryptStringToBinaryA(base64_data, base64_len, CRYPT_STRING_BASE64, NULL, &dwDecodedLen, NULL, NULL)) {
-            log_message("Failed to calculate Base64 decoded length", __FILE__, __LINE__, GetLastError(), NULL);
-            return -1;
-        }
-        decoded = malloc(dwDecodedLen + 1);
-        if (!decoded) {
-            log_message("Memory allocation failed for decoded data", __FILE__, __LINE__, 0, NULL);
-            return -1;
-        }
-        if (!CryptStringToBinaryA(base64_data, base64_len, CRYPT_STRING_BASE64, (BYTE*)decoded, &dwDecodedLen, NULL, NULL)) {
-            log_message("Base64 decoding failed", __FILE__, __LINE__, GetLastError(), NULL);
-            free(decoded);
-            return -1;
-        }
-        decoded[dwDecodedLen] = '\0';
-        decoded_len = dwDecodedLen;
-        #else
-        BIO* b64 = BIO_new(BIO_f_base64());
-        BIO* bio = BIO_new_mem_buf(base64_data, base64_len);
-        bio = BIO_push(b64, bio);
-        BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
-        char temp[1024];
-        decoded_len = BIO_read(bio, temp, sizeof(temp));
-        if (decoded_len <= 0) {
+    if (base64_is_encoded(authority.ptr, authority.len)) {
+        size_t decoded_len = 0;
+        decoded = base64_decode_alloc(authority.ptr, authority.len, &decoded_len);
+        if (!decoded || decoded_len == 0) {
             log_message("Base64 decoding failed", __FILE__, __LINE__, 0, NULL);
-            BIO_free_all(bio);
-            return -1;
-        }
-        decoded = malloc(decoded_len + 1);
-        if (!decoded) {
-            log_message("Memory allocation failed for decoded data", __FILE__, __LINE__, 0, NULL);
-            BIO_free_all(bio);
-            return -1;
-        }
-        memcpy(decoded, temp, decoded_len);
-        decoded[decoded_len] = '\0';
-        BIO_free_all(bio);
-        #endif
-    } else {
-        decoded = strdup(base64_copy);
-        if (!decoded) {
-            log_message("Memory allocation failed for decoded data", __FILE__, __LINE__, 0, NULL);
+            free(decoded);
             return -1;
         }
-        decoded_len = strlen(decoded);
+        authority_data = decoded;
+        authority_len = decoded_len;
     }
 
-    if (decoded_len <= 0) {
-        log_message("Decoded length is invalid", __FILE__, __LINE__, 0, NULL);
+    /* The authority is either plain or the legacy base64(method:password@address:port) form */
+    if (uri_parse_authority(authority_data, authority_len, &uri) != 0) {
+        log_message("Invalid address:port format", __FILE__, __LINE__, 0, decoded ? decoded : ss_str);
+        free(decoded);
+        return -1;
+    }
+    if (uri.userinfo.len == 0) {
+        log_message("Invalid decoded format: missing @", __FILE__, __LINE__, 0, decoded ? decoded : ss_str);
         free(decoded);
         return -1;
     }
 
     char method[128] = "2022-blake3-aes-128-gcm";
     char password[128] = "";
-    char address[2048] = "";
-    char port_str[16] = "";
-
-    char* at_sign = strchr(decoded, '@');
-    if (at_sign) {
-        size_t pre_at_len = at_sign - decoded;
-        char pre_at[256];
-        if (pre_at_len >= sizeof(pre_at)) {
-            log_message("Data before @ too long", __FILE__, __LINE__, 0, decoded);
-            free(decoded);
-            return -1;
-        }
-        strncpy(pre_at, decoded, pre_at_len);
-        pre_at[pre_at_len] = '\0';
-
-        if (is_valid_uuid(pre_at)) {
-            strncpy(password, pre_at, sizeof(password) - 1);
-            password[sizeof(password) - 1] = '\0';
-        } else if (sscanf(pre_at, "%127[^:]:%127s", method, password) != 2) {
-            log_message("Invalid method:password format", __FILE__, __LINE__, 0, pre_at);
-            free(decoded);
-            return -1;
-        }
+    char address[256] = "";
 
-        const char* addr_start = at_sign + 1;
-        char* colon = NULL;
-        if (addr_start[0] == '[') {
-            char* ipv6_end = strchr(addr_start, ']');
-            if (!ipv6_end || ipv6_end[1] != ':') {
-                log_message("Invalid IPv6 address format", __FILE__, __LINE__, 0, addr_start);
-                free(decoded);
-                return -1;
-            }
-            colon = ipv6_end + 1;
-        } else {
-            colon = strchr(addr_start, ':');
-        }
+    StrView credentials = uri.userinfo;
+    int is_uuid = sv_copy(credentials, password, sizeof(password)) == 0 && is_valid_uuid(password);
 
-        if (!colon) {
-            log_message("Invalid address:port format in decoded data", __FILE__, __LINE__, 0, addr_start);
-            free(decoded);
-            return -1;
-        }
+    /* SIP002 encodes only the userinfo: ss://base64(method:password)@address:port */
+    char userinfo[256];
+    if (!is_uuid && !memchr(credentials.ptr, ':', credentials.len) && base64_is_encoded(credentials.ptr, credentials.len)) {
+        int n = base64_decode_into(credentials.ptr, credentials.len, (unsigned char*)userinfo, sizeof(userinfo));
+        if (n > 0 && memchr(userinfo, ':', (size_t)n)) credentials = (StrView){ userinfo, (size_t)n };
+    }
 
-        size_t addr_len = colon - addr_start;
-        if (addr_len >= sizeof(address)) addr_len = sizeof(address) - 1;
-        strncpy(address, addr_start, addr_len);
-        address[addr_len] = '\0';
-
-        size_t port_len = decoded_len - (colon - decoded + 1);
-        if (port_len >= sizeof(port_str)) port_len = sizeof(port_str) - 1;
-        strncpy(port_str, colon + 1, port_len);
-        port_str[port_len] = '\0';
-    } else {
-        log_message("Invalid decoded format: missing @", __FILE__, __LINE__, 0, decoded);
+    /* A bare UUID is a 2022-blake3 key and keeps the default method */
+    StrView method_view;
+    if (!is_uuid && (!sv_cut(&credentials, ':', &method_view) || method_view.len == 0 || credentials.len == 0 ||
+                     sv_copy(method_view, method, sizeof(method)) != 0 || sv_copy(credentials, password, sizeof(password)) != 0)) {
+        log_message("Invalid method:password format", __FILE__, __LINE__, 0, decoded ? decoded : ss_str);
         free(decoded);
         return -1;
     }
+
+    int server_port = sv_to_port(uri.port);
+    int address_ok = sv_copy(uri.host, address, sizeof(address)) == 0;
     free(decoded);
 
-    if (!validate_address(address)) {
+    if (!address_ok || !validate_address(address)) {
         log_message("Invalid address format", __FILE__, __LINE__, 0, address);
         return -1;
     }
-    if (!validate_port(port_str)) {
-        log_message("Invalid port", __FILE__, __LINE__, 0, port_str);
+    if (server_port < 0) {
+        log_message("Invalid port", __FILE__, __LINE__, 0, ss_str);
         return -1;
     }
-    int server_port = atoi(port_str);
-
-    char remark[128] = "";
-    if (remark_start < ss_str + strlen(ss_str)) {
-        snprintf(remark, sizeof(remark), "%s", remark_start + 1);
-    }
 
-    char plugin[128] = "";
-    char plugin_opts[1024] = "";
-    char tag[128] = "";
-    char level[16] = "0";
-    char ota[16] = "false";
-    char network[16] = "tcp";
-    char security[16] = "none";
-    char host[2048] = "";
-    char sni[2048] = "";
-    char fingerprint[128] = "";
-    char public_key[2048] = "";
-    char header_type[16] = "none";
-
-    if (query_start < remark_start && *query_start == '?') {
-        const char* query = query_start + 1;
-        if (get_query_param(query, "plugin", plugin, sizeof(plugin))) {
-            get_query_param(query, "plugin-opts", plugin_opts, sizeof(plugin_opts));
-        }
-        get_query_param(query, "tag", tag, sizeof(tag));
-        get_query_param(query, "level", level, sizeof(level));
-        get_query_param(query, "ota", ota, sizeof(ota));
-        if (!get_query_param(query, "type", network, sizeof(network))) {
-            get_query_param(query, "network", network, sizeof(network));
-        }
-        get_query_param(query, "security", security, sizeof(security));
-        get_query_param(query, "host", host, sizeof(host));
-        get_query_param(query, "sni", sni, sizeof(sni));
-        get_query_param(query, "fp", fingerprint, sizeof(fingerprint));
-        get_query_param(query, "pbk", public_key, sizeof(public_key));
-        get_query_param(query, "headerType", header_type, sizeof(header_type));
+    StrView p[SP_COUNT];
+    memset(p, 0, sizeof(p));
+    p[SP_LEVEL] = SV_LIT("0");
+    p[SP_OTA] = SV_LIT("false");
+    p[SP_NETWORK] = SV_LIT("tcp");
+    p[SP_SECURITY] = SV_LIT("none");
+    p[SP_HEADER_TYPE] = SV_LIT("none");
+
+    StrView query = uri.query, key, value;
+    while (uri_next_param(&query, &key, &value)) {
+        int id = ss_param_id(key);
+        if (id >= 0 && ss_param_valid(id, value)) p[id] = value;
     }
 
-    if (!tag[0] && remark[0]) {
-        strncpy(tag, remark, sizeof(tag) - 1);
-        tag[sizeof(tag) - 1] = '\0';
-    }
+    StrView plugin = p[SP_PLUGIN];
+    StrView network = p[SP_TYPE].len ? p[SP_TYPE] : p[SP_NETWORK];
+    StrView security = p[SP_SECURITY];
+    StrView header_type = p[SP_HEADER_TYPE];
+    StrView host = p[SP_HOST];
+    StrView sni = p[SP_SNI];
+    StrView fingerprint = p[SP_FP];
+    StrView public_key = p[SP_PBK];
+    StrView tag = p[SP_TAG].len ? p[SP_TAG] : uri.fragment;
 
     fprintf(fp, "{\n");
     fprintf(fp, "  \"inbounds\": [\n");
@@ -449,94 +322,87 @@ EXPORT int parse_shadowsocks_string(const char* ss_str, FILE* fp, int http_port,
     fprintf(fp, "        \"port\": %d,\n", server_port);
     fprintf(fp, "        \"method\": \"%s\",\n", method);
     fprintf(fp, "        \"password\": \"%s\",\n", password);
-    fprintf(fp, "        \"ota\": %s,\n", strcmp(ota, "true") == 0 ? "true" : "false");
-    fprintf(fp, "        \"level\": %d\n", atoi(level));
+    fprintf(fp, "        \"ota\": %s,\n", sv_eq(p[SP_OTA], "true") ? "true" : "false");
+    fprintf(fp, "        \"level\": %d\n", sv_to_int(p[SP_LEVEL], 0));
     fprintf(fp, "      }]\n");
     fprintf(fp, "    },\n");
 
     fprintf(fp, "    \"streamSettings\": {\n");
-    fprintf(fp, "      \"network\": \"%s\"", network);
+    fprintf(fp, "      \"network\": \"%.*s\"", SV_FMT(network));
     
     int need_comma = 0;
-    if (security[0]) {
-        fprintf(fp, ",\n      \"security\": \"%s\"", security);
+    if (security.len) {
+        fprintf(fp, ",\n      \"security\": \"%.*s\"", SV_FMT(security));
         need_comma = 1;
     }
 
-    if (strcmp(security, "tls") == 0) {
+    if (sv_eq(security, "tls")) {
         if (need_comma) fprintf(fp, ",");
         fprintf(fp, "\n      \"tlsSettings\": {");
         int first = 1;
-        if (sni[0]) {
-            fprintf(fp, "\"serverName\": \"%s\"", sni);
+        if (sni.len) {
+            fprintf(fp, "\"serverName\": \"%.*s\"", SV_FMT(sni));
             first = 0;
         }
-        if (fingerprint[0]) {
+        if (fingerprint.len) {
             if (!first) fprintf(fp, ", ");
-            fprintf(fp, "\"fingerprint\": \"%s\"", fingerprint);
+            fprintf(fp, "\"fingerprint\": \"%.*s\"", SV_FMT(fingerprint));
         }
         fprintf(fp, "}");
         need_comma = 1;
-    } else if (strcmp(security, "reality") == 0) {
+    } else if (sv_eq(security, "reality")) {
         if (need_comma) fprintf(fp, ",");
         fprintf(fp, "\n      \"realitySettings\": {");
         int first = 1;
-        if (public_key[0]) {
-            fprintf(fp, "\"publicKey\": \"%s\"", public_key);
+        if (public_key.len) {
+            fprintf(fp, "\"publicKey\": \"%.*s\"", SV_FMT(public_key));
             first = 0;
         }
-        if (fingerprint[0]) {
+        if (fingerprint.len) {
             if (!first) fprintf(fp, ", ");
-            fprintf(fp, "\"fingerprint\": \"%s\"", fingerprint);
+            fprintf(fp, "\"fingerprint\": \"%.*s\"", SV_FMT(fingerprint));
             first = 0;
         }
-        if (sni[0]) {
+        if (sni.len) {
             if (!first) fprintf(fp, ", ");
-            fprintf(fp, "\"serverName\": \"%s\"", sni);
+            fprintf(fp, "\"serverName\": \"%.*s\"", SV_FMT(sni));
         }
         fprintf(fp, "}");
         need_comma = 1;
     }
 
-    if (strcmp(network, "tcp") == 0) {
-        if (strcmp(header_type, "none") != 0) {
+    if (sv_eq(network, "tcp")) {
+        if (!sv_eq(header_type, "none")) {
             if (need_comma) fprintf(fp, ",");
-            fprintf(fp, "\n      \"tcpSettings\": {\"header\": {\"type\": \"%s\"}}", header_type);
+            fprintf(fp, "\n      \"tcpSettings\": {\"header\": {\"type\": \"%.*s\"}}", SV_FMT(header_type));
             need_comma = 1;
         }
-    } else if (strcmp(network, "ws") == 0) {
+    } else if (sv_eq(network, "ws")) {
         if (need_comma) fprintf(fp, ",");
         fprintf(fp, "\n      \"wsSettings\": {");
-        if (host[0]) fprintf(fp, "\"path\": \"%s\"", host);
+        if (host.len) fprintf(fp, "\"path\": \"%.*s\"", SV_FMT(host));
         fprintf(fp, "}");
         need_comma = 1;
-    } else if (strcmp(network, "http") == 0) {
+    } else if (sv_eq(network, "http")) {
         if (need_comma) fprintf(fp, ",");
         fprintf(fp, "\n      \"httpSettings\": {");
-        if (host[0]) fprintf(fp, "\"path\": \"%s\"", host);
+        if (host.len) fprintf(fp, "\"path\": \"%.*s\"", SV_FMT(host));
         fprintf(fp, "}");
         need_comma = 1;
     }
 
-    if (plugin[0]) {
+    if (plugin.len) {
         if (need_comma) fprintf(fp, ",");
-        fprintf(fp, "\n      \"plugin\": \"%s\"", plugin);
+        fprintf(fp, "\n      \"plugin\": \"%.*s\"", SV_FMT(plugin));
         fprintf(fp, ",\n      \"pluginOpts\": {");
-        if (plugin_opts[0]) {
-            char opts_copy[1024];
-            strncpy(opts_copy, plugin_opts, sizeof(opts_copy) - 1);
-            opts_copy[sizeof(opts_copy) - 1] = '\0';
-            char* opt = strtok(opts_copy, ";");
-            int first = 1;
-            while (opt) {
-                char* eq = strchr(opt, '=');
-                if (eq) {
-                    *eq = '\0';
-                    if (!first) fprintf(fp, ", ");
-                    fprintf(fp, "\"%s\": \"%s\"", opt, eq + 1);
-                    first = 0;
-                }
-                opt = strtok(NULL, ";");
+        StrView opts = p[SP_PLUGIN_OPTS];
+        StrView opt, opt_name;
+        int first = 1;
+        while (sv_split(&opts, ';', &opt)) {
+            if (sv_cut(&opt, '=', &opt_name)) {
+                if (!first) fprintf(fp, ", ");
+                fprintf(fp, "\"%.*s\": \"%.*s\"", SV_FMT(opt_name), SV_FMT(opt));
+                first = 0;
             }
         }
         fprintf(fp, "}");
@@ -545,17 +411,18 @@ EXPORT int parse_shadowsocks_string(const char* ss_str, FILE* fp, int http_port,
 
     fprintf(fp, "\n    },\n");
 
-    if (tag[0]) {
-        fprintf(fp, "    \"tag\": \"%s\",\n", tag);
+    if (tag.len) {
+        fprintf(fp, "    \"tag\": \"");
+        uri_write_decoded(fp, tag);
+        fprintf(fp, "\",\n");
     }
 
     fprintf(fp, "    \"protocol\": \"shadowsocks\"\n");
     fprintf(fp, "  }]\n");
     fprintf(fp, "}\n");
 
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "Address: %s, Port: %d, Method: %s, HTTP Port: %d, SOCKS Port: %d, Tag: %s",
-             address, server_port, method, final_http_port, final_socks_port, tag[0] ? tag : "none");
-    log_message("Shadowsocks config with full options written successfully", __FILE__, __LINE__, 0, extra_info);
+    LOG_DEBUGF("Shadowsocks config with full options written successfully", "Address: %s, Port: %d, Method: %s, HTTP Port: %d, SOCKS Port: %d, Tag: %.*s",
+             address, server_port, method, final_http_port, final_socks_port,
+             tag.len ? (int)tag.len : 4, tag.len ? tag.ptr : "none");
     return 0;
 }
\ No newline at end of file
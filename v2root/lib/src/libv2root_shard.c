@@ -0,0 +1,601 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET shard_socket_t;
+typedef WSAPOLLFD shard_pollfd_t;
+#define CLOSE_SOCKET closesocket
+#define SHARD_POLL(fds, n, ms) WSAPoll(fds, (ULONG)(n), ms)
+#define SHARD_IN_PROGRESS() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SEND_FLAGS 0
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+typedef int shard_socket_t;
+typedef struct pollfd shard_pollfd_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#define SHARD_POLL(fds, n, ms) poll(fds, (nfds_t)(n), ms)
+#define SHARD_IN_PROGRESS() (errno == EINPROGRESS)
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_shard.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_records.h"
+#include "libv2root_utils.h"
+
+#define SHARD_FRAME_HEADER sizeof(uint64_t)
+
+/* Coordinator side of one worker connection */
+typedef struct {
+    shard_socket_t fd;
+    int hello_done;                 /* 1 once the ShardHello was accepted */
+    int region;                     /* Region slot of the worker */
+    int expected;                   /* Frames announced in the hello */
+    int received;
+    size_t frame_size;              /* SHARD_FRAME_HEADER + the worker's record size */
+    size_t have;                    /* Bytes of the current message in buf */
+    char buf[SHARD_FRAME_HEADER + SHARD_MAX_RECORD_SIZE];
+} ShardConn;
+
+/* Worker state shared with the stream callback */
+typedef struct {
+    shard_socket_t fd;
+    const uint64_t* fingerprints;   /* Fingerprint of each config in the shard */
+    int failed;                     /* 1 after the connection was lost */
+    int sent;
+} ShardSender;
+
+/* Ranking key of one reported config */
+typedef struct {
+    int index;
+    int success;
+    double score;
+    int ttfb_ms;
+} ShardRank;
+
+static void shard_set_nonblocking(shard_socket_t fd, int on) {
+#ifdef _WIN32
+    u_long mode = on ? 1 : 0;
+    ioctlsocket(fd, FIONBIO, &mode);
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, on ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+#endif
+}
+
+static void shard_no_inherit(shard_socket_t fd) {
+    /* Keep the socket out of V2Ray processes started while it is open */
+#ifdef _WIN32
+    SetHandleInformation((HANDLE)fd, HANDLE_FLAG_INHERIT, 0);
+#else
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+}
+
+/* Sends all len bytes; returns 0, or -1 once the connection is lost */
+static int shard_send_all(shard_socket_t fd, const char* data, size_t len) {
+    while (len > 0) {
+        int n = send(fd, data, (int)len, SEND_FLAGS);
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Maps a fingerprint to its shard with the jump consistent hash of Lamping and Veach.
+ *
+ * Growing the shard count from N to N+1 moves 1/(N+1) of the fingerprints, all to the new
+ * shard, so the other workers keep the configs they already probed.
+ *
+ * Parameters:
+ *   fingerprint (uint64_t): v2root_config_fingerprint of a config.
+ *   shards (int): Number of shards (1..SHARD_MAX_SHARDS).
+ *
+ * Returns:
+ *   int: The shard, 0..shards-1, or -2 for an invalid shard count.
+ */
+EXPORT int v2root_shard_of(uint64_t fingerprint, int shards) {
+    if (shards <= 0 || shards > SHARD_MAX_SHARDS) return V2ROOT_ERROR_INVALID_INPUT;
+    int64_t bucket = -1, next = 0;
+    uint64_t key = fingerprint;
+    while (next < shards) {
+        bucket = next;
+        key = key * 2862933555777941757ULL + 1;
+        next = (int64_t)((double)(bucket + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+    }
+    return (int)bucket;
+}
+
+uint64_t shard_table_hash(const uint64_t* fingerprints, int n) {
+    FpIndex seen;
+    if (fp_index_init(&seen, (size_t)n) != 0) return 0;
+    uint64_t sum = 0, distinct = 0;
+    for (int i = 0; i < n; i++) {
+        if (fingerprints[i] == 0 || fp_index_insert(&seen, fingerprints[i], i) != -1) continue;
+        sum += fingerprints[i];
+        distinct++;
+    }
+    fp_index_free(&seen);
+    return sum ^ (distinct * 0x9e3779b97f4a7c15ULL);
+}
+
+/* Fingerprints every config; returns a malloc'd array, NULL on allocation failure */
+static uint64_t* shard_fingerprints(const char** configs, int n) {
+    uint64_t* fingerprints = malloc((size_t)n * sizeof(uint64_t));
+    if (!fingerprints) {
+        log_message("Failed to allocate fingerprints", __FILE__, __LINE__, 0, NULL);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) fingerprints[i] = v2root_config_fingerprint(configs[i]);
+    return fingerprints;
+}
+
+/* Connects to host:port within SHARD_CONNECT_TIMEOUT_MS; returns the blocking socket or INVALID_SOCKET */
+static shard_socket_t shard_connect(const char* host, int port) {
+    char port_str[16];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port_str, &hints, &res) != 0 || !res) {
+        log_message("Failed to resolve shard coordinator", __FILE__, __LINE__, 0, host);
+        return INVALID_SOCKET;
+    }
+    shard_socket_t fd = INVALID_SOCKET;
+    for (struct addrinfo* ai = res; ai && fd == INVALID_SOCKET; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == INVALID_SOCKET) continue;
+        shard_no_inherit(fd);
+        shard_set_nonblocking(fd, 1);
+        int connected = connect(fd, ai->ai_addr, (int)ai->ai_addrlen) == 0;
+        if (!connected && SHARD_IN_PROGRESS()) {
+            shard_pollfd_t pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            int error = 0;
+            socklen_t len = sizeof(error);
+            connected = SHARD_POLL(&pfd, 1, SHARD_CONNECT_TIMEOUT_MS) == 1 &&
+                        getsockopt(fd, SOL_SOCKET, SO_ERROR, (char*)&error, &len) == 0 && error == 0;
+        }
+        if (!connected) {
+            CLOSE_SOCKET(fd);
+            fd = INVALID_SOCKET;
+            continue;
+        }
+        shard_set_nonblocking(fd, 0);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+    }
+    freeaddrinfo(res);
+    if (fd == INVALID_SOCKET) {
+        log_message("Failed to connect to shard coordinator", __FILE__, __LINE__, errno, host);
+    }
+    return fd;
+}
+
+static void shard_send_record(const ProbeRecord* record, void* user_data) {
+    ShardSender* sender = (ShardSender*)user_data;
+    if (sender->failed) return;
+    ShardFrame frame;
+    frame.fingerprint = sender->fingerprints[record->index];
+    frame.record = *record;
+    if (shard_send_all(sender->fd, (const char*)&frame, sizeof(frame)) != 0) {
+        log_message("Lost connection to shard coordinator", __FILE__, __LINE__, errno, NULL);
+        sender->failed = 1;
+        return;
+    }
+    sender->sent++;
+}
+
+/*
+ * Probes this host's shard of a config table and streams the records to a coordinator.
+ *
+ * The shard is every config whose fingerprint v2root_shard_of maps to shard; configs that
+ * cannot be fingerprinted belong to no shard, and a fingerprint listed twice is probed once.
+ * Records go to the coordinator as each group of v2root_probe_stream completes, so the
+ * coordinator sees progress while V2Ray processes are still being started for later groups.
+ *
+ * Parameters:
+ *   coordinator (const char*): Host name or address of the coordinator.
+ *   port (int): Port the coordinator listens on.
+ *   configs (const char**): The full config table, the same set the coordinator loaded.
+ *   n (int): Number of configurations.
+ *   mode (int): One of the PROBE_MODE_* constants; PROBE_MODE_BATCH for proxied probes.
+ *   shard (int): Shard of this worker, 0..shards-1.
+ *   shards (int): Number of workers in the sweep (1..SHARD_MAX_SHARDS).
+ *   region (const char*): Region label the coordinator ranks this worker's records under.
+ *
+ * Returns:
+ *   int: Number of successful probes, -1 on failure, -2 for invalid input, -6 if the
+ *   coordinator could not be reached or the connection was lost.
+ *
+ * Errors:
+ *   Logs errors for invalid input, allocation failures and network failures.
+ */
+EXPORT int v2root_shard_worker(const char* coordinator, int port, const char** configs, int n, int mode,
+                               int shard, int shards, const char* region) {
+    if (!coordinator || port <= 0 || port > 65535 || !configs || n <= 0 || !region ||
+        shards <= 0 || shards > SHARD_MAX_SHARDS || shard < 0 || shard >= shards ||
+        mode < PROBE_MODE_QUICK || mode > PROBE_MODE_HANDSHAKE) {
+        log_message("Invalid arguments to v2root_shard_worker", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    uint64_t* fingerprints = shard_fingerprints(configs, n);
+    const char** own = malloc((size_t)n * sizeof(const char*));
+    uint64_t* own_fingerprints = malloc((size_t)n * sizeof(uint64_t));
+    FpIndex seen;
+    memset(&seen, 0, sizeof(seen));
+    if (!fingerprints || !own || !own_fingerprints || fp_index_init(&seen, (size_t)n) != 0) {
+        log_message("Failed to allocate shard table", __FILE__, __LINE__, 0, NULL);
+        free(fingerprints);
+        free(own);
+        free(own_fingerprints);
+        fp_index_free(&seen);
+        return V2ROOT_ERROR;
+    }
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (fingerprints[i] == 0 || v2root_shard_of(fingerprints[i], shards) != shard) continue;
+        if (fp_index_insert(&seen, fingerprints[i], i) != -1) continue;
+        own[count] = configs[i];
+        own_fingerprints[count] = fingerprints[i];
+        count++;
+    }
+    fp_index_free(&seen);
+
+    ShardHello hello;
+    memset(&hello, 0, sizeof(hello));
+    memcpy(hello.magic, SHARD_MAGIC, sizeof(hello.magic));
+    hello.version = SHARD_PROTOCOL_VERSION;
+    hello.byte_order = SHARD_BYTE_ORDER;
+    hello.record_size = (uint32_t)sizeof(ProbeRecord);
+    hello.mode = mode;
+    hello.shard = shard;
+    hello.shards = shards;
+    hello.count = count;
+    hello.table_hash = shard_table_hash(fingerprints, n);
+    strncpy(hello.region, region, sizeof(hello.region) - 1);
+    free(fingerprints);
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        free(own);
+        free(own_fingerprints);
+        return V2ROOT_ERROR;
+    }
+#endif
+    int result = V2ROOT_ERROR_NETWORK;
+    shard_socket_t fd = shard_connect(coordinator, port);
+    if (fd != INVALID_SOCKET && shard_send_all(fd, (const char*)&hello, sizeof(hello)) == 0) {
+        LOG_INFOF("Shard worker started", "Probing shard %d/%d (%d of %d configs) for region %s",
+                  shard, shards, count, n, hello.region);
+        ShardSender sender = { fd, own_fingerprints, 0, 0 };
+        result = count > 0 ? v2root_probe_stream(own, count, mode, shard_send_record, &sender) : 0;
+        if (result >= 0 && sender.failed) result = V2ROOT_ERROR_NETWORK;
+        LOG_INFOF("Shard worker finished", "Sent %d of %d records", sender.sent, count);
+    } else if (fd != INVALID_SOCKET) {
+        log_message("Failed to send shard hello", __FILE__, __LINE__, errno, coordinator);
+    }
+    if (fd != INVALID_SOCKET) CLOSE_SOCKET(fd);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    free(own);
+    free(own_fingerprints);
+    return result;
+}
+
+/* Returns the slot of region, adding it if there is room; -1 when max_regions are taken */
+static int shard_region_slot(char* regions, int* region_count, int max_regions, const char* region) {
+    for (int r = 0; r < *region_count; r++) {
+        if (strcmp(regions + (size_t)r * SHARD_REGION_LEN, region) == 0) return r;
+    }
+    if (*region_count >= max_regions) return -1;
+    char* slot = regions + (size_t)(*region_count) * SHARD_REGION_LEN;
+    memcpy(slot, region, SHARD_REGION_LEN);
+    return (*region_count)++;
+}
+
+/* Validates a hello received on conn; returns 0 after setting up the connection for frames */
+static int shard_accept_hello(ShardConn* conn, uint64_t table_hash, char* regions, int* region_count,
+                              int max_regions) {
+    ShardHello hello;
+    memcpy(&hello, conn->buf, sizeof(hello));
+    hello.region[SHARD_REGION_LEN - 1] = '\0';
+    if (memcmp(hello.magic, SHARD_MAGIC, sizeof(hello.magic)) != 0 || hello.byte_order != SHARD_BYTE_ORDER ||
+        hello.version != SHARD_PROTOCOL_VERSION) {
+        log_message("Rejected shard worker with an incompatible protocol", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    if (hello.record_size < PROBE_RECORD_MIN_SIZE || hello.record_size > SHARD_MAX_RECORD_SIZE || hello.count < 0) {
+        log_message("Rejected shard worker with an invalid record size", __FILE__, __LINE__, 0, hello.region);
+        return -1;
+    }
+    if (hello.table_hash != table_hash) {
+        log_message("Rejected shard worker probing a different config table", __FILE__, __LINE__, 0, hello.region);
+        return -1;
+    }
+    int region = shard_region_slot(regions, region_count, max_regions, hello.region);
+    if (region < 0) {
+        log_message("Rejected shard worker: too many regions", __FILE__, __LINE__, 0, hello.region);
+        return -1;
+    }
+    conn->hello_done = 1;
+    conn->region = region;
+    conn->expected = hello.count;
+    conn->frame_size = SHARD_FRAME_HEADER + hello.record_size;
+    LOG_INFOF("Shard worker connected", "Shard %d/%d of region %s, %d records", (int)hello.shard,
+              (int)hello.shards, hello.region, (int)hello.count);
+    return 0;
+}
+
+/* Stores the frame in conn->buf for every row of the table sharing its fingerprint */
+static void shard_merge_frame(ShardConn* conn, const FpIndex* index, const int* next_row, int n,
+                              void* out, size_t record_size) {
+    uint64_t fingerprint;
+    memcpy(&fingerprint, conn->buf, sizeof(fingerprint));
+    size_t bytes = conn->frame_size - SHARD_FRAME_HEADER;
+    ProbeRecord record;
+    memset(&record, 0, sizeof(record));
+    memcpy(&record, conn->buf + SHARD_FRAME_HEADER, bytes < sizeof(record) ? bytes : sizeof(record));
+    record.error_details[sizeof(record.error_details) - 1] = '\0';
+    if (record.error_code < 0 || record.error_code >= PROBE_CODE_COUNT) record.error_code = PROBE_CODE_UNKNOWN;
+    for (int row = fp_index_find(index, fingerprint); row >= 0; row = next_row[row]) {
+        record.index = row;
+        probe_record_store(out, record_size, conn->region * n + row, &record);
+    }
+}
+
+/* Reads what conn has buffered; returns 0 while it stays open, -1 once it is finished or rejected */
+static int shard_read(ShardConn* conn, uint64_t table_hash, const FpIndex* index, const int* next_row, int n,
+                      void* out, size_t record_size, char* regions, int* region_count, int max_regions) {
+    size_t need = conn->hello_done ? conn->frame_size : sizeof(ShardHello);
+    int got = recv(conn->fd, conn->buf + conn->have, (int)(need - conn->have), 0);
+    if (got <= 0) return -1;
+    conn->have += (size_t)got;
+    if (conn->have < need) return 0;
+    conn->have = 0;
+    if (!conn->hello_done) {
+        return shard_accept_hello(conn, table_hash, regions, region_count, max_regions);
+    }
+    if (conn->received < conn->expected) {
+        shard_merge_frame(conn, index, next_row, n, out, record_size);
+        conn->received++;
+    }
+    return conn->received < conn->expected ? 0 : -1;
+}
+
+static int shard_rank_compare(const void* a, const void* b) {
+    const ShardRank* x = (const ShardRank*)a;
+    const ShardRank* y = (const ShardRank*)b;
+    if (x->success != y->success) return y->success - x->success;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    if (x->ttfb_ms != y->ttfb_ms) return x->ttfb_ms - y->ttfb_ms;
+    return x->index - y->index;
+}
+
+/* Orders the reported rows of each region by success, score and TTFB; pads with -1 */
+static void shard_rank_regions(const void* out, size_t record_size, int n, int region_count, int max_regions,
+                               int* ranking) {
+    ShardRank* ranks = malloc((size_t)n * sizeof(ShardRank));
+    for (int r = 0; r < max_regions; r++) {
+        int* order = ranking + (size_t)r * n;
+        int count = 0;
+        for (int i = 0; ranks && r < region_count && i < n; i++) {
+            const ProbeRecord* record = (const ProbeRecord*)((const char*)out + ((size_t)r * n + i) * record_size);
+            if (record->error_code == PROBE_CODE_SKIPPED) continue;
+            ranks[count].index = i;
+            ranks[count].success = record->success ? 1 : 0;
+            ranks[count].score = record->score;
+            ranks[count].ttfb_ms = record->ttfb_ms;
+            count++;
+        }
+        if (count > 1) qsort(ranks, (size_t)count, sizeof(ShardRank), shard_rank_compare);
+        for (int i = 0; i < n; i++) order[i] = i < count ? ranks[i].index : -1;
+    }
+    if (!ranks) log_message("Failed to allocate shard ranking", __FILE__, __LINE__, 0, NULL);
+    free(ranks);
+}
+
+/* Opens a listening socket on every interface; INVALID_SOCKET on failure */
+static shard_socket_t shard_listen(int port) {
+    shard_socket_t fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd == INVALID_SOCKET) return fd;
+    shard_no_inherit(fd);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        CLOSE_SOCKET(fd);
+        return INVALID_SOCKET;
+    }
+    return fd;
+}
+
+/*
+ * Collects a sharded sweep from its workers and ranks every region.
+ *
+ * Listens on port on every interface until workers connections that sent a valid hello have
+ * finished, or timeout_ms has passed, merging each frame into the rows of configs with its
+ * fingerprint as it arrives. Workers of the same region fill the same record set; each
+ * region's set is ranked on its own, so a node that is fast from one egress and blocked from
+ * another ranks accordingly in each.
+ *
+ * Parameters:
+ *   port (int): Port to listen on (1..65535).
+ *   configs (const char**): The config table the workers were given.
+ *   n (int): Number of configurations.
+ *   workers (int): Worker connections to wait for (1..SHARD_MAX_WORKERS).
+ *   timeout_ms (int): Longest the sweep may take; <= 0 for SHARD_DEFAULT_TIMEOUT_MS.
+ *   out (void*): Caller array of max_regions * n records of record_size bytes; region r's
+ *                record for configs[i] is slot r * n + i. Rows no worker reported keep
+ *                error_code PROBE_CODE_SKIPPED.
+ *   record_size (size_t): The caller's sizeof(ProbeRecord) (at least PROBE_RECORD_MIN_SIZE).
+ *   regions (char*): Caller array of max_regions * SHARD_REGION_LEN bytes receiving the
+ *                    terminated region labels, in the order the regions first connected.
+ *   max_regions (int): Number of regions out and regions hold.
+ *   ranking (int*): Optional caller array of max_regions * n ints; row r lists the indices of
+ *                   configs reported for region r, best first, padded with -1.
+ *
+ * Returns:
+ *   int: Number of regions that reported, -1 on failure, -2 for invalid input, -6 if the
+ *   port cannot be opened.
+ *
+ * Errors:
+ *   Logs errors for invalid input, allocation and socket failures, rejected workers and a
+ *   sweep that timed out before every worker finished.
+ */
+EXPORT int v2root_shard_coordinate(int port, const char** configs, int n, int workers, int timeout_ms,
+                                   void* out, size_t record_size, char* regions, int max_regions, int* ranking) {
+    if (port <= 0 || port > 65535 || !configs || n <= 0 || workers <= 0 || workers > SHARD_MAX_WORKERS ||
+        !out || record_size < PROBE_RECORD_MIN_SIZE || !regions || max_regions <= 0) {
+        log_message("Invalid arguments to v2root_shard_coordinate", __FILE__, __LINE__, 0, NULL);
+        return V2ROOT_ERROR_INVALID_INPUT;
+    }
+    uint64_t* fingerprints = shard_fingerprints(configs, n);
+    int* next_row = malloc((size_t)n * sizeof(int));
+    ShardConn* conns = calloc(SHARD_MAX_WORKERS, sizeof(ShardConn));
+    shard_pollfd_t* pfds = calloc(SHARD_MAX_WORKERS + 1, sizeof(shard_pollfd_t));
+    FpIndex index;
+    memset(&index, 0, sizeof(index));
+    if (!fingerprints || !next_row || !conns || !pfds || fp_index_init(&index, (size_t)n) != 0) {
+        log_message("Failed to allocate shard coordinator", __FILE__, __LINE__, 0, NULL);
+        free(fingerprints);
+        free(next_row);
+        free(conns);
+        free(pfds);
+        fp_index_free(&index);
+        return V2ROOT_ERROR;
+    }
+    /* Rows sharing a fingerprint are chained from the first one, which the index holds */
+    for (int i = 0; i < n; i++) {
+        next_row[i] = -1;
+        if (fingerprints[i] == 0) continue;
+        int first = fp_index_insert(&index, fingerprints[i], i);
+        if (first >= 0) {
+            next_row[i] = next_row[first];
+            next_row[first] = i;
+        }
+    }
+    uint64_t table_hash = shard_table_hash(fingerprints, n);
+    free(fingerprints);
+
+    ProbeRecord skipped;
+    for (int r = 0; r < max_regions; r++) {
+        for (int i = 0; i < n; i++) {
+            probe_record_init(&skipped, i);
+            skipped.error_code = PROBE_CODE_SKIPPED;
+            probe_record_store(out, record_size, r * n + i, &skipped);
+        }
+    }
+    memset(regions, 0, (size_t)max_regions * SHARD_REGION_LEN);
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        free(next_row);
+        free(conns);
+        free(pfds);
+        fp_index_free(&index);
+        return V2ROOT_ERROR;
+    }
+#endif
+    shard_socket_t listener = shard_listen(port);
+    if (listener == INVALID_SOCKET) {
+        char port_str[16];
+        snprintf(port_str, sizeof(port_str), "%d", port);
+        log_message("Failed to listen on shard coordinator port", __FILE__, __LINE__, errno, port_str);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        free(next_row);
+        free(conns);
+        free(pfds);
+        fp_index_free(&index);
+        return V2ROOT_ERROR_NETWORK;
+    }
+    LOG_INFOF("Shard coordinator started", "Waiting for %d workers on port %d for %d configs", workers, port, n);
+
+    long long deadline = get_monotonic_ms() + (timeout_ms > 0 ? timeout_ms : SHARD_DEFAULT_TIMEOUT_MS);
+    int region_count = 0, open = 0, finished = 0;
+    while (finished < workers) {
+        long long remaining = deadline - get_monotonic_ms();
+        if (remaining <= 0) {
+            log_message("Shard sweep timed out before every worker finished", __FILE__, __LINE__, 0, NULL);
+            break;
+        }
+        pfds[0].fd = listener;
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        for (int c = 0; c < open; c++) {
+            pfds[c + 1].fd = conns[c].fd;
+            pfds[c + 1].events = POLLIN;
+            pfds[c + 1].revents = 0;
+        }
+        int ready = SHARD_POLL(pfds, open + 1, remaining < SHARD_POLL_MS ? (int)remaining : SHARD_POLL_MS);
+        if (ready <= 0) continue;
+        /* Connections are compacted from the end, so walk them backwards */
+        for (int c = open - 1; c >= 0; c--) {
+            if (!(pfds[c + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ShardConn* conn = &conns[c];
+            if (shard_read(conn, table_hash, &index, next_row, n, out, record_size, regions, &region_count,
+                           max_regions) == 0) {
+                continue;
+            }
+            if (conn->hello_done) {
+                finished++;
+                if (conn->received < conn->expected) {
+                    LOG_WARNINGF("Shard worker disconnected early", "Received %d of %d records for region %s",
+                              conn->received, conn->expected, regions + (size_t)conn->region * SHARD_REGION_LEN);
+                }
+            }
+            CLOSE_SOCKET(conn->fd);
+            conns[c] = conns[--open];
+        }
+        if ((pfds[0].revents & POLLIN) && open < SHARD_MAX_WORKERS) {
+            shard_socket_t client = accept(listener, NULL, NULL);
+            if (client != INVALID_SOCKET) {
+                shard_no_inherit(client);
+                memset(&conns[open], 0, sizeof(ShardConn));
+                conns[open].fd = client;
+                open++;
+            }
+        }
+    }
+    for (int c = 0; c < open; c++) CLOSE_SOCKET(conns[c].fd);
+    CLOSE_SOCKET(listener);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    if (ranking) shard_rank_regions(out, record_size, n, region_count, max_regions, ranking);
+    LOG_INFOF("Shard coordinator finished", "%d of %d workers finished, %d regions", finished, workers, region_count);
+    free(next_row);
+    free(conns);
+    free(pfds);
+    fp_index_free(&index);
+    return region_count;
+}
@@ -0,0 +1,75 @@
+#ifndef LIBV2ROOT_SHARD_H
+#define LIBV2ROOT_SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sharded sweeps across several hosts.
+ *
+ * Every host loads the same config table. The table is split into shards by config
+ * fingerprint with a jump consistent hash, so each host can work out its own shard without
+ * coordination and adding a host moves only 1/N of the configs. A worker probes the configs
+ * of its shard through v2root_probe_stream, each fingerprint once, and streams one ShardFrame
+ * per probed fingerprint to the coordinator over TCP as each group completes. The coordinator
+ * maps fingerprints back to rows of its own table with an FpIndex, keeps one record set per
+ * worker region and ranks every region separately.
+ *
+ * The wire format is the ShardHello followed by that many frames, in the worker's byte
+ * order. The coordinator closes the connection of a worker whose byte order, protocol
+ * version or table hash differ from its own; nothing else is sent back, so a rejection only
+ * shows in the coordinator's log. There is no authentication: the coordinator port must
+ * only be reachable by the workers.
+ */
+
+#define SHARD_MAGIC "V2RSHARD"
+#define SHARD_PROTOCOL_VERSION 1
+#define SHARD_BYTE_ORDER 0x01020304u         /* Read back as another value by a host of the other byte order */
+#define SHARD_REGION_LEN 32
+#define SHARD_MAX_SHARDS 1024
+#define SHARD_MAX_WORKERS 256               /* Workers connected to a coordinator at once */
+#define SHARD_MAX_RECORD_SIZE 4096          /* Largest ProbeRecord a coordinator accepts */
+#define SHARD_CONNECT_TIMEOUT_MS 10000
+#define SHARD_DEFAULT_TIMEOUT_MS 3600000    /* Whole sweep, when the coordinator is given no timeout */
+#define SHARD_POLL_MS 500
+
+/* First message of a worker connection */
+typedef struct {
+    char magic[8];                  /* SHARD_MAGIC, not terminated */
+    uint32_t version;               /* SHARD_PROTOCOL_VERSION */
+    uint32_t byte_order;            /* SHARD_BYTE_ORDER */
+    uint32_t record_size;           /* sizeof(ProbeRecord) of the worker */
+    int32_t mode;                   /* PROBE_MODE_* the worker probes with */
+    int32_t shard;                  /* Shard of this worker, 0..shards-1 */
+    int32_t shards;
+    int32_t count;                  /* Frames that follow */
+    int32_t reserved;
+    uint64_t table_hash;            /* shard_table_hash of the worker's config table */
+    char region[SHARD_REGION_LEN];  /* Region label of the worker, terminated */
+} ShardHello;
+
+/* Every following message: fingerprint, then record_size bytes of the worker's ProbeRecord */
+typedef struct {
+    uint64_t fingerprint;           /* v2root_config_fingerprint of the probed config */
+    ProbeRecord record;
+} ShardFrame;
+
+/* Order-independent hash of the distinct non-zero fingerprints of a table */
+uint64_t shard_table_hash(const uint64_t* fingerprints, int n);
+
+EXPORT int v2root_shard_of(uint64_t fingerprint, int shards);
+EXPORT int v2root_shard_worker(const char* coordinator, int port, const char** configs, int n, int mode,
+                               int shard, int shards, const char* region);
+EXPORT int v2root_shard_coordinate(int port, const char** configs, int n, int workers, int timeout_ms,
+                                   void* out, size_t record_size, char* regions, int max_regions, int* ranking);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_SHARD_H */
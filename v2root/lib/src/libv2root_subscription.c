@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "libv2root_arena.h"
+#include "libv2root_common.h"
+#include "libv2root_subscription.h"
+#include "libv2root_uri.h"
+#include "libv2root_base64.h"
+#include "libv2root_fingerprint.h"
+#include "libv2root_utils.h"
+
+#define SUB_ALIGN(n) (((n) + (size_t)7) & ~(size_t)7)
+
+/* Bytes of column storage per record: hash, line_offset, host_offset, port, protocol, transport, security */
+#define SUB_COLUMN_BYTES (sizeof(uint64_t) + 2 * sizeof(uint32_t) + sizeof(uint16_t) + 3)
+
+/* Per-call parse state */
+typedef struct {
+    V2ConfigTable* table;
+    size_t pool_used;
+    char* scratch;              /* Reused decode buffer for VMess and legacy Shadowsocks bodies */
+    size_t scratch_size;
+} SubParser;
+
+/* 64-bit FNV-1a; identifies lines config_fingerprint cannot parse */
+static uint64_t sub_hash(const char* s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* A body holding share links in the clear has a "://" in it; anything else is treated as base64 */
+static int sub_body_is_plain(const char* body, size_t len) {
+    for (size_t i = 0; i + 2 < len; i++) {
+        if (body[i] == ':' && body[i + 1] == '/' && body[i + 2] == '/') return 1;
+    }
+    return 0;
+}
+
+static uint8_t sub_transport(StrView v) {
+    if (v.len == 0 || sv_eq(v, "tcp") || sv_eq(v, "raw")) return V2_NET_TCP;
+    if (sv_eq(v, "ws")) return V2_NET_WS;
+    if (sv_eq(v, "http") || sv_eq(v, "h2")) return V2_NET_HTTP;
+    if (sv_eq(v, "grpc")) return V2_NET_GRPC;
+    if (sv_eq(v, "kcp") || sv_eq(v, "mkcp")) return V2_NET_KCP;
+    if (sv_eq(v, "quic")) return V2_NET_QUIC;
+    return V2_NET_OTHER;
+}
+
+static uint8_t sub_security(StrView v) {
+    if (sv_eq(v, "tls")) return V2_SEC_TLS;
+    if (sv_eq(v, "reality")) return V2_SEC_REALITY;
+    return V2_SEC_NONE;
+}
+
+/* Reads the transport and security keys shared by VLESS and Shadowsocks query strings */
+static void sub_scan_params(StrView query, uint8_t* transport, uint8_t* security) {
+    StrView key, value, network = { NULL, 0 };
+    int have_type = 0;
+    while (uri_next_param(&query, &key, &value)) {
+        if (sv_eq(key, "type")) {
+            network = value;
+            have_type = 1;
+        } else if (sv_eq(key, "network") && !have_type) {
+            network = value;
+        } else if (sv_eq(key, "security")) {
+            *security = sub_security(value);
+        }
+    }
+    *transport = sub_transport(network);
+}
+
+/* Copies a host into the pool; the pool is sized so every record's host fits */
+static uint32_t sub_pool_add(SubParser* p, StrView v) {
+    uint32_t offset = (uint32_t)p->pool_used;
+    memcpy(p->table->pool + p->pool_used, v.ptr, v.len);
+    p->table->pool[p->pool_used + v.len] = '\0';
+    p->pool_used += v.len + 1;
+    return offset;
+}
+
+/* Decodes a base64 view into the scratch buffer as a NUL-terminated string */
+static int sub_decode(SubParser* p, StrView v) {
+    size_t need = BASE64_DECODED_MAX(v.len) + 1;
+    if (need > p->scratch_size) {
+        char* grown = realloc(p->scratch, need);
+        if (!grown) return -1;
+        p->scratch = grown;
+        p->scratch_size = need;
+    }
+    int n = base64_decode_into(v.ptr, v.len, (unsigned char*)p->scratch, need - 1);
+    if (n < 0) return -1;
+    p->scratch[n] = '\0';
+    return n;
+}
+
+/*
+ * Extracts host, port, transport and security from a VMess body.
+ *
+ * Returns:
+ *   int: 0 if host and port were found, -1 otherwise (the record keeps port 0).
+ */
+static int sub_parse_vmess(SubParser* p, StrView body, StrView* host, int* port, uint8_t* transport, uint8_t* security) {
+    if (sub_decode(p, body) <= 0) return -1;
+    ArenaMark scratch = arena_begin();
+    cJSON* json = cJSON_Parse(p->scratch);
+    if (!json) {
+        arena_end(scratch);
+        return -1;
+    }
+    cJSON* add = cJSON_GetObjectItem(json, "add");
+    cJSON* port_item = cJSON_GetObjectItem(json, "port");
+    cJSON* net = cJSON_GetObjectItem(json, "net");
+    cJSON* tls = cJSON_GetObjectItem(json, "tls");
+    int rc = -1;
+    if (cJSON_IsString(net)) *transport = sub_transport((StrView){ net->valuestring, strlen(net->valuestring) });
+    if (cJSON_IsString(tls)) *security = sub_security((StrView){ tls->valuestring, strlen(tls->valuestring) });
+    if (cJSON_IsString(add) && add->valuestring[0]) {
+        if (cJSON_IsNumber(port_item)) {
+            *port = port_item->valueint;
+        } else if (cJSON_IsString(port_item)) {
+            *port = sv_to_port((StrView){ port_item->valuestring, strlen(port_item->valuestring) });
+        }
+        if (*port > 0 && *port <= 65535) {
+            /* Reuse the scratch buffer for the host: it is copied to the pool before the next decode */
+            size_t n = strlen(add->valuestring);
+            memmove(p->scratch, add->valuestring, n);
+            *host = (StrView){ p->scratch, n };
+            rc = 0;
+        }
+    }
+    cJSON_Delete(json);
+    arena_end(scratch);
+    return rc;
+}
+
+/*
+ * Parses one trimmed, NUL-terminated line into record i.
+ *
+ * Returns:
+ *   int: 1 if the line was recorded, 0 if it is not a share link.
+ */
+static int sub_parse_line(SubParser* p, int i, char* line, size_t len) {
+    V2ConfigTable* t = p->table;
+    UriParts uri;
+    if (uri_split(line, len, &uri) != 0) return 0;
+
+    uint8_t protocol = V2_PROTO_UNKNOWN;
+    if (sv_eq(uri.scheme, "vless")) protocol = V2_PROTO_VLESS;
+    else if (sv_eq(uri.scheme, "vmess")) protocol = V2_PROTO_VMESS;
+    else if (sv_eq(uri.scheme, "ss")) protocol = V2_PROTO_SHADOWSOCKS;
+
+    StrView host = { "", 0 };
+    int port = 0;
+    uint8_t transport = V2_NET_TCP;
+    uint8_t security = V2_SEC_NONE;
+
+    if (protocol == V2_PROTO_VMESS) {
+        if (sub_parse_vmess(p, uri.body, &host, &port, &transport, &security) != 0) {
+            host = (StrView){ "", 0 };
+            port = 0;
+        }
+    } else {
+        StrView authority = uri.body;
+        const char* slash = memchr(authority.ptr, '/', authority.len);
+        if (slash) authority.len = (size_t)(slash - authority.ptr);
+        int n = -1;
+        if (protocol == V2_PROTO_SHADOWSOCKS && base64_is_encoded(authority.ptr, authority.len)) {
+            n = sub_decode(p, authority);
+            if (n > 0) authority = (StrView){ p->scratch, (size_t)n };
+        }
+        if (uri_parse_authority(authority.ptr, authority.len, &uri) == 0) {
+            port = sv_to_port(uri.port);
+            if (port > 0) host = uri.host;
+            else port = 0;
+        }
+        sub_scan_params(uri.query, &transport, &security);
+    }
+
+    uint64_t hash = config_fingerprint(line, len);
+    if (hash == 0) {
+        StrView hashed = { line, len };
+        if (uri.fragment.len) hashed.len = (size_t)(uri.fragment.ptr - 1 - line);
+        hash = sub_hash(hashed.ptr, hashed.len);
+    }
+
+    t->hash[i] = hash;
+    t->line_offset[i] = (uint32_t)(line - t->text);
+    t->host_offset[i] = sub_pool_add(p, host);
+    t->port[i] = (uint16_t)port;
+    t->protocol[i] = protocol;
+    t->transport[i] = transport;
+    t->security[i] = security;
+    return 1;
+}
+
+/*
+ * Parses a whole subscription body into a compact config table.
+ *
+ * The body may be the share links themselves or base64 of them. It is decoded once into the
+ * table's arena, split into lines in place, and each vless://, vmess:// and ss:// line is
+ * reduced to protocol, host, port, transport, security and its canonical fingerprint. Lines with
+ * other schemes are kept with V2_PROTO_UNKNOWN; lines without a scheme are skipped.
+ *
+ * Parameters:
+ *   body (const char*): The subscription body as fetched; need not be NUL-terminated.
+ *   len (size_t): Length of body in bytes.
+ *   out (V2ConfigTable**): Receives the table; release it with v2root_free_config_table.
+ *
+ * Returns:
+ *   int: Number of records on success, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for invalid arguments, bodies that are neither share links nor base64,
+ *   oversized bodies and allocation failures.
+ */
+EXPORT int v2root_parse_subscription(const char* body, size_t len, V2ConfigTable** out) {
+    if (!body || !out) {
+        log_message("Invalid arguments to v2root_parse_subscription", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    *out = NULL;
+    if (len > UINT32_MAX / 2) {
+        log_message("Subscription body too large", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+
+    int plain = sub_body_is_plain(body, len);
+    size_t head = SUB_ALIGN(sizeof(V2ConfigTable));
+    size_t text_cap = plain ? len : BASE64_DECODED_MAX(len);
+    char* arena = malloc(head + text_cap + 1);
+    if (!arena) {
+        log_message("Failed to allocate subscription table", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+
+    char* text = arena + head;
+    size_t text_len = len;
+    if (plain) {
+        memcpy(text, body, len);
+    } else {
+        int n = base64_decode_into(body, len, (unsigned char*)text, text_cap);
+        if (n < 0) {
+            log_message("Subscription body is neither share links nor base64", __FILE__, __LINE__, 0, NULL);
+            free(arena);
+            return -1;
+        }
+        text_len = (size_t)n;
+    }
+    text[text_len] = '\0';
+
+    size_t lines = 1;
+    for (const char* c = text; (c = memchr(c, '\n', text_len - (size_t)(c - text))) != NULL; c++) lines++;
+
+    /* Grow the arena once for the columns and the host pool; everything is addressed by offset */
+    size_t columns_at = head + SUB_ALIGN(text_len + 1);
+    size_t pool_at = columns_at + SUB_ALIGN(lines * SUB_COLUMN_BYTES);
+    char* grown = realloc(arena, pool_at + text_len + lines + 1);
+    if (!grown) {
+        log_message("Failed to allocate subscription table", __FILE__, __LINE__, 0, NULL);
+        free(arena);
+        return -1;
+    }
+    arena = grown;
+
+    V2ConfigTable* table = (V2ConfigTable*)arena;
+    memset(table, 0, sizeof(V2ConfigTable));
+    table->text = arena + head;
+    char* column = arena + columns_at;
+    table->hash = (uint64_t*)column;
+    column += lines * sizeof(uint64_t);
+    table->line_offset = (uint32_t*)column;
+    column += lines * sizeof(uint32_t);
+    table->host_offset = (uint32_t*)column;
+    column += lines * sizeof(uint32_t);
+    table->port = (uint16_t*)column;
+    column += lines * sizeof(uint16_t);
+    table->protocol = (uint8_t*)column;
+    column += lines;
+    table->transport = (uint8_t*)column;
+    column += lines;
+    table->security = (uint8_t*)column;
+    table->pool = arena + pool_at;
+
+    SubParser parser = { table, 0, NULL, 0 };
+    text = table->text;
+    size_t start = 0;
+    while (start <= text_len) {
+        char* nl = memchr(text + start, '\n', text_len - start);
+        size_t end = nl ? (size_t)(nl - text) : text_len;
+        size_t s = start;
+        size_t e = end;
+        while (s < e && (text[s] == ' ' || text[s] == '\t' || text[s] == '\r')) s++;
+        while (e > s && (text[e - 1] == ' ' || text[e - 1] == '\t' || text[e - 1] == '\r')) e--;
+        text[e] = '\0';
+        if (e > s) {
+            if (sub_parse_line(&parser, table->count, text + s, e - s)) table->count++;
+            else table->skipped++;
+        }
+        start = end + 1;
+    }
+    free(parser.scratch);
+
+    LOG_DEBUGF("Subscription parsed", "%d records, %d skipped lines, %s body",
+             table->count, table->skipped, plain ? "plain" : "base64");
+    *out = table;
+    return table->count;
+}
+
+/*
+ * Releases a table returned by v2root_parse_subscription.
+ *
+ * Parameters:
+ *   table (V2ConfigTable*): The table; NULL is ignored.
+ *
+ * Returns:
+ *   None
+ */
+EXPORT void v2root_free_config_table(V2ConfigTable* table) {
+    free(table);
+}
+
+/* Returns the number of records in a table, or 0 for NULL */
+EXPORT int v2root_config_count(const V2ConfigTable* table) {
+    return table ? table->count : 0;
+}
+
+/*
+ * Reads one record of a table.
+ *
+ * Iterating index from 0 to v2root_config_count() - 1 visits the records in subscription order.
+ *
+ * Parameters:
+ *   table (const V2ConfigTable*): The table.
+ *   index (int): The record index.
+ *   out (V2ConfigRecord*): Receives the record; its strings point into the table.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the arguments are invalid or index is out of range.
+ */
+EXPORT int v2root_config_get(const V2ConfigTable* table, int index, V2ConfigRecord* out) {
+    if (!table || !out || index < 0 || index >= table->count) return -1;
+    out->config = table->text + table->line_offset[index];
+    out->host = table->pool + table->host_offset[index];
+    out->port = table->port[index];
+    out->protocol = table->protocol[index];
+    out->transport = table->transport[index];
+    out->security = table->security[index];
+    out->hash = table->hash[index];
+    return 0;
+}
+
+/*
+ * Removes records whose fingerprint matches an earlier record.
+ *
+ * The first occurrence of each config is kept and the table is compacted in place, preserving
+ * subscription order. Duplicates are found through an FpIndex, so the pass is O(n).
+ *
+ * Parameters:
+ *   table (V2ConfigTable*): The table to compact.
+ *
+ * Returns:
+ *   int: Number of records removed, -1 on failure.
+ *
+ * Errors:
+ *   Logs errors for invalid arguments or allocation failures.
+ */
+EXPORT int v2root_config_dedupe(V2ConfigTable* table) {
+    if (!table) {
+        log_message("Invalid arguments to v2root_config_dedupe", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    FpIndex index;
+    if (fp_index_init(&index, (size_t)table->count) != 0) {
+        log_message("Failed to allocate fingerprint index", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    int kept = 0;
+    for (int i = 0; i < table->count; i++) {
+        if (fp_index_insert(&index, table->hash[i], i) != -1) continue;
+        table->hash[kept] = table->hash[i];
+        table->line_offset[kept] = table->line_offset[i];
+        table->host_offset[kept] = table->host_offset[i];
+        table->port[kept] = table->port[i];
+        table->protocol[kept] = table->protocol[i];
+        table->transport[kept] = table->transport[i];
+        table->security[kept] = table->security[i];
+        kept++;
+    }
+    fp_index_free(&index);
+
+    int removed = table->count - kept;
+    table->count = kept;
+    LOG_DEBUGF("Subscription deduplicated", "%d duplicates removed, %d kept", removed, kept);
+    return removed;
+}
@@ -0,0 +1,73 @@
+#ifndef LIBV2ROOT_SUBSCRIPTION_H
+#define LIBV2ROOT_SUBSCRIPTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Record protocol codes */
+#define V2_PROTO_UNKNOWN 0      /* Any other scheme:// line, kept so callers can filter it */
+#define V2_PROTO_VLESS 1
+#define V2_PROTO_VMESS 2
+#define V2_PROTO_SHADOWSOCKS 3
+
+/* Record transport codes */
+#define V2_NET_TCP 0
+#define V2_NET_WS 1
+#define V2_NET_HTTP 2           /* http and h2 */
+#define V2_NET_GRPC 3
+#define V2_NET_KCP 4
+#define V2_NET_QUIC 5
+#define V2_NET_OTHER 6
+
+/* Record security codes */
+#define V2_SEC_NONE 0
+#define V2_SEC_TLS 1
+#define V2_SEC_REALITY 2
+
+/*
+ * Parsed subscription as a struct of arrays.
+ *
+ * The header, the config text, every column and the host pool live in one allocation, so a
+ * table is released with a single v2root_free_config_table call. Offsets index text and pool.
+ */
+typedef struct {
+    int count;                  /* Records in the table */
+    int skipped;                /* Non-empty lines that were not share links */
+    uint64_t* hash;             /* config_fingerprint of the line, for deduplication */
+    uint32_t* line_offset;      /* NUL-terminated config line in text */
+    uint32_t* host_offset;      /* NUL-terminated server host in pool */
+    uint16_t* port;             /* 0 if the endpoint could not be parsed */
+    uint8_t* protocol;          /* V2_PROTO_* */
+    uint8_t* transport;         /* V2_NET_* */
+    uint8_t* security;          /* V2_SEC_* */
+    char* text;
+    char* pool;
+} V2ConfigTable;
+
+/* One row of a table; the strings point into the table and live as long as it does */
+typedef struct {
+    const char* config;
+    const char* host;
+    int port;
+    int protocol;
+    int transport;
+    int security;
+    uint64_t hash;
+} V2ConfigRecord;
+
+EXPORT int v2root_parse_subscription(const char* body, size_t len, V2ConfigTable** out);
+EXPORT void v2root_free_config_table(V2ConfigTable* table);
+EXPORT int v2root_config_count(const V2ConfigTable* table);
+EXPORT int v2root_config_get(const V2ConfigTable* table, int index, V2ConfigRecord* out);
+EXPORT int v2root_config_dedupe(V2ConfigTable* table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_SUBSCRIPTION_H */
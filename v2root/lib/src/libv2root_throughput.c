@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winhttp.h>
+#else
+#include <curl/curl.h>
+#include "libv2root_http.h"
+#endif
+
+#include "libv2root_common.h"
+#include "libv2root_throughput.h"
+#include "libv2root_utils.h"
+
+#define THROUGHPUT_POLL_MS 50
+#define THROUGHPUT_BUFFER_SIZE 65536
+
+/* Windowed view of the bytes received by all streams of one probe */
+typedef struct {
+    long long start_ms;                         /* Probe start */
+    long long deadline_ms;                      /* start_ms + budget */
+    long long first_byte_ms;                    /* First byte of any stream, 0 before */
+    long long window_ms;                        /* Start of the open window */
+    long long window_bytes;                     /* Bytes received before the open window */
+    long long measure_ms;                       /* End of the warm-up, 0 before */
+    long long measure_bytes;                    /* Bytes received during the warm-up */
+    double rates[THROUGHPUT_STABLE_WINDOWS];    /* Mbps of the latest windows after warm-up */
+    int windows;                                /* Windows closed after warm-up */
+    int stalled;                                /* 1 while windows keep coming up empty */
+    int stalls;                                 /* Runs of empty windows after the first byte */
+    int stable;                                 /* 1 once the latest windows agree */
+} ThroughputMeter;
+
+static void meter_start(ThroughputMeter* meter, int budget_ms) {
+    memset(meter, 0, sizeof(*meter));
+    meter->start_ms = get_monotonic_ms();
+    meter->deadline_ms = meter->start_ms + budget_ms;
+    meter->window_ms = meter->start_ms;
+}
+
+/* Closes the open window if it is due; returns 1 when the probe should stop */
+static int meter_update(ThroughputMeter* meter, long long bytes) {
+    long long now = get_monotonic_ms();
+    if (bytes > 0 && meter->first_byte_ms == 0) {
+        meter->first_byte_ms = now;
+        meter->window_ms = now;
+    }
+    if (meter->first_byte_ms > 0 && now - meter->window_ms >= THROUGHPUT_WINDOW_MS) {
+        long long delta = bytes - meter->window_bytes;
+        if (delta == 0) {
+            if (!meter->stalled) meter->stalls++;
+            meter->stalled = 1;
+        } else {
+            meter->stalled = 0;
+        }
+        if (meter->measure_ms == 0 && now - meter->first_byte_ms >= THROUGHPUT_WARMUP_MS) {
+            meter->measure_ms = now;
+            meter->measure_bytes = bytes;
+        } else if (meter->measure_ms > 0) {
+            double rate = (double)delta * 8.0 / ((double)(now - meter->window_ms) * 1000.0);
+            meter->rates[meter->windows % THROUGHPUT_STABLE_WINDOWS] = rate;
+            meter->windows++;
+            if (meter->windows >= THROUGHPUT_STABLE_WINDOWS) {
+                double mean = 0.0, spread = 0.0;
+                for (int i = 0; i < THROUGHPUT_STABLE_WINDOWS; i++) mean += meter->rates[i];
+                mean /= THROUGHPUT_STABLE_WINDOWS;
+                for (int i = 0; i < THROUGHPUT_STABLE_WINDOWS; i++) {
+                    double deviation = meter->rates[i] > mean ? meter->rates[i] - mean : mean - meter->rates[i];
+                    if (deviation > spread) spread = deviation;
+                }
+                meter->stable = mean > 0.0 && spread <= THROUGHPUT_STABLE_TOLERANCE * mean;
+            }
+        }
+        meter->window_ms = now;
+        meter->window_bytes = bytes;
+    }
+    return meter->stable || now >= meter->deadline_ms;
+}
+
+/*
+ * Fills result from the meter. Throughput is averaged over the windows after the warm-up,
+ * or over everything since the first byte when the probe ended during the warm-up.
+ */
+static int meter_finish(const ThroughputMeter* meter, long long bytes, int streams, ProbeResult* result) {
+    long long now = get_monotonic_ms();
+    result->attempts = streams;
+    result->total_ms = (int)(now - meter->start_ms);
+    result->stalls = meter->stalls;
+    if (bytes <= 0 || meter->first_byte_ms == 0) {
+        result->success = 0;
+        result->throughput_mbps = 0.0;
+        return -1;
+    }
+    long long from_ms = meter->first_byte_ms, from_bytes = 0;
+    if (meter->measure_ms > 0 && meter->window_ms > meter->measure_ms) {
+        from_ms = meter->measure_ms;
+        from_bytes = meter->measure_bytes;
+        now = meter->window_ms;
+        bytes = meter->window_bytes;
+    }
+    long long elapsed_ms = now - from_ms;
+    if (elapsed_ms < 1) elapsed_ms = 1;
+    result->success = 1;
+    result->ttfb_ms = (int)(meter->first_byte_ms - meter->start_ms);
+    result->throughput_mbps = (double)(bytes - from_bytes) * 8.0 / ((double)elapsed_ms * 1000.0);
+    return 0;
+}
+
+static void throughput_fail(ProbeResult* result, const char* error_type, const char* details) {
+    strncpy(result->error_type, error_type, sizeof(result->error_type) - 1);
+    result->error_type[sizeof(result->error_type) - 1] = '\0';
+    snprintf(result->error_details, sizeof(result->error_details), "Bandwidth probe failed: %s", details);
+}
+
+#ifndef _WIN32
+
+static size_t throughput_write(char* data, size_t size, size_t nmemb, void* userdata) {
+    *(long long*)userdata += (long long)(size * nmemb);
+    return size * nmemb;
+}
+
+static CURL* throughput_new_stream(const char* url, const char* proxy, int budget_ms, long long* bytes) {
+    CURL* easy = curl_easy_init();
+    if (!easy) return NULL;
+    curl_easy_setopt(easy, CURLOPT_URL, url);
+    curl_easy_setopt(easy, CURLOPT_PROXY, proxy);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, throughput_write);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, bytes);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, (long)THROUGHPUT_CONNECT_TIMEOUT_MS);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, (long)(budget_ms + THROUGHPUT_CONNECT_TIMEOUT_MS));
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, "V2Root-Throughput/1.0");
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    CURLSH* share = http_shared_handle();
+    if (share) curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    return easy;
+}
+
+/*
+ * Runs the streams on one curl multi handle. A stream that completes its download is
+ * restarted; a stream that fails is dropped, and the probe ends early when none are left.
+ */
+int throughput_measure(int http_port, int streams, int bytes, int budget_ms, ProbeResult* result) {
+    if (!result || http_port <= 0) return -1;
+    if (streams < 1) streams = 1;
+    if (streams > MAX_THROUGHPUT_STREAMS) streams = MAX_THROUGHPUT_STREAMS;
+    if (bytes <= 0 || bytes > MAX_THROUGHPUT_BYTES) bytes = DEFAULT_THROUGHPUT_BYTES;
+    if (budget_ms <= 0 || budget_ms > MAX_THROUGHPUT_BUDGET_MS) budget_ms = DEFAULT_THROUGHPUT_BUDGET_MS;
+
+    char url[256], proxy[64];
+    snprintf(url, sizeof(url), "https://" THROUGHPUT_PROBE_HOST THROUGHPUT_PROBE_PATH, bytes);
+    snprintf(proxy, sizeof(proxy), "http://127.0.0.1:%d", http_port);
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        throughput_fail(result, PROBE_ERROR_UNKNOWN, "failed to initialize curl multi handle");
+        return -1;
+    }
+
+    long long received = 0;
+    ThroughputMeter meter;
+    meter_start(&meter, budget_ms);
+    CURL* easies[MAX_THROUGHPUT_STREAMS] = {0};
+    int active = 0;
+    for (int i = 0; i < streams; i++) {
+        easies[i] = throughput_new_stream(url, proxy, budget_ms, &received);
+        if (easies[i] && curl_multi_add_handle(multi, easies[i]) == CURLM_OK) active++;
+    }
+
+    CURLcode last_error = CURLE_OK;
+    while (active > 0) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int left;
+        while ((msg = curl_multi_info_read(multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL* easy = msg->easy_handle;
+            CURLcode code = msg->data.result;
+            curl_multi_remove_handle(multi, easy);
+            if (code == CURLE_OK && curl_multi_add_handle(multi, easy) == CURLM_OK) continue;
+            if (code != CURLE_OK) last_error = code;
+            active--;
+        }
+
+        if (meter_update(&meter, received)) break;
+        if (active > 0) curl_multi_poll(multi, NULL, 0, THROUGHPUT_POLL_MS, NULL);
+    }
+
+    for (int i = 0; i < streams; i++) {
+        if (!easies[i]) continue;
+        curl_multi_remove_handle(multi, easies[i]);
+        curl_easy_cleanup(easies[i]);
+    }
+    curl_multi_cleanup(multi);
+
+    if (meter_finish(&meter, received, streams, result) != 0) {
+        if (last_error != CURLE_OK) {
+            throughput_fail(result, last_error == CURLE_OPERATION_TIMEDOUT ? PROBE_ERROR_TIMEOUT : PROBE_ERROR_TRANSPORT,
+                            curl_easy_strerror(last_error));
+        } else {
+            throughput_fail(result, PROBE_ERROR_TIMEOUT, "no data received within the time budget");
+        }
+        return -1;
+    }
+    LOG_DEBUGF("Bandwidth probe completed", "Bandwidth probe: %.2f Mbps over %d stream(s), %d stall(s), %s after %dms",
+               result->throughput_mbps, streams, result->stalls, meter.stable ? "stable" : "stopped", result->total_ms);
+    return 0;
+}
+
+#else /* _WIN32 */
+
+/* One download stream, run on its own thread with blocking WinHTTP calls */
+typedef struct {
+    HINTERNET session;
+    const wchar_t* path;
+    volatile LONG64* received;
+    volatile LONG* stop;
+    DWORD error;                    /* Last WinHTTP error, 0 if none */
+} ThroughputStream;
+
+/* Downloads the object repeatedly until the probe stops or a request fails */
+static DWORD WINAPI throughput_stream_main(LPVOID arg) {
+    ThroughputStream* stream = (ThroughputStream*)arg;
+    char* buffer = malloc(THROUGHPUT_BUFFER_SIZE);
+    HINTERNET connect = buffer ? WinHttpConnect(stream->session, L"" THROUGHPUT_PROBE_HOST, INTERNET_DEFAULT_HTTPS_PORT, 0) : NULL;
+    if (!connect) {
+        stream->error = GetLastError();
+        free(buffer);
+        return 0;
+    }
+    while (!*stream->stop) {
+        HINTERNET request = WinHttpOpenRequest(connect, L"GET", stream->path, NULL, WINHTTP_NO_REFERER,
+                                               WINHTTP_DEFAULT_ACCEPT_TYPES, WINHTTP_FLAG_SECURE);
+        if (!request || !WinHttpSendRequest(request, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0) ||
+            !WinHttpReceiveResponse(request, NULL)) {
+            stream->error = GetLastError();
+            if (request) WinHttpCloseHandle(request);
+            break;
+        }
+        DWORD read = 0;
+        while (!*stream->stop && WinHttpReadData(request, buffer, THROUGHPUT_BUFFER_SIZE, &read) && read > 0) {
+            InterlockedExchangeAdd64(stream->received, (LONG64)read);
+        }
+        WinHttpCloseHandle(request);
+    }
+    WinHttpCloseHandle(connect);
+    free(buffer);
+    return 0;
+}
+
+/*
+ * Runs each stream on a thread of its own and samples the shared byte counter every
+ * THROUGHPUT_POLL_MS. The receive timeout bounds how long a stream takes to notice the stop.
+ */
+int throughput_measure(int http_port, int streams, int bytes, int budget_ms, ProbeResult* result) {
+    if (!result || http_port <= 0) return -1;
+    if (streams < 1) streams = 1;
+    if (streams > MAX_THROUGHPUT_STREAMS) streams = MAX_THROUGHPUT_STREAMS;
+    if (bytes <= 0 || bytes > MAX_THROUGHPUT_BYTES) bytes = DEFAULT_THROUGHPUT_BYTES;
+    if (budget_ms <= 0 || budget_ms > MAX_THROUGHPUT_BUDGET_MS) budget_ms = DEFAULT_THROUGHPUT_BUDGET_MS;
+
+    wchar_t proxy[64], path[64];
+    _snwprintf(proxy, 64, L"http://127.0.0.1:%d", http_port);
+    _snwprintf(path, 64, L"" THROUGHPUT_PROBE_PATH, bytes);
+    proxy[63] = path[63] = L'\0';
+
+    HINTERNET session = WinHttpOpen(L"V2Root-Throughput/1.0", WINHTTP_ACCESS_TYPE_NAMED_PROXY, proxy, WINHTTP_NO_PROXY_BYPASS, 0);
+    if (!session) {
+        char details[64];
+        snprintf(details, sizeof(details), "failed to open HTTP session: %lu", GetLastError());
+        throughput_fail(result, PROBE_ERROR_TRANSPORT, details);
+        return -1;
+    }
+    DWORD connect_timeout = THROUGHPUT_CONNECT_TIMEOUT_MS, io_timeout = 2 * THROUGHPUT_WINDOW_MS * THROUGHPUT_STABLE_WINDOWS;
+    WinHttpSetOption(session, WINHTTP_OPTION_CONNECT_TIMEOUT, &connect_timeout, sizeof(connect_timeout));
+    WinHttpSetOption(session, WINHTTP_OPTION_SEND_TIMEOUT, &io_timeout, sizeof(io_timeout));
+    WinHttpSetOption(session, WINHTTP_OPTION_RECEIVE_TIMEOUT, &io_timeout, sizeof(io_timeout));
+    WinHttpSetOption(session, WINHTTP_OPTION_RECEIVE_RESPONSE_TIMEOUT, &connect_timeout, sizeof(connect_timeout));
+
+    volatile LONG64 received = 0;
+    volatile LONG stop = 0;
+    ThroughputStream stream_state[MAX_THROUGHPUT_STREAMS];
+    HANDLE threads[MAX_THROUGHPUT_STREAMS];
+    int started = 0;
+    ThroughputMeter meter;
+    meter_start(&meter, budget_ms);
+    for (int i = 0; i < streams; i++) {
+        stream_state[started].session = session;
+        stream_state[started].path = path;
+        stream_state[started].received = &received;
+        stream_state[started].stop = &stop;
+        stream_state[started].error = 0;
+        threads[started] = CreateThread(NULL, 0, throughput_stream_main, &stream_state[started], 0, NULL);
+        if (threads[started]) started++;
+    }
+
+    while (started > 0 && WaitForMultipleObjects((DWORD)started, threads, TRUE, THROUGHPUT_POLL_MS) == WAIT_TIMEOUT) {
+        if (meter_update(&meter, InterlockedCompareExchange64(&received, 0, 0))) break;
+    }
+    InterlockedExchange(&stop, 1);
+    if (started > 0) WaitForMultipleObjects((DWORD)started, threads, TRUE, INFINITE);
+    DWORD last_error = 0;
+    for (int i = 0; i < started; i++) {
+        CloseHandle(threads[i]);
+        if (stream_state[i].error) last_error = stream_state[i].error;
+    }
+    WinHttpCloseHandle(session);
+
+    if (meter_finish(&meter, (long long)received, streams, result) != 0) {
+        char details[64];
+        if (last_error == ERROR_WINHTTP_TIMEOUT || last_error == 0) {
+            throughput_fail(result, PROBE_ERROR_TIMEOUT, "no data received within the time budget");
+        } else {
+            snprintf(details, sizeof(details), "WinHTTP error %lu", last_error);
+            throughput_fail(result, PROBE_ERROR_TRANSPORT, details);
+        }
+        return -1;
+    }
+    LOG_DEBUGF("Bandwidth probe completed", "Bandwidth probe: %.2f Mbps over %d stream(s), %d stall(s), %s after %dms",
+               result->throughput_mbps, streams, result->stalls, meter.stable ? "stable" : "stopped", result->total_ms);
+    return 0;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,47 @@
+#ifndef LIBV2ROOT_THROUGHPUT_H
+#define LIBV2ROOT_THROUGHPUT_H
+
+#include "libv2root_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bandwidth probes.
+ *
+ * Latency probes read a few hundred bytes of generate_204, which says nothing about how fast
+ * a node moves data. A bandwidth probe downloads a sized object from THROUGHPUT_PROBE_HOST
+ * through a local HTTP inbound on several parallel streams, restarting streams that finish
+ * until the time budget runs out. The transferred bytes are sampled every
+ * THROUGHPUT_WINDOW_MS; after THROUGHPUT_WARMUP_MS of TCP slow start, the probe stops early
+ * once THROUGHPUT_STABLE_WINDOWS consecutive windows agree within THROUGHPUT_STABLE_TOLERANCE.
+ * A stall is a run of windows in which no stream received anything.
+ */
+
+#define THROUGHPUT_PROBE_HOST "speed.cloudflare.com"
+#define THROUGHPUT_PROBE_PATH "/__down?bytes=%d"
+#define DEFAULT_THROUGHPUT_BYTES 25000000
+#define MAX_THROUGHPUT_BYTES 1000000000
+#define DEFAULT_THROUGHPUT_STREAMS 4
+#define MAX_THROUGHPUT_STREAMS 16
+#define DEFAULT_THROUGHPUT_BUDGET_MS 10000
+#define MAX_THROUGHPUT_BUDGET_MS 60000
+#define THROUGHPUT_CONNECT_TIMEOUT_MS 5000
+#define THROUGHPUT_WINDOW_MS 250
+#define THROUGHPUT_WARMUP_MS 1000
+#define THROUGHPUT_STABLE_WINDOWS 4
+#define THROUGHPUT_STABLE_TOLERANCE 0.10    /* Largest deviation from the mean of the stable windows */
+
+/*
+ * Downloads through the HTTP inbound on http_port as described above and fills
+ * throughput_mbps, stalls, ttfb_ms (first byte of any stream), total_ms, attempts (streams
+ * started) and success of result; the other fields are left alone.
+ */
+int throughput_measure(int http_port, int streams, int bytes, int budget_ms, ProbeResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_THROUGHPUT_H */
@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "libv2root_uri.h"
+
+/*
+ * Share-link tokenizer shared by the protocol parsers and endpoint extraction.
+ *
+ * Every function hands out StrViews pointing into the caller's string, so a link is scanned
+ * once and nothing is copied until a caller needs a NUL-terminated value.
+ */
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Returns the decoded byte of a "%XX" escape at p, or -1 if p does not start one */
+static int pct_byte(const char* p, const char* end) {
+    if (end - p < 3 || p[0] != '%') return -1;
+    int hi = hex_value(p[1]);
+    int lo = hex_value(p[2]);
+    if (hi < 0 || lo < 0) return -1;
+    return hi * 16 + lo;
+}
+
+/* Returns the length of a separator at p: 1 for the raw byte, 3 for its escape, 0 otherwise */
+static size_t sep_len(const char* p, const char* end, char sep) {
+    if (*p == sep) return 1;
+    if (*p == '%' && pct_byte(p, end) == (unsigned char)sep) return 3;
+    return 0;
+}
+
+/*
+ * Splits a share link into scheme, body, query and fragment without interpreting the body.
+ *
+ * Used as-is by formats whose body is opaque (vmess:// carries base64 JSON) and as the first
+ * stage of uri_parse.
+ *
+ * Parameters:
+ *   uri (const char*): The link; need not be NUL-terminated.
+ *   len (size_t): Length of uri in bytes.
+ *   out (UriParts*): Receives the views; fields not present are empty.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the link has no "scheme://" prefix.
+ */
+int uri_split(const char* uri, size_t len, UriParts* out) {
+    if (!uri || !out) return -1;
+    memset(out, 0, sizeof(UriParts));
+
+    size_t i = 0;
+    while (i < len && (isalnum((unsigned char)uri[i]) || uri[i] == '+' || uri[i] == '-' || uri[i] == '.')) i++;
+    if (i == 0 || len - i < 3 || memcmp(uri + i, "://", 3) != 0) return -1;
+    out->scheme = (StrView){ uri, i };
+
+    const char* p = uri + i + 3;
+    const char* end = uri + len;
+    const char* q = p;
+    while (q < end && *q != '?' && *q != '#') q++;
+    out->body = (StrView){ p, (size_t)(q - p) };
+
+    if (q < end && *q == '?') {
+        const char* f = ++q;
+        while (f < end && *f != '#') f++;
+        out->query = (StrView){ q, (size_t)(f - q) };
+        q = f;
+    }
+    if (q < end && *q == '#') {
+        q++;
+        out->fragment = (StrView){ q, (size_t)(end - q) };
+    }
+    return 0;
+}
+
+/*
+ * Parses "userinfo@host:port" into views.
+ *
+ * Parameters:
+ *   s (const char*): The authority; need not be NUL-terminated.
+ *   len (size_t): Length of s in bytes.
+ *   out (UriParts*): Receives userinfo, host and port; other fields are left untouched.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the host or a numeric port is missing.
+ */
+int uri_parse_authority(const char* s, size_t len, UriParts* out) {
+    if (!s || !out) return -1;
+    const char* end = s + len;
+    const char* hp = s;
+    for (const char* c = end; c > s; c--) {
+        if (c[-1] == '@') {
+            out->userinfo = (StrView){ s, (size_t)(c - 1 - s) };
+            hp = c;
+            break;
+        }
+    }
+    if (hp == s) out->userinfo = (StrView){ s, 0 };
+
+    const char* colon;
+    if (hp < end && *hp == '[') {
+        const char* close = memchr(hp, ']', (size_t)(end - hp));
+        if (!close || close + 1 >= end || close[1] != ':') return -1;
+        out->host = (StrView){ hp + 1, (size_t)(close - hp - 1) };
+        colon = close + 1;
+    } else {
+        colon = NULL;
+        for (const char* c = end; c > hp; c--) {
+            if (c[-1] == ':') {
+                colon = c - 1;
+                break;
+            }
+        }
+        if (!colon) return -1;
+        out->host = (StrView){ hp, (size_t)(colon - hp) };
+    }
+
+    out->port = (StrView){ colon + 1, (size_t)(end - colon - 1) };
+    if (out->host.len == 0 || out->port.len == 0) return -1;
+    for (size_t i = 0; i < out->port.len; i++) {
+        if (!isdigit((unsigned char)out->port.ptr[i])) return -1;
+    }
+    return 0;
+}
+
+/*
+ * Parses a share link of the form scheme://userinfo@host:port/path?query#fragment.
+ *
+ * Parameters:
+ *   uri (const char*): The link; need not be NUL-terminated.
+ *   len (size_t): Length of uri in bytes.
+ *   out (UriParts*): Receives views into uri.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the scheme, host or port is missing or malformed.
+ */
+int uri_parse(const char* uri, size_t len, UriParts* out) {
+    if (uri_split(uri, len, out) != 0) return -1;
+    const char* a = out->body.ptr;
+    const char* slash = memchr(a, '/', out->body.len);
+    size_t alen = slash ? (size_t)(slash - a) : out->body.len;
+    if (slash) out->path = (StrView){ slash, out->body.len - alen };
+    return uri_parse_authority(a, alen, out);
+}
+
+/*
+ * Takes the next key=value pair off a query string.
+ *
+ * Parameters:
+ *   query (StrView*): The remaining query; advanced past the returned pair.
+ *   key (StrView*): Receives the raw key.
+ *   value (StrView*): Receives the raw value, empty if the pair has no '='.
+ *
+ * Returns:
+ *   int: 1 if a pair was produced, 0 once the query is exhausted.
+ */
+int uri_next_param(StrView* query, StrView* key, StrView* value) {
+    const char* p = query->ptr;
+    const char* end = p + query->len;
+    while (p < end && *p == '&') p++;
+    if (p == end) {
+        *query = (StrView){ end, 0 };
+        return 0;
+    }
+    const char* amp = memchr(p, '&', (size_t)(end - p));
+    if (!amp) amp = end;
+    const char* eq = memchr(p, '=', (size_t)(amp - p));
+    if (eq) {
+        *key = (StrView){ p, (size_t)(eq - p) };
+        *value = (StrView){ eq + 1, (size_t)(amp - eq - 1) };
+    } else {
+        *key = (StrView){ p, (size_t)(amp - p) };
+        *value = (StrView){ amp, 0 };
+    }
+    *query = (StrView){ amp, (size_t)(end - amp) };
+    return 1;
+}
+
+/*
+ * Takes the next non-empty item off a separated list.
+ *
+ * Share links often percent-encode list separators (alpn=h2%2Chttp%2F1.1), so the escaped
+ * form of sep splits items as well.
+ *
+ * Parameters:
+ *   rest (StrView*): The remaining list; advanced past the returned item.
+ *   sep (char): The separator.
+ *   item (StrView*): Receives the item.
+ *
+ * Returns:
+ *   int: 1 if an item was produced, 0 once the list is exhausted.
+ */
+int sv_split(StrView* rest, char sep, StrView* item) {
+    const char* p = rest->ptr;
+    const char* end = p + rest->len;
+    size_t n;
+    while (p < end && (n = sep_len(p, end, sep)) > 0) p += n;
+    if (p == end) {
+        *rest = (StrView){ end, 0 };
+        return 0;
+    }
+    const char* s = p;
+    while (p < end && sep_len(p, end, sep) == 0) p++;
+    *item = (StrView){ s, (size_t)(p - s) };
+    *rest = (StrView){ p, (size_t)(end - p) };
+    return 1;
+}
+
+/*
+ * Cuts rest at its first raw sep.
+ *
+ * Returns:
+ *   int: 1 if sep was found (head is the part before it, rest the part after), 0 otherwise
+ *        with rest left unchanged.
+ */
+int sv_cut(StrView* rest, char sep, StrView* head) {
+    const char* c = memchr(rest->ptr, sep, rest->len);
+    if (!c) return 0;
+    *head = (StrView){ rest->ptr, (size_t)(c - rest->ptr) };
+    *rest = (StrView){ c + 1, rest->len - head->len - 1 };
+    return 1;
+}
+
+/* Returns 1 if the view equals the NUL-terminated literal */
+int sv_eq(StrView v, const char* lit) {
+    size_t n = strlen(lit);
+    return v.len == n && memcmp(v.ptr, lit, n) == 0;
+}
+
+/*
+ * Copies a view into a NUL-terminated buffer.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the view does not fit (dst is then left empty).
+ */
+int sv_copy(StrView v, char* dst, size_t size) {
+    if (!dst || size == 0) return -1;
+    if (v.len >= size) {
+        dst[0] = '\0';
+        return -1;
+    }
+    memcpy(dst, v.ptr, v.len);
+    dst[v.len] = '\0';
+    return 0;
+}
+
+/* Returns the port number in v (1-65535), or -1 if v is not a valid port */
+int sv_to_port(StrView v) {
+    if (v.len == 0 || v.len > 5) return -1;
+    int port = 0;
+    for (size_t i = 0; i < v.len; i++) {
+        if (!isdigit((unsigned char)v.ptr[i])) return -1;
+        port = port * 10 + (v.ptr[i] - '0');
+    }
+    return (port > 0 && port <= 65535) ? port : -1;
+}
+
+/* Returns the decimal integer in v, or fallback if v is empty or not a number */
+int sv_to_int(StrView v, int fallback) {
+    size_t i = 0;
+    int sign = 1;
+    if (v.len > 0 && v.ptr[0] == '-') {
+        sign = -1;
+        i = 1;
+    }
+    if (i == v.len || v.len - i > 9) return fallback;
+    int value = 0;
+    for (; i < v.len; i++) {
+        if (!isdigit((unsigned char)v.ptr[i])) return fallback;
+        value = value * 10 + (v.ptr[i] - '0');
+    }
+    return sign * value;
+}
+
+/*
+ * Percent-decodes a view into a buffer.
+ *
+ * '+' decodes to a space as in form encoding.
+ *
+ * Parameters:
+ *   v (StrView): The raw, possibly percent-encoded, value.
+ *   out (char*): Destination; always NUL-terminated.
+ *   size (size_t): Size of out; a decoded value never needs more than v.len + 1 bytes.
+ *
+ * Returns:
+ *   size_t: Decoded length, excluding bytes that did not fit.
+ */
+size_t uri_decode(StrView v, char* out, size_t size) {
+    if (!out || size == 0) return 0;
+    size_t n = 0;
+    const char* p = v.ptr;
+    const char* end = v.ptr + v.len;
+    while (p < end && n + 1 < size) {
+        int c = pct_byte(p, end);
+        if (c >= 0) {
+            p += 3;
+        } else {
+            c = (unsigned char)(*p == '+' ? ' ' : *p);
+            p++;
+        }
+        out[n++] = (char)c;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+/*
+ * Writes a percent-decoded view as the body of a JSON string.
+ *
+ * '+' decodes to a space as in form encoding. Decoded quotes, backslashes and control bytes
+ * are escaped so a crafted link cannot break out of the surrounding JSON string.
+ *
+ * Parameters:
+ *   fp (FILE*): The output stream.
+ *   v (StrView): The raw, possibly percent-encoded, value.
+ *
+ * Returns:
+ *   None
+ */
+void uri_write_decoded(FILE* fp, StrView v) {
+    char out[256];
+    size_t n = 0;
+    const char* p = v.ptr;
+    const char* end = v.ptr + v.len;
+    while (p < end) {
+        int c = pct_byte(p, end);
+        if (c >= 0) {
+            p += 3;
+        } else {
+            c = (unsigned char)(*p == '+' ? ' ' : *p);
+            p++;
+        }
+        if (n > sizeof(out) - 8) {
+            fwrite(out, 1, n, fp);
+            n = 0;
+        }
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = (char)c;
+        } else if (c < 0x20) {
+            n += (size_t)snprintf(out + n, sizeof(out) - n, "\\u%04x", c);
+        } else {
+            out[n++] = (char)c;
+        }
+    }
+    if (n > 0) fwrite(out, 1, n, fp);
+}
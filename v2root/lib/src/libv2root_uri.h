@@ -0,0 +1,60 @@
+#ifndef LIBV2ROOT_URI_H
+#define LIBV2ROOT_URI_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A non-owning slice of a larger string; not NUL-terminated */
+typedef struct {
+    const char* ptr;
+    size_t len;
+} StrView;
+
+#define SV_LIT(s) ((StrView){ (s), sizeof(s) - 1 })
+#define SV_FMT(v) (int)(v).len, (v).ptr
+
+/* Views into a share link such as scheme://userinfo@host:port/path?query#fragment */
+typedef struct {
+    StrView scheme;     /* Without "://" */
+    StrView body;       /* Everything between "://" and the query or fragment */
+    StrView userinfo;   /* Before the last '@' of the authority, empty if absent */
+    StrView host;       /* IPv6 literals without their brackets */
+    StrView port;       /* Digits only */
+    StrView path;       /* From the first '/' after the authority, if any */
+    StrView query;      /* Without the leading '?' */
+    StrView fragment;   /* Without the leading '#' */
+} UriParts;
+
+int uri_split(const char* uri, size_t len, UriParts* out);
+int uri_parse(const char* uri, size_t len, UriParts* out);
+int uri_parse_authority(const char* s, size_t len, UriParts* out);
+
+/* Iterates key=value pairs of a query string, consuming it */
+int uri_next_param(StrView* query, StrView* key, StrView* value);
+
+/* Splits off the next non-empty item separated by sep (or its %XX form) */
+int sv_split(StrView* rest, char sep, StrView* item);
+
+/* Splits rest at the first sep: head receives the part before it, rest the part after */
+int sv_cut(StrView* rest, char sep, StrView* head);
+
+int sv_eq(StrView v, const char* lit);
+int sv_copy(StrView v, char* dst, size_t size);
+int sv_to_port(StrView v);
+int sv_to_int(StrView v, int fallback);
+
+/* Percent-decodes a view into a NUL-terminated buffer */
+size_t uri_decode(StrView v, char* out, size_t size);
+
+/* Percent-decodes a view into a JSON string body, escaping quotes and control bytes */
+void uri_write_decoded(FILE* fp, StrView v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBV2ROOT_URI_H */
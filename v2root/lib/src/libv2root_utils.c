@@ -16,39 +16,6 @@
 
 #include "libv2root_utils.h"
 
-#define LOG_FILE "v2root.log"
-
-/*
- * Logs a message with timestamp, file location, and optional error information.
- * Writes to v2root.log file ONLY - no terminal output.
- */
-void log_message(const char* message, const char* file, int line, int error_code, const char* extra_info) {
-    time_t now = time(NULL);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    /* Open log file in append mode */
-    FILE* log_fp = fopen(LOG_FILE, "a");
-    if (!log_fp) {
-        /* If we can't open the log file, silently fail - no terminal output */
-        return;
-    }
-    
-    fprintf(log_fp, "[%s] %s:%d - %s", timestamp, file, line, message);
-    
-    if (error_code != 0) {
-        fprintf(log_fp, " (Error code: %d)", error_code);
-    }
-    
-    if (extra_info != NULL && extra_info[0] != '\0') {
-        fprintf(log_fp, " - %s", extra_info);
-    }
-    
-    fprintf(log_fp, "\n");
-    fflush(log_fp);
-    fclose(log_fp);
-}
-
 /*
  * Validates an IP address or domain name.
  */
@@ -242,14 +209,33 @@ int send_http_probe(int sockfd, const char* host, const char* path, int* ttfb_ms
  * Returns score between 0.0 (worst) and 1.0 (best).
  */
 double calculate_probe_score(int ttfb_ms, int tcp_ms, int success) {
+    return calculate_probe_score_bw(ttfb_ms, tcp_ms, 0.0, success);
+}
+
+/*
+ * Calculates normalized score from latency metrics and, when measured, bandwidth.
+ * Returns score between 0.0 (worst) and 1.0 (best).
+ *
+ * Without a bandwidth measurement (mbps <= 0) this is the latency-only score. With one,
+ * bandwidth takes 40% of the weight, with u = mbps / (mbps + SCORE_REFERENCE_MBPS), so a
+ * node moving data ten times faster can outrank one with a slightly lower TTFB.
+ */
+double calculate_probe_score_bw(int ttfb_ms, int tcp_ms, double mbps, int success) {
     if (!success) return 0.0;
     
     /* Utility function: u = 1 / (1 + ms/100) */
     double u_ttfb = 1.0 / (1.0 + (ttfb_ms / 100.0));
     double u_tcp = 1.0 / (1.0 + (tcp_ms / 100.0));
     
-    /* Weighted score: 70% app-level, 25% TCP, 5% success bonus */
-    double score = (0.70 * u_ttfb) + (0.25 * u_tcp) + 0.05;
+    double score;
+    if (mbps > 0.0) {
+        /* Weighted score: 40% app-level, 15% TCP, 40% bandwidth, 5% success bonus */
+        double u_bw = mbps / (mbps + SCORE_REFERENCE_MBPS);
+        score = (0.40 * u_ttfb) + (0.15 * u_tcp) + (0.40 * u_bw) + 0.05;
+    } else {
+        /* Weighted score: 70% app-level, 25% TCP, 5% success bonus */
+        score = (0.70 * u_ttfb) + (0.25 * u_tcp) + 0.05;
+    }
     
     /* Clamp to [0, 1] */
     if (score < 0.0) score = 0.0;
@@ -257,3 +243,64 @@ double calculate_probe_score(int ttfb_ms, int tcp_ms, int success) {
     
     return score;
 }
+
+/*
+ * Returns a monotonic timestamp in milliseconds.
+ * Unaffected by wall-clock changes; only differences between calls are meaningful.
+ */
+long long get_monotonic_ms(void) {
+#ifdef _WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+#endif
+}
+
+/*
+ * Returns a monotonic timestamp in microseconds, for timing phases shorter than a few ms.
+ * Only differences between calls are meaningful.
+ */
+long long get_monotonic_us(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (long long)(now.QuadPart / freq.QuadPart) * 1000000LL +
+           (long long)(now.QuadPart % freq.QuadPart) * 1000000LL / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+#endif
+}
+
+/*
+ * Returns the nearest-rank percentile of values, sorting them in place.
+ *
+ * Parameters:
+ *   values (int*): Samples; reordered by the call.
+ *   count (int): Number of samples.
+ *   percentile (int): Percentile in 1..100 (50 for the median).
+ *
+ * Returns:
+ *   int: The percentile value, or 0 if count <= 0.
+ */
+int percentile_int(int* values, int count, int percentile) {
+    if (count <= 0) return 0;
+    for (int i = 1; i < count; i++) {
+        int v = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+    int rank = (percentile * count + 99) / 100;
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return values[rank - 1];
+}
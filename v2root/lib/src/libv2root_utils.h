@@ -2,14 +2,12 @@
 #define LIBV2ROOT_UTILS_H
 
 #include "libv2root_common.h"
+#include "libv2root_log.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Logging */
-void log_message(const char* message, const char* file, int line, int error_code, const char* extra_info);
-
 /* Validation */
 int validate_address(const char* address);
 int validate_port(const char* port_str);
@@ -22,6 +20,12 @@ char* trim_whitespace(char* str);
 /* New probe functions */
 int send_http_probe(int sockfd, const char* host, const char* path, int* ttfb_ms);
 double calculate_probe_score(int ttfb_ms, int tcp_ms, int success);
+double calculate_probe_score_bw(int ttfb_ms, int tcp_ms, double mbps, int success);
+
+/* Timing */
+long long get_monotonic_ms(void);
+long long get_monotonic_us(void);
+int percentile_int(int* values, int count, int percentile);
 
 #ifdef __cplusplus
 }
@@ -4,6 +4,67 @@
 #include "libv2root_vless.h"
 #include "libv2root_core.h"
 #include "libv2root_utils.h"
+#include "libv2root_uri.h"
+
+ 
+ enum {
+     VP_ENCRYPTION, VP_FLOW, VP_TYPE, VP_SECURITY, VP_HEADER_TYPE, VP_PATH, VP_HOST, VP_SNI,
+     VP_ALPN, VP_FP, VP_PBK, VP_SID, VP_SPX, VP_QUIC_SECURITY, VP_KEY, VP_SERVICE_NAME,
+     VP_AUTHORITY, VP_MAX_STREAMS, VP_SEED, VP_CONGESTION, VP_HEADERS, VP_FALLBACK, VP_FALLBACKS,
+     VP_MUX, VP_SESSION_RESUMPTION, VP_UTLS, VP_ALLOW_INSECURE, VP_SHOW, VP_DEST, VP_SERVER_NAMES,
+     VP_OUTBOUNDS, VP_ROUTING, VP_COUNT
+ };
+ 
+ #define VP_MATCH(lit, id) if (memcmp(key.ptr, lit, sizeof(lit) - 1) == 0) return id
+ 
+ /*
+  * Maps a query key to its slot with one switch on the key length and at most a few memcmps.
+  * Returns -1 for keys the parser does not use.
+  */
+ static int vless_param_id(StrView key) {
+     switch (key.len) {
+     case 2:
+         VP_MATCH("fp", VP_FP);
+         break;
+     case 3:
+         VP_MATCH("sni", VP_SNI); VP_MATCH("pbk", VP_PBK); VP_MATCH("sid", VP_SID);
+         VP_MATCH("spx", VP_SPX); VP_MATCH("key", VP_KEY); VP_MATCH("mux", VP_MUX);
+         break;
+     case 4:
+         VP_MATCH("type", VP_TYPE); VP_MATCH("flow", VP_FLOW); VP_MATCH("path", VP_PATH);
+         VP_MATCH("host", VP_HOST); VP_MATCH("alpn", VP_ALPN); VP_MATCH("seed", VP_SEED);
+         VP_MATCH("utls", VP_UTLS); VP_MATCH("show", VP_SHOW); VP_MATCH("dest", VP_DEST);
+         break;
+     case 7:
+         VP_MATCH("headers", VP_HEADERS); VP_MATCH("routing", VP_ROUTING);
+         break;
+     case 8:
+         VP_MATCH("security", VP_SECURITY); VP_MATCH("fallback", VP_FALLBACK);
+         break;
+     case 9:
+         VP_MATCH("authority", VP_AUTHORITY); VP_MATCH("fallbacks", VP_FALLBACKS); VP_MATCH("outbounds", VP_OUTBOUNDS);
+         break;
+     case 10:
+         VP_MATCH("encryption", VP_ENCRYPTION); VP_MATCH("headerType", VP_HEADER_TYPE);
+         VP_MATCH("maxStreams", VP_MAX_STREAMS); VP_MATCH("congestion", VP_CONGESTION);
+         break;
+     case 11:
+         VP_MATCH("serviceName", VP_SERVICE_NAME); VP_MATCH("serverNames", VP_SERVER_NAMES);
+         break;
+     case 12:
+         VP_MATCH("quicSecurity", VP_QUIC_SECURITY);
+         break;
+     case 13:
+         VP_MATCH("allowInsecure", VP_ALLOW_INSECURE);
+         break;
+     case 17:
+         VP_MATCH("sessionResumption", VP_SESSION_RESUMPTION);
+         break;
+     }
+     return -1;
+ }
+ 
+ #undef VP_MATCH
 
 /*
  * Parses a VLESS configuration string and writes the resulting JSON configuration to a file.
@@ -28,7 +89,7 @@
  * - Inbound proxies: HTTP and SOCKS proxies with configurable ports, falling back to DEFAULT_HTTP_PORT and DEFAULT_SOCKS_PORT if invalid.
  *
  * Parameters:
- *   vless_str (const char*): The VLESS configuration string in the format vless://uuid@address:port?params.
+ *   vless_str (const char*): The VLESS configuration string in the format vless://uuid@address:port?params#remark.
  *   fp (FILE*): File pointer to write the resulting JSON configuration.
  *   http_port (int): The HTTP proxy port (defaults to DEFAULT_HTTP_PORT if invalid or <= 0).
  *   socks_port (int): The SOCKS proxy port (defaults to DEFAULT_SOCKS_PORT if invalid or <= 0).
@@ -41,36 +102,10 @@
  *   - Invalid VLESS prefix (must start with "vless://").
  *   - Parsing failures (incorrect format, invalid UUID, address, or port).
  *   - Invalid port or address (via validate_port and validate_address).
- *   - Parameter buffer overflow (params exceeding 4096 bytes).
+ *   - Address too long to validate (more than 255 bytes).
  *   - Invalid flow values (only xtls-rprx-vision and xtls-rprx-direct allowed).
  */
 
- 
- void urldecode(char* dst, const char* src, size_t dst_size) {
-     char* d = dst;
-     const char* s = src;
-     size_t i = 0;
- 
-     while (*s && i < dst_size - 1) {
-         if (*s == '%' && s[1] && s[2]) {
-             char hex[3] = {s[1], s[2], 0};
-             int value = 0;
-             sscanf(hex, "%x", &value);
-             *d++ = (char)value;
-             s += 3;
-             i++;
-         } else if (*s == '+') {
-             *d++ = ' ';
-             s++;
-             i++;
-         } else {
-             *d++ = *s++;
-             i++;
-         }
-     }
-     *d = '\0';
- }
- 
  EXPORT int parse_vless_string(const char* vless_str, FILE* fp, int http_port, int socks_port) {
      if (vless_str == NULL || fp == NULL) {
          log_message("Null vless_str or fp", __FILE__, __LINE__, 0, NULL);
@@ -89,127 +124,51 @@
      int final_http_port = (http_port > 0 && validate_port(http_port_str)) ? http_port : DEFAULT_HTTP_PORT;
      int final_socks_port = (socks_port > 0 && validate_port(socks_port_str)) ? socks_port : DEFAULT_SOCKS_PORT;
  
-     char uuid[128] = "";
-     char address[2048] = "";
-     char port_str[16] = "";
-     char params[4096] = "";
- 
-     if (sscanf(vless_str, "vless://%127[^@]@%2047[^:]:%15[^?]?%4095s", uuid, address, port_str, params) != 4) {
+     UriParts uri;
+     if (uri_parse(vless_str, strlen(vless_str), &uri) != 0 || uri.userinfo.len == 0) {
          log_message("Failed to parse VLESS format", __FILE__, __LINE__, 0, vless_str);
          return -1;
      }
  
-     int server_port = atoi(port_str);
-     if (!validate_port(port_str)) {
-         log_message("Invalid server port", __FILE__, __LINE__, 0, port_str);
+     int server_port = sv_to_port(uri.port);
+     if (server_port < 0) {
+         log_message("Invalid server port", __FILE__, __LINE__, 0, vless_str);
          return -1;
      }
-     if (!validate_address(address)) {
-         char err_msg[256];
-         snprintf(err_msg, sizeof(err_msg), "Address validation failed for: %s", address);
+     char address[256];
+     if (sv_copy(uri.host, address, sizeof(address)) != 0 || !validate_address(address)) {
+         char err_msg[320];
+         snprintf(err_msg, sizeof(err_msg), "Address validation failed for: %.*s", SV_FMT(uri.host));
          log_message(err_msg, __FILE__, __LINE__, 0, vless_str);
          return -1;
      }
+     StrView uuid = uri.userinfo;
  
-     char encryption[128] = "none";
-     char flow[128] = "";
-     char network[128] = "tcp";
-     char security[128] = "none";
-     char header_type[128] = "none";
-     char path[2048] = "";
-     char host[2048] = "";
-     char sni[2048] = "";
-     char alpn[4096] = "";
-     char fingerprint[128] = "";
-     char public_key[2048] = "";
-     char short_ids[2048] = "";
-     char spider_x[2048] = "";
-     char quic_security[128] = "";
-     char quic_key[128] = "";
-     char grpc_service_name[2048] = "";
-     char grpc_authority[2048] = "";
-     char grpc_max_streams[16] = "";
-     char mkcp_seed[128] = "";
-     char congestion[16] = "";
-     char http_headers[4096] = "";
-     char fallback[2048] = "";
-     char fallbacks[4096] = "";
-     char mux[16] = "";
-     char session_resumption[16] = "";
-     char utls[128] = "";
-     char allow_insecure[16] = "";
-     char reality_show[16] = "";
-     char reality_dest[2048] = "";
-     char reality_server_names[4096] = "";
-     char outbounds[4096] = "";
-     char routing[4096] = "";
- 
-     char params_copy[4096];
-     if (strlen(params) >= sizeof(params_copy)) {
-         log_message("Parameters exceed buffer size", __FILE__, __LINE__, 0, params);
-         return -1;
-     }
-     strncpy(params_copy, params, sizeof(params_copy) - 1);
-     params_copy[sizeof(params_copy) - 1] = '\0';
+     StrView p[VP_COUNT];
+     memset(p, 0, sizeof(p));
+     p[VP_ENCRYPTION] = SV_LIT("none");
+     p[VP_TYPE] = SV_LIT("tcp");
+     p[VP_SECURITY] = SV_LIT("none");
+     p[VP_HEADER_TYPE] = SV_LIT("none");
  
-     char* param = strtok(params_copy, "&");
-     while (param) {
-         if (strncmp(param, "encryption=", 11) == 0) strncpy(encryption, param + 11, sizeof(encryption) - 1);
-         else if (strncmp(param, "flow=", 5) == 0) strncpy(flow, param + 5, sizeof(flow) - 1);
-         else if (strncmp(param, "type=", 5) == 0) {
-             char* hash = strchr(param + 5, '#');
-             if (hash) {
-                 size_t network_len = hash - (param + 5);
-                 strncpy(network, param + 5, network_len < sizeof(network) ? network_len : sizeof(network) - 1);
-                 network[network_len] = '\0';
-                 strncpy(grpc_service_name, hash + 1, sizeof(grpc_service_name) - 1);
-             } else {
-                 strncpy(network, param + 5, sizeof(network) - 1);
-             }
-         }
-         else if (strncmp(param, "security=", 9) == 0) strncpy(security, param + 9, sizeof(security) - 1);
-         else if (strncmp(param, "headerType=", 11) == 0) strncpy(header_type, param + 11, sizeof(header_type) - 1);
-         else if (strncmp(param, "path=", 5) == 0) strncpy(path, param + 5, sizeof(path) - 1);
-         else if (strncmp(param, "host=", 5) == 0) strncpy(host, param + 5, sizeof(host) - 1);
-         else if (strncmp(param, "sni=", 4) == 0) strncpy(sni, param + 4, sizeof(sni) - 1);
-         else if (strncmp(param, "alpn=", 5) == 0) strncpy(alpn, param + 5, sizeof(alpn) - 1);
-         else if (strncmp(param, "fp=", 3) == 0) strncpy(fingerprint, param + 3, sizeof(fingerprint) - 1);
-         else if (strncmp(param, "pbk=", 4) == 0) strncpy(public_key, param + 4, sizeof(public_key) - 1);
-         else if (strncmp(param, "sid=", 4) == 0) strncpy(short_ids, param + 4, sizeof(short_ids) - 1);
-         else if (strncmp(param, "spx=", 4) == 0) strncpy(spider_x, param + 4, sizeof(spider_x) - 1);
-         else if (strncmp(param, "quicSecurity=", 13) == 0) strncpy(quic_security, param + 13, sizeof(quic_security) - 1);
-         else if (strncmp(param, "key=", 4) == 0) strncpy(quic_key, param + 4, sizeof(quic_key) - 1);
-         else if (strncmp(param, "serviceName=", 12) == 0) strncpy(grpc_service_name, param + 12, sizeof(grpc_service_name) - 1);
-         else if (strncmp(param, "authority=", 10) == 0) strncpy(grpc_authority, param + 10, sizeof(grpc_authority) - 1);
-         else if (strncmp(param, "maxStreams=", 11) == 0) strncpy(grpc_max_streams, param + 11, sizeof(grpc_max_streams) - 1);
-         else if (strncmp(param, "seed=", 5) == 0) strncpy(mkcp_seed, param + 5, sizeof(mkcp_seed) - 1);
-         else if (strncmp(param, "congestion=", 11) == 0) strncpy(congestion, param + 11, sizeof(congestion) - 1);
-         else if (strncmp(param, "headers=", 8) == 0) strncpy(http_headers, param + 8, sizeof(http_headers) - 1);
-         else if (strncmp(param, "fallback=", 9) == 0) strncpy(fallback, param + 9, sizeof(fallback) - 1);
-         else if (strncmp(param, "fallbacks=", 10) == 0) strncpy(fallbacks, param + 10, sizeof(fallbacks) - 1);
-         else if (strncmp(param, "mux=", 4) == 0) strncpy(mux, param + 4, sizeof(mux) - 1);
-         else if (strncmp(param, "sessionResumption=", 17) == 0) strncpy(session_resumption, param + 17, sizeof(session_resumption) - 1);
-         else if (strncmp(param, "utls=", 5) == 0) strncpy(utls, param + 5, sizeof(utls) - 1);
-         else if (strncmp(param, "allowInsecure=", 14) == 0) strncpy(allow_insecure, param + 14, sizeof(allow_insecure) - 1);
-         else if (strncmp(param, "show=", 5) == 0) strncpy(reality_show, param + 5, sizeof(reality_show) - 1);
-         else if (strncmp(param, "dest=", 5) == 0) strncpy(reality_dest, param + 5, sizeof(reality_dest) - 1);
-         else if (strncmp(param, "serverNames=", 12) == 0) strncpy(reality_server_names, param + 12, sizeof(reality_server_names) - 1);
-         else if (strncmp(param, "outbounds=", 10) == 0) strncpy(outbounds, param + 10, sizeof(outbounds) - 1);
-         else if (strncmp(param, "routing=", 8) == 0) strncpy(routing, param + 8, sizeof(routing) - 1);
-         param = strtok(NULL, "&");
+     StrView query = uri.query, key, value;
+     while (uri_next_param(&query, &key, &value)) {
+         int id = vless_param_id(key);
+         if (id >= 0) p[id] = value;
      }
  
-     if (flow[0] && strcmp(flow, "xtls-rprx-vision") != 0 && strcmp(flow, "xtls-rprx-direct") != 0) {
-         log_message("Invalid flow value", __FILE__, __LINE__, 0, flow);
+     StrView flow = p[VP_FLOW];
+     if (flow.len && !sv_eq(flow, "xtls-rprx-vision") && !sv_eq(flow, "xtls-rprx-direct")) {
+         char err_msg[160];
+         snprintf(err_msg, sizeof(err_msg), "%.*s", SV_FMT(flow));
+         log_message("Invalid flow value", __FILE__, __LINE__, 0, err_msg);
          return -1;
      }
  
-     char decoded_path[2048];
-     char decoded_host[2048];
-     char decoded_sni[2048];
-     urldecode(decoded_path, path, sizeof(decoded_path));
-     urldecode(decoded_host, host, sizeof(decoded_host));
-     urldecode(decoded_sni, sni, sizeof(decoded_sni));
+     StrView network = p[VP_TYPE];
+     StrView security = p[VP_SECURITY];
+     StrView header_type = p[VP_HEADER_TYPE];
+     StrView item;
  
      fprintf(fp, "{\n");
      fprintf(fp, "  \"inbounds\": [\n");
@@ -220,125 +179,116 @@
  
      fprintf(fp, "    {\n");
      fprintf(fp, "      \"protocol\": \"vless\",\n");
-     fprintf(fp, "      \"settings\": {\"vnext\": [{\"address\": \"%s\", \"port\": %d, \"users\": [{\"id\": \"%s\", \"encryption\": \"%s\"",
-             address, server_port, uuid, encryption);
-     if (flow[0]) fprintf(fp, ", \"flow\": \"%s\"", flow);
+     fprintf(fp, "      \"settings\": {\"vnext\": [{\"address\": \"%s\", \"port\": %d, \"users\": [{\"id\": \"%.*s\", \"encryption\": \"%.*s\"",
+             address, server_port, SV_FMT(uuid), SV_FMT(p[VP_ENCRYPTION]));
+     if (flow.len) fprintf(fp, ", \"flow\": \"%.*s\"", SV_FMT(flow));
      fprintf(fp, "}]}]},\n");
  
      fprintf(fp, "      \"streamSettings\": {\n");
-     fprintf(fp, "        \"network\": \"%s\"", network);
-     fprintf(fp, ",\n        \"security\": \"%s\"", security);
+     fprintf(fp, "        \"network\": \"%.*s\"", SV_FMT(network));
+     fprintf(fp, ",\n        \"security\": \"%.*s\"", SV_FMT(security));
  
      int need_comma = 0;
  
-     if (strcmp(network, "tcp") == 0) {
-         fprintf(fp, ",\n        \"tcpSettings\": {\"header\": {\"type\": \"%s\"}}", header_type);
+     if (sv_eq(network, "tcp")) {
+         fprintf(fp, ",\n        \"tcpSettings\": {\"header\": {\"type\": \"%.*s\"}}", SV_FMT(header_type));
          need_comma = 1;
-     } else if (strcmp(network, "http") == 0 || strcmp(network, "h2") == 0) {
-         fprintf(fp, ",\n        \"httpSettings\": {\"path\": \"%s\"", decoded_path);
-         if (host[0]) fprintf(fp, ", \"host\": [\"%s\"]", decoded_host);
-         if (http_headers[0]) {
+     } else if (sv_eq(network, "http") || sv_eq(network, "h2")) {
+         fprintf(fp, ",\n        \"httpSettings\": {\"path\": \"");
+         uri_write_decoded(fp, p[VP_PATH]);
+         fprintf(fp, "\"");
+         if (p[VP_HOST].len) {
+             fprintf(fp, ", \"host\": [\"");
+             uri_write_decoded(fp, p[VP_HOST]);
+             fprintf(fp, "\"]");
+         }
+         if (p[VP_HEADERS].len) {
              fprintf(fp, ", \"headers\": {");
-             char headers_copy[4096];
-             strncpy(headers_copy, http_headers, sizeof(headers_copy) - 1);
-             headers_copy[sizeof(headers_copy) - 1] = '\0';
-             char* header = strtok(headers_copy, ",");
+             StrView headers = p[VP_HEADERS];
              int first = 1;
-             while (header) 
-             {
-                 char* eq = strchr(header, '=');
-                 if (eq) {
-                     *eq = '\0';
+             while (sv_split(&headers, ',', &item)) {
+                 StrView name;
+                 if (sv_cut(&item, '=', &name)) {
                      if (!first) fprintf(fp, ", ");
-                     fprintf(fp, "\"%s\": [\"%s\"]", header, eq + 1);
+                     fprintf(fp, "\"%.*s\": [\"%.*s\"]", SV_FMT(name), SV_FMT(item));
                      first = 0;
                  }
-                 header = strtok(NULL, ",");
              }
              fprintf(fp, "}");
          }
          fprintf(fp, "}");
          need_comma = 1;
-     } else if (strcmp(network, "ws") == 0) {
-         fprintf(fp, ",\n        \"wsSettings\": {\"path\": \"%s\"", decoded_path);
-         if (host[0]) fprintf(fp, ", \"headers\": {\"Host\": \"%s\"}", decoded_host);
+     } else if (sv_eq(network, "ws")) {
+         fprintf(fp, ",\n        \"wsSettings\": {\"path\": \"");
+         uri_write_decoded(fp, p[VP_PATH]);
+         fprintf(fp, "\"");
+         if (p[VP_HOST].len) {
+             fprintf(fp, ", \"headers\": {\"Host\": \"");
+             uri_write_decoded(fp, p[VP_HOST]);
+             fprintf(fp, "\"}");
+         }
          fprintf(fp, "}");
          need_comma = 1;
-     } else if (strcmp(network, "kcp") == 0) {
-         fprintf(fp, ",\n        \"kcpSettings\": {\"header\": {\"type\": \"%s\"}", header_type);
-         if (mkcp_seed[0]) fprintf(fp, ", \"seed\": \"%s\"", mkcp_seed);
-         if (congestion[0]) fprintf(fp, ", \"congestion\": %s", strcmp(congestion, "bbr") == 0 ? "true" : "false");
+     } else if (sv_eq(network, "kcp")) {
+         fprintf(fp, ",\n        \"kcpSettings\": {\"header\": {\"type\": \"%.*s\"}", SV_FMT(header_type));
+         if (p[VP_SEED].len) fprintf(fp, ", \"seed\": \"%.*s\"", SV_FMT(p[VP_SEED]));
+         if (p[VP_CONGESTION].len) fprintf(fp, ", \"congestion\": %s", sv_eq(p[VP_CONGESTION], "bbr") ? "true" : "false");
          fprintf(fp, "}");
          need_comma = 1;
-     } else if (strcmp(network, "quic") == 0) {
-         fprintf(fp, ",\n        \"quicSettings\": {\"security\": \"%s\", \"key\": \"%s\", \"header\": {\"type\": \"%s\"}}",
-                 quic_security, quic_key, header_type);
+     } else if (sv_eq(network, "quic")) {
+         fprintf(fp, ",\n        \"quicSettings\": {\"security\": \"%.*s\", \"key\": \"%.*s\", \"header\": {\"type\": \"%.*s\"}}",
+                 SV_FMT(p[VP_QUIC_SECURITY]), SV_FMT(p[VP_KEY]), SV_FMT(header_type));
          need_comma = 1;
-     } else if (strcmp(network, "grpc") == 0) {
-         fprintf(fp, ",\n        \"grpcSettings\": {\"serviceName\": \"%s\", \"multiMode\": %s",
-                 grpc_service_name[0] ? grpc_service_name : "v2ray",
-                 strchr(grpc_service_name, ',') ? "true" : "false");
-         if (grpc_authority[0]) fprintf(fp, ", \"authority\": \"%s\"", grpc_authority);
-         if (grpc_max_streams[0]) fprintf(fp, ", \"maxStreams\": %s", grpc_max_streams);
+     } else if (sv_eq(network, "grpc")) {
+         StrView service_name = p[VP_SERVICE_NAME].len ? p[VP_SERVICE_NAME] : SV_LIT("v2ray");
+         fprintf(fp, ",\n        \"grpcSettings\": {\"serviceName\": \"%.*s\", \"multiMode\": %s",
+                 SV_FMT(service_name), memchr(service_name.ptr, ',', service_name.len) ? "true" : "false");
+         if (p[VP_AUTHORITY].len) fprintf(fp, ", \"authority\": \"%.*s\"", SV_FMT(p[VP_AUTHORITY]));
+         if (p[VP_MAX_STREAMS].len) fprintf(fp, ", \"maxStreams\": %d", sv_to_int(p[VP_MAX_STREAMS], 0));
          fprintf(fp, "}");
          need_comma = 1;
      }
  
-     if (strcmp(security, "tls") == 0) {
+     if (sv_eq(security, "tls")) {
          if (need_comma) fprintf(fp, ",");
-         fprintf(fp, "\n        \"tlsSettings\": {\"serverName\": \"%s\"", decoded_sni);
-         if (alpn[0]) {
+         fprintf(fp, "\n        \"tlsSettings\": {\"serverName\": \"");
+         uri_write_decoded(fp, p[VP_SNI]);
+         fprintf(fp, "\"");
+         if (p[VP_ALPN].len) {
              fprintf(fp, ", \"alpn\": [");
-             char alpn_copy[4096];
-             strncpy(alpn_copy, alpn, sizeof(alpn_copy) - 1);
-             alpn_copy[sizeof(alpn_copy) - 1] = '\0';
- 
-             char* pos = alpn_copy;
-             while ((pos = strstr(pos, "%2C")) != NULL) {
-                 *pos = ','; 
-                 memmove(pos + 1, pos + 3, strlen(pos + 3) + 1);
-             }
- 
-             char* alpn_value = strtok(alpn_copy, ",");
+             StrView alpn = p[VP_ALPN];
              int first = 1;
-             while (alpn_value) {
-                 char decoded_alpn[128];
-                 urldecode(decoded_alpn, alpn_value, sizeof(decoded_alpn));
-                 char* hash = strchr(decoded_alpn, '#');
-                 if (hash) *hash = '\0';
+             while (sv_split(&alpn, ',', &item)) {
                  if (!first) fprintf(fp, ", ");
-                 fprintf(fp, "\"%s\"", decoded_alpn);
+                 fprintf(fp, "\"");
+                 uri_write_decoded(fp, item);
+                 fprintf(fp, "\"");
                  first = 0;
-                 alpn_value = strtok(NULL, ",");
              }
              fprintf(fp, "]");
          }
-         if (fingerprint[0]) fprintf(fp, ", \"fingerprint\": \"%s\"", fingerprint);
-         if (allow_insecure[0]) fprintf(fp, ", \"allowInsecure\": %s", strcmp(allow_insecure, "true") == 0 ? "true" : "false");
-         if (session_resumption[0]) fprintf(fp, ", \"enableSessionResumption\": %s", strcmp(session_resumption, "true") == 0 ? "true" : "false");
-         if (utls[0]) fprintf(fp, ", \"utls\": \"%s\"", utls);
+         if (p[VP_FP].len) fprintf(fp, ", \"fingerprint\": \"%.*s\"", SV_FMT(p[VP_FP]));
+         if (p[VP_ALLOW_INSECURE].len) fprintf(fp, ", \"allowInsecure\": %s", sv_eq(p[VP_ALLOW_INSECURE], "true") ? "true" : "false");
+         if (p[VP_SESSION_RESUMPTION].len) fprintf(fp, ", \"enableSessionResumption\": %s", sv_eq(p[VP_SESSION_RESUMPTION], "true") ? "true" : "false");
+         if (p[VP_UTLS].len) fprintf(fp, ", \"utls\": \"%.*s\"", SV_FMT(p[VP_UTLS]));
          fprintf(fp, "}");
          need_comma = 1;
-     } else if (strcmp(security, "reality") == 0) {
+     } else if (sv_eq(security, "reality")) {
          if (need_comma) fprintf(fp, ",");
-         fprintf(fp, "\n        \"realitySettings\": {\"publicKey\": \"%s\"", public_key);
-         if (short_ids[0]) fprintf(fp, ", \"shortIds\": [\"%s\"]", short_ids);
-         if (spider_x[0]) fprintf(fp, ", \"spiderX\": \"%s\"", spider_x);
-         if (fingerprint[0]) fprintf(fp, ", \"fingerprint\": \"%s\"", fingerprint);
-         if (reality_show[0]) fprintf(fp, ", \"show\": %s", strcmp(reality_show, "true") == 0 ? "true" : "false");
-         if (reality_dest[0]) fprintf(fp, ", \"dest\": \"%s\"", reality_dest);
-         if (reality_server_names[0]) {
+         fprintf(fp, "\n        \"realitySettings\": {\"publicKey\": \"%.*s\"", SV_FMT(p[VP_PBK]));
+         if (p[VP_SID].len) fprintf(fp, ", \"shortIds\": [\"%.*s\"]", SV_FMT(p[VP_SID]));
+         if (p[VP_SPX].len) fprintf(fp, ", \"spiderX\": \"%.*s\"", SV_FMT(p[VP_SPX]));
+         if (p[VP_FP].len) fprintf(fp, ", \"fingerprint\": \"%.*s\"", SV_FMT(p[VP_FP]));
+         if (p[VP_SHOW].len) fprintf(fp, ", \"show\": %s", sv_eq(p[VP_SHOW], "true") ? "true" : "false");
+         if (p[VP_DEST].len) fprintf(fp, ", \"dest\": \"%.*s\"", SV_FMT(p[VP_DEST]));
+         if (p[VP_SERVER_NAMES].len) {
              fprintf(fp, ", \"serverNames\": [");
-             char server_names_copy[4096];
-             strncpy(server_names_copy, reality_server_names, sizeof(server_names_copy) - 1);
-             server_names_copy[sizeof(server_names_copy) - 1] = '\0';
-             char* server_name = strtok(server_names_copy, ",");
+             StrView server_names = p[VP_SERVER_NAMES];
              int first = 1;
-             while (server_name) {
+             while (sv_split(&server_names, ',', &item)) {
                  if (!first) fprintf(fp, ", ");
-                 fprintf(fp, "\"%s\"", server_name);
+                 fprintf(fp, "\"%.*s\"", SV_FMT(item));
                  first = 0;
-                 server_name = strtok(NULL, ",");
              }
              fprintf(fp, "]");
          }
@@ -346,102 +296,84 @@
          need_comma = 1;
      }
  
-     if (fallbacks[0]) {
+     if (p[VP_FALLBACKS].len) {
          if (need_comma) fprintf(fp, ",");
          fprintf(fp, "\n        \"fallbacks\": [");
-         char fallbacks_copy[4096];
-         strncpy(fallbacks_copy, fallbacks, sizeof(fallbacks_copy) - 1);
-         fallbacks_copy[sizeof(fallbacks_copy) - 1] = '\0';
-         char* fallback_entry = strtok(fallbacks_copy, ";");
+         StrView fallbacks = p[VP_FALLBACKS];
+         StrView entry;
          int first = 1;
-         while (fallback_entry) {
-             char fb_alpn[128] = "";
-             char fb_dest[2048] = "";
-             char fb_xver[16] = "";
-             char entry_copy[4096];
-             strncpy(entry_copy, fallback_entry, sizeof(entry_copy) - 1);
-             entry_copy[sizeof(entry_copy) - 1] = '\0';
-             char* fb_param = strtok(entry_copy, ",");
-             while (fb_param) {
-                 if (strncmp(fb_param, "alpn:", 5) == 0) strncpy(fb_alpn, fb_param + 5, sizeof(fb_alpn) - 1);
-                 else if (strncmp(fb_param, "dest:", 5) == 0) strncpy(fb_dest, fb_param + 5, sizeof(fb_dest) - 1);
-                 else if (strncmp(fb_param, "xver:", 5) == 0) strncpy(fb_xver, fb_param + 5, sizeof(fb_xver) - 1);
-                 fb_param = strtok(NULL, ",");
+         while (sv_split(&fallbacks, ';', &entry)) {
+             StrView fb_alpn = { NULL, 0 };
+             StrView fb_dest = { NULL, 0 };
+             StrView fb_xver = { NULL, 0 };
+             while (sv_split(&entry, ',', &item)) {
+                 StrView name;
+                 if (!sv_cut(&item, ':', &name)) continue;
+                 if (sv_eq(name, "alpn")) fb_alpn = item;
+                 else if (sv_eq(name, "dest")) fb_dest = item;
+                 else if (sv_eq(name, "xver")) fb_xver = item;
              }
-             if (fb_dest[0]) {
+             if (fb_dest.len) {
                  if (!first) fprintf(fp, ", ");
                  fprintf(fp, "{");
-                 if (fb_alpn[0]) fprintf(fp, "\"alpn\": \"%s\",", fb_alpn);
-                 fprintf(fp, "\"dest\": \"%s\"", fb_dest);
-                 if (fb_xver[0]) fprintf(fp, ", \"xver\": %s", fb_xver);
+                 if (fb_alpn.len) fprintf(fp, "\"alpn\": \"%.*s\",", SV_FMT(fb_alpn));
+                 fprintf(fp, "\"dest\": \"%.*s\"", SV_FMT(fb_dest));
+                 if (fb_xver.len) fprintf(fp, ", \"xver\": %d", sv_to_int(fb_xver, 0));
                  fprintf(fp, "}");
                  first = 0;
              }
-             fallback_entry = strtok(NULL, ";");
          }
          fprintf(fp, "]");
          need_comma = 1;
-     } else if (fallback[0]) {
+     } else if (p[VP_FALLBACK].len) {
          if (need_comma) fprintf(fp, ",");
-         fprintf(fp, "\n        \"fallback\": \"%s\"", fallback);
+         fprintf(fp, "\n        \"fallback\": \"%.*s\"", SV_FMT(p[VP_FALLBACK]));
          need_comma = 1;
      }
  
-     if (mux[0]) {
+     if (p[VP_MUX].len) {
          if (need_comma) fprintf(fp, ",");
-         fprintf(fp, "\n        \"mux\": {\"enabled\": %s}", strcmp(mux, "true") == 0 ? "true" : "false");
+         fprintf(fp, "\n        \"mux\": {\"enabled\": %s}", sv_eq(p[VP_MUX], "true") ? "true" : "false");
          need_comma = 1;
      }
  
      fprintf(fp, "\n      }\n");
      fprintf(fp, "    }");
  
-     if (outbounds[0]) {
-         char outbounds_copy[4096];
-         strncpy(outbounds_copy, outbounds, sizeof(outbounds_copy) - 1);
-         outbounds_copy[sizeof(outbounds_copy) - 1] = '\0';
-         char* outbound_entry = strtok(outbounds_copy, ";");
-         while (outbound_entry) {
-             char tag[128] = "";
-             char ob_address[2048] = "";
-             char ob_port[16] = "";
-             if (sscanf(outbound_entry, "%127[^:]:%2047[^:]:%15s", tag, ob_address, ob_port) == 3) {
-                 fprintf(fp, ",\n    {\n");
-                 fprintf(fp, "      \"protocol\": \"vless\",\n");
-                 fprintf(fp, "      \"tag\": \"%s\",\n", tag);
-                 fprintf(fp, "      \"settings\": {\"vnext\": [{\"address\": \"%s\", \"port\": %d, \"users\": [{\"id\": \"%s\", \"encryption\": \"%s\"}]}]}\n",
-                         ob_address, atoi(ob_port), uuid, encryption);
-                 fprintf(fp, "    }");
-             }
-             outbound_entry = strtok(NULL, ";");
+     StrView outbounds = p[VP_OUTBOUNDS];
+     StrView entry;
+     while (sv_split(&outbounds, ';', &entry)) {
+         StrView tag, ob_address;
+         if (sv_cut(&entry, ':', &tag) && sv_cut(&entry, ':', &ob_address) && tag.len && ob_address.len && entry.len) {
+             fprintf(fp, ",\n    {\n");
+             fprintf(fp, "      \"protocol\": \"vless\",\n");
+             fprintf(fp, "      \"tag\": \"%.*s\",\n", SV_FMT(tag));
+             fprintf(fp, "      \"settings\": {\"vnext\": [{\"address\": \"%.*s\", \"port\": %d, \"users\": [{\"id\": \"%.*s\", \"encryption\": \"%.*s\"}]}]}\n",
+                     SV_FMT(ob_address), sv_to_int(entry, 0), SV_FMT(uuid), SV_FMT(p[VP_ENCRYPTION]));
+             fprintf(fp, "    }");
          }
      }
 
-     if (routing[0]) {
+     StrView routing = p[VP_ROUTING];
+     if (routing.len) {
          fprintf(fp, "\n  ],\n");
      }
      else{
         fprintf(fp, "\n  ]\n");
      }
-     if (routing[0]) {
+     if (routing.len) {
          fprintf(fp, "  \"routing\": {\n");
          fprintf(fp, "    \"rules\": [\n");
-         char routing_copy[4096];
-         strncpy(routing_copy, routing, sizeof(routing_copy) - 1);
-         routing_copy[sizeof(routing_copy) - 1] = '\0';
-         char* rule = strtok(routing_copy, ";");
+         StrView rule;
          int first = 1;
-         while (rule) {
-             char type[128] = "";
-             char value[2048] = "";
-             char outbound_tag[128] = "";
-             if (sscanf(rule, "%127[^:]:%2047[^:]:%127s", type, value, outbound_tag) == 3) {
+         while (sv_split(&routing, ';', &rule)) {
+             StrView type, rule_value;
+             if (sv_cut(&rule, ':', &type) && sv_cut(&rule, ':', &rule_value) && type.len && rule_value.len && rule.len) {
                  if (!first) fprintf(fp, ",\n");
-                 fprintf(fp, "      {\"type\": \"field\", \"%s\": [\"%s\"], \"outboundTag\": \"%s\"}",
-                         strcmp(type, "domain") == 0 ? "domain" : "ip", value, outbound_tag);
+                 fprintf(fp, "      {\"type\": \"field\", \"%s\": [\"%.*s\"], \"outboundTag\": \"%.*s\"}",
+                         sv_eq(type, "domain") ? "domain" : "ip", SV_FMT(rule_value), SV_FMT(rule));
                  first = 0;
              }
-             rule = strtok(NULL, ";");
          }
          fprintf(fp, "\n    ]\n");
          fprintf(fp, "  }\n");
@@ -449,9 +381,7 @@
  
      fprintf(fp, "}\n");
  
-     char extra_info[256];
-     snprintf(extra_info, sizeof(extra_info), "Address: %s, Port: %d, HTTP Port: %d, SOCKS Port: %d",
+     LOG_DEBUGF("VLESS config written successfully", "Address: %s, Port: %d, HTTP Port: %d, SOCKS Port: %d",
               address, server_port, final_http_port, final_socks_port);
-     log_message("VLESS config written successfully", __FILE__, __LINE__, 0, extra_info);
      return 0;
  }
\ No newline at end of file
@@ -1,11 +1,3 @@
-#ifdef _WIN32
-#include <windows.h>
-#include <wincrypt.h>
-#else
-#include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
-#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +5,9 @@
 #include "libv2root_vmess.h"
 #include "libv2root_core.h"
 #include "libv2root_utils.h"
+#include "libv2root_uri.h"
+#include "libv2root_base64.h"
+#include "libv2root_arena.h"
 
 /*
  * Parses a VMess configuration string and generates a V2Ray JSON configuration file.
@@ -84,62 +79,25 @@
      int final_http_port = (http_port > 0 && validate_port(http_port_str)) ? http_port : DEFAULT_HTTP_PORT;
      int final_socks_port = (socks_port > 0 && validate_port(socks_port_str)) ? socks_port : DEFAULT_SOCKS_PORT;
  
-     const char* base64_data = vmess_str + 8;
-     size_t base64_len = strlen(base64_data);
-     char* decoded = NULL;
-     int decoded_len = 0;
- 
-     #ifdef _WIN32
-     DWORD dwDecodedLen = 0;
-     if (!CryptStringToBinaryA(base64_data, base64_len, CRYPT_STRING_BASE64, NULL, &dwDecodedLen, NULL, NULL)) {
-         log_message("Failed to calculate Base64 decoded length", __FILE__, __LINE__, GetLastError(), NULL);
-         return -1;
-     }
-     decoded = malloc(dwDecodedLen + 1);
-     if (!decoded) {
-         log_message("Memory allocation failed for decoded data", __FILE__, __LINE__, 0, NULL);
-         return -1;
-     }
-     if (!CryptStringToBinaryA(base64_data, base64_len, CRYPT_STRING_BASE64, (BYTE*)decoded, &dwDecodedLen, NULL, NULL)) {
-         log_message("Base64 decoding failed", __FILE__, __LINE__, GetLastError(), NULL);
-         free(decoded);
+     /* Share links append "#remark" after the base64 payload */
+     UriParts uri;
+     if (uri_split(vmess_str, strlen(vmess_str), &uri) != 0 || uri.body.len == 0) {
+         log_message("Invalid VMess format", __FILE__, __LINE__, 0, NULL);
          return -1;
      }
-     decoded[dwDecodedLen] = '\0';
-     decoded_len = dwDecodedLen;
-     #else
-     BIO* b64 = BIO_new(BIO_f_base64());
-     BIO* bio = BIO_new_mem_buf(base64_data, base64_len);
-     bio = BIO_push(b64, bio);
-     BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
-     char temp[1024];
-     decoded_len = BIO_read(bio, temp, sizeof(temp));
-     if (decoded_len <= 0) {
+     /* The decoded payload and its cJSON tree live in the thread's scratch arena */
+     ArenaMark scratch = arena_begin();
+     char* decoded = base64_decode_scratch(uri.body.ptr, uri.body.len, NULL);
+     if (!decoded || !decoded[0]) {
          log_message("Base64 decoding failed", __FILE__, __LINE__, 0, NULL);
-         BIO_free_all(bio);
-         return -1;
-     }
-     decoded = malloc(decoded_len + 1);
-     if (!decoded) {
-         log_message("Memory allocation failed for decoded data", __FILE__, __LINE__, 0, NULL);
-         BIO_free_all(bio);
-         return -1;
-     }
-     memcpy(decoded, temp, decoded_len);
-     decoded[decoded_len] = '\0';
-     BIO_free_all(bio);
-     #endif
- 
-     if (decoded_len <= 0) {
-         log_message("Decoded length is invalid", __FILE__, __LINE__, 0, NULL);
-         free(decoded);
+         arena_end(scratch);
          return -1;
      }
  
      cJSON* json = cJSON_Parse(decoded);
-     free(decoded);
      if (!json) {
          log_message("Invalid JSON format", __FILE__, __LINE__, 0, cJSON_GetErrorPtr());
+         arena_end(scratch);
          return -1;
      }
  
@@ -261,6 +219,7 @@
      }
  
      cJSON_Delete(json);
+     arena_end(scratch);
  
      if (id[0] == '\0' || address[0] == '\0' || port_str[0] == '\0') {
          log_message("Missing required fields (id, address, or port)", __FILE__, __LINE__, 0, NULL);
@@ -384,10 +343,10 @@
      }
  
      fprintf(fp, "    }\n");
-     fprintf(fp, "  }],\n");
+     fprintf(fp, "  }]");
  
      if (fallbacks[0]) {
-         fprintf(fp, "  \"fallbacks\": [");
+         fprintf(fp, ",\n  \"fallbacks\": [");
          char fallbacks_copy[4096];
          strncpy(fallbacks_copy, fallbacks, sizeof(fallbacks_copy) - 1);
          fallbacks_copy[sizeof(fallbacks_copy) - 1] = '\0';
@@ -414,14 +373,12 @@
              }
              fb_entry = strtok(NULL, ";");
          }
-         fprintf(fp, "]\n");
+         fprintf(fp, "]");
      }
  
-     fprintf(fp, "}\n");
+     fprintf(fp, "\n}\n");
  
-     char extra_info[256];
-     snprintf(extra_info, sizeof(extra_info), "Address: %s, Port: %d, HTTP Port: %d, SOCKS Port: %d, Tag: %s",
+     LOG_DEBUGF("VMess config written successfully", "Address: %s, Port: %d, HTTP Port: %d, SOCKS Port: %d, Tag: %s",
              address, server_port, final_http_port, final_socks_port, tag[0] ? tag : "none");
-     log_message("VMess config written successfully", __FILE__, __LINE__, 0, extra_info);
      return 0;
  }
\ No newline at end of file
@@ -17,6 +17,8 @@ BOOL WINAPI InternetSetOptionA(HINTERNET hInternet, DWORD dwOption, LPVOID lpBuf
 #include <stdio.h>
 #include <string.h>
 #include "libv2root_win.h"
+#include "libv2root_metrics.h"
+#include "libv2root_records.h"
 #include "libv2root_utils.h"
 
 #define REGISTRY_KEY "Software\\V2ROOT"
@@ -75,7 +77,7 @@ int win_start_v2ray_process(const char* config_file, const char* v2ray_path, DWO
             CloseHandle(hProcess);
         }
         /* If we reach here, the PID was invalid or process terminated - clean up registry */
-        log_message("Cleaning up stale PID from registry", __FILE__, __LINE__, 0, NULL);
+        LOG_INFO("Cleaning up stale PID from registry", NULL);
         save_pid_to_registry(0);
     }
     
@@ -92,26 +94,179 @@ int win_start_v2ray_process(const char* config_file, const char* v2ray_path, DWO
     char cmdLine[2048];
     snprintf(cmdLine, sizeof(cmdLine), "\"%s\" run -c \"%s\"", v2ray_path, config_file);
     
+    long long start_us = get_monotonic_us();
     if (!CreateProcessA(NULL, cmdLine, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
         DWORD error = GetLastError();
+        metrics_spawn_finished(0, start_us);
         log_message("Failed to create V2Ray process", __FILE__, __LINE__, error, cmdLine);
         return -1;
     }
+    metrics_spawn_finished(1, start_us);
     
     *pid = pi.dwProcessId;
     
     CloseHandle(pi.hThread);
     CloseHandle(pi.hProcess);
     
-    Sleep(500); /* Wait 500ms for process to start */
+    LOG_INFOF("Windows V2Ray process started", "V2Ray started with PID: %lu", *pid);
     
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "V2Ray started with PID: %lu", *pid);
-    log_message("Windows V2Ray process started", __FILE__, __LINE__, 0, extra_info);
+    return 0;
+}
+
+static INIT_ONCE managed_job_once = INIT_ONCE_STATIC_INIT;
+static HANDLE managed_job = NULL;
+
+/*
+ * Creates the job object that holds every managed V2Ray process. Closing its last handle
+ * kills the processes in it, so they never outlive the host process, even when it crashes.
+ */
+static BOOL CALLBACK create_managed_job(PINIT_ONCE once, PVOID param, PVOID* context) {
+    HANDLE job = CreateJobObjectA(NULL, NULL);
+    if (job) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+        ZeroMemory(&limits, sizeof(limits));
+        limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+        if (!SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits))) {
+            CloseHandle(job);
+            job = NULL;
+        }
+    }
+    if (!job) {
+        log_message("Failed to create job object, managed V2Ray processes may outlive the host", __FILE__, __LINE__, GetLastError(), NULL);
+    }
+    managed_job = job;
+    return TRUE;
+}
+
+/*
+ * Starts a V2Ray process owned by this library instance: test instances, batch probes and the
+ * warm pool.
+ *
+ * Unlike win_start_v2ray_process, the registry PID of the system proxy is neither checked nor
+ * written. The process is created suspended and assigned to the managed job object before its
+ * first instruction runs, so it is killed with the host process instead of being orphaned.
+ *
+ * Parameters:
+ *   config_file (const char*): Config path passed to "run -c".
+ *   v2ray_path (const char*): V2Ray executable path.
+ *   pid (DWORD*): Receives the process ID.
+ *
+ * Returns:
+ *   int: 0 on success, -1 on failure.
+ */
+int win_start_v2ray_managed(const char* config_file, const char* v2ray_path, DWORD* pid) {
+    if (!config_file || !v2ray_path || !pid) {
+        log_message("Invalid arguments to win_start_v2ray_managed", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    InitOnceExecuteOnce(&managed_job_once, create_managed_job, NULL, NULL);
     
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;
+    ZeroMemory(&pi, sizeof(pi));
+    
+    char cmdLine[2048];
+    snprintf(cmdLine, sizeof(cmdLine), "\"%s\" run -c \"%s\"", v2ray_path, config_file);
+    
+    long long start_us = get_monotonic_us();
+    if (!CreateProcessA(NULL, cmdLine, NULL, NULL, FALSE, CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi)) {
+        DWORD error = GetLastError();
+        metrics_spawn_finished(0, start_us);
+        log_message("Failed to create V2Ray process", __FILE__, __LINE__, error, cmdLine);
+        return -1;
+    }
+    /* A host running in a job that forbids nesting keeps its children unassigned */
+    if (managed_job && !AssignProcessToJobObject(managed_job, pi.hProcess)) {
+        LOG_DEBUGF("V2Ray process not assigned to job", "AssignProcessToJobObject failed: %lu", GetLastError());
+    }
+    ResumeThread(pi.hThread);
+    metrics_spawn_finished(1, start_us);
+    
+    *pid = pi.dwProcessId;
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    
+    LOG_DEBUGF("Managed V2Ray process started", "V2Ray started with PID: %lu", *pid);
     return 0;
 }
 
+/*
+ * Checks whether a local inbound accepts TCP connections.
+ * Connections to 127.0.0.1 are refused immediately when nothing listens.
+ */
+static int inbound_accepts(int port) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) return 0;
+    struct sockaddr_in addr;
+    ZeroMemory(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((u_short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int ok = connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    closesocket(sock);
+    return ok;
+}
+
+/*
+ * Waits until a freshly started V2Ray process accepts connections on an inbound port.
+ *
+ * Polls the inbound every 25ms, sleeping on the process handle so an early exit is noticed
+ * immediately.
+ *
+ * Parameters:
+ *   pid (DWORD): The V2Ray process ID returned by win_start_v2ray_process.
+ *   port (int): A local inbound port from the process config.
+ *   timeout_ms (int): Upper bound for the wait in milliseconds.
+ *
+ * Returns:
+ *   int: 0 once the inbound accepts, -1 on timeout, -2 if the process exited.
+ */
+int win_wait_for_ready(DWORD pid, int port, int timeout_ms) {
+    if (pid == 0 || port <= 0) {
+        log_message("Invalid arguments to win_wait_for_ready", __FILE__, __LINE__, 0, NULL);
+        return -1;
+    }
+    HANDLE hProcess = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (hProcess == NULL) {
+        log_message("V2Ray exited before becoming ready", __FILE__, __LINE__, GetLastError(), NULL);
+        return -2;
+    }
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        log_message("WSAStartup failed", __FILE__, __LINE__, WSAGetLastError(), NULL);
+        CloseHandle(hProcess);
+        return -1;
+    }
+    long long start = get_monotonic_ms();
+    long long deadline = start + (timeout_ms > 0 ? timeout_ms : 0);
+    int result = -1;
+    for (;;) {
+        if (WaitForSingleObject(hProcess, 0) == WAIT_OBJECT_0) {
+            log_message("V2Ray exited before becoming ready", __FILE__, __LINE__, 0, NULL);
+            result = -2;
+            break;
+        }
+        if (inbound_accepts(port)) {
+            LOG_DEBUGF("V2Ray inbound ready", "Port %d ready after %lld ms", port, get_monotonic_ms() - start);
+            result = 0;
+            break;
+        }
+        long long now = get_monotonic_ms();
+        if (now >= deadline) {
+            LOG_WARNINGF("V2Ray readiness timed out", "Port %d not ready within %d ms", port, timeout_ms);
+            break;
+        }
+        WaitForSingleObject(hProcess, (DWORD)(deadline - now < 25 ? deadline - now : 25));
+    }
+    WSACleanup();
+    CloseHandle(hProcess);
+    return result;
+}
+
 /*
  * Stops V2Ray process by terminating it.
  */
@@ -152,7 +307,7 @@ int win_stop_v2ray_process(DWORD pid) {
     
     if (exitCode != STILL_ACTIVE) {
         /* Process already terminated - silently succeed, only log */
-        log_message("Process already terminated - no action needed", __FILE__, __LINE__, 0, NULL);
+        LOG_DEBUG("Process already terminated - no action needed", NULL);
         CloseHandle(hProcess);
         return 0;
     }
@@ -194,7 +349,7 @@ int win_stop_v2ray_process(DWORD pid) {
     }
     
     CloseHandle(hProcess);
-    log_message("V2Ray process terminated successfully", __FILE__, __LINE__, 0, NULL);
+    LOG_DEBUG("V2Ray process terminated successfully", NULL);
     return 0;
 }
 
@@ -207,7 +362,7 @@ void save_pid_to_registry(DWORD pid) {
     if (RegCreateKeyExA(HKEY_CURRENT_USER, REGISTRY_KEY, 0, NULL, 0, KEY_WRITE, NULL, &hKey, NULL) == ERROR_SUCCESS) {
         RegSetValueExA(hKey, REGISTRY_PID_VALUE, 0, REG_DWORD, (BYTE*)&pid, sizeof(DWORD));
         RegCloseKey(hKey);
-        log_message("PID saved to registry", __FILE__, __LINE__, 0, NULL);
+        LOG_DEBUG("PID saved to registry", NULL);
     } else {
         log_message("Failed to save PID to registry", __FILE__, __LINE__, GetLastError(), NULL);
     }
@@ -256,9 +411,7 @@ int win_enable_system_proxy(int http_port, int socks_port) {
     /* Notify Internet Explorer of proxy change */
     notify_proxy_change();
     
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "Proxy: %s", proxy);
-    log_message("Windows system proxy enabled", __FILE__, __LINE__, 0, extra_info);
+    LOG_INFOF("Windows system proxy enabled", "Proxy: %s", proxy);
     
     return 0;
 }
@@ -282,7 +435,7 @@ int win_disable_system_proxy(void) {
     /* Notify Internet Explorer of proxy change */
     notify_proxy_change();
     
-    log_message("Windows system proxy disabled", __FILE__, __LINE__, 0, NULL);
+    LOG_INFO("Windows system proxy disabled", NULL);
     return 0;
 }
 
@@ -413,19 +566,64 @@ int win_test_connection(int http_port, int* latency, HANDLE hProcess) {
     WinHttpCloseHandle(hConnect);
     WinHttpCloseHandle(hSession);
     
-    char extra_info[256];
-    snprintf(extra_info, sizeof(extra_info), "Real connection latency: %d ms (actual: %.2f ms)", *latency, elapsed_ms);
-    log_message("Connection test successful via proxy", __FILE__, __LINE__, 0, extra_info);
+    LOG_INFOF("Connection test successful via proxy", "Real connection latency: %d ms (actual: %.2f ms)", *latency, elapsed_ms);
     
     return 0;
 }
 
+/*
+ * Performs one HTTPS request through the V2Ray proxy and records its phase timings.
+ *
+ * Each sample opens its own WinHTTP session, so no connection or TLS session is reused.
+ * WinHTTP does not report the local connect or the CONNECT response separately, so
+ * connect_ms and tunnel_ms stay 0; app_connect_ms is the time until the request was sent,
+ * which covers the tunnel and the TLS handshake.
+ *
+ * Parameters:
+ *   http_port (int): HTTP inbound port of the V2Ray process.
+ *   sample (ProbeSample*): Receives the phase timings.
+ *
+ * Returns:
+ *   int: 0 on success, -1 if the request failed.
+ */
+int win_probe_sample(int http_port, ProbeSample* sample) {
+    memset(sample, 0, sizeof(ProbeSample));
+    char proxy_str[64];
+    snprintf(proxy_str, sizeof(proxy_str), "http://127.0.0.1:%d", http_port);
+    wchar_t proxy_wide[64];
+    MultiByteToWideChar(CP_UTF8, 0, proxy_str, -1, proxy_wide, 64);
+    HINTERNET hSession = WinHttpOpen(L"V2Root-Probe/1.0", WINHTTP_ACCESS_TYPE_NAMED_PROXY,
+                                     proxy_wide, WINHTTP_NO_PROXY_BYPASS, 0);
+    if (!hSession) return -1;
+    DWORD timeout = DEFAULT_TTFB_TIMEOUT_MS;
+    WinHttpSetTimeouts(hSession, (int)timeout, (int)timeout, (int)timeout, (int)timeout);
+    HINTERNET hConnect = WinHttpConnect(hSession, L"www.google.com", INTERNET_DEFAULT_HTTPS_PORT, 0);
+    HINTERNET hRequest = hConnect ? WinHttpOpenRequest(hConnect, L"GET", L"/generate_204", NULL, WINHTTP_NO_REFERER,
+                                                       WINHTTP_DEFAULT_ACCEPT_TYPES, WINHTTP_FLAG_SECURE) : NULL;
+    int result = -1;
+    long long start_us = get_monotonic_us();
+    if (hRequest && WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0)) {
+        sample->app_connect_ms = (int)((get_monotonic_us() - start_us + 500) / 1000);
+        if (WinHttpReceiveResponse(hRequest, NULL)) {
+            sample->ttfb_ms = (int)((get_monotonic_us() - start_us + 500) / 1000);
+            if (sample->ttfb_ms < 1) sample->ttfb_ms = 1;
+            sample->total_ms = sample->ttfb_ms;
+            result = 0;
+        }
+    }
+    if (result != 0) LOG_DEBUGF("Probe sample failed", "WinHTTP error %lu", GetLastError());
+    if (hRequest) WinHttpCloseHandle(hRequest);
+    if (hConnect) WinHttpCloseHandle(hConnect);
+    WinHttpCloseHandle(hSession);
+    return result;
+}
+
 /*
  * Performs a single HTTP request through the V2Ray proxy and measures TTFB.
- * Returns JSON with platform, success, ttfb_ms, http_status, and error_message.
+ * Fills success, ttfb_ms, http_status and, on failure, error_code and error_details of
+ * record; returns 0 on success and -1 on failure.
  */
-EXPORT char* win_measure_ttfb(int http_port) {
-    static char result[1024];
+int win_measure_ttfb_record(int http_port, ProbeRecord* record) {
     LARGE_INTEGER freq, start, end;
     QueryPerformanceFrequency(&freq);
     
@@ -445,10 +643,9 @@ EXPORT char* win_measure_ttfb(int http_port) {
     );
     
     if (!hSession) {
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"windows\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to open HTTP session: %lu\"}", 
-                 GetLastError());
-        return result;
+        record->error_code = PROBE_CODE_TRANSPORT;
+        snprintf(record->error_details, sizeof(record->error_details), "Failed to open HTTP session: %lu", GetLastError());
+        return -1;
     }
     
     // Set timeouts (10 seconds total)
@@ -467,10 +664,9 @@ EXPORT char* win_measure_ttfb(int http_port) {
     
     if (!hConnect) {
         WinHttpCloseHandle(hSession);
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"windows\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to connect: %lu\"}", 
-                 GetLastError());
-        return result;
+        record->error_code = PROBE_CODE_TRANSPORT;
+        snprintf(record->error_details, sizeof(record->error_details), "Failed to connect: %lu", GetLastError());
+        return -1;
     }
     
     // Create HTTP request
@@ -487,10 +683,9 @@ EXPORT char* win_measure_ttfb(int http_port) {
     if (!hRequest) {
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"windows\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to create request: %lu\"}", 
-                 GetLastError());
-        return result;
+        record->error_code = PROBE_CODE_TRANSPORT;
+        snprintf(record->error_details, sizeof(record->error_details), "Failed to create request: %lu", GetLastError());
+        return -1;
     }
     
     // Start timing
@@ -501,10 +696,9 @@ EXPORT char* win_measure_ttfb(int http_port) {
         WinHttpCloseHandle(hRequest);
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"windows\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to send request: %lu\"}", 
-                 GetLastError());
-        return result;
+        record->error_code = PROBE_CODE_TRANSPORT;
+        snprintf(record->error_details, sizeof(record->error_details), "Failed to send request: %lu", GetLastError());
+        return -1;
     }
     
     // Receive response
@@ -512,10 +706,9 @@ EXPORT char* win_measure_ttfb(int http_port) {
         WinHttpCloseHandle(hRequest);
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        snprintf(result, sizeof(result),
-                 "{\"platform\": \"windows\", \"success\": false, \"ttfb_ms\": null, \"http_status\": null, \"error_message\": \"Failed to receive response: %lu\"}", 
-                 GetLastError());
-        return result;
+        record->error_code = PROBE_CODE_TRANSPORT;
+        snprintf(record->error_details, sizeof(record->error_details), "Failed to receive response: %lu", GetLastError());
+        return -1;
     }
     
     // Stop timing at TTFB
@@ -539,11 +732,19 @@ EXPORT char* win_measure_ttfb(int http_port) {
     WinHttpCloseHandle(hConnect);
     WinHttpCloseHandle(hSession);
     
-    // Return formatted result
-    snprintf(result, sizeof(result),
-             "{\"platform\": \"windows\", \"success\": true, \"ttfb_ms\": %d, \"http_status\": %lu, \"error_message\": null}", 
-             (int)(elapsed_ms + 0.5), status_code);
-    
+    record->success = 1;
+    record->ttfb_ms = (int32_t)(elapsed_ms + 0.5);
+    record->http_status = (int32_t)status_code;
+    return 0;
+}
+
+/* As win_measure_ttfb_record, returning the result as JSON in a per-thread buffer */
+EXPORT char* win_measure_ttfb(int http_port) {
+    static THREAD_LOCAL char result[1024];
+    ProbeRecord record;
+    probe_record_init(&record, 0);
+    win_measure_ttfb_record(http_port, &record);
+    probe_record_ttfb_json(&record, result, sizeof(result));
     return result;
 }
 
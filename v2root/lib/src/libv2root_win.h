@@ -12,7 +12,9 @@ extern "C" {
 
 /* Process management */
 int win_start_v2ray_process(const char* config_file, const char* v2ray_path, DWORD* pid);
+int win_start_v2ray_managed(const char* config_file, const char* v2ray_path, DWORD* pid);
 int win_stop_v2ray_process(DWORD pid);
+int win_wait_for_ready(DWORD pid, int port, int timeout_ms);
 
 /* Registry operations for PID persistence */
 void save_pid_to_registry(DWORD pid);
@@ -24,6 +26,8 @@ int win_disable_system_proxy(void);
 
 /* Connection testing */
 int win_test_connection(int http_port, int* latency, HANDLE hProcess);
+int win_probe_sample(int http_port, ProbeSample* sample);
+int win_measure_ttfb_record(int http_port, ProbeRecord* record);
 EXPORT char* win_measure_ttfb(int http_port);
 
 #ifdef __cplusplus
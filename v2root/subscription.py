@@ -24,6 +24,71 @@ from urllib.parse import urlparse, parse_qs, unquote
 
 from .logger import logger, log_function_call
 
+# Native base64 decoder registered by V2ROOT once the C library is loaded
+_native_b64decode: Optional[Callable[[Union[str, bytes]], Optional[bytes]]] = None
+
+
+def set_native_base64_decoder(decoder: Optional[Callable[[Union[str, bytes]], Optional[bytes]]]) -> None:
+    """
+    Register a native decoder for subscription payloads.
+
+    Args:
+        decoder: Callable returning the decoded bytes, or None if the input is not base64.
+                 Pass None to fall back to the pure-Python decoder.
+    """
+    global _native_b64decode
+    _native_b64decode = decoder
+
+
+# Native whole-body parser registered by V2ROOT once the C library is loaded
+_native_parse: Optional[Callable[[str], Optional[List[Tuple[str, str, int, int]]]]] = None
+
+
+def set_native_subscription_parser(parser: Optional[Callable[[str], Optional[List[Tuple[str, str, int, int]]]]]) -> None:
+    """
+    Register a native parser for whole subscription bodies.
+
+    Args:
+        parser: Callable returning (config, host, port, fingerprint) tuples for every share link
+                in the body, with port 0 when the endpoint is unknown, or None if the body cannot
+                be decoded. Pass None to fall back to the pure-Python parser.
+    """
+    global _native_parse
+    _native_parse = parser
+
+
+# Native canonical fingerprint registered by V2ROOT once the C library is loaded
+_native_fingerprint: Optional[Callable[[str], int]] = None
+
+
+def set_native_fingerprint(fingerprint: Optional[Callable[[str], int]]) -> None:
+    """
+    Register a native canonical fingerprint for configuration strings.
+
+    Args:
+        fingerprint: Callable returning a non-zero 64-bit fingerprint, or 0 if the config cannot
+                     be parsed. Pass None to fall back to comparing configs without their remark.
+    """
+    global _native_fingerprint
+    _native_fingerprint = fingerprint
+
+
+def config_fingerprint(config_string: str) -> Union[int, str]:
+    """
+    Return a key that is equal for configs differing only in remark or parameter order.
+
+    Args:
+        config_string: V2Ray configuration string (vmess://, vless://, etc.)
+
+    Returns:
+        The native fingerprint if available, otherwise the config without its #remark.
+    """
+    if _native_fingerprint:
+        fingerprint = _native_fingerprint(config_string)
+        if fingerprint:
+            return fingerprint
+    return config_string.split('#', 1)[0]
+
 class SubscriptionError(Exception):
     """Base exception for subscription-related errors."""
     pass
@@ -43,18 +108,23 @@ class ConfigMetadata:
     Stores information about protocol, server location, latency, etc.
     """
     
-    def __init__(self, config_string: str):
+    def __init__(self, config_string: str, address: Optional[str] = None, port: Optional[int] = None,
+                 fingerprint: Optional[Union[int, str]] = None):
         """
         Initialize config metadata from a configuration string.
         
         Args:
             config_string: V2Ray configuration string (vmess://, vless://, etc.)
+            address: Server address already parsed natively; extracted from the string if None
+            port: Server port already parsed natively; extracted from the string if None
+            fingerprint: Deduplication key already computed natively; see config_fingerprint
         """
         self.config_string = config_string
+        self.fingerprint = fingerprint if fingerprint else config_fingerprint(config_string)
         self.protocol = self._extract_protocol()
         self.name = self._extract_name()
-        self.address = self._extract_address()
-        self.port = self._extract_port()
+        self.address = address if address is not None else self._extract_address()
+        self.port = port if port is not None else self._extract_port()
         self.last_test_time = 0
         self.last_latency = -1
         self.success_count = 0
@@ -229,6 +299,7 @@ class Subscription:
         self.tags = tags or []
         self.update_thread = None
         self.stop_auto_update_flag = threading.Event()
+        self.on_update: Optional[Callable[[List[str]], Any]] = None
         
         # Statistics
         self.total_updates = 0
@@ -319,24 +390,36 @@ class Subscription:
         """
         try:
             config_strings = []
+            parsed = {}
             
-            # Try to decode as Base64 first
-            try:
-                # Check if content looks like Base64 (no spaces, special chars suggest it's encoded)
-                if ' ' not in content and '\n' not in content and len(content) > 100:
-                    padding = 4 - (len(content) % 4) if len(content) % 4 else 0
-                    padded_content = content + "=" * padding
-                    decoded = base64.b64decode(padded_content).decode('utf-8')
-                    config_strings = [line.strip() for line in decoded.splitlines() if line.strip()]
-                    logger.debug(f"Successfully decoded Base64 content for {self.name}")
-                else:
-                    # Content already has newlines, likely not Base64 encoded
+            # The native parser decodes and splits the whole body in one call
+            native_records = _native_parse(content) if _native_parse else None
+            if native_records is not None:
+                config_strings = [record[0] for record in native_records]
+                parsed = {config: (host if port > 0 else None, port if port > 0 else None, fingerprint)
+                          for config, host, port, fingerprint in native_records}
+                logger.debug(f"Parsed subscription {self.name} natively")
+            else:
+                # Try to decode as Base64 first
+                try:
+                    # Check if content looks like Base64 (no spaces, special chars suggest it's encoded)
+                    if ' ' not in content and '\n' not in content and len(content) > 100:
+                        decoded_bytes = _native_b64decode(content) if _native_b64decode else None
+                        if decoded_bytes is None:
+                            padding = 4 - (len(content) % 4) if len(content) % 4 else 0
+                            padded_content = content + "=" * padding
+                            decoded_bytes = base64.b64decode(padded_content)
+                        decoded = decoded_bytes.decode('utf-8')
+                        config_strings = [line.strip() for line in decoded.splitlines() if line.strip()]
+                        logger.debug(f"Successfully decoded Base64 content for {self.name}")
+                    else:
+                        # Content already has newlines, likely not Base64 encoded
+                        config_strings = [line.strip() for line in content.splitlines() if line.strip()]
+                        logger.debug(f"Content appears to be plain text for {self.name}")
+                except Exception as e:
+                    logger.warning(f"Base64 decoding failed for {self.name}: {str(e)}, trying direct parsing")
+                    # If Base64 fails, try direct parsing
                     config_strings = [line.strip() for line in content.splitlines() if line.strip()]
-                    logger.debug(f"Content appears to be plain text for {self.name}")
-            except Exception as e:
-                logger.warning(f"Base64 decoding failed for {self.name}: {str(e)}, trying direct parsing")
-                # If Base64 fails, try direct parsing
-                config_strings = [line.strip() for line in content.splitlines() if line.strip()]
             
             # Log what we got before filtering
             logger.debug(f"Found {len(config_strings)} lines in subscription {self.name}")
@@ -366,13 +449,19 @@ class Subscription:
                 logger.error(error_details)
                 raise ParseError(error_details)
             
-            # Create ConfigMetadata objects
+            # Create ConfigMetadata objects, keeping the first of each duplicate
+            existing_by_fingerprint = {c.fingerprint: c for c in self.configs}
+            seen = set()
             new_configs = []
             for config_str in valid_configs:
                 try:
-                    config_meta = ConfigMetadata(config_str)
+                    address, port, fingerprint = parsed.get(config_str, (None, None, None))
+                    config_meta = ConfigMetadata(config_str, address=address, port=port, fingerprint=fingerprint)
+                    if config_meta.fingerprint in seen:
+                        continue
+                    seen.add(config_meta.fingerprint)
                     # Try to preserve existing metadata
-                    existing = self._find_existing_config(config_str)
+                    existing = existing_by_fingerprint.get(config_meta.fingerprint)
                     if existing:
                         config_meta.last_test_time = existing.last_test_time
                         config_meta.last_latency = existing.last_latency
@@ -384,6 +473,9 @@ class Subscription:
                     logger.warning(f"Failed to parse config: {str(e)}")
             
             self.configs = new_configs
+            duplicates = len(valid_configs) - len(new_configs)
+            if duplicates > 0:
+                logger.debug(f"Dropped {duplicates} duplicate configurations from {self.name}")
             logger.info(f"Successfully parsed {len(new_configs)} configurations from {self.name}")
             return new_configs
             
@@ -396,9 +488,10 @@ class Subscription:
                 raise
     
     def _find_existing_config(self, config_str: str) -> Optional[ConfigMetadata]:
-        """Find existing config by string match."""
+        """Find an existing config with the same fingerprint."""
+        fingerprint = config_fingerprint(config_str)
         for config in self.configs:
-            if config.config_string == config_str:
+            if config.fingerprint == fingerprint:
                 return config
         return None
     
@@ -406,8 +499,16 @@ class Subscription:
         """Update the subscription (convenience method)."""
         return self.fetch(timeout)
     
-    def start_auto_update(self):
-        """Start auto-updating this subscription in the background."""
+    def start_auto_update(self, on_update: Optional[Callable[[List[str]], Any]] = None):
+        """
+        Start auto-updating this subscription in the background.
+
+        Args:
+            on_update: Called with the enabled config strings after every successful refresh,
+                       e.g. V2ROOT.monitor_sync to have the health monitor re-score them.
+        """
+        if on_update is not None:
+            self.on_update = on_update
         if not self.auto_update:
             self.auto_update = True
             
@@ -436,6 +537,8 @@ class Subscription:
             if time.time() - self.last_update_time >= self.update_interval:
                 try:
                     self.fetch()
+                    if self.on_update and self.last_fetch_success:
+                        self.on_update(self.get_configs())
                 except Exception as e:
                     logger.error(f"Auto-update failed for {self.name}: {str(e)}")
                     
@@ -785,12 +888,14 @@ class SubscriptionManager:
         return results
     
     @log_function_call
-    def get_all_configs(self, enabled_only: bool = True) -> List[str]:
+    def get_all_configs(self, enabled_only: bool = True, unique: bool = True) -> List[str]:
         """
         Get all configuration strings from all subscriptions.
         
         Args:
             enabled_only: If True, only return configs from enabled subscriptions (default: True)
+            unique: If True, keep only the first of configs that differ just in remark or
+                    parameter order across subscriptions (default: True)
         
         Returns:
             List[str]: List of all configuration strings
@@ -804,9 +909,15 @@ class SubscriptionManager:
             >>> all_configs = manager.get_all_configs(enabled_only=False)
         """
         all_configs = []
+        seen = set()
         for subscription in self.subscriptions.values():
             if not enabled_only or subscription.enabled:
-                all_configs.extend(subscription.get_configs())
+                for config in subscription.configs:
+                    if unique:
+                        if config.fingerprint in seen:
+                            continue
+                        seen.add(config.fingerprint)
+                    all_configs.append(config.config_string)
         return all_configs
     
     @log_function_call
@@ -1,14 +1,239 @@
 from colorama import init, Fore, Style
 from .logger import logger, log_function_call, configure_logger
+from .subscription import set_native_base64_decoder, set_native_subscription_parser, set_native_fingerprint
 import ctypes
 import os
 import sys
 import platform
 import subprocess
 import select
+import logging
 
 init(autoreset=True)
 
+class V2ConfigRecord(ctypes.Structure):
+    """Mirror of the C V2ConfigRecord returned by v2root_config_get."""
+    _fields_ = [
+        ("config", ctypes.c_char_p),
+        ("host", ctypes.c_char_p),
+        ("port", ctypes.c_int),
+        ("protocol", ctypes.c_int),
+        ("transport", ctypes.c_int),
+        ("security", ctypes.c_int),
+        ("hash", ctypes.c_uint64)
+    ]
+
+class ProbeResult(ctypes.Structure):
+    """Mirror of the C ProbeResult filled by probe_config_quick and probe_config_full."""
+    _fields_ = [
+        ("success", ctypes.c_int),
+        ("dns_ms", ctypes.c_int),
+        ("tcp_connect_ms", ctypes.c_int),
+        ("tls_handshake_ms", ctypes.c_int),
+        ("transport_handshake_ms", ctypes.c_int),
+        ("proxy_setup_ms", ctypes.c_int),
+        ("app_connect_ms", ctypes.c_int),
+        ("ttfb_ms", ctypes.c_int),
+        ("total_ms", ctypes.c_int),
+        ("attempts", ctypes.c_int),
+        ("score", ctypes.c_double),
+        ("error_type", ctypes.c_char * 64),
+        ("error_details", ctypes.c_char * 256),
+        ("dns_cache_hit", ctypes.c_int),
+        ("warm_rtt_ms", ctypes.c_int),
+        ("v2ray_ready_ms", ctypes.c_int),
+        ("ttfb_p90_ms", ctypes.c_int),
+        ("throughput_mbps", ctypes.c_double),
+        ("stalls", ctypes.c_int)
+    ]
+
+class ProbeRecord(ctypes.Structure):
+    """Mirror of the versioned C ProbeRecord used by the record and streaming APIs."""
+    _fields_ = [
+        ("size", ctypes.c_uint32),
+        ("version", ctypes.c_uint32),
+        ("index", ctypes.c_int32),
+        ("success", ctypes.c_int32),
+        ("error_code", ctypes.c_int32),
+        ("http_status", ctypes.c_int32),
+        ("dns_ms", ctypes.c_int32),
+        ("tcp_connect_ms", ctypes.c_int32),
+        ("tls_handshake_ms", ctypes.c_int32),
+        ("transport_handshake_ms", ctypes.c_int32),
+        ("proxy_setup_ms", ctypes.c_int32),
+        ("app_connect_ms", ctypes.c_int32),
+        ("ttfb_ms", ctypes.c_int32),
+        ("total_ms", ctypes.c_int32),
+        ("attempts", ctypes.c_int32),
+        ("dns_cache_hit", ctypes.c_int32),
+        ("warm_rtt_ms", ctypes.c_int32),
+        ("reserved", ctypes.c_int32),
+        ("score", ctypes.c_double),
+        ("error_details", ctypes.c_char * 256),
+        ("v2ray_ready_ms", ctypes.c_int32),
+        ("ttfb_p90_ms", ctypes.c_int32),
+        ("stage", ctypes.c_int32),
+        ("reserved_v3", ctypes.c_int32),
+        ("throughput_mbps", ctypes.c_double),
+        ("stalls", ctypes.c_int32),
+        ("reserved_v4", ctypes.c_int32)
+    ]
+
+    def to_dict(self):
+        """Convert the record to the dict layout used by the probe methods."""
+        return {
+            'index': self.index,
+            'success': bool(self.success),
+            'error_type': None if self.success else PROBE_ERROR_TYPES[self.error_code]
+                          if 0 <= self.error_code < len(PROBE_ERROR_TYPES) else 'unknown',
+            'error_details': self.error_details.decode('utf-8', 'replace') or None,
+            'http_status': self.http_status or None,
+            'dns_ms': self.dns_ms,
+            'tcp_ms': self.tcp_connect_ms,
+            'tls_ms': self.tls_handshake_ms,
+            'transport_handshake_ms': self.transport_handshake_ms,
+            'proxy_setup_ms': self.proxy_setup_ms,
+            'ttfb_ms': self.ttfb_ms,
+            'ttfb_p90_ms': self.ttfb_p90_ms,
+            'total_ms': self.total_ms,
+            'v2ray_ready_ms': self.v2ray_ready_ms,
+            'warm_rtt_ms': self.warm_rtt_ms,
+            'attempts': self.attempts,
+            'dns_cache_hit': bool(self.dns_cache_hit),
+            'score': self.score,
+            'throughput_mbps': self.throughput_mbps or None,
+            'stalls': self.stalls,
+            'stage': PROBE_STAGES[self.stage] if 0 <= self.stage < len(PROBE_STAGES) else None
+        }
+
+PROBE_RECORD_VERSION = 4
+PROBE_MODES = {'quick': 0, 'batch': 1, 'observatory': 2, 'handshake': 3}
+SHARD_REGION_LEN = 32
+PROBE_ERROR_TYPES = ['none', 'dns_failure', 'tcp_timeout', 'tls_error', 'transport_error',
+                     'auth_error', 'upstream_blocked', 'timeout', 'unknown', 'skipped']
+PROBE_STAGES = [None, 'tcp', 'tls', 'ttfb']
+ProbeRecordCallback = ctypes.CFUNCTYPE(None, ctypes.POINTER(ProbeRecord), ctypes.c_void_p)
+
+METRICS_BUCKETS = 100
+METRIC_COUNTERS = ['probes_started', 'probes_succeeded'] + \
+                  ['probes_failed_' + name for name in PROBE_ERROR_TYPES] + \
+                  ['v2ray_spawns', 'v2ray_spawn_failures', 'ready_failures', 'parse_failures', 'process_restarts']
+METRIC_HISTOGRAMS = ['v2ray_spawn', 'v2ray_ready', 'ttfb', 'parse']
+
+class MetricsHistogram(ctypes.Structure):
+    """Mirror of the C MetricsHistogram (log-linear buckets in microseconds)."""
+    _fields_ = [
+        ("count", ctypes.c_uint64),
+        ("sum_us", ctypes.c_uint64),
+        ("buckets", ctypes.c_uint64 * METRICS_BUCKETS)
+    ]
+
+class MetricsSnapshot(ctypes.Structure):
+    """Mirror of the C MetricsSnapshot filled by v2root_metrics_snapshot."""
+    _fields_ = [
+        ("counters", ctypes.c_uint64 * len(METRIC_COUNTERS)),
+        ("histograms", MetricsHistogram * len(METRIC_HISTOGRAMS))
+    ]
+
+class MonitorStat(ctypes.Structure):
+    """Mirror of the C MonitorStat returned by v2root_monitor_snapshot."""
+    _fields_ = [
+        ("id", ctypes.c_int),
+        ("samples", ctypes.c_int),
+        ("last_success", ctypes.c_int),
+        ("probes", ctypes.c_int),
+        ("fingerprint", ctypes.c_uint64),
+        ("ewma_ms", ctypes.c_double),
+        ("ewma_tcp_ms", ctypes.c_double),
+        ("jitter_ms", ctypes.c_double),
+        ("success_rate", ctypes.c_double),
+        ("score", ctypes.c_double),
+        ("age_ms", ctypes.c_longlong)
+    ]
+
+class CacheStat(ctypes.Structure):
+    """Mirror of the C CacheStat returned by v2root_cache_get."""
+    _fields_ = [
+        ("fingerprint", ctypes.c_uint64),
+        ("samples", ctypes.c_int),
+        ("successes", ctypes.c_int),
+        ("last_success", ctypes.c_int),
+        ("median_ms", ctypes.c_int),
+        ("success_rate", ctypes.c_double),
+        ("score", ctypes.c_double),
+        ("age_ms", ctypes.c_longlong)
+    ]
+
+MONITOR_PROBE_MODES = {'quick': 0, 'batch': 1, 'observatory': 2}
+MONITOR_MAX_CONFIGS = 4096
+
+FailoverCallback = ctypes.CFUNCTYPE(None, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_char_p)
+FAILOVER_EVENTS = {0: 'started', 1: 'standby', 2: 'switched', 3: 'degraded', 4: 'error'}
+
+class V2RootContext:
+    """
+    An independent native library context created by V2ROOT.create_context.
+
+    Each context owns its own ports, V2Ray process and result buffer, so separate contexts
+    can test configs from different threads at the same time.
+    """
+
+    def __init__(self, owner, handle, http_port, socks_port):
+        self._owner = owner
+        self._handle = handle
+        self.http_port = http_port
+        self.socks_port = socks_port
+
+    def test_connection(self, config_str):
+        """
+        Test a config through this context's ports.
+
+        Args:
+            config_str (str): V2Ray configuration string to test.
+
+        Returns:
+            int: Latency of the connection in milliseconds.
+
+        Raises:
+            Exception: If the context is closed or the connection test fails.
+        """
+        if not self._handle:
+            raise Exception("Context is closed")
+        latency = ctypes.c_int()
+        result = self._owner.lib.v2root_ctx_test_connection(self._handle, config_str.encode('utf-8'), ctypes.byref(latency))
+        if result != 0:
+            raise Exception(self._owner._explain_error_code(result, "Connection test failed"))
+        return latency.value
+
+    def measure_ttfb(self, config_str):
+        """
+        Measure the time to first byte of a config through this context's HTTP port.
+
+        Returns:
+            dict: The measurement result, as returned by V2ROOT._measure_ttfb.
+
+        Raises:
+            Exception: If the context is closed.
+        """
+        if not self._handle:
+            raise Exception("Context is closed")
+        record = ProbeRecord()
+        self._owner.lib.v2root_ctx_measure_ttfb_record(self._handle, config_str.encode('utf-8'),
+                                                       ctypes.byref(record), ctypes.sizeof(record))
+        return self._owner._ttfb_dict(record)
+
+    def close(self):
+        """Stop this context's V2Ray process, if any, and release the context."""
+        if self._handle:
+            self._owner.lib.v2root_ctx_free(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        self.close()
+
 class V2ROOT:
     """
     A class to manage V2Ray proxy operations on Windows and Linux platforms.
@@ -204,6 +429,9 @@ class V2ROOT:
         self.lib.reset_network_proxy.restype = ctypes.c_int
         self.lib.parse_config_string.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
         self.lib.parse_config_string.restype = ctypes.c_int
+        self.lib.parse_config_strings_balanced.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+                                                           ctypes.c_int, ctypes.c_int, ctypes.c_int]
+        self.lib.parse_config_strings_balanced.restype = ctypes.c_int
         self.lib.start_v2ray.argtypes = [ctypes.c_int, ctypes.c_int]
         self.lib.start_v2ray.restype = ctypes.c_int
         self.lib.stop_v2ray.argtypes = []
@@ -213,14 +441,142 @@ class V2ROOT:
         self.lib.ping_server.argtypes = [ctypes.c_char_p, ctypes.c_int]
         self.lib.ping_server.restype = ctypes.c_int
 
-        self.lib.probe_config_quick.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p), ctypes.c_int, ctypes.c_int]
+        self.lib.probe_config_quick.argtypes = [ctypes.c_char_p, ctypes.POINTER(ProbeResult), ctypes.c_int, ctypes.c_int]
         self.lib.probe_config_quick.restype = ctypes.c_int
-        self.lib.probe_config_full.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p), ctypes.c_int, ctypes.c_int, ctypes.c_int]
+        self.lib.probe_config_full.argtypes = [ctypes.c_char_p, ctypes.POINTER(ProbeResult), ctypes.c_int, ctypes.c_int, ctypes.c_int]
         self.lib.probe_config_full.restype = ctypes.c_int
+        self.lib.probe_config_throughput.argtypes = [ctypes.c_char_p, ctypes.POINTER(ProbeResult), ctypes.c_int, ctypes.c_int,
+                                                     ctypes.c_int, ctypes.c_int, ctypes.c_int]
+        self.lib.probe_config_throughput.restype = ctypes.c_int
         
         self.lib.measure_ttfb.argtypes = [ctypes.c_char_p, ctypes.c_int]
         self.lib.measure_ttfb.restype = ctypes.c_char_p  
 
+        self.lib.base64_decode_into.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t]
+        self.lib.base64_decode_into.restype = ctypes.c_int
+        set_native_base64_decoder(self.decode_base64)
+
+        self.lib.v2root_parse_subscription.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_void_p)]
+        self.lib.v2root_parse_subscription.restype = ctypes.c_int
+        self.lib.v2root_config_get.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(V2ConfigRecord)]
+        self.lib.v2root_config_get.restype = ctypes.c_int
+        self.lib.v2root_free_config_table.argtypes = [ctypes.c_void_p]
+        self.lib.v2root_free_config_table.restype = None
+        set_native_subscription_parser(self.parse_subscription)
+
+        self.lib.v2root_config_fingerprint.argtypes = [ctypes.c_char_p]
+        self.lib.v2root_config_fingerprint.restype = ctypes.c_uint64
+        set_native_fingerprint(self.config_fingerprint)
+
+        self.lib.v2root_set_log_level.argtypes = [ctypes.c_int]
+        self.lib.v2root_set_log_level.restype = None
+        self.lib.v2root_flush_log.argtypes = []
+        self.lib.v2root_flush_log.restype = None
+        self.set_native_log_level(logger.log_level)
+
+        pid_type = ctypes.c_int if self.is_linux else ctypes.c_ulong
+        self.lib.v2root_pool_start.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int]
+        self.lib.v2root_pool_start.restype = ctypes.c_int
+        self.lib.v2root_pool_prepare.argtypes = [ctypes.c_char_p]
+        self.lib.v2root_pool_prepare.restype = ctypes.c_int
+        self.lib.v2root_pool_switch.argtypes = []
+        self.lib.v2root_pool_switch.restype = ctypes.c_int
+        self.lib.v2root_pool_stop.argtypes = []
+        self.lib.v2root_pool_stop.restype = ctypes.c_int
+        self.lib.v2root_pool_status.argtypes = [ctypes.POINTER(pid_type), ctypes.POINTER(pid_type)]
+        self.lib.v2root_pool_status.restype = ctypes.c_int
+        self._pid_type = pid_type
+
+        self.lib.v2root_monitor_add.argtypes = [ctypes.c_char_p]
+        self.lib.v2root_monitor_add.restype = ctypes.c_int
+        self.lib.v2root_monitor_remove.argtypes = [ctypes.c_int]
+        self.lib.v2root_monitor_remove.restype = ctypes.c_int
+        self.lib.v2root_monitor_start.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_int]
+        self.lib.v2root_monitor_start.restype = ctypes.c_int
+        self.lib.v2root_monitor_stop.argtypes = []
+        self.lib.v2root_monitor_stop.restype = ctypes.c_int
+        self.lib.v2root_monitor_snapshot.argtypes = [ctypes.POINTER(MonitorStat), ctypes.c_int]
+        self.lib.v2root_monitor_snapshot.restype = ctypes.c_int
+        self._monitor_ids = {}
+
+        self.lib.v2root_failover_set_callback.argtypes = [FailoverCallback]
+        self.lib.v2root_failover_set_callback.restype = None
+        self.lib.v2root_failover_start.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_double,
+                                                   ctypes.c_double, ctypes.c_int]
+        self.lib.v2root_failover_start.restype = ctypes.c_int
+        self.lib.v2root_failover_stop.argtypes = []
+        self.lib.v2root_failover_stop.restype = ctypes.c_int
+        self.lib.v2root_failover_active.argtypes = []
+        self.lib.v2root_failover_active.restype = ctypes.c_int
+        self._failover_callback = None
+
+        self.lib.v2root_ports_set_range.argtypes = [ctypes.c_int, ctypes.c_int]
+        self.lib.v2root_ports_set_range.restype = ctypes.c_int
+
+        self.lib.v2root_metrics_snapshot.argtypes = [ctypes.POINTER(MetricsSnapshot)]
+        self.lib.v2root_metrics_snapshot.restype = ctypes.c_int
+        self.lib.v2root_metrics_reset.argtypes = []
+        self.lib.v2root_metrics_reset.restype = None
+        self.lib.v2root_metrics_quantile_us.argtypes = [ctypes.POINTER(MetricsHistogram), ctypes.c_double]
+        self.lib.v2root_metrics_quantile_us.restype = ctypes.c_longlong
+        self.lib.v2root_metrics_format.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+        self.lib.v2root_metrics_format.restype = ctypes.c_int
+        self.lib.v2root_metrics_serve.argtypes = [ctypes.c_int]
+        self.lib.v2root_metrics_serve.restype = ctypes.c_int
+        self.lib.v2root_metrics_stop_server.argtypes = []
+        self.lib.v2root_metrics_stop_server.restype = ctypes.c_int
+
+        self.lib.v2root_cache_open.argtypes = [ctypes.c_char_p, ctypes.c_int]
+        self.lib.v2root_cache_open.restype = ctypes.c_int
+        self.lib.v2root_cache_close.argtypes = []
+        self.lib.v2root_cache_close.restype = ctypes.c_int
+        self.lib.v2root_cache_get.argtypes = [ctypes.c_char_p, ctypes.POINTER(CacheStat)]
+        self.lib.v2root_cache_get.restype = ctypes.c_int
+        self.lib.v2root_cache_best.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_longlong]
+        self.lib.v2root_cache_best.restype = ctypes.c_int
+
+        self.lib.v2root_ctx_new.argtypes = []
+        self.lib.v2root_ctx_new.restype = ctypes.c_void_p
+        self.lib.v2root_ctx_free.argtypes = [ctypes.c_void_p]
+        self.lib.v2root_ctx_free.restype = None
+        self.lib.v2root_ctx_init.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p]
+        self.lib.v2root_ctx_init.restype = ctypes.c_int
+        self.lib.v2root_ctx_set_ports.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int]
+        self.lib.v2root_ctx_set_ports.restype = ctypes.c_int
+        self.lib.v2root_ctx_test_connection.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_int)]
+        self.lib.v2root_ctx_test_connection.restype = ctypes.c_int
+        self.lib.v2root_ctx_measure_ttfb.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.v2root_ctx_measure_ttfb.restype = ctypes.c_char_p
+        self.lib.v2root_ctx_measure_ttfb_record.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_size_t]
+        self.lib.v2root_ctx_measure_ttfb_record.restype = ctypes.c_int
+
+        self.lib.v2root_measure_ttfb_record.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_size_t]
+        self.lib.v2root_measure_ttfb_record.restype = ctypes.c_int
+        self.lib.v2root_probe_records.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_int,
+                                                  ctypes.c_void_p, ctypes.c_size_t]
+        self.lib.v2root_probe_records.restype = ctypes.c_int
+        self.lib.v2root_probe_stream.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_int,
+                                                 ProbeRecordCallback, ctypes.c_void_p]
+        self.lib.v2root_probe_stream.restype = ctypes.c_int
+        self.lib.v2root_probe_select_records.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_int,
+                                                         ctypes.c_int, ctypes.c_double, ctypes.c_int,
+                                                         ctypes.c_void_p, ctypes.c_size_t]
+        self.lib.v2root_probe_select_records.restype = ctypes.c_int
+        self.lib.v2root_probe_pipeline.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_double,
+                                                   ctypes.c_double, ProbeRecordCallback, ctypes.c_void_p]
+        self.lib.v2root_probe_pipeline.restype = ctypes.c_int
+
+        self.lib.v2root_shard_of.argtypes = [ctypes.c_uint64, ctypes.c_int]
+        self.lib.v2root_shard_of.restype = ctypes.c_int
+        self.lib.v2root_shard_worker.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.POINTER(ctypes.c_char_p),
+                                                 ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                                 ctypes.c_char_p]
+        self.lib.v2root_shard_worker.restype = ctypes.c_int
+        self.lib.v2root_shard_coordinate.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+                                                     ctypes.c_int, ctypes.c_int, ctypes.c_void_p, ctypes.c_size_t,
+                                                     ctypes.c_char_p, ctypes.c_int, ctypes.POINTER(ctypes.c_int)]
+        self.lib.v2root_shard_coordinate.restype = ctypes.c_int
+
         self._init_v2ray('config.json', v2ray_path_resolved)
         logger.info(f"V2ROOT initialized successfully with V2Ray at: {v2ray_path_resolved}")
         print(f"{Fore.GREEN}V2ROOT initialized successfully{Style.RESET_ALL}")
@@ -402,6 +758,101 @@ class V2ROOT:
         logger.info("Network settings reset successfully")
         print(f"{Fore.GREEN}Network settings reset successfully!{Style.RESET_ALL}")
 
+    def decode_base64(self, data):
+        """
+        Decode standard or URL-safe base64 with the native decoder.
+
+        Padding and line breaks are optional, so whole subscription payloads can be passed as fetched.
+
+        Args:
+            data (str | bytes): The encoded text.
+
+        Returns:
+            bytes: The decoded data, or None if data is not valid base64.
+        """
+        if isinstance(data, str):
+            data = data.encode('ascii', errors='replace')
+        size = (len(data) + 3) // 4 * 3
+        out = ctypes.create_string_buffer(size + 1)
+        result = self.lib.base64_decode_into(data, len(data), out, size)
+        if result < 0:
+            return None
+        return out.raw[:result]
+
+    def parse_subscription(self, content):
+        """
+        Parse a whole subscription body with the native parser.
+
+        The body may be plain share links or base64 of them; it is decoded and split in one call.
+
+        Args:
+            content (str | bytes): The subscription body as fetched.
+
+        Returns:
+            list: (config, host, port, fingerprint) tuples in subscription order, with port 0 when
+                  the endpoint could not be parsed, or None if the body is neither share links nor
+                  base64.
+        """
+        if isinstance(content, str):
+            content = content.encode('utf-8')
+        table = ctypes.c_void_p()
+        count = self.lib.v2root_parse_subscription(content, len(content), ctypes.byref(table))
+        if count < 0:
+            return None
+        try:
+            records = []
+            record = V2ConfigRecord()
+            for i in range(count):
+                if self.lib.v2root_config_get(table, i, ctypes.byref(record)) != 0:
+                    break
+                records.append((record.config.decode('utf-8', errors='replace'),
+                                record.host.decode('utf-8', errors='replace'), record.port, record.hash))
+            return records
+        finally:
+            self.lib.v2root_free_config_table(table)
+
+    def set_native_log_level(self, level):
+        """
+        Set the minimum level the C library writes to v2root.log.
+
+        Disabled levels cost the library nothing: their messages are never formatted.
+
+        Args:
+            level (int | str): A logging level such as logging.DEBUG, or its name.
+        """
+        if isinstance(level, str):
+            level = logging.getLevelName(level.upper())
+            if not isinstance(level, int):
+                raise ValueError("Unknown log level name")
+        if level <= logging.DEBUG:
+            native_level = 0
+        elif level <= logging.INFO:
+            native_level = 1
+        elif level <= logging.WARNING:
+            native_level = 2
+        else:
+            native_level = 3
+        self.lib.v2root_set_log_level(native_level)
+
+    def flush_native_log(self):
+        """Write every line queued by the C library to v2root.log before returning."""
+        self.lib.v2root_flush_log()
+
+    def config_fingerprint(self, config_str):
+        """
+        Compute the canonical fingerprint of a configuration string.
+
+        Configs that differ only in their remark, parameter order, host case or encoding share a
+        fingerprint.
+
+        Args:
+            config_str (str): V2Ray configuration string (e.g., VLESS, VMess).
+
+        Returns:
+            int: The 64-bit fingerprint, or 0 if the config cannot be parsed.
+        """
+        return self.lib.v2root_config_fingerprint(config_str.encode('utf-8'))
+
     @log_function_call
     def set_config_string(self, config_str):
         """
@@ -433,6 +884,37 @@ class V2ROOT:
         logger.info("Configuration applied successfully")
         print(f"{Fore.GREEN}Connection OK{Style.RESET_ALL}")
 
+    def set_config_strings_balanced(self, config_strs, strategy='leastPing'):
+        """
+        Parse several configuration strings into one load-balanced V2Ray configuration.
+
+        Every config becomes an outbound behind a balancer, so concurrent connections through
+        the proxy ports are spread over all nodes; pass e.g. the top K configs by score.
+
+        Args:
+            config_strs (list): V2Ray configuration strings (1-64).
+            strategy (str): 'leastPing' (lowest observatory delay) or 'random'.
+
+        Returns:
+            int: Number of nodes included; configs that fail to parse are skipped.
+
+        Raises:
+            ValueError: If config_strs is empty or too long, or strategy is unknown.
+            Exception: If no config could be parsed or the file cannot be written.
+        """
+        strategies = {'random': 0, 'leastPing': 1}
+        if strategy not in strategies:
+            raise ValueError(f"Unknown balancer strategy: {strategy}")
+        if not config_strs or len(config_strs) > 64:
+            raise ValueError("config_strs must hold 1 to 64 configuration strings")
+        encoded = (ctypes.c_char_p * len(config_strs))(*[c.encode('utf-8') for c in config_strs])
+        result = self.lib.parse_config_strings_balanced(encoded, len(config_strs), self.http_port,
+                                                        self.socks_port, strategies[strategy])
+        if result <= 0:
+            raise Exception(self._explain_error_code(result, "Failed to build balanced configuration"))
+        logger.info(f"Balanced configuration applied with {result} nodes ({strategy})")
+        return result
+
     def start(self):
         """
         Start the V2Ray proxy service.
@@ -512,6 +994,578 @@ class V2ROOT:
             if rlist:
                 sys.stdin.readline()
 
+    def pool_start(self, config_str, base_port=0):
+        """
+        Start a warm process pool serving config_str on the configured HTTP and SOCKS ports.
+
+        The pool relays the proxy ports to an internal V2Ray process, so the node can later be
+        changed with pool_prepare and pool_switch without dropping the listening ports.
+
+        Args:
+            config_str (str): V2Ray configuration string (e.g., VLESS, VMess).
+            base_port (int): First internal port used by pooled processes (0 to lease free ports).
+
+        Raises:
+            Exception: If the pool cannot be started.
+        """
+        result = self.lib.v2root_pool_start(config_str.encode('utf-8'), self.http_port, self.socks_port, base_port)
+        if result != 0:
+            raise Exception(self._explain_error_code(result, "Failed to start V2Ray pool"))
+        logger.info(f"V2Ray pool started (HTTP port: {self.http_port}, SOCKS port: {self.socks_port})")
+
+    def pool_prepare(self, config_str):
+        """
+        Start a standby V2Ray process for the next node and wait until it is ready.
+
+        Args:
+            config_str (str): V2Ray configuration string for the next node.
+
+        Raises:
+            Exception: If the standby process cannot be started.
+        """
+        result = self.lib.v2root_pool_prepare(config_str.encode('utf-8'))
+        if result != 0:
+            raise Exception(self._explain_error_code(result, "Failed to prepare standby V2Ray process"))
+
+    def pool_switch(self):
+        """
+        Switch the pool to the prepared standby node.
+
+        New connections use the standby at once; connections already open on the previous
+        node are allowed to finish before its process is stopped.
+
+        Raises:
+            Exception: If the pool is not running or has no standby.
+        """
+        result = self.lib.v2root_pool_switch()
+        if result != 0:
+            raise Exception(self._explain_error_code(result, "Failed to switch V2Ray pool"))
+
+    def pool_stop(self):
+        """
+        Stop the pool and every pooled V2Ray process.
+
+        Raises:
+            Exception: If the pool is not running.
+        """
+        result = self.lib.v2root_pool_stop()
+        if result != 0:
+            raise Exception(self._explain_error_code(result, "Failed to stop V2Ray pool"))
+
+    def pool_status(self):
+        """
+        Report the pool's process IDs.
+
+        Returns:
+            dict: 'running', 'active_pid' and 'standby_pid' (0 when there is no standby).
+        """
+        active = self._pid_type(0)
+        standby = self._pid_type(0)
+        running = self.lib.v2root_pool_status(ctypes.byref(active), ctypes.byref(standby))
+        return {'running': bool(running), 'active_pid': active.value, 'standby_pid': standby.value}
+
+    def monitor_start(self, probes_per_second=10, stale_seconds=60, threshold=0.5, mode='batch'):
+        """
+        Start the native background health monitor.
+
+        Configs registered with monitor_add or monitor_sync are re-probed only when their data
+        is older than stale_seconds, or sooner when their score is close to threshold, using
+        at most probes_per_second probes per second.
+
+        Args:
+            probes_per_second (int): Probe budget per second.
+            stale_seconds (float): Age after which a config is re-probed.
+            threshold (float): Selection score threshold (0.0-1.0).
+            mode (str): 'quick' (DNS + TCP), 'batch' (proxied request) or 'observatory'.
+
+        Raises:
+            ValueError: If mode is unknown.
+            Exception: If the monitor cannot be started.
+        """
+        if mode not in MONITOR_PROBE_MODES:
+            raise ValueError(f"Unknown monitor mode: {mode}")
+        result = self.lib.v2root_monitor_start(probes_per_second, int(stale_seconds * 1000), threshold,
+                                               MONITOR_PROBE_MODES[mode])
+        if result != 0:
+            raise Exception(self._explain_error_code(result, "Failed to start health monitor"))
+
+    def monitor_stop(self):
+        """Stop the health monitor; registered configs and their statistics are kept."""
+        self.lib.v2root_monitor_stop()
+
+    def monitor_add(self, config_str):
+        """
+        Register a config with the health monitor.
+
+        Returns:
+            int: The monitor handle of the config.
+
+        Raises:
+            Exception: If the config cannot be registered.
+        """
+        result = self.lib.v2root_monitor_add(config_str.encode('utf-8'))
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Failed to add config to health monitor"))
+        self._monitor_ids[config_str] = result
+        return result
+
+    def monitor_remove(self, config_str):
+        """Unregister a config from the health monitor."""
+        handle = self._monitor_ids.pop(config_str, None)
+        if handle is not None:
+            self.lib.v2root_monitor_remove(handle)
+
+    def monitor_sync(self, configs):
+        """
+        Make the monitored set match configs, keeping the history of configs already monitored.
+
+        Suitable as the on_update callback of Subscription.start_auto_update so every refresh
+        is re-scored.
+
+        Args:
+            configs (list): Configuration strings to monitor.
+        """
+        wanted = set(configs)
+        for config_str in [c for c in self._monitor_ids if c not in wanted]:
+            self.monitor_remove(config_str)
+        for config_str in wanted:
+            if config_str not in self._monitor_ids:
+                self.monitor_add(config_str)
+
+    def monitor_snapshot(self):
+        """
+        Read the monitor's current rankings without blocking the prober.
+
+        Returns:
+            list: One dict per monitored config, best score first, with the config string and
+            its ewma_ms, ewma_tcp_ms, jitter_ms, success_rate, score, samples, probes,
+            last_success and age_ms (-1 if not yet probed).
+        """
+        stats = (MonitorStat * MONITOR_MAX_CONFIGS)()
+        count = self.lib.v2root_monitor_snapshot(stats, MONITOR_MAX_CONFIGS)
+        configs_by_id = {handle: config_str for config_str, handle in self._monitor_ids.items()}
+        ranking = []
+        for stat in stats[:count]:
+            ranking.append({
+                'config': configs_by_id.get(stat.id),
+                'id': stat.id,
+                'ewma_ms': stat.ewma_ms,
+                'ewma_tcp_ms': stat.ewma_tcp_ms,
+                'jitter_ms': stat.jitter_ms,
+                'success_rate': stat.success_rate,
+                'score': stat.score,
+                'samples': stat.samples,
+                'probes': stat.probes,
+                'last_success': bool(stat.last_success),
+                'age_ms': stat.age_ms
+            })
+        return ranking
+
+    def failover_start(self, max_ttfb_ms=1500, max_error_rate=0.3, hysteresis=0.15, hold_seconds=30, on_event=None):
+        """
+        Serve the best monitored node on the configured ports and switch nodes automatically.
+
+        Requires a running health monitor (monitor_start) with registered configs. The best
+        healthy node runs in the warm pool with the next best kept as a ready standby; when the
+        active node's rolling latency or error rate crosses its threshold, traffic moves to the
+        standby without restarting V2Ray.
+
+        Args:
+            max_ttfb_ms (int): Rolling latency (ms) above which the active node is degraded.
+            max_error_rate (float): Rolling error rate (0.0-1.0) above which it is degraded.
+            hysteresis (float): Margin by which candidates must clear the thresholds and a
+                                better node must beat the active score before switching.
+            hold_seconds (float): Minimum time between switches not forced by degradation.
+            on_event (callable): Called from a native thread with a dict holding 'event'
+                                 ('started', 'standby', 'switched', 'degraded' or 'error'),
+                                 'from_config', 'to_config' and 'reason'.
+
+        Raises:
+            Exception: If the failover controller cannot be started.
+        """
+        def dispatch(event, from_id, to_id, reason):
+            if on_event is None:
+                return
+            configs_by_id = {handle: config_str for config_str, handle in self._monitor_ids.items()}
+            try:
+                on_event({
+                    'event': FAILOVER_EVENTS.get(event, str(event)),
+                    'from_config': configs_by_id.get(from_id),
+                    'to_config': configs_by_id.get(to_id),
+                    'reason': reason.decode('utf-8', errors='replace') if reason else ''
+                })
+            except Exception as e:
+                logger.error(f"Failover event handler failed: {str(e)}")
+
+        self._failover_callback = FailoverCallback(dispatch)
+        self.lib.v2root_failover_set_callback(self._failover_callback)
+        result = self.lib.v2root_failover_start(self.http_port, self.socks_port, max_ttfb_ms, max_error_rate,
+                                                hysteresis, int(hold_seconds * 1000))
+        if result != 0:
+            raise Exception(self._explain_error_code(result, "Failed to start failover"))
+        logger.info(f"Failover started (HTTP port: {self.http_port}, SOCKS port: {self.socks_port})")
+
+    def failover_stop(self):
+        """Stop automatic failover and the pool serving the proxy ports."""
+        self.lib.v2root_failover_stop()
+        self.lib.v2root_failover_set_callback(FailoverCallback())
+        self._failover_callback = None
+
+    def failover_active(self):
+        """
+        Get the node currently serving traffic under failover.
+
+        Returns:
+            str: The active configuration string, or None if no node is active.
+        """
+        handle = self.lib.v2root_failover_active()
+        if handle < 0:
+            return None
+        configs_by_id = {h: config_str for config_str, h in self._monitor_ids.items()}
+        return configs_by_id.get(handle)
+
+    def probe_many(self, configs, mode='quick'):
+        """
+        Probe many configurations in one native call.
+
+        Results come back as fixed-layout native records in one array, so no per-config
+        string is formatted or parsed.
+
+        Args:
+            configs (list): V2Ray configuration strings.
+            mode (str): 'quick' (DNS + TCP), 'batch' (proxied request through one V2Ray process
+                per chunk), 'observatory' (V2Ray observatory) or 'handshake' (direct VLESS or
+                Shadowsocks handshake without V2Ray; unsupported configs come back 'skipped').
+
+        Returns:
+            list: One dict per config, in order (see ProbeRecord.to_dict).
+
+        Raises:
+            ValueError: If mode is unknown.
+            Exception: If the native probe fails.
+        """
+        if mode not in PROBE_MODES:
+            raise ValueError(f"mode must be one of {sorted(PROBE_MODES)}")
+        if not configs:
+            return []
+        config_array = (ctypes.c_char_p * len(configs))(*[c.encode('utf-8') for c in configs])
+        records = (ProbeRecord * len(configs))()
+        result = self.lib.v2root_probe_records(config_array, len(configs), PROBE_MODES[mode],
+                                               records, ctypes.sizeof(ProbeRecord))
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Probe failed"))
+        return [record.to_dict() for record in records]
+
+    def probe_stream(self, configs, on_result, mode='quick'):
+        """
+        Probe many configurations, calling on_result as each group of probes completes.
+
+        Args:
+            configs (list): V2Ray configuration strings.
+            on_result (callable): Called as on_result(config_str, result_dict) on this thread.
+            mode (str): As for probe_many.
+
+        Returns:
+            int: Number of successful probes.
+
+        Raises:
+            ValueError: If mode is unknown.
+            Exception: If the native probe fails.
+        """
+        if mode not in PROBE_MODES:
+            raise ValueError(f"mode must be one of {sorted(PROBE_MODES)}")
+        if not configs:
+            return 0
+        config_array = (ctypes.c_char_p * len(configs))(*[c.encode('utf-8') for c in configs])
+
+        def dispatch(record_ptr, _user_data):
+            record = record_ptr.contents
+            try:
+                on_result(configs[record.index], record.to_dict())
+            except Exception as e:
+                logger.error(f"Probe stream callback failed: {e}")
+
+        callback = ProbeRecordCallback(dispatch)
+        result = self.lib.v2root_probe_stream(config_array, len(configs), PROBE_MODES[mode], callback, None)
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Probe failed"))
+        return result
+
+    def select_fastest(self, configs, k=10, mode='quick', factor=3.0, stop=True):
+        """
+        Find the k fastest configurations without waiting out every dead node.
+
+        Once k configs have answered, probes slower than factor times the median of the k
+        fastest are abandoned; with stop the sweep ends as soon as k configs have succeeded.
+
+        Args:
+            configs (list): V2Ray configuration strings.
+            k (int): Number of configurations wanted (1-64).
+            mode (str): 'quick' (DNS + TCP, ranked by connect time) or 'batch' (proxied
+                request, ranked by TTFB).
+            factor (float): Deadline as a multiple of the reference median.
+            stop (bool): Stop probing once k configurations have succeeded.
+
+        Returns:
+            list: Up to k (config_str, result_dict) tuples, fastest first.
+
+        Raises:
+            ValueError: If mode is not 'quick' or 'batch'.
+            Exception: If the native probe fails.
+        """
+        if mode not in ('quick', 'batch'):
+            raise ValueError("mode must be 'quick' or 'batch'")
+        if not configs:
+            return []
+        config_array = (ctypes.c_char_p * len(configs))(*[c.encode('utf-8') for c in configs])
+        records = (ProbeRecord * len(configs))()
+        result = self.lib.v2root_probe_select_records(config_array, len(configs), PROBE_MODES[mode], k, factor,
+                                                      1 if stop else 0, records, ctypes.sizeof(ProbeRecord))
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Selection probe failed"))
+        latency = 'tcp_ms' if mode == 'quick' else 'ttfb_ms'
+        found = [(configs[r.index], r.to_dict()) for r in records if r.success]
+        found.sort(key=lambda item: item[1][latency])
+        return found[:k]
+
+    def probe_pipeline(self, configs, on_result=None, tcp_keep=0.5, tls_keep=0.5):
+        """
+        Probe many configurations through cheap direct stages before starting V2Ray.
+
+        Every config gets a DNS + TCP check; the fastest tcp_keep fraction of those that
+        connect get a direct TLS/REALITY handshake with their server, and the fastest
+        tls_keep fraction of those get the full proxied probe. A config's result is ready
+        as soon as it drops out, and its 'stage' key tells how far it got ('tcp', 'tls' or
+        'ttfb'); only 'ttfb' results carry a full probe's timings and score.
+
+        Args:
+            configs (list): V2Ray configuration strings.
+            on_result (callable): Optional; called as on_result(config_str, result_dict) on
+                this thread as each config leaves the pipeline.
+            tcp_keep (float): Fraction of the TCP survivors passed on (0-1, 1 keeps all).
+            tls_keep (float): Fraction of the TLS survivors passed on (0-1, 1 keeps all).
+
+        Returns:
+            list: One dict per config, in order.
+
+        Raises:
+            Exception: If the native probe fails.
+        """
+        if not configs:
+            return []
+        config_array = (ctypes.c_char_p * len(configs))(*[c.encode('utf-8') for c in configs])
+        results = [None] * len(configs)
+
+        def dispatch(record_ptr, _user_data):
+            record = record_ptr.contents
+            results[record.index] = record.to_dict()
+            if on_result:
+                try:
+                    on_result(configs[record.index], results[record.index])
+                except Exception as e:
+                    logger.error(f"Probe pipeline callback failed: {e}")
+
+        callback = ProbeRecordCallback(dispatch)
+        result = self.lib.v2root_probe_pipeline(config_array, len(configs), tcp_keep, tls_keep, callback, None)
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Pipeline probe failed"))
+        return results
+
+    def set_port_range(self, first_port, last_port):
+        """
+        Set the loopback port range leased to temporary V2Ray instances.
+
+        Connection tests, probes and the warm pool take their inbound ports from this range,
+        so they never collide with each other or with the running proxy.
+
+        Args:
+            first_port (int): Lowest port of the range (1024-65535).
+            last_port (int): Highest port of the range.
+
+        Raises:
+            ValueError: If the range is invalid.
+        """
+        result = self.lib.v2root_ports_set_range(first_port, last_port)
+        if result != 0:
+            raise ValueError(f"Invalid port range {first_port}-{last_port}")
+
+    def metrics(self):
+        """
+        Return the native runtime metrics.
+
+        Returns:
+            dict: 'counters' maps each name in METRIC_COUNTERS to its value; 'histograms' maps
+                each name in METRIC_HISTOGRAMS to its count, sum_ms, p50_ms, p90_ms and p99_ms
+                (None while empty).
+        """
+        snapshot = MetricsSnapshot()
+        self.lib.v2root_metrics_snapshot(ctypes.byref(snapshot))
+        histograms = {}
+        for name, histogram in zip(METRIC_HISTOGRAMS, snapshot.histograms):
+            quantiles = {}
+            for label, q in (('p50_ms', 0.5), ('p90_ms', 0.9), ('p99_ms', 0.99)):
+                us = self.lib.v2root_metrics_quantile_us(ctypes.byref(histogram), q)
+                quantiles[label] = us / 1000.0 if us >= 0 else None
+            histograms[name] = dict(count=histogram.count, sum_ms=histogram.sum_us / 1000.0, **quantiles)
+        return {
+            'counters': dict(zip(METRIC_COUNTERS, snapshot.counters)),
+            'histograms': histograms
+        }
+
+    def metrics_text(self):
+        """
+        Return the native runtime metrics in the Prometheus text exposition format.
+
+        Returns:
+            str: The exposition text.
+        """
+        buffer = ctypes.create_string_buffer(65536)
+        length = self.lib.v2root_metrics_format(buffer, len(buffer))
+        if length < 0:
+            raise Exception("Failed to format metrics")
+        return buffer.raw[:length].decode('utf-8')
+
+    def serve_metrics(self, port):
+        """
+        Serve the Prometheus metrics on 127.0.0.1:port from a native background thread.
+
+        Args:
+            port (int): Loopback port to listen on.
+
+        Raises:
+            ValueError: If the port is invalid.
+            Exception: If the server is already running or cannot listen on the port.
+        """
+        result = self.lib.v2root_metrics_serve(port)
+        if result == -2:
+            raise ValueError(f"Invalid metrics port {port}")
+        if result == -7:
+            raise Exception("Metrics server is already running")
+        if result != 0:
+            raise Exception(f"Failed to listen on metrics port {port}")
+
+    def stop_metrics_server(self):
+        """Stop the Prometheus metrics server; returns False if it was not running."""
+        return self.lib.v2root_metrics_stop_server() == 0
+
+    def reset_metrics(self):
+        """Clear every native counter and histogram."""
+        self.lib.v2root_metrics_reset()
+
+    def cache_open(self, path, capacity=0):
+        """
+        Open the persistent probe cache, creating the file if needed.
+
+        While it is open, probe_many, probe_stream, select_fastest and the health monitor
+        record every outcome in it, and configs added to the monitor start with their cached
+        history, so latency knowledge survives restarts.
+
+        Args:
+            path (str): Path of the cache file.
+            capacity (int): Slots of a new file (0 for the default of 4096).
+
+        Raises:
+            Exception: If the file cannot be opened or mapped.
+        """
+        result = self.lib.v2root_cache_open(path.encode('utf-8'), capacity)
+        if result != 0:
+            raise Exception(f"Failed to open probe cache {path} (code {result})")
+
+    def cache_close(self):
+        """Write back and close the probe cache."""
+        self.lib.v2root_cache_close()
+
+    def cache_get(self, config_str):
+        """
+        Read the cached history of a config.
+
+        Returns:
+            dict: samples, successes, last_success, median_ms, success_rate, score and age_ms,
+            or None if the config is not cached.
+        """
+        stat = CacheStat()
+        if self.lib.v2root_cache_get(config_str.encode('utf-8'), ctypes.byref(stat)) != 0:
+            return None
+        return {
+            'samples': stat.samples,
+            'successes': stat.successes,
+            'last_success': bool(stat.last_success),
+            'median_ms': stat.median_ms,
+            'success_rate': stat.success_rate,
+            'score': stat.score,
+            'age_ms': stat.age_ms
+        }
+
+    def cache_best(self, configs, max_age_seconds=86400):
+        """
+        Pick the config with the best cached score whose latest cached probe succeeded.
+
+        Args:
+            configs (list): Candidate configuration strings.
+            max_age_seconds (float): Ignore configs last probed longer ago (0 for any age).
+
+        Returns:
+            str: The best config, or None if no candidate qualifies.
+        """
+        if not configs:
+            return None
+        config_array = (ctypes.c_char_p * len(configs))(*[c.encode('utf-8') for c in configs])
+        index = self.lib.v2root_cache_best(config_array, len(configs), int(max_age_seconds * 1000))
+        return configs[index] if index >= 0 else None
+
+    def warm_start(self, configs, cache_path=None, max_age_seconds=86400):
+        """
+        Start serving on the best cached node at once and re-probe in the background.
+
+        Opens cache_path if given, starts the proxy on cache_best(configs) and registers
+        every config with the health monitor, seeded from the cache; start the monitor with
+        monitor_start to have stale entries re-probed.
+
+        Args:
+            configs (list): Candidate configuration strings.
+            cache_path (str): Probe cache to open first, or None to use the one already open.
+            max_age_seconds (float): As for cache_best.
+
+        Returns:
+            str: The config now serving, or None if the cache knew no good node (nothing
+            is started; probe the list instead).
+        """
+        if cache_path:
+            self.cache_open(cache_path)
+        best = self.cache_best(configs, max_age_seconds)
+        if best is not None:
+            self.set_config_string(best)
+            self.start()
+        self.monitor_sync(configs)
+        return best
+
+    def create_context(self, http_port, socks_port):
+        """
+        Create an independent native context for concurrent testing.
+
+        Args:
+            http_port (int): HTTP proxy port used when the context runs V2Ray as a proxy.
+            socks_port (int): SOCKS proxy port used when the context runs V2Ray as a proxy.
+                Tests through the context lease their own ports.
+
+        Returns:
+            V2RootContext: The context; release it with close() or a with-block.
+
+        Raises:
+            Exception: If the context cannot be created or initialized.
+        """
+        handle = self.lib.v2root_ctx_new()
+        if not handle:
+            raise Exception("Failed to create V2ROOT context")
+        context = V2RootContext(self, handle, http_port, socks_port)
+        result = self.lib.v2root_ctx_init(handle, b'config.json', self.v2ray_path.encode('utf-8'))
+        if result == 0:
+            result = self.lib.v2root_ctx_set_ports(handle, http_port, socks_port)
+        if result != 0:
+            context.close()
+            raise Exception(self._explain_error_code(result, "Failed to initialize V2ROOT context"))
+        return context
+
     def test_connection(self, config_str):
         """
         Test connectivity and latency of a V2Ray configuration.
@@ -554,7 +1608,7 @@ class V2ROOT:
         else:
             
             latency = ctypes.c_int()
-            result = self.lib.test_config_connection(config_str.encode('utf-8'), ctypes.byref(latency), self.http_port, self.socks_port)
+            result = self.lib.test_config_connection(config_str.encode('utf-8'), ctypes.byref(latency), 0, 0)
             if result != 0:
                 raise Exception(self._explain_error_code(result, "Connection test failed"))
             print(f"{Fore.GREEN}Connection OK, Latency {latency.value}ms{Style.RESET_ALL}")
@@ -587,21 +1641,10 @@ class V2ROOT:
             raise Exception("V2Ray is not properly initialized.")
         
         
-        class ProbeResult(ctypes.Structure):
-            _fields_ = [
-                ("success", ctypes.c_int),
-                ("total_ms", ctypes.c_int),
-                ("dns_ms", ctypes.c_int),
-                ("tcp_ms", ctypes.c_int),
-                ("ttfb_ms", ctypes.c_int),
-                ("score", ctypes.c_double),
-                ("error_type", ctypes.c_char * 64)
-            ]
-        
-        result_ptr = ctypes.pointer(ProbeResult())
+        probe_result = ProbeResult()
         result = self.lib.probe_config_quick(
             config_str.encode('utf-8'),
-            ctypes.cast(result_ptr, ctypes.POINTER(ctypes.c_void_p)),
+            ctypes.byref(probe_result),
             self.http_port,
             self.socks_port
         )
@@ -617,12 +1660,11 @@ class V2ROOT:
                 'error_type': f"Error code: {result}. {error_msg}"
             }
         
-        probe_result = result_ptr.contents
         return {
             'success': bool(probe_result.success),
             'total_ms': probe_result.total_ms,
             'dns_ms': probe_result.dns_ms,
-            'tcp_ms': probe_result.tcp_ms,
+            'tcp_ms': probe_result.tcp_connect_ms,
             'error_type': probe_result.error_type.decode('utf-8') if not probe_result.success else None
         }
     
@@ -632,12 +1674,13 @@ class V2ROOT:
         [PRIVATE] Full probe (DNS + TCP + HTTP GET) for comprehensive testing.
         
         This internal method performs a complete end-to-end test similar to V2rayNG,
-        measuring DNS resolution time, TCP connection time, and Time to First Byte (TTFB)
-        via HTTP GET request.
+        measuring DNS resolution time, TCP connection time, V2Ray start-up, and the
+        proxied CONNECT, TLS and Time to First Byte (TTFB) phases of an HTTP GET request.
+        Phase times are medians over the completed attempts.
         
         Args:
             config_str (str): V2Ray configuration string to probe.
-            attempts (int): Number of probe attempts for reliability.
+            attempts (int): Number of proxied requests to sample (at most 16).
             
         Returns:
             dict: Probe results with success status, latency info, and quality score.
@@ -659,23 +1702,12 @@ class V2ROOT:
             raise Exception("V2Ray is not properly initialized.")
         
         
-        class ProbeResult(ctypes.Structure):
-            _fields_ = [
-                ("success", ctypes.c_int),
-                ("total_ms", ctypes.c_int),
-                ("dns_ms", ctypes.c_int),
-                ("tcp_ms", ctypes.c_int),
-                ("ttfb_ms", ctypes.c_int),
-                ("score", ctypes.c_double),
-                ("error_type", ctypes.c_char * 64)
-            ]
-        
-        result_ptr = ctypes.pointer(ProbeResult())
+        probe_result = ProbeResult()
         result = self.lib.probe_config_full(
             config_str.encode('utf-8'),
-            ctypes.cast(result_ptr, ctypes.POINTER(ctypes.c_void_p)),
-            self.http_port,
-            self.socks_port,
+            ctypes.byref(probe_result),
+            0,
+            0,
             attempts
         )
         
@@ -692,17 +1724,160 @@ class V2ROOT:
                 'error_type': f"Error code: {result}. {error_msg}"
             }
         
-        probe_result = result_ptr.contents
         return {
             'success': bool(probe_result.success),
             'total_ms': probe_result.total_ms,
             'dns_ms': probe_result.dns_ms,
-            'tcp_ms': probe_result.tcp_ms,
+            'tcp_ms': probe_result.tcp_connect_ms,
+            'v2ray_ready_ms': probe_result.v2ray_ready_ms,
+            'connect_ms': probe_result.transport_handshake_ms,
+            'tls_ms': probe_result.tls_handshake_ms,
+            'proxy_setup_ms': probe_result.proxy_setup_ms,
             'ttfb_ms': probe_result.ttfb_ms,
+            'ttfb_p90_ms': probe_result.ttfb_p90_ms,
+            'attempts': probe_result.attempts,
             'score': probe_result.score,
             'error_type': probe_result.error_type.decode('utf-8') if not probe_result.success else None
         }
 
+    @log_function_call
+    def probe_throughput(self, config_str, streams=4, size_bytes=25000000, budget_ms=10000):
+        """
+        Measure the download bandwidth of a configuration through a temporary V2Ray process.
+
+        Downloads a size_bytes object on several parallel streams until the measured rate
+        holds steady or budget_ms runs out. The score weights the bandwidth alongside TTFB
+        and TCP latency, so it is comparable only with other bandwidth probe scores.
+
+        Args:
+            config_str (str): V2Ray configuration string to probe.
+            streams (int): Parallel downloads (1-16).
+            size_bytes (int): Size of each download in bytes.
+            budget_ms (int): Longest measurement in milliseconds (at most 60000).
+
+        Returns:
+            dict: Probe results with throughput_mbps, stalls, latency info and score.
+
+        Raises:
+            TypeError: If config_str is not a string.
+            ValueError: If config_str is empty or a parameter is out of range.
+            Exception: If V2Ray is not properly initialized.
+        """
+        if not isinstance(config_str, str):
+            raise TypeError("config_str must be a string")
+        if not config_str.strip():
+            raise ValueError("config_str cannot be empty")
+        if not 1 <= streams <= 16:
+            raise ValueError("streams must be between 1 and 16")
+        if size_bytes < 1 or not 1 <= budget_ms <= 60000:
+            raise ValueError("size_bytes must be positive and budget_ms between 1 and 60000")
+        if not self.is_initialized:
+            raise Exception("V2Ray is not properly initialized.")
+
+        probe_result = ProbeResult()
+        result = self.lib.probe_config_throughput(config_str.encode('utf-8'), ctypes.byref(probe_result),
+                                                  0, 0, streams, size_bytes, budget_ms)
+        return {
+            'success': result == 0 and bool(probe_result.success),
+            'dns_ms': probe_result.dns_ms,
+            'tcp_ms': probe_result.tcp_connect_ms,
+            'v2ray_ready_ms': probe_result.v2ray_ready_ms,
+            'ttfb_ms': probe_result.ttfb_ms,
+            'total_ms': probe_result.total_ms,
+            'throughput_mbps': probe_result.throughput_mbps,
+            'stalls': probe_result.stalls,
+            'streams': probe_result.attempts,
+            'score': probe_result.score,
+            'error_type': probe_result.error_type.decode('utf-8') or None if result != 0 else None,
+            'error_details': probe_result.error_details.decode('utf-8', 'replace') or None if result != 0 else None
+        }
+
+    def shard_of(self, config_str, shards):
+        """
+        Get the shard a configuration belongs to in a sweep split across shards workers.
+
+        Returns:
+            int: The shard (0 to shards-1), or -1 if the config cannot be fingerprinted.
+        """
+        fingerprint = self.lib.v2root_config_fingerprint(config_str.encode('utf-8'))
+        return self.lib.v2root_shard_of(fingerprint, shards) if fingerprint else -1
+
+    def shard_worker(self, coordinator, port, configs, shard, shards, region, mode='batch'):
+        """
+        Probe this host's shard of a config table and stream the results to a coordinator.
+
+        Every worker and the coordinator load the same configs; each worker probes only the
+        configs whose fingerprint falls into its shard, and sends the records as each group
+        completes.
+
+        Args:
+            coordinator (str): Host name or address of the coordinator.
+            port (int): Port the coordinator listens on.
+            configs (list): The full config table.
+            shard (int): Shard of this worker (0 to shards-1).
+            shards (int): Number of workers in the sweep.
+            region (str): Region label the coordinator ranks this worker's results under.
+            mode (str): As for probe_many.
+
+        Returns:
+            int: Number of successful probes in the shard.
+
+        Raises:
+            ValueError: If mode is unknown or shard is out of range.
+            Exception: If the coordinator cannot be reached or the probe fails.
+        """
+        if mode not in PROBE_MODES:
+            raise ValueError(f"mode must be one of {sorted(PROBE_MODES)}")
+        if not 0 <= shard < shards:
+            raise ValueError("shard must be between 0 and shards - 1")
+        if not configs:
+            return 0
+        config_array = (ctypes.c_char_p * len(configs))(*[c.encode('utf-8') for c in configs])
+        result = self.lib.v2root_shard_worker(coordinator.encode('utf-8'), port, config_array, len(configs),
+                                              PROBE_MODES[mode], shard, shards, region.encode('utf-8'))
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Shard worker failed"))
+        return result
+
+    def shard_coordinate(self, port, configs, workers, timeout_ms=0, max_regions=8):
+        """
+        Collect a sharded sweep from its workers and rank the configs of every region.
+
+        Blocks until workers workers have finished or timeout_ms has passed. Workers whose
+        config table differs from configs are rejected.
+
+        Args:
+            port (int): Port to listen on, on every interface.
+            configs (list): The config table the workers were given.
+            workers (int): Number of workers to wait for.
+            timeout_ms (int): Longest the sweep may take (0 for one hour).
+            max_regions (int): Most regions to keep.
+
+        Returns:
+            dict: Region label to a list of (config_str, result_dict) tuples, best first.
+            Configs no worker of a region reported are left out of its list.
+
+        Raises:
+            Exception: If the port cannot be opened.
+        """
+        if not configs:
+            return {}
+        n = len(configs)
+        config_array = (ctypes.c_char_p * n)(*[c.encode('utf-8') for c in configs])
+        records = (ProbeRecord * (max_regions * n))()
+        regions = ctypes.create_string_buffer(max_regions * SHARD_REGION_LEN)
+        ranking = (ctypes.c_int * (max_regions * n))()
+        result = self.lib.v2root_shard_coordinate(port, config_array, n, workers, timeout_ms, records,
+                                                  ctypes.sizeof(ProbeRecord), regions, max_regions, ranking)
+        if result < 0:
+            raise Exception(self._explain_error_code(result, "Shard coordinator failed"))
+        rankings = {}
+        for r in range(result):
+            label = regions.raw[r * SHARD_REGION_LEN:(r + 1) * SHARD_REGION_LEN].split(b'\0', 1)[0].decode('utf-8', 'replace')
+            order = [i for i in ranking[r * n:(r + 1) * n] if i >= 0]
+            rankings[label] = [(configs[i], records[r * n + i].to_dict()) for i in order]
+        return rankings
+
     @log_function_call
     def _measure_ttfb(self, config_str, http_port=None):
         """
@@ -713,7 +1888,8 @@ class V2ROOT:
         
         Args:
             config_str (str): V2Ray configuration string (vless://, vmess://, etc.)
-            http_port (int, optional): HTTP proxy port. Defaults to self.http_port.
+            http_port (int, optional): HTTP proxy port of the test instance. Defaults to a
+                port leased from the native port allocator.
         
         Returns:
             dict: Comprehensive test results containing:
@@ -735,49 +1911,25 @@ class V2ROOT:
         if not self.is_initialized:
             raise Exception("V2Ray not initialized. Call set_config_string() first.")
             
-        port = http_port if http_port is not None else self.http_port
-        
-        
-        result_ptr = self.lib.measure_ttfb(config_str.encode('utf-8'), port)
-        
-        
-        if result_ptr is None or isinstance(result_ptr, int):
-            error_code = int(result_ptr) if isinstance(result_ptr, int) else -1
-            error_msg = self._explain_error_code(error_code, "TTFB measurement failed")
-            logger.error(f"TTFB test failed with error code {error_code}")
-            
-            
-            return {
-                'platform': 'windows' if platform.system() == 'Windows' else 'linux',
-                'success': False,
-                'ttfb_ms': None,
-                'http_status': None,
-                'error_message': f"Error code: {error_code}. {error_msg}"
-            }
-        
-        try:
-            
-            import json
-            json_str = ctypes.string_at(result_ptr).decode('utf-8')
-            result = json.loads(json_str)
-            
-            
-            if result['success']:
-                logger.info(f"TTFB test successful: {result['ttfb_ms']}ms, status: {result['http_status']}")
-            else:
-                logger.error(f"TTFB test failed: {result['error_message']}")
-            
-            return result
-        except Exception as e:
-            logger.exception(f"Failed to parse TTFB result: {e}")
-            
-            return {
-                'platform': 'windows' if platform.system() == 'Windows' else 'linux',
-                'success': False,
-                'ttfb_ms': None,
-                'http_status': None,
-                'error_message': f"Failed to parse result: {str(e)}"
-            }
+        port = http_port if http_port is not None else 0
+        record = ProbeRecord()
+        self.lib.v2root_measure_ttfb_record(config_str.encode('utf-8'), port, ctypes.byref(record), ctypes.sizeof(record))
+        result = self._ttfb_dict(record)
+        if result['success']:
+            logger.info(f"TTFB test successful: {result['ttfb_ms']}ms, status: {result['http_status']}")
+        else:
+            logger.error(f"TTFB test failed: {result['error_message']}")
+        return result
+
+    def _ttfb_dict(self, record):
+        """Convert a TTFB ProbeRecord into the dict returned by _measure_ttfb."""
+        return {
+            'platform': 'windows' if platform.system() == 'Windows' else 'linux',
+            'success': bool(record.success),
+            'ttfb_ms': record.ttfb_ms if record.success else None,
+            'http_status': record.http_status if record.success else None,
+            'error_message': None if record.success else record.error_details.decode('utf-8', 'replace')
+        }
 
     def _test_single_config(self, config, timeout=10):
         """